@@ -60,6 +60,7 @@
 #include <86box/pci.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/bench.h>
 #include <86box/device.h>
 #include <86box/pit.h>
 #include <86box/random.h>
@@ -120,6 +121,7 @@
 /* Stuff that used to be globally declared in plat.h but is now extern there
    and declared here instead. */
 int          dopause = 1;  /* system is paused */
+volatile int turbo_mode;   /* run unthrottled, see pc_run() */
 atomic_flag  doresize; /* screen resize requested */
 volatile int is_quit;  /* system exit requested */
 uint64_t     timer_freq;
@@ -657,6 +659,11 @@ pc_show_usage(char *s)
             "\n%sUsage: 86box [options] [cfg-file]\n\n"
             "Valid options are:\n\n"
             "-? or --help\t\t\t- show this information\n"
+#ifdef USE_SDL_UI
+            "-B or --benchmark secs[,path]\t- run headless and unthrottled for 'secs'\n"
+            "\t\t\t\t   emulated seconds, then write a JSON report\n"
+            "\t\t\t\t   to 'path' (or stdout) and exit\n"
+#endif
 #ifdef SHOW_EXTRA_PARAMS
             "-C or --config path\t\t- set 'path' to be config file\n"
 #endif
@@ -678,6 +685,8 @@ pc_show_usage(char *s)
 #ifdef USE_INSTRUMENT
             "-J or --instrument name\t- set 'name' to be the profiling instrument\n"
 #endif
+            "-K or --timerprof path\t\t- profile timer callbacks and write the\n"
+            "\t\t\t\t   report to 'path' (.csv or .json) on exit\n"
             "-L or --logfile path\t\t- set 'path' to be the logfile\n"
             "-M or --missing\t\t- dump missing machines and video cards\n"
             "-N or --noconfirm\t\t- do not ask for confirmation on quit\n"
@@ -691,6 +700,8 @@ pc_show_usage(char *s)
             "-T or --testmode\t\t- test mode: execute the test mode entry\n"
             "\t\t\t\t   point on init/hard reset\n"
 #endif
+            "-U or --overlay path\t\t- leave the hard disk images untouched and\n"
+            "\t\t\t\t   keep the writes in overlay files in 'path'\n"
             "-V or --vmname name\t\t- overrides the name of the running VM\n"
 #ifdef _WIN32
             "-W or --nohook\t\t- disables keyboard hook\n"
@@ -890,6 +901,29 @@ usage:
         } else if (!strcasecmp(argv[c], "--settings") || !strcasecmp(argv[c], "-S")) {
             settings_only = 1;
 #endif
+#ifdef USE_SDL_UI
+        } else if (!strcasecmp(argv[c], "--benchmark") || !strcasecmp(argv[c], "-B")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            const char *sep = strchr(argv[++c], ',');
+            if (sep != NULL)
+                snprintf(bench_path, sizeof(bench_path), "%s", sep + 1);
+            bench_seconds = atoi(argv[c]);
+            if (bench_seconds <= 0)
+                goto usage;
+#endif
+        } else if (!strcasecmp(argv[c], "--timerprof") || !strcasecmp(argv[c], "-K")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            timer_prof_enabled = 1;
+            snprintf(timer_prof_path, sizeof(timer_prof_path), "%s", argv[++c]);
+        } else if (!strcasecmp(argv[c], "--overlay") || !strcasecmp(argv[c], "-U")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            snprintf(hdd_overlay_path, sizeof(hdd_overlay_path), "%s", argv[++c]);
         } else if (!strcasecmp(argv[c], "--testmode") || !strcasecmp(argv[c], "-T")) {
             test_mode = 1;
         } else if (!strcasecmp(argv[c], "--noconfirm") || !strcasecmp(argv[c], "-N")) {
@@ -1784,6 +1818,19 @@ pc_close(UNUSED(thread_t *ptr))
     /* Close all the memory mappings. */
     mem_close();
 
+#ifdef USE_INSTRUMENT
+    if (instru_enabled) {
+        timer_dump_stats();
+#    if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+        if (cpu_use_dynarec)
+            codegen_dump_hot_blocks(32);
+#    endif
+    }
+#endif
+
+    if (timer_prof_enabled && timer_prof_path[0])
+        timer_prof_dump(timer_prof_path);
+
     /* Turn off timer processing to avoid potential segmentation faults. */
     timer_close();
 
@@ -1844,8 +1891,9 @@ ack_pause(void)
 void
 pc_run(void)
 {
-    int     mouse_msg_idx;
-    wchar_t temp[200];
+    static int turbo_active = 0;
+    int        mouse_msg_idx;
+    wchar_t    temp[200];
 
     /* Trigger a hard reset if one is pending. */
     if (hard_reset_pending) {
@@ -1854,6 +1902,23 @@ pc_run(void)
         pc_reset_hard_init();
     }
 
+    /* The monitor console can not reset the timer profiler itself, as
+       that would race with the callbacks being timed on this thread. */
+    if (timer_prof_reset_pending) {
+        timer_prof_reset_pending = 0;
+        timer_prof_reset();
+    }
+
+    /* In turbo mode the guest runs ahead of the host clock: the RTC and
+       PIT only ever advance on emulated time, so leaving it is the point
+       where a synchronized RTC has to catch up with the host again. */
+    if (turbo_mode != turbo_active) {
+        turbo_active = turbo_mode;
+        pclog("Turbo mode %s\n", turbo_active ? "enabled" : "disabled");
+        if (!turbo_active && (time_sync & TIME_SYNC_ENABLED))
+            nvr_time_sync();
+    }
+
     /* Update the guest-CPU independent timer for devices with independent clock speed */
     rivatimer_update_all();
 
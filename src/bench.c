@@ -0,0 +1,248 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Headless benchmark mode.
+ *
+ *          The configured machine is run unthrottled for a fixed amount
+ *          of emulated time, after which a JSON report is written with
+ *          the host time that took, the guest instructions executed,
+ *          the host time spent in each device's timer callbacks, how
+ *          busy each Voodoo render thread was and what the dynamic
+ *          recompiler cached.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#ifdef USE_DYNAREC
+#    include "codegen_public.h"
+#endif
+#include <86box/timer.h>
+#include <86box/machine.h>
+#include <86box/plat.h>
+#include <86box/video.h>
+#include <86box/bench.h>
+
+#define BENCH_DEVICES_MAX 256
+
+typedef struct bench_device_t {
+    const char *name;
+    uint64_t    calls;
+    uint64_t    ns;
+} bench_device_t;
+
+typedef struct bench_devices_t {
+    bench_device_t list[BENCH_DEVICES_MAX];
+    int            count;
+    uint64_t       ns;
+} bench_devices_t;
+
+int  bench_seconds = 0;
+char bench_path[1024];
+
+static uint64_t bench_start_ns;
+static uint64_t bench_start_ins;
+static uint64_t bench_ms;
+
+void
+bench_start(void)
+{
+    /* The timer profiler gives the per-device split of the host time. */
+    timer_prof_enabled = 1;
+    timer_prof_reset();
+
+    cpu_ins_count_enabled = 1;
+
+    voodoo_render_prof_reset();
+
+    bench_ms        = 0;
+    bench_start_ins = cpu_ins_count;
+    bench_start_ns  = plat_get_ns();
+}
+
+/* Account for one pc_run() frame, returns 1 once the run is complete. */
+int
+bench_frame(void)
+{
+    bench_ms += force_10ms ? 10 : 1;
+
+    return bench_ms >= ((uint64_t) bench_seconds * 1000);
+}
+
+/* Callbacks with no owning device found are lumped together. */
+static void
+bench_add_device(const char *name, uint64_t calls, uint64_t ns, void *priv)
+{
+    bench_devices_t *devices = (bench_devices_t *) priv;
+    int              i;
+
+    for (i = 0; i < devices->count; i++) {
+        if ((devices->list[i].name == name) || (name && devices->list[i].name && !strcmp(devices->list[i].name, name)))
+            break;
+    }
+
+    if (i == devices->count) {
+        if (devices->count == BENCH_DEVICES_MAX)
+            i--;
+        else {
+            devices->list[i].name = name;
+            devices->count++;
+        }
+    }
+
+    devices->list[i].calls += calls;
+    devices->list[i].ns += ns;
+    devices->ns += ns;
+}
+
+static int
+bench_device_compare(const void *a, const void *b)
+{
+    const bench_device_t *da = (const bench_device_t *) a;
+    const bench_device_t *db = (const bench_device_t *) b;
+
+    if (da->ns == db->ns)
+        return 0;
+
+    return (da->ns > db->ns) ? -1 : 1;
+}
+
+static void
+bench_write_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s; s++) {
+        if ((*s == '"') || (*s == '\\'))
+            fputc('\\', fp);
+        fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+typedef struct bench_render_t {
+    FILE *fp;
+    int   count;
+} bench_render_t;
+
+/* One entry per Voodoo card. The parallelism is how many of its render
+   threads were kept busy on average, so the best speedup over a single
+   thread the scanline split allows given a host core for each. */
+static void
+bench_write_render(int threads, const uint64_t *busy_ns, const int *pixels, void *priv)
+{
+    bench_render_t *render = (bench_render_t *) priv;
+    uint64_t        total  = 0;
+    uint64_t        max    = 0;
+
+    fprintf(render->fp, "%s\n    { \"threads\": %i, \"busy_ns\": [", render->count ? "," : "", threads);
+    for (int c = 0; c < threads; c++) {
+        fprintf(render->fp, "%s%" PRIu64, c ? ", " : " ", busy_ns[c]);
+        total += busy_ns[c];
+        max = MAX(max, busy_ns[c]);
+    }
+    fprintf(render->fp, " ], \"pixels\": [");
+    for (int c = 0; c < threads; c++)
+        fprintf(render->fp, "%s%u", c ? ", " : " ", (uint32_t) pixels[c]);
+    fprintf(render->fp, " ], \"parallelism\": %.2f }", max ? ((double) total / (double) max) : 0.0);
+
+    render->count++;
+}
+
+void
+bench_report(void)
+{
+    bench_devices_t *devices;
+    bench_render_t   render;
+    uint64_t         host_ns = plat_get_ns() - bench_start_ns;
+    uint64_t         ins     = cpu_ins_count - bench_start_ins;
+    double           host_s  = (double) host_ns / 1000000000.0;
+    double           emu_s   = (double) bench_ms / 1000.0;
+    FILE            *fp      = stdout;
+
+    devices = (bench_devices_t *) calloc(1, sizeof(bench_devices_t));
+    if (devices == NULL)
+        return;
+    timer_prof_foreach(bench_add_device, devices);
+    qsort(devices->list, devices->count, sizeof(bench_device_t), bench_device_compare);
+
+    if (bench_path[0] != '\0') {
+        fp = plat_fopen(bench_path, "w");
+        if (fp == NULL) {
+            pclog("Benchmark: unable to open %s for writing\n", bench_path);
+            free(devices);
+            return;
+        }
+    }
+
+    fprintf(fp, "{\n  \"config\": ");
+    bench_write_string(fp, cfg_path);
+    fprintf(fp, ",\n  \"machine\": ");
+    bench_write_string(fp, machine_get_internal_name());
+    fprintf(fp, ",\n  \"cpu\": ");
+    bench_write_string(fp, cpu_s->name);
+    fprintf(fp, ",\n  \"cpu_speed\": %u,\n  \"dynarec\": %s,\n", cpu_s->rspeed, cpu_use_dynarec ? "true" : "false");
+
+    fprintf(fp, "  \"emulated_seconds\": %.3f,\n  \"host_seconds\": %.3f,\n  \"speed\": %.3f,\n",
+            emu_s, host_s, (host_s > 0.0) ? (emu_s / host_s) : 0.0);
+    fprintf(fp, "  \"instructions\": %" PRIu64 ",\n  \"mips\": %.3f,\n  \"guest_mips\": %.3f,\n",
+            ins, (host_s > 0.0) ? (ins / host_s / 1000000.0) : 0.0, (emu_s > 0.0) ? (ins / emu_s / 1000000.0) : 0.0);
+
+    /* Whatever isn't spent in timer callbacks is CPU emulation and the frame loop. */
+    fprintf(fp, "  \"host_ns\": { \"total\": %" PRIu64 ", \"cpu\": %" PRIu64 ", \"timers\": %" PRIu64 " },\n",
+            host_ns, (host_ns > devices->ns) ? (host_ns - devices->ns) : 0, devices->ns);
+
+    fprintf(fp, "  \"devices\": [\n");
+    for (int i = 0; i < devices->count; i++) {
+        fprintf(fp, "    { \"device\": ");
+        if (devices->list[i].name != NULL)
+            bench_write_string(fp, devices->list[i].name);
+        else
+            fprintf(fp, "null");
+        fprintf(fp, ", \"timer_calls\": %" PRIu64 ", \"host_ns\": %" PRIu64 " }%s\n",
+                devices->list[i].calls, devices->list[i].ns, (i < (devices->count - 1)) ? "," : "");
+    }
+    fprintf(fp, "  ],\n");
+
+    fprintf(fp, "  \"voodoo_render\": [");
+    render.fp    = fp;
+    render.count = 0;
+    voodoo_render_prof_foreach(bench_write_render, &render);
+    fprintf(fp, "%s],\n", render.count ? "\n  " : " ");
+
+    fprintf(fp, "  \"dynarec_blocks\": ");
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    if (cpu_use_dynarec) {
+        int      blocks;
+        int      hot_blocks;
+        uint64_t executions;
+
+        codegen_block_stats(&blocks, &hot_blocks, &executions);
+        fprintf(fp, "{ \"cached\": %i, \"hot\": %i, \"executions\": %" PRIu64 ", \"hot_threshold\": %i }\n",
+                blocks, hot_blocks, executions, codegen_hot_threshold);
+    } else
+#endif
+        fprintf(fp, "null\n");
+    fprintf(fp, "}\n");
+
+    if (fp != stdout)
+        fclose(fp);
+    else
+        fflush(fp);
+
+    free(devices);
+}
@@ -35,9 +35,13 @@
 #include <86box/log.h>
 #include <86box/path.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
 #include <86box/cdrom.h>
 #include <86box/cdrom_image.h>
 #include <86box/cdrom_image_viso.h>
+#ifdef USE_CHD
+#include <86box/cdrom_image_chd.h>
+#endif
 
 #include <sndfile.h>
 
@@ -45,6 +49,15 @@
 #define MAX_FILENAME_LENGTH 256
 #define CROSS_LEN           512
 
+/*
+   The sector cache works on blocks of the track files rather than on
+   sectors, so that one host read serves many sectors of sequential reads.
+ */
+#define IMAGE_CACHE_BLOCK_SIZE 65536
+#define IMAGE_CACHE_BLOCKS     32
+#define IMAGE_CACHE_AHEAD      2
+#define IMAGE_CACHE_STREAMS    2
+
 static char temp_keyword[1024];
 
 #define INDEX_SPECIAL -2 /* Track A0h onwards. */
@@ -106,17 +119,65 @@ typedef struct
 
 #define dstruct_t mds_disc_struct_t
 
+typedef struct image_cache_block_t {
+    track_file_t *file; /* NULL if unused. */
+    uint64_t      block;
+    uint32_t      len;
+    uint32_t      last_use;
+    int           prefetched;
+    uint8_t      *data;
+} image_cache_block_t;
+
+typedef struct image_cache_file_t {
+    track_file_t *file;
+    uint64_t      length;
+} image_cache_file_t;
+
+typedef struct image_cache_stream_t {
+    track_file_t *file;
+    uint64_t      block;
+    uint32_t      last_use;
+} image_cache_stream_t;
+
+typedef struct image_cache_t {
+    /* Only one thread at a time may read from the track files. */
+    mutex_t             *file_mutex;
+    uint8_t             *fill_buffer;
+
+    mutex_t             *mutex;
+    image_cache_block_t  blocks[IMAGE_CACHE_BLOCKS];
+    uint8_t             *data;
+    uint32_t             clock;
+
+    image_cache_file_t  *files;
+    int                  files_num;
+
+    image_cache_stream_t streams[IMAGE_CACHE_STREAMS];
+
+    thread_t            *thread;
+    event_t             *wake_event;
+    int                  quit;
+    track_file_t        *ahead_file; /* NULL if there is nothing to read ahead. */
+    uint64_t             ahead_block;
+
+    uint64_t             hits;
+    uint64_t             misses;
+    uint64_t             prefetches;
+    uint64_t             prefetch_hits;
+} image_cache_t;
+
 typedef struct cd_image_t {
-    cdrom_t      *dev;
-    void         *log;
-    int           is_dvd;
-    int           has_audio;
-    int           has_dstruct;
-    int32_t       tracks_num;
-    uint32_t      bad_sectors_num;
-    track_t      *tracks;
-    uint32_t     *bad_sectors;
-    dstruct_t     dstruct;
+    cdrom_t       *dev;
+    void          *log;
+    int            is_dvd;
+    int            has_audio;
+    int            has_dstruct;
+    int32_t        tracks_num;
+    uint32_t       bad_sectors_num;
+    track_t       *tracks;
+    uint32_t      *bad_sectors;
+    dstruct_t      dstruct;
+    image_cache_t *cache;
 } cd_image_t;
 
 typedef enum
@@ -2292,6 +2353,470 @@ image_load_mds(cd_image_t *img, const char *mdsfile)
     return success;
 }
 
+#ifdef USE_CHD
+typedef struct chd_track_type_t {
+    const char *type;
+    uint8_t     attr;
+    uint8_t     mode;
+    uint8_t     form;
+    uint32_t    sector_size;
+} chd_track_type_t;
+
+static const chd_track_type_t chd_track_types[] = {
+  // clang-format off
+    { "MODE1",          DATA_TRACK,  1, 0, COOKED_SECTOR_SIZE },
+    { "MODE1/2048",     DATA_TRACK,  1, 0, COOKED_SECTOR_SIZE },
+    { "MODE1_RAW",      DATA_TRACK,  1, 0, RAW_SECTOR_SIZE    },
+    { "MODE1/2352",     DATA_TRACK,  1, 0, RAW_SECTOR_SIZE    },
+    { "MODE2",          DATA_TRACK,  2, 1, 2336               },
+    { "MODE2/2336",     DATA_TRACK,  2, 1, 2336               },
+    { "MODE2_FORM1",    DATA_TRACK,  2, 1, COOKED_SECTOR_SIZE },
+    { "MODE2/2048",     DATA_TRACK,  2, 1, COOKED_SECTOR_SIZE },
+    { "MODE2_FORM2",    DATA_TRACK,  2, 2, 2324               },
+    { "MODE2/2324",     DATA_TRACK,  2, 2, 2324               },
+    { "MODE2_FORM_MIX", DATA_TRACK,  2, 1, 2336               },
+    { "MODE2_RAW",      DATA_TRACK,  2, 1, RAW_SECTOR_SIZE    },
+    { "MODE2/2352",     DATA_TRACK,  2, 1, RAW_SECTOR_SIZE    },
+    { "CDI/2352",       DATA_TRACK,  2, 1, RAW_SECTOR_SIZE    },
+    { "AUDIO",          AUDIO_TRACK, 0, 0, RAW_SECTOR_SIZE    },
+    { NULL,             0,           0, 0, 0                  }
+  // clang-format on
+};
+
+static int
+image_load_chd(cd_image_t *img, const char *chdfile)
+{
+    const chd_track_type_t *tt;
+    chd_track_info_t        ti;
+    track_t                *ct;
+    track_index_t          *ci;
+    track_file_t           *tf;
+    void                   *chd;
+    int                     tracks  = 0;
+    int                     success = 1;
+
+    img->tracks     = NULL;
+    img->tracks_num = 0;
+
+    chd = chd_image_open(img->dev->id, chdfile, &tracks);
+    if (chd == NULL)
+        success = 0;
+
+    /*
+       Pass 1 - loading the track list from the CHD metadata.
+     */
+    image_log(img->log, "Pass 1 (loading the CHD track list)...\n");
+
+    for (int i = 0; i < 3; i++)
+        (void) image_insert_track(img, 1, 0xa0 + i);
+
+    for (int t = 1; success && (t <= tracks); t++) {
+        if (!chd_image_get_track_info(chd, t, &ti)) {
+            success = 0;
+            break;
+        }
+
+        for (tt = chd_track_types; tt->type != NULL; tt++) {
+            if (!strcmp(tt->type, ti.type))
+                break;
+        }
+        if (tt->type == NULL) {
+            image_log(img->log, "    [TRACK   ] Unsupported CHD track type \"%s\"\n", ti.type);
+            success = 0;
+            break;
+        }
+
+        ct       = image_insert_track(img, 1, t);
+        ct->attr = tt->attr;
+        ct->mode = tt->mode;
+        ct->form = tt->form;
+
+        /* Raw subchannel data is only used along with raw sectors. */
+        ct->sector_size = tt->sector_size;
+        if ((ct->sector_size == RAW_SECTOR_SIZE) && !strcmp(ti.subtype, "RW_RAW"))
+            ct->sector_size = 2448;
+        if ((ct->sector_size == 2336) && (ct->mode == 2) && (ct->form == 1))
+            ct->skip = 8;
+
+        image_set_track_subch_type(ct);
+
+        tf = chd_image_track_init(chd, t, ct->sector_size, ct->attr == AUDIO_TRACK);
+        if (tf == NULL) {
+            success = 0;
+            break;
+        }
+
+        for (int i = 0; i < 3; i++) {
+            ct->idx[i].type = INDEX_NONE;
+            ct->idx[i].file = tf;
+        }
+
+        ci             = &(ct->idx[1]);
+        ci->type       = INDEX_NORMAL;
+        ci->file_start = 0ULL;
+
+        if (ti.pregap > 0) {
+            if (ti.pregap_in_file) {
+                ct->idx[0].type       = INDEX_NORMAL;
+                ct->idx[0].file_start = 0ULL;
+                ci->file_start        = ti.pregap;
+            } else {
+                ct->idx[0].type   = INDEX_ZERO;
+                ct->idx[0].length = ti.pregap;
+            }
+        }
+
+        if (ti.postgap > 0) {
+            ct->idx[2].type   = INDEX_ZERO;
+            ct->idx[2].length = ti.postgap;
+        }
+
+        image_log(img->log, "    [TRACK   ] %02X/%02X, ATTR %02X, MODE %02X/%02X,\n",
+                  ct->session,
+                  ct->point,
+                  ct->attr,
+                  ct->mode, ct->form);
+        image_log(img->log, "               %i\n",
+                  ct->sector_size);
+    }
+
+    /* The track files keep the image open from here on. */
+    chd_image_release(chd);
+
+    if (success)
+        image_process(img);
+    else
+#ifdef ENABLE_IMAGE_LOG
+        log_warning(img->log, "    [CHD   ] Unable to open CHD image \"%s\"\n", chdfile);
+#else
+        warning("Unable to open CHD image \"%s\"\n", chdfile);
+#endif
+
+    return success;
+}
+#endif
+
+/* Sector cache functions. */
+static image_cache_block_t *
+image_cache_find(image_cache_t *cache, const track_file_t *file, const uint64_t block)
+{
+    for (int i = 0; i < IMAGE_CACHE_BLOCKS; i++) {
+        if ((cache->blocks[i].file == file) && (cache->blocks[i].block == block))
+            return &cache->blocks[i];
+    }
+
+    return NULL;
+}
+
+/* Put a freshly read block in the cache, in place of the least recently
+   used one. Must be called with the cache mutex held. */
+static image_cache_block_t *
+image_cache_insert(image_cache_t *cache, track_file_t *file, const uint64_t block,
+                   const uint8_t *data, const uint32_t len)
+{
+    image_cache_block_t *entry = image_cache_find(cache, file, block);
+
+    if (entry == NULL) {
+        entry = &cache->blocks[0];
+        for (int i = 1; i < IMAGE_CACHE_BLOCKS; i++) {
+            if ((cache->blocks[i].file == NULL) ||
+                ((entry->file != NULL) && (cache->blocks[i].last_use < entry->last_use)))
+                entry = &cache->blocks[i];
+        }
+
+        entry->file       = file;
+        entry->block      = block;
+        entry->len        = len;
+        entry->prefetched = 0;
+        memcpy(entry->data, data, len);
+    }
+
+    return entry;
+}
+
+static uint64_t
+image_cache_file_length(const image_cache_t *cache, const track_file_t *file)
+{
+    for (int i = 0; i < cache->files_num; i++) {
+        if (cache->files[i].file == file)
+            return cache->files[i].length;
+    }
+
+    return 0ULL;
+}
+
+/* Read a whole block into the fill buffer. Must be called with the file
+   mutex held. */
+static int
+image_cache_fill(image_cache_t *cache, track_file_t *file, const uint64_t block, uint32_t *len)
+{
+    const uint64_t length = image_cache_file_length(cache, file);
+    const uint64_t start  = block * IMAGE_CACHE_BLOCK_SIZE;
+
+    if (start >= length)
+        return 0;
+
+    *len = (uint32_t) MIN(length - start, IMAGE_CACHE_BLOCK_SIZE);
+
+    return file->read(file, cache->fill_buffer, start, *len);
+}
+
+static void
+image_cache_thread(void *priv)
+{
+    image_cache_t *cache = (image_cache_t *) priv;
+    track_file_t  *file;
+    uint64_t       block;
+    uint32_t       len;
+    int            cached;
+    int            ret;
+
+    while (1) {
+        thread_wait_event(cache->wake_event, -1);
+        thread_reset_event(cache->wake_event);
+
+        if (cache->quit)
+            break;
+
+        for (int i = 0; i < IMAGE_CACHE_AHEAD; i++) {
+            thread_wait_mutex(cache->mutex);
+            file   = cache->ahead_file;
+            block  = cache->ahead_block;
+            cached = (file != NULL) && (image_cache_find(cache, file, block) != NULL);
+            if ((file != NULL) && (i < (IMAGE_CACHE_AHEAD - 1)))
+                cache->ahead_block++;
+            else
+                cache->ahead_file = NULL;
+            thread_release_mutex(cache->mutex);
+
+            if (file == NULL)
+                break;
+            if (cached)
+                continue;
+
+            thread_wait_mutex(cache->file_mutex);
+            ret = image_cache_fill(cache, file, block, &len);
+            if (ret > 0) {
+                thread_wait_mutex(cache->mutex);
+                image_cache_block_t *entry = image_cache_insert(cache, file, block,
+                                                                cache->fill_buffer, len);
+                /* As recent as the block being read, so that older blocks go first. */
+                entry->last_use   = cache->clock;
+                entry->prefetched = 1;
+                cache->prefetches++;
+                thread_release_mutex(cache->mutex);
+            }
+            thread_release_mutex(cache->file_mutex);
+
+            if (ret <= 0)
+                break;
+        }
+    }
+}
+
+/*
+   Note a read of a block and queue the blocks after it for read-ahead
+   if the reads are sequential. Must be called with the cache mutex held,
+   returns 1 if the read-ahead thread has to be woken up.
+ */
+static int
+image_cache_track(image_cache_t *cache, track_file_t *file, const uint64_t block)
+{
+    image_cache_stream_t *stream = &cache->streams[0];
+    int                   sequential;
+
+    /*
+       The emulation and sound threads read at the same time when a game
+       plays CD audio while loading data, so keep track of more than one
+       stream of reads.
+     */
+    for (int i = 0; i < IMAGE_CACHE_STREAMS; i++) {
+        const image_cache_stream_t *cur = &cache->streams[i];
+
+        if ((cur->file == file) && ((cur->block == block) || ((cur->block + 1) == block))) {
+            stream = &cache->streams[i];
+            break;
+        }
+
+        if (cur->last_use < stream->last_use)
+            stream = &cache->streams[i];
+    }
+
+    sequential = (stream->file == file) && ((stream->block + 1) == block);
+
+    stream->file     = file;
+    stream->block    = block;
+    stream->last_use = cache->clock;
+
+    if (sequential && (cache->thread != NULL)) {
+        cache->ahead_file  = file;
+        cache->ahead_block = block + 1;
+    }
+
+    return sequential && (cache->thread != NULL);
+}
+
+static int
+image_cache_read(cd_image_t *img, track_file_t *file, uint8_t *buffer,
+                 uint64_t seek, size_t count)
+{
+    image_cache_t *cache = img->cache;
+    int            ret   = 1;
+
+    if ((cache == NULL) || file->no_cache)
+        return file->read(file, buffer, seek, count);
+
+    if ((seek + count) > image_cache_file_length(cache, file)) {
+        /* Let the file backend decide what reading past the end means. */
+        thread_wait_mutex(cache->file_mutex);
+        ret = file->read(file, buffer, seek, count);
+        thread_release_mutex(cache->file_mutex);
+
+        return ret;
+    }
+
+    while (count > 0) {
+        const uint64_t block  = seek / IMAGE_CACHE_BLOCK_SIZE;
+        const uint32_t offset = seek % IMAGE_CACHE_BLOCK_SIZE;
+        const uint32_t remain = MIN(count, IMAGE_CACHE_BLOCK_SIZE - offset);
+        uint32_t       len;
+        int            wake;
+
+        thread_wait_mutex(cache->mutex);
+        image_cache_block_t *entry = image_cache_find(cache, file, block);
+        if (entry == NULL) {
+            cache->misses++;
+            thread_release_mutex(cache->mutex);
+
+            thread_wait_mutex(cache->file_mutex);
+            ret = image_cache_fill(cache, file, block, &len);
+            if (ret <= 0) {
+                thread_release_mutex(cache->file_mutex);
+                image_log(img->log, "Read of cache block %" PRIu64 " failed\n", block);
+                break;
+            }
+
+            thread_wait_mutex(cache->mutex);
+            entry = image_cache_insert(cache, file, block, cache->fill_buffer, len);
+            thread_release_mutex(cache->file_mutex);
+        } else {
+            cache->hits++;
+            if (entry->prefetched) {
+                cache->prefetch_hits++;
+                entry->prefetched = 0;
+            }
+        }
+
+        entry->last_use = ++cache->clock;
+        memcpy(buffer, entry->data + offset, remain);
+
+        wake = image_cache_track(cache, file, block);
+        thread_release_mutex(cache->mutex);
+
+        if (wake)
+            thread_set_event(cache->wake_event);
+
+        buffer += remain;
+        seek += remain;
+        count -= remain;
+    }
+
+    return ret;
+}
+
+static void
+image_cache_add_file(image_cache_t *cache, track_file_t *file)
+{
+    for (int i = 0; i < cache->files_num; i++) {
+        if (cache->files[i].file == file)
+            return;
+    }
+
+    image_cache_file_t *files = (image_cache_file_t *) realloc(cache->files,
+                                                               (cache->files_num + 1) * sizeof(image_cache_file_t));
+
+    if (files != NULL) {
+        cache->files                          = files;
+        cache->files[cache->files_num].file   = file;
+        cache->files[cache->files_num].length = file->get_length(file);
+        cache->files_num++;
+    }
+}
+
+static void
+image_cache_close(cd_image_t *img)
+{
+    image_cache_t *cache = img->cache;
+
+    if (cache == NULL)
+        return;
+
+    if (cache->thread != NULL) {
+        cache->quit = 1;
+        thread_set_event(cache->wake_event);
+        thread_wait(cache->thread);
+    }
+
+    if (cache->wake_event != NULL)
+        thread_destroy_event(cache->wake_event);
+    if (cache->file_mutex != NULL)
+        thread_close_mutex(cache->file_mutex);
+    if (cache->mutex != NULL)
+        thread_close_mutex(cache->mutex);
+
+    free(cache->files);
+    free(cache->data);
+    free(cache);
+
+    img->cache = NULL;
+}
+
+static void
+image_cache_init(cd_image_t *img)
+{
+    image_cache_t *cache = (image_cache_t *) calloc(1, sizeof(image_cache_t));
+
+    if (cache == NULL)
+        return;
+
+    /* One extra block for the fill buffer. */
+    cache->data = (uint8_t *) malloc((IMAGE_CACHE_BLOCKS + 1) * IMAGE_CACHE_BLOCK_SIZE);
+    if (cache->data == NULL) {
+        free(cache);
+        return;
+    }
+
+    for (int i = 0; i < IMAGE_CACHE_BLOCKS; i++)
+        cache->blocks[i].data = cache->data + (i * IMAGE_CACHE_BLOCK_SIZE);
+    cache->fill_buffer = cache->data + (IMAGE_CACHE_BLOCKS * IMAGE_CACHE_BLOCK_SIZE);
+
+    for (int i = 0; i < img->tracks_num; i++) {
+        const track_t *cur = &img->tracks[i];
+
+        for (int j = 0; j <= cur->max_index; j++) {
+            const track_index_t *idx = &cur->idx[j];
+
+            if ((idx->type == INDEX_NORMAL) && (idx->file != NULL) && !idx->file->no_cache)
+                image_cache_add_file(cache, idx->file);
+        }
+    }
+
+    img->cache = cache;
+
+    if (cache->files_num == 0) {
+        image_cache_close(img);
+        return;
+    }
+
+    cache->mutex      = thread_create_mutex();
+    cache->file_mutex = thread_create_mutex();
+    cache->wake_event = thread_create_event();
+    cache->thread     = thread_create(image_cache_thread, cache);
+
+    image_log(img->log, "Sector cache: %i files, %i blocks of %i bytes\n",
+              cache->files_num, IMAGE_CACHE_BLOCKS, IMAGE_CACHE_BLOCK_SIZE);
+}
+
 /* Root functions. */
 static void
 image_clear_tracks(cd_image_t *img)
@@ -2478,7 +3003,7 @@ image_read_sector(const void *local, uint8_t *buffer,
 
             if (idx->type >= INDEX_NORMAL)
                 /* Read the data from the file. */
-                ret = idx->file->read(idx->file, buffer, seek, trk->sector_size);
+                ret = image_cache_read((cd_image_t *) img, idx->file, buffer, seek, trk->sector_size);
             else
                 /* Index is not in the file, no read to fail here. */
                 ret = 1;
@@ -2642,6 +3167,7 @@ image_close(void *local)
     cd_image_t *img = (cd_image_t *) local;
 
     if (img != NULL) {
+        image_cache_close(img);
         image_clear_tracks(img);
 
         image_log(img->log, "Log closed\n");
@@ -2672,6 +3198,41 @@ static const cdrom_ops_t image_ops = {
 };
 
 /* Public functions. */
+void
+cdrom_image_cache_stats_dump(void)
+{
+    int found = 0;
+
+    for (uint8_t i = 0; i < CDROM_NUM; i++) {
+        const cd_image_t    *img;
+        const image_cache_t *cache;
+
+        if ((cdrom[i].ops != &image_ops) || (cdrom[i].local == NULL))
+            continue;
+
+        img   = (const cd_image_t *) cdrom[i].local;
+        cache = img->cache;
+        found = 1;
+
+        if (cache == NULL) {
+            pclog("CD-ROM %i: Sector cache not in use\n", i + 1);
+            continue;
+        }
+
+        thread_wait_mutex(cache->mutex);
+        pclog("CD-ROM %i: %" PRIu64 " cache hits, %" PRIu64 " misses, %" PRIu64 " blocks read ahead, %"
+              PRIu64 " read ahead blocks used\n",
+              i + 1, cache->hits, cache->misses, cache->prefetches, cache->prefetch_hits);
+        if (cache->hits || cache->misses)
+            pclog("CD-ROM %i: %.1f%% hit rate\n", i + 1,
+                  (100.0 * (double) cache->hits) / (double) (cache->hits + cache->misses));
+        thread_release_mutex(cache->mutex);
+    }
+
+    if (!found)
+        pclog("CD-ROM: No CD-ROM images loaded\n");
+}
+
 void *
 image_open(cdrom_t *dev, const char *path)
 {
@@ -2682,6 +3243,9 @@ image_open(cdrom_t *dev, const char *path)
         int       ret;
         const int is_cue  = ((ext == 4) && !stricmp(path + strlen(path) - ext + 1, "CUE"));
         const int is_mds  = ((ext == 4) && !stricmp(path + strlen(path) - ext + 1, "MDS"));
+#ifdef USE_CHD
+        const int is_chd  = ((ext == 4) && !stricmp(path + strlen(path) - ext + 1, "CHD"));
+#endif
         char      n[1024] = { 0 };
 
         sprintf(n, "CD-ROM %i Image", dev->id + 1);
@@ -2696,6 +3260,16 @@ image_open(cdrom_t *dev, const char *path)
                 img->has_audio = 0;
             else if (ret)
                 img->has_audio = 1;
+#ifdef USE_CHD
+        } else if (is_chd) {
+            ret = image_load_chd(img, path);
+
+            if (ret)
+                img->has_audio = 1;
+
+            if (ret >= 1)
+                img->is_dvd = 2;
+#endif
         } else if (is_cue) {
             ret = image_load_cue(img, path);
 
@@ -2721,6 +3295,8 @@ image_open(cdrom_t *dev, const char *path)
                 img->is_dvd = (lb >= 524287);    /* Minimum 1 GB total capacity as threshold for DVD. */
             }
 
+            image_cache_init(img);
+
             dev->ops = &image_ops;
         } else {
             log_warning(img->log, "Unable to load CD-ROM image: %s\n", path);
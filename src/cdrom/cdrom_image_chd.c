@@ -0,0 +1,493 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          CHD (MAME compressed hunks of data) CD-ROM image back-end.
+ *
+ *          The image is decompressed a hunk at a time through libchdr.
+ *          Decompressed hunks are kept in a small LRU cache, and when
+ *          the guest reads sequentially, the hunks after the one being
+ *          read are decompressed ahead of time on a worker thread.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#ifdef ENABLE_IMAGE_CHD_LOG
+#include <stdarg.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <libchdr/chd.h>
+#include <86box/86box.h>
+#include <86box/cdrom.h>
+#include <86box/cdrom_image.h>
+#include <86box/cdrom_image_chd.h>
+#include <86box/log.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+
+/* Every CD frame takes 2352 bytes of sector data followed by 96 bytes of
+   subchannel data, and every track is padded to a multiple of 4 frames. */
+#define CHD_FRAME_SIZE    2448
+#define CHD_TRACK_PADDING 4
+
+#define CHD_CACHE_HUNKS 16
+#define CHD_READ_AHEAD  4
+
+/* The metadata formats from chd.h, with the string lengths bounded. */
+#define CHD_TRACK_FORMAT  "TRACK:%d TYPE:%31s SUBTYPE:%31s FRAMES:%d"
+#define CHD_TRACK2_FORMAT "TRACK:%d TYPE:%31s SUBTYPE:%31s FRAMES:%d PREGAP:%d PGTYPE:%31s PGSUB:%31s POSTGAP:%d"
+
+typedef struct chd_hunk_t {
+    uint32_t hunk; /* UINT32_MAX if unused. */
+    uint32_t last_use;
+    uint8_t *data;
+} chd_hunk_t;
+
+typedef struct chd_image_t {
+    chd_file *chd;
+    uint32_t  hunk_bytes;
+    uint32_t  total_hunks;
+    int       refs;
+    void     *log;
+
+    chd_track_info_t tracks[99];
+    int              tracks_num;
+
+    /* Only one thread at a time may decompress, libchdr is not reentrant. */
+    mutex_t *chd_mutex;
+    uint8_t *read_buffer;
+
+    mutex_t   *cache_mutex;
+    chd_hunk_t cache[CHD_CACHE_HUNKS];
+    uint32_t   clock;
+    uint32_t   last_hunk;
+
+    thread_t *thread;
+    event_t  *wake_event;
+    int       quit;
+    uint32_t  ahead_hunk; /* Next hunk to read ahead, UINT32_MAX if none. */
+    uint8_t  *ahead_buffer;
+} chd_image_t;
+
+/* A track file is a view of one track, laid out like a plain image file
+   with the track's own sector size. */
+typedef struct chd_track_file_t {
+    track_file_t tf;
+    chd_image_t *img;
+    uint64_t     first_frame;
+    uint32_t     frames;
+    uint32_t     sector_size;
+} chd_track_file_t;
+
+#ifdef ENABLE_IMAGE_CHD_LOG
+int image_chd_do_log = ENABLE_IMAGE_CHD_LOG;
+
+static void
+image_chd_log(void *priv, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (image_chd_do_log) {
+        va_start(ap, fmt);
+        log_out(priv, fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define image_chd_log(priv, fmt, ...)
+#endif
+
+static chd_hunk_t *
+chd_cache_find(chd_image_t *img, uint32_t hunk)
+{
+    for (int i = 0; i < CHD_CACHE_HUNKS; i++) {
+        if (img->cache[i].hunk == hunk)
+            return &img->cache[i];
+    }
+
+    return NULL;
+}
+
+/* Put a freshly decompressed hunk in the cache, in place of the least
+   recently used one. Must be called with the cache mutex held. */
+static chd_hunk_t *
+chd_cache_insert(chd_image_t *img, uint32_t hunk, const uint8_t *data)
+{
+    chd_hunk_t *entry = chd_cache_find(img, hunk);
+
+    if (entry == NULL) {
+        entry = &img->cache[0];
+        for (int i = 1; i < CHD_CACHE_HUNKS; i++) {
+            if ((img->cache[i].hunk == UINT32_MAX) ||
+                ((entry->hunk != UINT32_MAX) && (img->cache[i].last_use < entry->last_use)))
+                entry = &img->cache[i];
+        }
+
+        entry->hunk = hunk;
+        memcpy(entry->data, data, img->hunk_bytes);
+    }
+
+    return entry;
+}
+
+static void
+chd_read_ahead_thread(void *priv)
+{
+    chd_image_t *img = (chd_image_t *) priv;
+    uint32_t     hunk;
+    int          cached;
+
+    while (1) {
+        thread_wait_event(img->wake_event, -1);
+        thread_reset_event(img->wake_event);
+
+        if (img->quit)
+            break;
+
+        for (int i = 0; i < CHD_READ_AHEAD; i++) {
+            thread_wait_mutex(img->cache_mutex);
+            hunk            = img->ahead_hunk;
+            cached          = (hunk != UINT32_MAX) && (chd_cache_find(img, hunk) != NULL);
+            img->ahead_hunk = ((hunk != UINT32_MAX) && ((hunk + 1) < img->total_hunks) &&
+                               (i < (CHD_READ_AHEAD - 1))) ? (hunk + 1) : UINT32_MAX;
+            thread_release_mutex(img->cache_mutex);
+
+            if (hunk == UINT32_MAX)
+                break;
+            if (cached)
+                continue;
+
+            thread_wait_mutex(img->chd_mutex);
+            chd_error err = chd_read(img->chd, hunk, img->ahead_buffer);
+            thread_release_mutex(img->chd_mutex);
+
+            if (err != CHDERR_NONE) {
+                image_chd_log(img->log, "Read ahead of hunk %" PRIu32 " failed: %s\n", hunk, chd_error_string(err));
+                break;
+            }
+
+            thread_wait_mutex(img->cache_mutex);
+            /* As recent as the hunk being read, so that older hunks go first. */
+            chd_cache_insert(img, hunk, img->ahead_buffer)->last_use = img->clock;
+            thread_release_mutex(img->cache_mutex);
+        }
+    }
+}
+
+/* Copy part of a hunk out, decompressing it first if it is not cached. */
+static int
+chd_read_hunk(chd_image_t *img, uint32_t hunk, uint32_t offset, uint8_t *buffer, uint32_t count)
+{
+    chd_hunk_t *entry;
+    int         sequential;
+
+    thread_wait_mutex(img->cache_mutex);
+    entry = chd_cache_find(img, hunk);
+    if (entry == NULL) {
+        thread_release_mutex(img->cache_mutex);
+
+        /* read_buffer is shared by the sound and emulation threads, so
+           chd_mutex is held until the hunk has been copied into the cache.
+           The lock order is always chd_mutex before cache_mutex. */
+        thread_wait_mutex(img->chd_mutex);
+        chd_error err = chd_read(img->chd, hunk, img->read_buffer);
+
+        if (err != CHDERR_NONE) {
+            thread_release_mutex(img->chd_mutex);
+            image_chd_log(img->log, "Read of hunk %" PRIu32 " failed: %s\n", hunk, chd_error_string(err));
+            return 0;
+        }
+
+        thread_wait_mutex(img->cache_mutex);
+        entry = chd_cache_insert(img, hunk, img->read_buffer);
+        thread_release_mutex(img->chd_mutex);
+    }
+
+    entry->last_use = ++img->clock;
+    memcpy(buffer, entry->data + offset, count);
+
+    sequential = (hunk != img->last_hunk) && (hunk == (img->last_hunk + 1));
+    if (hunk != img->last_hunk)
+        img->last_hunk = hunk;
+    if (sequential && (img->thread != NULL) && ((hunk + 1) < img->total_hunks))
+        img->ahead_hunk = hunk + 1;
+    thread_release_mutex(img->cache_mutex);
+
+    if (sequential && (img->thread != NULL))
+        thread_set_event(img->wake_event);
+
+    return 1;
+}
+
+static int
+chd_track_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
+{
+    const chd_track_file_t *ctf    = (chd_track_file_t *) priv;
+    chd_image_t            *img    = ctf->img;
+    uint64_t                pos    = seek;
+    size_t                  remain = count;
+
+    while (remain > 0) {
+        const uint64_t sector = pos / ctf->sector_size;
+        const uint32_t within = (uint32_t) (pos % ctf->sector_size);
+        uint32_t       len    = ctf->sector_size - within;
+
+        if (sector >= ctf->frames)
+            return 0;
+
+        const uint64_t offset = ((ctf->first_frame + sector) * CHD_FRAME_SIZE) + within;
+        const uint32_t hunk   = (uint32_t) (offset / img->hunk_bytes);
+        const uint32_t in     = (uint32_t) (offset % img->hunk_bytes);
+
+        if (len > remain)
+            len = (uint32_t) remain;
+        /* Frames can straddle hunks when the hunk size is not a multiple
+           of the frame size. */
+        if (len > (img->hunk_bytes - in))
+            len = img->hunk_bytes - in;
+
+        if (!chd_read_hunk(img, hunk, in, buffer, len))
+            return 0;
+
+        buffer += len;
+        pos += len;
+        remain -= len;
+    }
+
+    /* CHD keeps audio big endian. */
+    if (ctf->tf.motorola) {
+        buffer -= count;
+        for (size_t i = 0; (i + 1) < count; i += 2) {
+            const uint8_t buffer0 = buffer[i];
+            buffer[i]             = buffer[i + 1];
+            buffer[i + 1]         = buffer0;
+        }
+    }
+
+    return 1;
+}
+
+static uint64_t
+chd_track_get_length(void *priv)
+{
+    const chd_track_file_t *ctf = (chd_track_file_t *) priv;
+
+    return (uint64_t) ctf->frames * ctf->sector_size;
+}
+
+static void
+chd_track_close(void *priv)
+{
+    chd_track_file_t *ctf = (chd_track_file_t *) priv;
+
+    if (ctf == NULL)
+        return;
+
+    chd_image_release(ctf->img);
+    free(ctf);
+}
+
+static int
+chd_image_read_tracks(chd_image_t *img)
+{
+    char             meta[256];
+    uint32_t         meta_len;
+    uint64_t         frame = 0;
+    chd_track_info_t *ti;
+    int              track;
+    int              frames;
+    int              pregap;
+    int              postgap;
+    char             pgtype[32];
+    char             pgsub[32];
+
+    for (uint32_t i = 0; i < 99; i++) {
+        ti = &img->tracks[i];
+        memset(meta, 0x00, sizeof(meta));
+        pregap = postgap = 0;
+        pgtype[0] = pgsub[0] = '\0';
+
+        if (chd_get_metadata(img->chd, CDROM_TRACK_METADATA2_TAG, i, meta, sizeof(meta) - 1,
+                             &meta_len, NULL, NULL) == CHDERR_NONE) {
+            if (sscanf(meta, CHD_TRACK2_FORMAT, &track, ti->type, ti->subtype, &frames,
+                       &pregap, pgtype, pgsub, &postgap) != 8)
+                return 0;
+        } else if (chd_get_metadata(img->chd, CDROM_TRACK_METADATA_TAG, i, meta, sizeof(meta) - 1,
+                                    &meta_len, NULL, NULL) == CHDERR_NONE) {
+            if (sscanf(meta, CHD_TRACK_FORMAT, &track, ti->type, ti->subtype, &frames) != 4)
+                return 0;
+        } else
+            break;
+
+        if ((track != (int) (i + 1)) || (frames <= 0))
+            return 0;
+
+        ti->frames         = frames;
+        ti->pregap         = pregap;
+        ti->postgap        = postgap;
+        /* A pre-gap type starting with V means its frames are in the image. */
+        ti->pregap_in_file = (pgtype[0] == 'V');
+        ti->first_frame    = frame;
+
+        image_chd_log(img->log, "Track %02i: %s/%s, %i frames from %" PRIu64 ", pre-gap %i%s, post-gap %i\n",
+                      track, ti->type, ti->subtype, frames, frame, pregap,
+                      ti->pregap_in_file ? " (in file)" : "", postgap);
+
+        frame += (frames + CHD_TRACK_PADDING - 1) & ~(CHD_TRACK_PADDING - 1);
+        img->tracks_num++;
+    }
+
+    return (img->tracks_num > 0) && ((frame * CHD_FRAME_SIZE) <= ((uint64_t) img->hunk_bytes * img->total_hunks));
+}
+
+void *
+chd_image_open(const uint8_t id, const char *filename, int *tracks)
+{
+    chd_image_t      *img = (chd_image_t *) calloc(1, sizeof(chd_image_t));
+    const chd_header *header;
+    chd_error         err;
+    char              n[1024] = { 0 };
+
+    *tracks = 0;
+
+    if (img == NULL)
+        return NULL;
+
+    sprintf(n, "CD-ROM %i CHD  ", id + 1);
+    img->log = log_open(n);
+
+    err = chd_open(filename, CHD_OPEN_READ, NULL, &img->chd);
+    if (err != CHDERR_NONE) {
+        image_chd_log(img->log, "Unable to open \"%s\": %s\n", filename, chd_error_string(err));
+        goto fail;
+    }
+
+    header           = chd_get_header(img->chd);
+    img->hunk_bytes  = header->hunkbytes;
+    img->total_hunks = header->totalhunks;
+    img->refs        = 1;
+
+    if ((img->hunk_bytes == 0) || !chd_image_read_tracks(img)) {
+        image_chd_log(img->log, "\"%s\" is not a CD image\n", filename);
+        goto fail;
+    }
+
+    img->read_buffer  = (uint8_t *) malloc(img->hunk_bytes);
+    img->ahead_buffer = (uint8_t *) malloc(img->hunk_bytes);
+    if ((img->read_buffer == NULL) || (img->ahead_buffer == NULL))
+        goto fail;
+    for (int i = 0; i < CHD_CACHE_HUNKS; i++) {
+        img->cache[i].hunk = UINT32_MAX;
+        img->cache[i].data = (uint8_t *) malloc(img->hunk_bytes);
+        if (img->cache[i].data == NULL)
+            goto fail;
+    }
+    img->last_hunk  = UINT32_MAX;
+    img->ahead_hunk = UINT32_MAX;
+
+    img->chd_mutex   = thread_create_mutex();
+    img->cache_mutex = thread_create_mutex();
+    img->wake_event  = thread_create_event();
+    img->thread      = thread_create(chd_read_ahead_thread, img);
+
+    image_chd_log(img->log, "Opened \"%s\": %i tracks, %" PRIu32 " hunks of %" PRIu32 " bytes\n",
+                  filename, img->tracks_num, img->total_hunks, img->hunk_bytes);
+
+    *tracks = img->tracks_num;
+    return img;
+
+fail:
+    img->refs = 1;
+    chd_image_release(img);
+    return NULL;
+}
+
+int
+chd_image_get_track_info(void *priv, int track, chd_track_info_t *ti)
+{
+    const chd_image_t *img = (chd_image_t *) priv;
+
+    if ((track < 1) || (track > img->tracks_num))
+        return 0;
+
+    *ti = img->tracks[track - 1];
+    return 1;
+}
+
+track_file_t *
+chd_image_track_init(void *priv, int track, uint32_t sector_size, int motorola)
+{
+    chd_image_t      *img = (chd_image_t *) priv;
+    chd_track_file_t *ctf;
+
+    if ((track < 1) || (track > img->tracks_num) || (sector_size > CHD_FRAME_SIZE))
+        return NULL;
+
+    ctf = (chd_track_file_t *) calloc(1, sizeof(chd_track_file_t));
+    if (ctf == NULL)
+        return NULL;
+
+    ctf->img         = img;
+    ctf->first_frame = img->tracks[track - 1].first_frame;
+    ctf->frames      = img->tracks[track - 1].frames;
+    ctf->sector_size = sector_size;
+
+    /* The track file is the first member, so the image code can treat
+       this as any other track file. */
+    ctf->tf.read       = chd_track_read;
+    ctf->tf.get_length = chd_track_get_length;
+    ctf->tf.close      = chd_track_close;
+    ctf->tf.motorola   = motorola;
+    ctf->tf.no_cache   = 1;
+    ctf->tf.priv       = img;
+
+    img->refs++;
+
+    return &ctf->tf;
+}
+
+void
+chd_image_release(void *priv)
+{
+    chd_image_t *img = (chd_image_t *) priv;
+
+    if ((img == NULL) || (--img->refs > 0))
+        return;
+
+    if (img->thread != NULL) {
+        img->quit = 1;
+        thread_set_event(img->wake_event);
+        thread_wait(img->thread);
+        img->thread = NULL;
+    }
+    if (img->wake_event != NULL)
+        thread_destroy_event(img->wake_event);
+    if (img->cache_mutex != NULL)
+        thread_close_mutex(img->cache_mutex);
+    if (img->chd_mutex != NULL)
+        thread_close_mutex(img->chd_mutex);
+
+    for (int i = 0; i < CHD_CACHE_HUNKS; i++)
+        free(img->cache[i].data);
+    free(img->read_buffer);
+    free(img->ahead_buffer);
+
+    if (img->chd != NULL)
+        chd_close(img->chd);
+
+    image_chd_log(img->log, "Closed\n");
+    log_close(img->log);
+
+    free(img);
+}
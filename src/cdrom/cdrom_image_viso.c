@@ -81,6 +81,9 @@ typedef struct stat stat_t;
 #define VISO_SECTOR_SIZE COOKED_SECTOR_SIZE
 #define VISO_OPEN_FILES  32
 
+#define VISO_INDEX_MAGIC   "86BOXVSI"
+#define VISO_INDEX_VERSION 1
+
 enum {
     VISO_CHARSET_D = 0,
     VISO_CHARSET_A,
@@ -121,20 +124,62 @@ typedef struct _viso_entry_ {
     char *basename, path[];
 } viso_entry_t;
 
+typedef struct {
+    viso_entry_t *entry;
+    uint32_t      last_use;
+} viso_open_file_t;
+
+/* A file's data, which runs until the start of the next extent. */
+typedef struct {
+    uint64_t      sector;
+    viso_entry_t *entry;
+} viso_extent_t;
+
 typedef struct {
     uint64_t vol_size_offsets[2];
     uint64_t pt_meta_offsets[2];
     int      format;
     uint8_t  use_version_suffix : 1;
-    size_t   metadata_sectors, all_sectors, entry_map_size, sector_size, file_fifo_pos;
-    uint8_t *metadata;
-
-    track_file_t   tf;
-    viso_entry_t  *root_dir;
-    viso_entry_t **entry_map;
-    viso_entry_t  *file_fifo[VISO_OPEN_FILES];
+    size_t   metadata_sectors, all_sectors, extents_num, sector_size;
+    uint8_t *metadata, *metadata_loaded;
+
+    /* Metadata is paged in from here on first access. */
+    FILE    *metadata_fp;
+    uint64_t metadata_base;
+
+    track_file_t     tf;
+    viso_entry_t    *root_dir;
+    viso_extent_t   *extents;
+    viso_open_file_t open_files[VISO_OPEN_FILES];
+    uint32_t         open_clock;
+    char             index_fn[1024];
 } viso_t;
 
+/*
+   The layout index is a header, a record for every directory (root first)
+   and file, and then the metadata sectors. It is only read back by the
+   same host, so everything is stored in host byte order.
+ */
+#pragma pack(push, 1)
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t sector_size;
+    uint64_t metadata_sectors;
+    uint64_t all_sectors;
+    uint32_t records_num;
+    int8_t   tz_offset;
+    char     emu_version[32];
+} viso_index_header_t;
+
+typedef struct {
+    uint8_t  is_dir;
+    uint16_t path_len;
+    uint64_t value; /* modification time for directories, data offset for files */
+    uint64_t size;
+} viso_index_record_t;
+#pragma pack(pop)
+
 static const char rr_eid[]   = "RRIP_1991A"; /* identifiers used in ER field for Rock Ridge */
 static const char rr_edesc[] = "THE ROCK RIDGE INTERCHANGE PROTOCOL PROVIDES SUPPORT FOR POSIX FILE SYSTEM SEMANTICS.";
 static int8_t     tz_offset  = 0;
@@ -680,6 +725,101 @@ viso_compare_entries(const void *a, const void *b)
     return strcmp((*((viso_entry_t **) a))->name_short, (*((viso_entry_t **) b))->name_short);
 }
 
+static viso_entry_t *
+viso_find_entry(const viso_t *viso, const uint64_t sector)
+{
+    size_t lo = 0;
+    size_t hi = viso->extents_num;
+
+    /* Find the last extent starting at or before this sector. */
+    while (lo < hi) {
+        const size_t mid = lo + ((hi - lo) >> 1);
+        if (viso->extents[mid].sector <= sector)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo ? viso->extents[lo - 1].entry : NULL;
+}
+
+static void
+viso_build_extents(viso_t *viso)
+{
+    viso_entry_t *entry;
+    size_t        num = 0;
+
+    for (entry = viso->root_dir->next; entry; entry = entry->next) {
+        if (!S_ISDIR(entry->stats.st_mode) && entry->stats.st_size)
+            num++;
+    }
+
+    viso->extents = (viso_extent_t *) calloc(num ? num : 1, sizeof(viso_extent_t));
+    if (viso->extents == NULL)
+        return;
+
+    /* Files are laid out in list order, so the extents come out sorted. */
+    for (entry = viso->root_dir->next; entry; entry = entry->next) {
+        if (!S_ISDIR(entry->stats.st_mode) && entry->stats.st_size) {
+            viso->extents[viso->extents_num].sector = entry->data_offset / viso->sector_size;
+            viso->extents[viso->extents_num].entry  = entry;
+            viso->extents_num++;
+        }
+    }
+}
+
+/* Get an entry's file handle, keeping at most VISO_OPEN_FILES files open. */
+static FILE *
+viso_get_file(viso_t *viso, viso_entry_t *entry)
+{
+    viso_open_file_t *slot = &viso->open_files[0];
+    stat_t            stats;
+
+    /* Find this entry's slot, or the least recently used one to replace. */
+    for (int i = 0; i < VISO_OPEN_FILES; i++) {
+        if (viso->open_files[i].entry == entry) {
+            slot = &viso->open_files[i];
+            break;
+        }
+        if (viso->open_files[i].last_use < slot->last_use)
+            slot = &viso->open_files[i];
+    }
+
+    if (slot->entry != entry) {
+        /* Close the file being replaced. */
+        if (slot->entry && slot->entry->file) {
+            image_viso_log(viso->tf.log, "Closing [%s]...\n", slot->entry->path);
+            fclose(slot->entry->file);
+            slot->entry->file = NULL;
+            image_viso_log(viso->tf.log, "Done\n");
+        }
+        slot->entry    = NULL;
+        slot->last_use = 0;
+
+        /* Open file. */
+        image_viso_log(viso->tf.log, "Opening [%s]...\n", entry->path);
+        if (!(entry->file = fopen(entry->path, "rb"))) {
+            image_viso_log(viso->tf.log, "Failed\n");
+            return NULL;
+        }
+        image_viso_log(viso->tf.log, "Done\n");
+        slot->entry = entry;
+
+        /* A file which changed size since the layout was made means the index
+           is stale; this is not picked up from the directory times alone. */
+        if (viso->index_fn[0] && (stat(entry->path, &stats) == 0) &&
+            (MIN((uint64_t) stats.st_size, (uint32_t) -1) != (uint64_t) entry->stats.st_size)) {
+            image_viso_log(viso->tf.log, "[%s] changed size, discarding layout index\n", entry->path);
+            remove(viso->index_fn);
+            viso->index_fn[0] = '\0';
+        }
+    }
+
+    slot->last_use = ++viso->open_clock;
+
+    return entry->file;
+}
+
 int
 viso_read(void *priv, uint8_t *buffer, uint64_t seek, size_t count)
 {
@@ -695,45 +835,29 @@ viso_read(void *priv, uint8_t *buffer, uint64_t seek, size_t count)
 
         /* Handle sector. */
         if (sector < viso->metadata_sectors) {
+            /* Page metadata in if this is the first access to this sector. */
+            if (!(viso->metadata_loaded[sector >> 3] & (1 << (sector & 7)))) {
+                if (viso_pread(viso->metadata + (sector * viso->sector_size),
+                               viso->metadata_base + (sector * viso->sector_size),
+                               viso->sector_size, 1, viso->metadata_fp) != 1)
+                    return -1;
+                viso->metadata_loaded[sector >> 3] |= 1 << (sector & 7);
+            }
+
             /* Copy metadata. */
             memcpy(buffer, viso->metadata + seek, sector_remain);
         } else {
             size_t read = 0;
 
             /* Get the file entry corresponding to this sector. */
-            viso_entry_t *entry = viso->entry_map[sector - viso->metadata_sectors];
+            viso_entry_t *entry = (sector < viso->all_sectors) ? viso_find_entry(viso, sector) : NULL;
             if (entry) {
-                /* Open file if it's not already open. */
-                if (!entry->file) {
-                    /* Close any existing FIFO entry's file. */
-                    viso_entry_t *other_entry = viso->file_fifo[viso->file_fifo_pos];
-                    if (other_entry && other_entry->file) {
-                        image_viso_log(viso->tf.log, "Closing [%s]...\n", other_entry->path);
-                        fclose(other_entry->file);
-                        other_entry->file = NULL;
-                        image_viso_log(viso->tf.log, "Done\n");
-                    }
-
-                    /* Open file. */
-                    image_viso_log(viso->tf.log, "Opening [%s]...\n", entry->path);
-                    if ((entry->file = fopen(entry->path, "rb"))) {
-                        image_viso_log(viso->tf.log, "Done\n");
-
-                        /* Add this entry to the FIFO. */
-                        viso->file_fifo[viso->file_fifo_pos++] = entry;
-                        viso->file_fifo_pos &= (sizeof(viso->file_fifo) / sizeof(viso->file_fifo[0])) - 1;
-                    } else {
-                        image_viso_log(viso->tf.log, "Failed\n");
-
-                        /* Clear any existing FIFO entry. */
-                        viso->file_fifo[viso->file_fifo_pos] = NULL;
-                    }
-                }
+                FILE *fp = viso_get_file(viso, entry);
 
                 /* Read data. */
-                if (!entry->file || (fseeko64(entry->file, seek - entry->data_offset, SEEK_SET) == -1))
+                if (!fp || (fseeko64(fp, seek - entry->data_offset, SEEK_SET) == -1))
                     return -1;
-                read = fread(buffer, 1, sector_remain, entry->file);
+                read = fread(buffer, 1, sector_remain, fp);
                 if (sector_remain && !read)
                     return -1;
             }
@@ -773,11 +897,14 @@ viso_close(void *priv)
     image_viso_log(viso->tf.log, "close()\n");
 
     /* De-allocate everything. */
-    if (tf->fp)
+    if (viso->metadata_fp && (viso->metadata_fp != tf->fp))
+        fclose(viso->metadata_fp);
+    if (tf->fp) {
         fclose(tf->fp);
 #ifndef ENABLE_IMAGE_VISO_LOG
-    remove(nvr_path(viso->tf.fn));
+        remove(nvr_path(viso->tf.fn));
 #endif
+    }
 
     viso_entry_t *entry = viso->root_dir;
     viso_entry_t *next_entry;
@@ -791,8 +918,10 @@ viso_close(void *priv)
 
     if (viso->metadata)
         free(viso->metadata);
-    if (viso->entry_map)
-        free(viso->entry_map);
+    if (viso->metadata_loaded)
+        free(viso->metadata_loaded);
+    if (viso->extents)
+        free(viso->extents);
 
     if (tf->log != NULL)
         log_close(tf->log);
@@ -800,6 +929,190 @@ viso_close(void *priv)
     free(viso);
 }
 
+static void
+viso_index_path(viso_t *viso, const char *dirname)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    char     fn[32];
+
+    /* The index is named after an FNV-1a hash of the directory path. */
+    for (const char *p = dirname; *p; p++)
+        hash = (hash ^ (uint8_t) *p) * 0x100000001b3ULL;
+
+    sprintf(fn, "viso_%016" PRIX64 ".idx", hash);
+    strncpy(viso->index_fn, nvr_path(fn), sizeof(viso->index_fn) - 1);
+}
+
+static void
+viso_index_fill_header(viso_index_header_t *hdr, const viso_t *viso, const uint32_t records_num)
+{
+    memset(hdr, 0x00, sizeof(viso_index_header_t));
+    memcpy(hdr->magic, VISO_INDEX_MAGIC, sizeof(hdr->magic));
+    hdr->version          = VISO_INDEX_VERSION;
+    hdr->sector_size      = viso->sector_size;
+    hdr->metadata_sectors = viso->metadata_sectors;
+    hdr->all_sectors      = viso->all_sectors;
+    hdr->records_num      = records_num;
+    hdr->tz_offset        = tz_offset;
+    strncpy(hdr->emu_version, EMU_VERSION, sizeof(hdr->emu_version) - 1);
+}
+
+/* Load the layout from the index, if all its directories are unchanged. */
+static int
+viso_index_load(viso_t *viso, const char *dirname)
+{
+    viso_index_header_t hdr;
+    viso_index_header_t cur;
+    viso_index_record_t rec;
+    viso_entry_t       *entry;
+    viso_entry_t       *last_entry = NULL;
+    stat_t              stats;
+    FILE               *fp;
+
+    if (!(fp = plat_fopen64(viso->index_fn, "rb")))
+        return 0;
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1)
+        goto fail;
+
+    /* Everything but the sizes has to match what this build would make. */
+    viso_index_fill_header(&cur, viso, hdr.records_num);
+    cur.metadata_sectors = hdr.metadata_sectors;
+    cur.all_sectors      = hdr.all_sectors;
+    if (memcmp(&hdr, &cur, sizeof(hdr)) || !hdr.records_num) {
+        image_viso_log(viso->tf.log, "Layout index is from a different version\n");
+        goto fail;
+    }
+
+    for (uint32_t i = 0; i < hdr.records_num; i++) {
+        if ((fread(&rec, sizeof(rec), 1, fp) != 1) || !rec.path_len || (!i && !rec.is_dir))
+            goto fail;
+
+        entry = (viso_entry_t *) calloc(1, sizeof(viso_entry_t) + rec.path_len + 1);
+        if (!entry)
+            goto fail;
+        if (fread(entry->path, rec.path_len, 1, fp) != 1) {
+            free(entry);
+            goto fail;
+        }
+
+        if (rec.is_dir) {
+            /* Any directory with entries added, removed or renamed has a new time. */
+            if ((!i && strcmp(entry->path, dirname)) || (stat(entry->path, &stats) != 0) || !S_ISDIR(stats.st_mode) ||
+                ((uint64_t) stats.st_mtime != rec.value)) {
+                image_viso_log(viso->tf.log, "[%s] changed since the layout index was made\n",
+                               entry->path);
+                free(entry);
+                goto fail;
+            }
+
+            /* Only the root directory is kept, as when building the layout. */
+            if (i) {
+                free(entry);
+                continue;
+            }
+            entry->stats   = stats;
+            entry->parent  = entry;
+            viso->root_dir = entry;
+        } else {
+            entry->basename      = path_get_filename(entry->path);
+            entry->stats.st_mode = S_IFREG;
+            entry->stats.st_size = rec.size;
+            entry->data_offset   = rec.value;
+            last_entry->next     = entry;
+        }
+        last_entry = entry;
+    }
+
+    viso->metadata_sectors = hdr.metadata_sectors;
+    viso->all_sectors      = hdr.all_sectors;
+    viso->metadata_fp      = fp;
+    viso->metadata_base    = ftello64(fp);
+
+    /* Make sure the metadata is all there. */
+    if ((fseeko64(fp, 0, SEEK_END) == -1) ||
+        (ftello64(fp) < (viso->metadata_base + (viso->metadata_sectors * viso->sector_size))))
+        goto fail;
+
+    image_viso_log(viso->tf.log, "Layout loaded from index\n");
+    return 1;
+
+fail:
+    entry = viso->root_dir;
+    while (entry) {
+        last_entry = entry->next;
+        free(entry);
+        entry = last_entry;
+    }
+    viso->root_dir    = NULL;
+    viso->metadata_fp = NULL;
+    fclose(fp);
+
+    return 0;
+}
+
+static int
+viso_index_add(FILE *fp, const viso_entry_t *entry, const int is_dir)
+{
+    viso_index_record_t rec;
+
+    rec.is_dir   = is_dir;
+    rec.path_len = strlen(entry->path);
+    rec.value    = is_dir ? (uint64_t) entry->stats.st_mtime : entry->data_offset;
+    rec.size     = is_dir ? 0 : entry->stats.st_size;
+
+    return (fwrite(&rec, sizeof(rec), 1, fp) == 1) &&
+           (fwrite(entry->path, rec.path_len, 1, fp) == 1);
+}
+
+static FILE *
+viso_index_create(viso_t *viso)
+{
+    viso_index_header_t hdr = { 0 };
+    char                temp_fn[sizeof(viso->index_fn) + 4];
+    FILE               *fp;
+
+    /* The header is written for real once the layout is done. */
+    sprintf(temp_fn, "%s.tmp", viso->index_fn);
+    if ((fp = plat_fopen64(temp_fn, "w+b")) && (fwrite(&hdr, sizeof(hdr), 1, fp) == 1) &&
+        viso_index_add(fp, viso->root_dir, 1))
+        return fp;
+
+    image_viso_log(viso->tf.log, "Could not create layout index\n");
+    if (fp) {
+        fclose(fp);
+        remove(temp_fn);
+    }
+    viso->index_fn[0] = '\0';
+
+    return NULL;
+}
+
+/* Append the metadata to a new index, then put it in place of the old one. */
+static void
+viso_index_finish(viso_t *viso, FILE *fp, const uint32_t records_num, int ret, uint8_t *data)
+{
+    viso_index_header_t hdr;
+    char                temp_fn[sizeof(viso->index_fn) + 4];
+
+    for (size_t i = 0; ret && (i < viso->metadata_sectors); i++)
+        ret = (viso_pread(data, i * viso->sector_size, viso->sector_size, 1, viso->tf.fp) == 1) &&
+              (fwrite(data, viso->sector_size, 1, fp) == 1);
+
+    viso_index_fill_header(&hdr, viso, records_num);
+    ret = ret && (viso_pwrite(&hdr, 0, sizeof(hdr), 1, fp) == 1);
+    ret = (fclose(fp) == 0) && ret;
+
+    sprintf(temp_fn, "%s.tmp", viso->index_fn);
+    if (ret)
+        remove(viso->index_fn);
+    if (!ret || rename(temp_fn, viso->index_fn)) {
+        image_viso_log(viso->tf.log, "Could not write layout index\n");
+        remove(temp_fn);
+        viso->index_fn[0] = '\0';
+    }
+}
+
 track_file_t *
 viso_init(const uint8_t id, const char *dirname, int *error)
 {
@@ -828,6 +1141,29 @@ viso_init(const uint8_t id, const char *dirname, int *error)
     if (!data)
         goto end;
 
+    /* Get current time for the volume descriptors, and calculate
+       the timezone offset for descriptors and file times to use. */
+    tzset();
+    time_t now = time(NULL);
+    struct tm now_tm;
+    if (viso->format & VISO_FORMAT_ISO) { /* timezones are ISO only */
+#ifdef _WIN32
+        gmtime_s(&now_tm, &now);  // Windows: output first param, input second
+#else
+        gmtime_r(&now, &now_tm);  // POSIX: input first param, output second
+#endif
+        tz_offset = (now - mktime(&now_tm)) / (3600 / 4);
+    }
+
+    /* Skip building the layout if the index has it. */
+    if (cdrom[id].viso_index) {
+        viso_index_path(viso, dirname);
+        if (viso_index_load(viso, dirname)) {
+            *error = 0;
+            goto end;
+        }
+    }
+
         /* Open temporary file. */
 #ifdef ENABLE_IMAGE_VISO_LOG
     strcpy(viso->tf.fn, "viso-debug.iso");
@@ -954,11 +1290,6 @@ viso_init(const uint8_t id, const char *dirname, int *error)
                     if (entry->stats.st_size > ((uint32_t) -1))
                         entry->stats.st_size = (uint32_t) -1;
 
-                    /* Increase entry map size. */
-                    viso->entry_map_size += entry->stats.st_size / viso->sector_size;
-                    if (entry->stats.st_size % viso->sector_size)
-                        viso->entry_map_size++; /* round up to the next sector */
-
                     /* Detect El Torito boot code file and set it accordingly. */
                     if (dir == eltorito_dir) {
                         if (!stricmp(readdir_entry->d_name, "Boot-NoEmul.img")) {
@@ -1042,20 +1373,6 @@ next_dir:
     for (int i = 0; i < 16; i++)
         fwrite(data, viso->sector_size, 1, viso->tf.fp);
 
-    /* Get current time for the volume descriptors, and calculate
-       the timezone offset for descriptors and file times to use. */
-    tzset();
-    time_t now = time(NULL);
-    struct tm now_tm;
-    if (viso->format & VISO_FORMAT_ISO) { /* timezones are ISO only */
-#ifdef _WIN32
-        gmtime_s(&now_tm, &now);  // Windows: output first param, input second
-#else
-        gmtime_r(&now, &now_tm);  // POSIX: input first param, output second
-#endif
-        tz_offset = (now - mktime(&now_tm)) / (3600 / 4);
-    }
-
     /* Get root directory basename for the volume ID. */
     const char *basename = path_get_filename(viso->root_dir->path);
     if (!basename || (basename[0] == '\0'))
@@ -1482,59 +1799,28 @@ next_entry:
         }
     }
 
-    /* Allocate entry map for sector->file lookups. */
-    size_t orig_sector_size = viso->sector_size;
-    while (1) {
-        image_viso_log(viso->tf.log, "Allocating entry map for %zu %zu-byte sectors\n",
-                       viso->entry_map_size, viso->sector_size);
-        viso->entry_map = (viso_entry_t **) calloc(viso->entry_map_size, sizeof(viso_entry_t *));
-        if (viso->entry_map) {
-            /* Successfully allocated. */
-            break;
-        } else {
-            /* Blank data buffer for padding if this is the first run. */
-            if (orig_sector_size == viso->sector_size)
-                memset(data, 0x00, orig_sector_size);
-
-            /* If we don't have enough memory, double the sector size. */
-            viso->sector_size *= 2;
-            if ((viso->sector_size < VISO_SECTOR_SIZE) || (viso->sector_size > (1 << 30))) /* give up if sectors become too large */
-                goto end;
-
-            /* Go through files, recalculating the entry map size. */
-            size_t orig_entry_map_size = viso->entry_map_size;
-            viso->entry_map_size       = 0;
-            entry                      = viso->root_dir;
-            while (entry) {
-                if (!S_ISDIR(entry->stats.st_mode)) {
-                    viso->entry_map_size += entry->stats.st_size / viso->sector_size;
-                    if (entry->stats.st_size % viso->sector_size)
-                        viso->entry_map_size++; /* round up to the next sector */
-                }
-                entry = entry->next;
-            }
-            if (viso->entry_map_size == orig_entry_map_size) /* give up if there was no change in map size */
-                goto end;
-
-            /* Pad metadata to the new size's next sector. */
-            while (ftello64(viso->tf.fp) % viso->sector_size)
-                fwrite(data, orig_sector_size, 1, viso->tf.fp);
-        }
-    }
-
     /* Start sector counts. */
     viso->metadata_sectors = ftello64(viso->tf.fp) / viso->sector_size;
     viso->all_sectors      = viso->metadata_sectors;
 
+    /* Start the layout index, which records directories as they go by. */
+    FILE    *index_fp      = viso->index_fn[0] ? viso_index_create(viso) : NULL;
+    uint32_t index_records = 1;
+    int      index_ok      = 1;
+
     /* Go through files, assigning sectors to them. */
     image_viso_log(viso->tf.log, "Assigning sectors to files:\n");
-    size_t        base_factor  = viso->sector_size / orig_sector_size;
-    viso_entry_t *prev_entry   = viso->root_dir;
-    viso_entry_t **entry_map_p = viso->entry_map;
-    entry                      = prev_entry->next;
+    viso_entry_t *prev_entry = viso->root_dir;
+    entry                    = prev_entry->next;
     while (entry) {
         /* Skip this entry if it corresponds to a directory. */
         if (S_ISDIR(entry->stats.st_mode)) {
+            /* Add actual directories (not . and ..) to the index. */
+            if (index_fp && entry->path[0]) {
+                index_ok = index_ok && viso_index_add(index_fp, entry, 1);
+                index_records++;
+            }
+
             /* Deallocate directory entries to save some memory. */
             prev_entry->next = entry->next;
             free(entry);
@@ -1556,11 +1842,11 @@ next_entry:
             } else { /* emulation */
                 AS_U16(data[0]) = cpu_to_le16(1);
             }
-            AS_U32(data[2]) = cpu_to_le32(viso->all_sectors * base_factor);
+            AS_U32(data[2]) = cpu_to_le32(viso->all_sectors);
             viso_pwrite(data, eltorito_offset, 6, 1, viso->tf.fp);
         } else {
             p = data;
-            VISO_LBE_32(p, viso->all_sectors * base_factor);
+            VISO_LBE_32(p, viso->all_sectors);
             for (int i = 0; i <= max_vd; i++)
                 viso_pwrite(data, entry->dr_offsets[i] + 2, 8, 1, viso->tf.fp);
         }
@@ -1577,8 +1863,11 @@ next_entry:
 
         /* Allocate sectors to this file. */
         viso->all_sectors += size;
-        while (size-- > 0)
-            *entry_map_p++ = entry;
+
+        if (index_fp) {
+            index_ok = index_ok && viso_index_add(index_fp, entry, 0);
+            index_records++;
+        }
 
         /* Move on to the next entry. */
         prev_entry = entry;
@@ -1591,29 +1880,31 @@ next_entry:
     for (int i = 0; i < (sizeof(viso->vol_size_offsets) / sizeof(viso->vol_size_offsets[0])); i++)
         viso_pwrite(data, viso->vol_size_offsets[i], 8, 1, viso->tf.fp);
 
-    /* Metadata processing is finished, read it back to memory. */
-    image_viso_log(viso->tf.log, "Reading back %zu %zu-byte sectors of metadata\n",
-                   viso->metadata_sectors, viso->sector_size);
-    viso->metadata = (uint8_t *) calloc(viso->metadata_sectors, viso->sector_size);
-    if (viso->metadata == NULL)
-        goto end;
-    fseeko64(viso->tf.fp, 0, SEEK_SET);
-    size_t metadata_size = viso->metadata_sectors * viso->sector_size;
-    size_t metadata_remain = metadata_size;
-    while (metadata_remain > 0)
-        metadata_remain -= fread(viso->metadata + (metadata_size - metadata_remain), 1, MIN(metadata_remain, viso->sector_size), viso->tf.fp);
-
-    /* We no longer need the temporary file; close and delete it. */
-    fclose(viso->tf.fp);
-    viso->tf.fp = NULL;
-#ifndef ENABLE_IMAGE_VISO_LOG
-    remove(nvr_path(viso->tf.fn));
-#endif
+    /* Metadata processing is finished, save it to the index if requested. */
+    if (index_fp)
+        viso_index_finish(viso, index_fp, index_records, index_ok, data);
+
+    /* The temporary file stays around, metadata is read from it on first access. */
+    viso->metadata_fp   = viso->tf.fp;
+    viso->metadata_base = 0;
 
     /* All good. */
     *error = 0;
 
 end:
+    if (!*error) {
+        /* Set up paging in metadata, and the extents for sector->file lookups. */
+        image_viso_log(viso->tf.log, "Mapping %zu %zu-byte sectors of metadata\n",
+                       viso->metadata_sectors, viso->sector_size);
+        viso->metadata        = (uint8_t *) calloc(viso->metadata_sectors, viso->sector_size);
+        viso->metadata_loaded = (uint8_t *) calloc((viso->metadata_sectors >> 3) + 1, 1);
+        viso_build_extents(viso);
+        if (!viso->metadata || !viso->metadata_loaded || !viso->extents)
+            *error = 1;
+    }
+    if (data)
+        free(data);
+
     /* Set the function pointers. */
     viso->tf.priv = viso;
     if (!*error) {
@@ -1627,8 +1918,6 @@ end:
     } else {
         if (viso != NULL) {
             image_viso_log(viso->tf.log, "Initialization failed\n");
-            if (data)
-                free(data);
             viso_close(&viso->tf);
         }
         return NULL;
@@ -30,6 +30,27 @@
   same page).
 */
 
+/*Maximum number of static exits per block that can be chained directly to another
+  block*/
+#define CODEBLOCK_CHAIN_SLOTS 4
+
+/*Chain slots are identified by the owning block number and the slot index*/
+#define CHAIN_ID(block_nr, slot) (((block_nr) << 2) | (slot))
+#define CHAIN_ID_BLOCK(id)       ((id) >> 2)
+#define CHAIN_ID_SLOT(id)        ((id) & 3)
+
+typedef struct codegen_chain_t {
+    /*Patchable jump in the host code, NULL if it has not been emitted*/
+    uint8_t *site;
+    /*Linear address of the exit destination*/
+    uint32_t pc;
+    /*Block the exit currently jumps to, BLOCK_INVALID if it goes through the
+      dispatcher*/
+    uint16_t target;
+    /*Next chain slot linked to the same target block*/
+    uint16_t next;
+} codegen_chain_t;
+
 typedef struct codeblock_t {
     uint32_t pc;
     uint32_t _cs;
@@ -57,6 +78,21 @@ typedef struct codeblock_t {
     /*First mem_block_t used by this block. Any subsequent mem_block_ts
       will be in the list starting at head_mem_block->next.*/
     struct mem_block_t *head_mem_block;
+
+    /*Number of times the compiled block has been entered from the
+      dispatcher.*/
+    uint32_t exec_count;
+
+    /*Static exits that may jump straight into another block in the same page,
+      without going through the dispatcher.*/
+    codegen_chain_t chain[CODEBLOCK_CHAIN_SLOTS];
+    uint8_t         chain_nr;
+    /*Head of the list of chain slots, in other blocks, that are linked to this
+      block*/
+    uint16_t chain_in;
+    /*Offset of the entry point used by chained jumps, past the host stack frame
+      setup*/
+    uint16_t chain_entry;
 } codeblock_t;
 
 extern codeblock_t *codeblock;
@@ -81,6 +117,9 @@ extern uint8_t *block_write_data;
 #define CODEBLOCK_IN_DIRTY_LIST 0x40
 /*Code block is not inlining immediate parameters, parameters must be fetched from memory*/
 #define CODEBLOCK_NO_IMMEDIATES 0x80
+/*Code block has crossed codegen_hot_threshold and is compiled with the hot block
+  optimisations*/
+#define CODEBLOCK_HOT 0x100
 
 #define BLOCK_PC_INVALID        0xffffffff
 
@@ -296,6 +335,16 @@ extern void codegen_block_remove(void);
 extern void codegen_block_start_recompile(codeblock_t *block);
 extern void codegen_block_end_recompile(codeblock_t *block);
 extern void codegen_block_end(void);
+extern void codegen_block_set_hot(codeblock_t *block);
+extern int  codegen_hot_threshold;
+
+extern uint32_t codegen_chain_request;
+extern int      codegen_chain_alloc(codeblock_t *block, uint32_t dest_pc);
+extern void     codegen_chain_link(codeblock_t *block);
+extern int      codegen_chain_check(uint32_t id);
+#if defined(__APPLE__) && defined(__aarch64__)
+extern int codegen_jit_writable;
+#endif
 extern void codegen_delete_block(codeblock_t *block);
 extern void codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_pc, uint32_t old_pc);
 extern void codegen_generate_seg_restore(void);
@@ -12,6 +12,8 @@
 void codegen_backend_init(void);
 void codegen_backend_prologue(codeblock_t *block);
 void codegen_backend_epilogue(codeblock_t *block);
+/*Point the chain jump at site to dest*/
+void codegen_backend_patch_jump(uint8_t *site, void *dest);
 
 struct ir_data_t;
 struct uop_t;
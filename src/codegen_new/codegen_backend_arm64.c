@@ -25,6 +25,9 @@
 #    if defined WIN32 || defined _WIN32 || defined _WIN32
 #        include <windows.h>
 #    endif
+#    if defined(__APPLE__) && defined(__aarch64__)
+#        include <pthread.h>
+#    endif
 #    include <string.h>
 
 void *codegen_mem_load_byte;
@@ -47,6 +50,11 @@ void *codegen_fp_round_quad;
 void *codegen_gpf_rout;
 void *codegen_exit_rout;
 
+#    if defined(__APPLE__) && defined(__aarch64__)
+/*Set while the dispatcher has lifted JIT write protection for recompilation*/
+int codegen_jit_writable = 0;
+#    endif
+
 host_reg_def_t codegen_host_reg_list[CODEGEN_HOST_REGS] = {
     { REG_X19, 0},
     { REG_X20, 0},
@@ -354,6 +362,8 @@ codegen_backend_prologue(codeblock_t *block)
     host_arm64_STP_PREIDX_X(block, REG_X21, REG_X22, REG_XSP, -16);
     host_arm64_STP_PREIDX_X(block, REG_X19, REG_X20, REG_XSP, -64);
 
+    /*Chained jumps from other blocks already have the stack frame set up*/
+    block->chain_entry = block_pos;
     host_arm64_MOVX_IMM(block, REG_CPUSTATE, (uint64_t) &cpu_state);
 
     if (block->flags & CODEBLOCK_HAS_FPU) {
@@ -377,4 +387,28 @@ codegen_backend_epilogue(codeblock_t *block)
     codegen_allocator_clean_blocks(block->head_mem_block);
 }
 
+void
+codegen_backend_patch_jump(uint8_t *site, void *dest)
+{
+    uint32_t *opcode = (uint32_t *) site;
+
+#    if defined(__APPLE__) && defined(__aarch64__)
+    if (!codegen_jit_writable && __builtin_available(macOS 11.0, *))
+        pthread_jit_write_protect_np(0);
+#    endif
+    /*site points at a B, emitted by codegen_JMP_CHAIN()*/
+    *opcode &= ~0x03ffffff;
+    host_arm64_branch_set_offset(opcode, dest);
+#    if defined(__APPLE__) && defined(__aarch64__)
+    if (!codegen_jit_writable && __builtin_available(macOS 11.0, *))
+        pthread_jit_write_protect_np(1);
+#    endif
+
+#    ifndef _MSC_VER
+    __clear_cache((char *) site, (char *) &site[4]);
+#    else
+    FlushInstructionCache(GetCurrentProcess(), site, 4);
+#    endif
+}
+
 #endif
@@ -814,6 +814,27 @@ codegen_JMP(codeblock_t *block, uop_t *uop)
     return 0;
 }
 
+static int
+codegen_JMP_CHAIN(codeblock_t *block, uop_t *uop)
+{
+    codegen_chain_t *chain = &block->chain[CHAIN_ID_SLOT(uop->imm_data)];
+
+    /*Loop unrolling can duplicate the exit, only the first copy is chained*/
+    if (chain->site) {
+        host_arm64_B(block, codegen_exit_rout);
+        return 0;
+    }
+
+    host_arm64_mov_imm(block, REG_ARG0, uop->imm_data);
+    host_arm64_call(block, (void *) codegen_chain_check);
+    host_arm64_CBNZ(block, REG_X0, (uintptr_t) codegen_exit_rout);
+    codegen_alloc(block, 4);
+    chain->site = &block_write_data[block_pos];
+    host_arm64_B(block, codegen_exit_rout);
+
+    return 0;
+}
+
 static int
 codegen_LOAD_FUNC_ARG0(codeblock_t *block, uop_t *uop)
 {
@@ -2923,6 +2944,9 @@ const uOpFn uop_handlers[UOP_MAX] = {
     [UOP_JMP &
         UOP_MASK]
     = codegen_JMP,
+    [UOP_JMP_CHAIN &
+        UOP_MASK]
+    = codegen_JMP_CHAIN,
 
     [UOP_LOAD_SEG &
         UOP_MASK]
@@ -365,6 +365,8 @@ codegen_backend_prologue(codeblock_t *block)
 #else
     host_x86_SUB64_REG_IMM(block, REG_RSP, 0x48);
 #endif
+    /*Chained jumps from other blocks already have the stack frame set up*/
+    block->chain_entry = block_pos;
     host_x86_MOV64_REG_IMM(block, REG_RBP, ((uintptr_t) &cpu_state) + 128);
     if (block->flags & CODEBLOCK_HAS_FPU) {
         host_x86_MOV32_REG_ABS(block, REG_EAX, &cpu_state.TOP);
@@ -395,4 +397,11 @@ codegen_backend_epilogue(codeblock_t *block)
     host_x86_POP(block, REG_RBX);
     host_x86_RET(block);
 }
+
+void
+codegen_backend_patch_jump(uint8_t *site, void *dest)
+{
+    /*site points at a JMP rel32, emitted by host_x86_JMP_long()*/
+    *(uint32_t *) &site[1] = (uintptr_t) dest - (uintptr_t) &site[5];
+}
 #endif
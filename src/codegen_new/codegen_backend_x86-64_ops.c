@@ -336,6 +336,18 @@ host_x86_JMP(codeblock_t *block, void *p)
     jmp(block, (uintptr_t) p);
 }
 
+uint8_t *
+host_x86_JMP_long(codeblock_t *block, void *p)
+{
+    uint8_t *site;
+
+    codegen_alloc_bytes(block, 5);
+    site = &block_write_data[block_pos];
+    codegen_addbyte(block, 0xe9); /*JMP*/
+    codegen_addlong(block, (uintptr_t) p - (uintptr_t) &block_write_data[block_pos + 4]);
+    return site;
+}
+
 void
 host_x86_JNZ(codeblock_t *block, void *p)
 {
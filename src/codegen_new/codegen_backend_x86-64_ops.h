@@ -26,6 +26,8 @@ void host_x86_CMP16_REG_REG(codeblock_t *block, int src_reg_a, int src_reg_b);
 void host_x86_CMP32_REG_REG(codeblock_t *block, int src_reg_a, int src_reg_b);
 
 void host_x86_JMP(codeblock_t *block, void *p);
+/*Always emits a 5 byte JMP rel32, returns a pointer to it for patching*/
+uint8_t *host_x86_JMP_long(codeblock_t *block, void *p);
 
 void host_x86_JNZ(codeblock_t *block, void *p);
 void host_x86_JZ(codeblock_t *block, void *p);
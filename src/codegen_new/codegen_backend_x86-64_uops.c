@@ -858,6 +858,30 @@ codegen_JMP(codeblock_t *block, uop_t *uop)
     return 0;
 }
 
+static int
+codegen_JMP_CHAIN(codeblock_t *block, uop_t *uop)
+{
+    codegen_chain_t *chain = &block->chain[CHAIN_ID_SLOT(uop->imm_data)];
+
+    /*Loop unrolling can duplicate the exit, only the first copy is chained*/
+    if (chain->site) {
+        host_x86_JMP(block, codegen_exit_rout);
+        return 0;
+    }
+
+#    if _WIN64
+    host_x86_MOV32_REG_IMM(block, REG_ECX, uop->imm_data);
+#    else
+    host_x86_MOV32_REG_IMM(block, REG_EDI, uop->imm_data);
+#    endif
+    host_x86_CALL(block, (void *) codegen_chain_check);
+    host_x86_TEST32_REG(block, REG_EAX, REG_EAX);
+    host_x86_JNZ(block, codegen_exit_rout);
+    chain->site = host_x86_JMP_long(block, codegen_exit_rout);
+
+    return 0;
+}
+
 static int
 codegen_LOAD_FUNC_ARG0(codeblock_t *block, uop_t *uop)
 {
@@ -2880,6 +2904,9 @@ const uOpFn uop_handlers[UOP_MAX] = {
     [UOP_JMP &
         UOP_MASK]
     = codegen_JMP,
+    [UOP_JMP_CHAIN &
+        UOP_MASK]
+    = codegen_JMP_CHAIN,
 
     [UOP_LOAD_SEG &
         UOP_MASK]
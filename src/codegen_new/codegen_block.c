@@ -45,6 +45,12 @@ int        block_pos;
 
 uint32_t codegen_endpc;
 
+int codegen_hot_threshold = 0;
+
+/*Chain slot that most recently left through the dispatcher because it was not
+  linked yet, or 0. See codegen_chain_link().*/
+uint32_t codegen_chain_request = 0;
+
 int        codegen_block_cycles;
 static int codegen_block_ins;
 static int codegen_block_full_ins;
@@ -60,6 +66,7 @@ uint32_t instr_counts[256 * 256];
 static uint16_t block_free_list;
 static void     delete_block(codeblock_t *block);
 static void     delete_dirty_block(codeblock_t *block);
+static void     codegen_chain_unlink(codeblock_t *block);
 
 /*Temporary list of code blocks that have recently been evicted. This allows for
   some historical state to be kept when a block is the target of self-modifying
@@ -379,6 +386,7 @@ invalidate_block(codeblock_t *block)
 #endif
     remove_from_block_list(block, old_pc);
     block_dirty_list_add(block);
+    codegen_chain_unlink(block);
     if (block->head_mem_block)
         codegen_allocator_free(block->head_mem_block);
     block->head_mem_block = NULL;
@@ -403,6 +411,7 @@ delete_block(codeblock_t *block)
         block_dirty_list_remove(block);
     else
         remove_from_block_list(block, old_pc);
+    codegen_chain_unlink(block);
     if (block->head_mem_block)
         codegen_allocator_free(block->head_mem_block);
     block->head_mem_block = NULL;
@@ -530,6 +539,9 @@ codegen_block_init(uint32_t phys_addr)
     block->page_mask = block->page_mask2 = 0;
     block->flags                         = CODEBLOCK_STATIC_TOP;
     block->status                        = cpu_cur_status;
+    block->exec_count                    = 0;
+    block->chain_nr                      = 0;
+    block->chain_in                      = BLOCK_INVALID;
 
     recomp_page = block->phys & ~0xfff;
     codeblock_tree_add(block);
@@ -559,6 +571,11 @@ codegen_block_start_recompile(codeblock_t *block)
         fatal("Recompile to used block!\n");
 #endif
 
+    /*Any existing code is being replaced, so nothing may jump into it or out
+      of it any more*/
+    codegen_chain_unlink(block);
+    block->chain_nr = 0;
+
     block->head_mem_block = codegen_allocator_allocate(NULL, block_current);
     block->data           = codeblock_allocator_get_ptr(block->head_mem_block);
 
@@ -779,6 +796,183 @@ codegen_block_end_recompile(codeblock_t *block)
     codegen_ir_compile(ir_data, block);
 }
 
+/*Throw away the compiled code for a block so that the next dispatch recompiles
+  it as a hot block. The block stays in its page lists, exactly as for a
+  FPU TOP mismatch.*/
+void
+codegen_block_set_hot(codeblock_t *block)
+{
+    codegen_chain_unlink(block);
+    if (block->head_mem_block)
+        codegen_allocator_free(block->head_mem_block);
+    block->head_mem_block = NULL;
+
+    block->flags &= ~CODEBLOCK_WAS_RECOMPILED;
+    block->flags |= CODEBLOCK_HOT;
+}
+
+/*Block chaining
+
+  A static exit (a conditional branch with a known destination) is compiled as a
+  call to codegen_chain_check() followed by a patchable jump, which initially
+  points at codegen_exit_rout. When the jump is taken while unlinked, the slot is
+  left in codegen_chain_request and the dispatcher links it to the destination
+  block the next time that block is entered, provided it lies in the same
+  physical page. From then on the exit jumps straight into the destination,
+  skipping the dispatcher entirely.
+
+  codegen_chain_check() makes sure the exit still goes back to the dispatcher
+  whenever it has something to do (interrupts, timers, end of timeslice) or
+  when the destination block has been dirtied by a write. Whenever the code for
+  a block is thrown away, all jumps into it are pointed back at
+  codegen_exit_rout and its own exits are removed from the blocks they were
+  linked to.*/
+int
+codegen_chain_alloc(codeblock_t *block, uint32_t dest_pc)
+{
+    if ((dest_pc ^ block->pc) & ~0xfff)
+        return 0;
+    if (block->chain_nr >= CODEBLOCK_CHAIN_SLOTS)
+        return 0;
+
+    block->chain[block->chain_nr].site   = NULL;
+    block->chain[block->chain_nr].pc     = dest_pc;
+    block->chain[block->chain_nr].target = BLOCK_INVALID;
+    block->chain[block->chain_nr].next   = 0;
+
+    return CHAIN_ID(get_block_nr(block), block->chain_nr++);
+}
+
+void
+codegen_chain_link(codeblock_t *block)
+{
+    uint32_t         id    = codegen_chain_request;
+    codeblock_t     *src   = &codeblock[CHAIN_ID_BLOCK(id)];
+    codegen_chain_t *chain = &src->chain[CHAIN_ID_SLOT(id)];
+
+    codegen_chain_request = 0;
+
+    /*Both blocks must still be compiled, and the request must not be stale*/
+    if (src->pc == BLOCK_PC_INVALID || (src->flags & (CODEBLOCK_IN_DIRTY_LIST | CODEBLOCK_WAS_RECOMPILED)) != CODEBLOCK_WAS_RECOMPILED)
+        return;
+    if (CHAIN_ID_SLOT(id) >= src->chain_nr || !chain->site || chain->target != BLOCK_INVALID || chain->pc != block->pc)
+        return;
+    if ((block->flags & (CODEBLOCK_IN_DIRTY_LIST | CODEBLOCK_WAS_RECOMPILED)) != CODEBLOCK_WAS_RECOMPILED)
+        return;
+
+    /*The destination must be entered exactly as the dispatcher would enter it.
+      Blocks spanning two pages and blocks depending on the FPU top-of-stack
+      are left to the dispatcher.*/
+    if (src->_cs != block->_cs || src->status != block->status || ((src->phys ^ block->phys) & ~0xfff))
+        return;
+    if (block->page_mask2 || (block->flags & CODEBLOCK_STATIC_TOP))
+        return;
+
+    chain->target   = get_block_nr(block);
+    chain->next     = block->chain_in;
+    block->chain_in = id;
+
+    codegen_backend_patch_jump(chain->site, &block->data[block->chain_entry]);
+}
+
+static void
+codegen_chain_unlink(codeblock_t *block)
+{
+    uint16_t id = block->chain_in;
+
+    /*Send every exit that jumps into this block back to the dispatcher*/
+    while (id) {
+        codegen_chain_t *chain = &codeblock[CHAIN_ID_BLOCK(id)].chain[CHAIN_ID_SLOT(id)];
+
+        id = chain->next;
+        codegen_backend_patch_jump(chain->site, codegen_exit_rout);
+        chain->target = BLOCK_INVALID;
+        chain->next   = 0;
+    }
+    block->chain_in = 0;
+
+    /*Remove this block's own exits from the blocks they are linked to. The
+      code containing them is about to be discarded, so it is not patched.*/
+    for (int c = 0; c < block->chain_nr; c++) {
+        codegen_chain_t *chain = &block->chain[c];
+
+        if (chain->target != BLOCK_INVALID) {
+            uint16_t  self = CHAIN_ID(get_block_nr(block), c);
+            uint16_t *link = &codeblock[chain->target].chain_in;
+
+            while (*link && *link != self)
+                link = &codeblock[CHAIN_ID_BLOCK(*link)].chain[CHAIN_ID_SLOT(*link)].next;
+            if (*link)
+                *link = chain->next;
+
+            chain->target = BLOCK_INVALID;
+            chain->next   = 0;
+        }
+        chain->site = NULL;
+    }
+    block->chain_nr = 0;
+}
+
+static int
+codegen_hot_block_compare(const void *a, const void *b)
+{
+    const codeblock_t *block_a = &codeblock[*(const int *) a];
+    const codeblock_t *block_b = &codeblock[*(const int *) b];
+
+    if (block_a->exec_count == block_b->exec_count)
+        return 0;
+
+    return (block_a->exec_count > block_b->exec_count) ? -1 : 1;
+}
+
+void
+codegen_dump_hot_blocks(int n)
+{
+    int *list;
+    int  count = 0;
+
+    list = malloc(BLOCK_SIZE * sizeof(int));
+    if (!list)
+        return;
+
+    for (int c = 1; c < BLOCK_SIZE; c++) {
+        if (codeblock[c].pc != BLOCK_PC_INVALID && codeblock[c].exec_count)
+            list[count++] = c;
+    }
+    qsort(list, count, sizeof(int), codegen_hot_block_compare);
+
+    pclog("Dynarec: %i blocks executed, hot threshold %i\n", count, codegen_hot_threshold);
+    for (int c = 0; c < count && c < n; c++) {
+        const codeblock_t *block = &codeblock[list[c]];
+
+        pclog("  %08X (CS %08X, phys %08X): %10u executions, %3u instructions%s\n",
+              block->pc, block->_cs, block->phys, block->exec_count, block->ins,
+              (block->flags & CODEBLOCK_HOT) ? ", hot" : "");
+    }
+
+    free(list);
+}
+
+void
+codegen_block_stats(int *blocks, int *hot_blocks, uint64_t *executions)
+{
+    *blocks     = 0;
+    *hot_blocks = 0;
+    *executions = 0;
+
+    for (int c = 1; c < BLOCK_SIZE; c++) {
+        const codeblock_t *block = &codeblock[c];
+
+        if (block->pc == BLOCK_PC_INVALID)
+            continue;
+
+        (*blocks)++;
+        if (block->flags & CODEBLOCK_HOT)
+            (*hot_blocks)++;
+        *executions += block->exec_count;
+    }
+}
+
 void
 codegen_flush(void)
 {
@@ -38,13 +38,21 @@ LOAD_IMMEDIATE_FROM_RAM_32_unaligned(UNUSED(codeblock_t *block), ir_data_t *ir,
 #define UNROLL_MAX_REG_REFERENCES 200
 #define UNROLL_MAX_UOPS           1000
 #define UNROLL_MAX_COUNT          10
+/*Limits used once a block has been promoted by codegen_hot_threshold. The uOP
+  budget is additionally capped so at least half of the IR buffer remains for
+  the rest of the block. Register references are bound by the 8-bit version
+  refcount, so are not raised.*/
+#define UNROLL_HOT_MAX_UOPS  2000
+#define UNROLL_HOT_MAX_COUNT 32
 int
 codegen_can_unroll_full(codeblock_t *block, ir_data_t *ir, UNUSED(uint32_t next_pc), uint32_t dest_addr)
 {
     int start;
     int max_unroll;
     int first_instruction;
-    int TOP = -1;
+    int max_uops  = UNROLL_MAX_UOPS;
+    int max_count = UNROLL_MAX_COUNT;
+    int TOP       = -1;
 
     /*Check that dest instruction was actually compiled into block*/
     start = codegen_get_instruction_uop(block, dest_addr, &first_instruction, &TOP);
@@ -63,11 +71,20 @@ codegen_can_unroll_full(codeblock_t *block, ir_data_t *ir, UNUSED(uint32_t next_
     if (TOP != cpu_state.TOP)
         return 0;
 
-    max_unroll = UNROLL_MAX_UOPS / ((ir->wr_pos - start) + 6);
+    if (block->flags & CODEBLOCK_HOT) {
+        max_uops  = UNROLL_HOT_MAX_UOPS;
+        max_count = UNROLL_HOT_MAX_COUNT;
+        if (max_uops > ((UOP_NR_MAX / 2) - ir->wr_pos))
+            max_uops = (UOP_NR_MAX / 2) - ir->wr_pos;
+        if (max_uops < UNROLL_MAX_UOPS)
+            max_uops = UNROLL_MAX_UOPS;
+    }
+
+    max_unroll = max_uops / ((ir->wr_pos - start) + 6);
     if ((max_version_refcount != 0) && (max_unroll > (UNROLL_MAX_REG_REFERENCES / max_version_refcount)))
         max_unroll = (UNROLL_MAX_REG_REFERENCES / max_version_refcount);
-    if (max_unroll > UNROLL_MAX_COUNT)
-        max_unroll = UNROLL_MAX_COUNT;
+    if (max_unroll > max_count)
+        max_unroll = max_count;
     if (max_unroll <= 1)
         return 0;
 
@@ -75,3 +92,17 @@ codegen_can_unroll_full(codeblock_t *block, ir_data_t *ir, UNUSED(uint32_t next_
 
     return 1;
 }
+
+/*Exit the block to a known destination. Exits within the block's own page get
+  a chain slot, so they can later be linked straight to the destination block.*/
+void
+codegen_exit_static(ir_data_t *ir, uint32_t dest_addr)
+{
+    int id = codegen_chain_alloc(ir->block, cs + dest_addr);
+
+    uop_MOV_IMM(ir, IREG_pc, dest_addr);
+    if (id)
+        uop_JMP_CHAIN(ir, id);
+    else
+        uop_JMP(ir, codegen_exit_rout);
+}
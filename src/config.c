@@ -38,6 +38,9 @@
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include "cpu.h"
+#ifdef USE_DYNAREC
+#    include "codegen_public.h"
+#endif
 #include <86box/device.h>
 #include <86box/timer.h>
 #include <86box/cassette.h>
@@ -477,6 +480,11 @@ load_machine(void)
         mem_size = machine_get_max_ram(machine);
 
     cpu_use_dynarec = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_hot_threshold = ini_section_get_int(cat, "dynarec_hot_threshold", 0);
+    if (codegen_hot_threshold < 0)
+        codegen_hot_threshold = 0;
+#endif
     fpu_softfloat = !!ini_section_get_int(cat, "fpu_softfloat", 0);
     if ((fpu_type != FPU_NONE) && machine_has_flags(machine, MACHINE_SOFTFLOAT_ONLY))
         fpu_softfloat = 1;
@@ -880,6 +888,14 @@ load_network(void)
                                              (NET_LINK_10_HD | NET_LINK_10_FD |
                                               NET_LINK_100_HD | NET_LINK_100_FD |
                                               NET_LINK_1000_HD | NET_LINK_1000_FD));
+
+        sprintf(temp, "net_%02i_queue_len", c + 1);
+        nc->queue_len = ini_section_get_int(cat, temp, 0);
+        if (nc->queue_len > NET_QUEUE_LEN_MAX)
+            nc->queue_len = NET_QUEUE_LEN_MAX;
+
+        sprintf(temp, "net_%02i_tap_offload", c + 1);
+        nc->tap_offload = !!ini_section_get_int(cat, temp, 0);
     }
 }
 
@@ -1258,6 +1274,9 @@ load_hard_disks(void)
         p                   = ini_section_get_string(cat, temp, tmp2);
         hdd[c].speed_preset = hdd_preset_get_from_internal_name(p);
 
+        sprintf(temp, "hdd_%02i_mmap", c + 1);
+        hdd[c].mmap = !!ini_section_get_int(cat, temp, 0);
+
         /* MFM/RLL */
         sprintf(temp, "hdd_%02i_mfm_channel", c + 1);
         if (hdd[c].bus_type == HDD_BUS_MFM)
@@ -1499,6 +1518,9 @@ load_floppy_and_cdrom_drives(void)
         sprintf(temp, "cdrom_%02i_no_check", c + 1);
         cdrom[c].no_check = ini_section_get_int(cat, temp, 0);
 
+        sprintf(temp, "cdrom_%02i_viso_index", c + 1);
+        cdrom[c].viso_index = !!ini_section_get_int(cat, temp, 0);
+
         sprintf(temp, "cdrom_%02i_type", c + 1);
         p = ini_section_get_string(cat, temp, cdrom[c].bus_type == CDROM_BUS_MKE ? "cr563" : "86cd");
         /* TODO: Configuration migration, remove when no longer needed. */
@@ -2599,6 +2621,13 @@ save_machine(void)
 
     ini_section_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    if (codegen_hot_threshold == 0)
+        ini_section_delete_var(cat, "dynarec_hot_threshold");
+    else
+        ini_section_set_int(cat, "dynarec_hot_threshold", codegen_hot_threshold);
+#endif
+
     if (fpu_softfloat == 0)
         ini_section_delete_var(cat, "fpu_softfloat");
     else
@@ -2924,6 +2953,18 @@ save_network(void)
         else
             ini_section_set_int(cat, temp, nc->link_state);
 
+        sprintf(temp, "net_%02i_queue_len", c + 1);
+        if (nc->queue_len == 0)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, nc->queue_len);
+
+        sprintf(temp, "net_%02i_tap_offload", c + 1);
+        if (nc->tap_offload == 0)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, nc->tap_offload);
+
         sprintf(temp, "net_%02i_switch_group", c + 1);
         if (nc->device_num == 0)
             ini_section_delete_var(cat, temp);
@@ -3404,6 +3445,12 @@ save_hard_disks(void)
             ini_section_delete_var(cat, temp);
         else
             ini_section_set_string(cat, temp, hdd_preset_get_internal_name(hdd[c].speed_preset));
+
+        sprintf(temp, "hdd_%02i_mmap", c + 1);
+        if (hdd_is_valid(c) && hdd[c].mmap)
+            ini_section_set_int(cat, temp, hdd[c].mmap);
+        else
+            ini_section_delete_var(cat, temp);
     }
 
     ini_delete_section_if_empty(config, cat);
@@ -3484,6 +3531,12 @@ save_floppy_and_cdrom_drives(void)
         else
             ini_section_delete_var(cat, temp);
 
+        sprintf(temp, "cdrom_%02i_viso_index", c + 1);
+        if (cdrom[c].viso_index)
+            ini_section_set_int(cat, temp, cdrom[c].viso_index);
+        else
+            ini_section_delete_var(cat, temp);
+
         sprintf(temp, "cdrom_%02i_speed", c + 1);
         if ((cdrom[c].bus_type == 0) || (cdrom[c].speed == 8))
             ini_section_delete_var(cat, temp);
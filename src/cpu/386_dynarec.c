@@ -270,6 +270,56 @@ update_tsc(void)
     }
 }
 
+#    ifdef USE_NEW_DYNAREC
+/* Called by a chainable block exit. Returns zero if the exit may jump
+   straight into the linked block, or non-zero if it has to go back
+   through the dispatcher, either because the slot is not linked yet or
+   because the dispatcher loop in exec386_dynarec() has work to do. */
+int
+codegen_chain_check(uint32_t id)
+{
+#        ifdef USE_GDBSTUB
+    /* The GDB stub has to see every block boundary. */
+    return 1;
+#        else
+    const codeblock_t *block = &codeblock[CHAIN_ID_BLOCK(id)];
+    uint16_t           target_nr = block->chain[CHAIN_ID_SLOT(id)].target;
+    codeblock_t       *target;
+    int                cycdiff;
+    uint64_t           delta;
+
+    if (target_nr == BLOCK_INVALID) {
+        codegen_chain_request = id;
+        return 1;
+    }
+    target = &codeblock[target_nr];
+
+    if ((cycles <= 0) || cpu_init || new_ne || smi_line || (nmi && nmi_enable && nmi_mask) ||
+        ((cpu_state.flags & I_FLAG) && pic.int_pending) || !CACHE_ON() || cpu_override_dynarec)
+        return 1;
+
+    /* Same checks as the dispatcher applies before entering a block. */
+    if ((target->_cs != cs) || ((target->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) ||
+        ((target->status & cpu_cur_status & CPU_STATUS_MASK) != (cpu_cur_status & CPU_STATUS_MASK)) ||
+        (target->page_mask & *target->dirty_mask))
+        return 1;
+
+    /* Leave if a timer is due, exactly as the dispatcher loop would. */
+    cycdiff = cycles_old - cycles;
+    delta   = tsc - tsc_old;
+    if (delta > 0)
+        cycdiff -= delta;
+    if ((cycdiff > 0) && TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) (tsc + cycdiff)))
+        return 1;
+
+    target->exec_count++;
+    if (cpu_ins_count_enabled)
+        cpu_ins_count += target->ins;
+    return 0;
+#        endif
+}
+#    endif
+
 static __inline void
 exec386_dynarec_int(void)
 {
@@ -314,6 +364,8 @@ exec386_dynarec_int(void)
             cpu_state.eflags &= ~(RF_FLAG);
 #    endif
             x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+            if (cpu_ins_count_enabled)
+                cpu_ins_count++;
         }
 
 #    ifndef USE_NEW_DYNAREC
@@ -495,6 +547,13 @@ exec386_dynarec_dyn(void)
             block->was_recompiled = 0;
 #    endif
         }
+#    ifdef USE_NEW_DYNAREC
+        if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED) && codegen_hot_threshold && !(block->flags & CODEBLOCK_HOT) && (block->exec_count >= (uint32_t) codegen_hot_threshold)) {
+            /* Block has been executed often enough to be worth compiling
+               again with the more aggressive hot block settings. */
+            codegen_block_set_hot(block);
+        }
+#    endif
     }
 
 #    ifdef USE_NEW_DYNAREC
@@ -505,8 +564,15 @@ exec386_dynarec_dyn(void)
     {
         void (*code)(void) = (void *) &block->data[BLOCK_START];
 
+        if (cpu_ins_count_enabled)
+            cpu_ins_count += block->ins;
+
 #    ifndef USE_NEW_DYNAREC
         codeblock_hash[hash] = block;
+#    else
+        block->exec_count++;
+        if (codegen_chain_request)
+            codegen_chain_link(block);
 #    endif
         inrecomp = 1;
         code();
@@ -534,6 +600,7 @@ exec386_dynarec_dyn(void)
         if (__builtin_available(macOS 11.0, *)) {
             pthread_jit_write_protect_np(0);
         }
+        codegen_jit_writable = 1;
 #    endif
         codegen_block_start_recompile(block);
         codegen_in_recompile = 1;
@@ -564,6 +631,8 @@ exec386_dynarec_dyn(void)
                 codegen_generate_call(opcode, x86_opcodes[(opcode | cpu_state.op32) & 0x3ff], fetchdat, cpu_state.pc, cpu_state.pc - 1);
 
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+                if (cpu_ins_count_enabled)
+                    cpu_ins_count++;
 
                 if (x86_was_reset)
                     break;
@@ -625,6 +694,7 @@ exec386_dynarec_dyn(void)
         if (__builtin_available(macOS 11.0, *)) {
             pthread_jit_write_protect_np(1);
         }
+        codegen_jit_writable = 0;
 #    endif
     } else if (!cpu_state.abrt) {
         /* Mark block but do not recompile */
@@ -666,6 +736,8 @@ exec386_dynarec_dyn(void)
                 cpu_state.pc++;
 
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+                if (cpu_ins_count_enabled)
+                    cpu_ins_count++;
 
                 if (x86_was_reset)
                     break;
@@ -937,6 +1009,8 @@ exec386(int32_t cycs)
                 cpu_state.eflags &= ~(RF_FLAG);
 #endif
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+                if (cpu_ins_count_enabled)
+                    cpu_ins_count++;
                 if (x86_was_reset)
                     break;
             }
@@ -3845,6 +3845,11 @@ execx86(int cycs)
         }
 exec_completed:
         if (completed) {
+            /* Prefixes and repeated string iterations are not instructions
+               of their own, count once they are done with. */
+            if (cpu_ins_count_enabled)
+                cpu_ins_count++;
+
             repeating  = 0;
             ovr_seg    = NULL;
             in_rep     = 0;
@@ -56,4 +56,15 @@ extern void codegen_flush(void);
 extern uint32_t recomp_page;
 extern int      codegen_in_recompile;
 
+#ifdef USE_NEW_DYNAREC
+/*Number of executions after which a compiled block is recompiled with the hot
+  block optimisations. 0 disables the second tier.*/
+extern int  codegen_hot_threshold;
+/*Log the n most executed code blocks*/
+extern void codegen_dump_hot_blocks(int n);
+/*Count the compiled blocks currently cached, the hot ones among them and how
+  often they were executed*/
+extern void codegen_block_stats(int *blocks, int *hot_blocks, uint64_t *executions);
+#endif
+
 #endif
@@ -257,7 +257,9 @@ uint32_t cache_index = 0;
 uint8_t  _cache[2048];
 
 uint64_t cpu_CR4_mask;
-uint64_t tsc = 0;
+uint64_t tsc           = 0;
+uint64_t cpu_ins_count = 0;
+int      cpu_ins_count_enabled = 0;
 
 double cpu_dmulti;
 double cpu_busspeed;
@@ -559,6 +559,8 @@ extern uint32_t cpu_cur_status;
 #endif
 extern uint64_t cpu_CR4_mask;
 extern uint64_t tsc;
+extern uint64_t cpu_ins_count; /* guest instructions executed, dynarec blocks count as a whole */
+extern int      cpu_ins_count_enabled; /* only set while benchmarking, cpu_ins_count stays put otherwise */
 extern msr_t    msr;
 extern uint8_t  opcode;
 extern int      cpl_override;
@@ -96,6 +96,7 @@
 #define WIN_SETIDLE1                   0xe3
 #define WIN_CHECKPOWERMODE1            0xe5
 #define WIN_SLEEP1                     0xe6
+#define WIN_FLUSH_CACHE                0xe7
 #define WIN_IDENTIFY                   0xec /* Ask drive to identify itself */
 #define WIN_SET_FEATURES               0xef
 #define WIN_READ_NATIVE_MAX            0xf8
@@ -761,6 +762,20 @@ ide_get_sector_format(ide_t *ide)
     }
 }
 
+/*
+ * Start reading the sectors of a read command into the sector buffer,
+ * so that the host I/O overlaps the emulated seek and transfer time
+ */
+static void
+ide_hdd_read_start(ide_t *ide)
+{
+    if (!ide->tf->lba && (ide->cfg_spt == 0))
+        return;
+
+    hdd_image_async_read(ide->hdd_num, ide_get_sector(ide),
+                         ide->tf->secount ? ide->tf->secount : 256, ide->sector_buffer);
+}
+
 /**
  * Move to the next sector using CHS addressing
  */
@@ -1795,6 +1810,7 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                             wait_time        = seek_time > xfer_time ? seek_time : xfer_time;
                         } else if ((val == WIN_READ_MULTIPLE) && (hdd[ide->hdd_num].speed_preset == 0)) {
                            ide_set_callback(ide, 200.0 * IDE_TIME);
+                           ide_hdd_read_start(ide);
                            ide->do_initial_read = 1;
                            break;
                         } else if ((val == WIN_READ_MULTIPLE) && (ide->blocksize > 0)) {
@@ -1815,6 +1831,7 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                             wait_time        = seek_time + xfer_time;
                         }
                         ide_set_callback(ide, wait_time);
+                        ide_hdd_read_start(ide);
                     } else
                         ide_set_callback(ide, 200.0 * IDE_TIME);
                     ide->do_initial_read = 1;
@@ -1920,6 +1937,13 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                     ide_callback(ide);
                     break;
 
+                case WIN_FLUSH_CACHE:
+                    ide->tf->atastat = BSY_STAT;
+                    if (ide->type == IDE_HDD)
+                        hdd_image_async_flush(ide->hdd_num);
+                    ide_set_callback(ide, IDE_TIME);
+                    break;
+
                 case WIN_PACKETCMD: /* ATAPI Packet */
                     /* Skip the command callback wait, and process immediately. */
                     ide->tf->pos           = 0;
@@ -2278,6 +2302,12 @@ ide_callback(void *priv)
 
     ide_log("ide_callback(%i): %02X\n", ide->channel, ide->command);
 
+    /* Keep the drive busy until the host is done with the image. */
+    if ((ide->type == IDE_HDD) && hdd_image_async_busy(ide->hdd_num)) {
+        ide_set_callback(ide, IDE_TIME);
+        return;
+    }
+
     switch (ide->command) {
         case WIN_SEEK ... 0x7f:
             chk_chs = !ide->tf->lba;
@@ -2344,6 +2374,18 @@ ide_callback(void *priv)
             ide_irq_raise(ide);
             break;
 
+        case WIN_FLUSH_CACHE:
+            if (ide->type != IDE_HDD)
+                err = ABRT_ERR;
+            else if (hdd_image_async_result(ide->hdd_num) < 0) {
+                ide_log("IDE %i: Cache flush failed\n", ide->channel);
+                err = UNC_ERR;
+            } else {
+                ide->tf->atastat = DRDY_STAT | DSC_STAT;
+                ide_irq_raise(ide);
+            }
+            break;
+
         case WIN_READ:
         case WIN_READ_NORETRY:
             if (ide->type == IDE_ATAPI) {
@@ -2355,8 +2397,7 @@ ide_callback(void *priv)
                 if (ide->do_initial_read) {
                     ide->do_initial_read = 0;
                     ide->sector_pos      = 0;
-                    ret = hdd_image_read(ide->hdd_num, ide_get_sector(ide),
-                                         ide->tf->secount ? ide->tf->secount : 256, ide->sector_buffer);
+                    ret = hdd_image_async_result(ide->hdd_num);
                 } else
                     ret = 0;
 
@@ -2394,7 +2435,7 @@ ide_callback(void *priv)
 
                 ide->tf->pos = 0;
 
-                if (hdd_image_read(ide->hdd_num, ide_get_sector(ide), ide->sector_pos, ide->sector_buffer) < 0) {
+                if (hdd_image_async_result(ide->hdd_num) < 0) {
                     ide_log("IDE %i: DMA read aborted (image read error)\n", ide->channel);
                     err = UNC_ERR;
                 } else if (!ide_boards[ide->board]->force_ata3 && bm->dma) {
@@ -2440,8 +2481,7 @@ ide_callback(void *priv)
                 if (ide->do_initial_read) {
                     ide->do_initial_read = 0;
                     ide->sector_pos      = 0;
-                    ret = hdd_image_read(ide->hdd_num, ide_get_sector(ide),
-                                         ide->tf->secount ? ide->tf->secount : 256, ide->sector_buffer);
+                    ret = hdd_image_async_result(ide->hdd_num);
                 } else {
                     ret = 0;
                 }
@@ -2475,7 +2515,7 @@ ide_callback(void *priv)
                 err = IDNF_ERR;
             else {
                 ui_sb_update_icon_write(SB_HDD | hdd[ide->hdd_num].bus_type, 1);
-                ret = hdd_image_write(ide->hdd_num, ide_get_sector(ide), 1, (uint8_t *) ide->buffer);
+                ret = hdd_image_async_write(ide->hdd_num, ide_get_sector(ide), 1, (uint8_t *) ide->buffer);
                 ide_irq_raise(ide);
                 ide->tf->secount--;
                 if (ide->tf->secount) {
@@ -2516,8 +2556,8 @@ ide_callback(void *priv)
                     } else if (ret & 1) {
                         /* DMA successful */
                         ui_sb_update_icon_write(SB_HDD | hdd[ide->hdd_num].bus_type, 1);
-                        ret = hdd_image_write(ide->hdd_num, ide_get_sector(ide),
-                                              ide->sector_pos, ide->sector_buffer);
+                        ret = hdd_image_async_write(ide->hdd_num, ide_get_sector(ide),
+                                                    ide->sector_pos, ide->sector_buffer);
 
                         ide_log("IDE %i: DMA write %ssuccessful\n", ide->channel, (ret < 0) ? "un" : "");
 
@@ -2550,7 +2590,7 @@ ide_callback(void *priv)
             else if (!ide->tf->lba && (ide->cfg_spt == 0))
                 err = IDNF_ERR;
             else {
-                ret = hdd_image_write(ide->hdd_num, ide_get_sector(ide), 1, (uint8_t *) ide->buffer);
+                ret = hdd_image_async_write(ide->hdd_num, ide_get_sector(ide), 1, (uint8_t *) ide->buffer);
                 ide->blockcount++;
                 if (ide->blockcount >= ide->blocksize || ide->tf->secount == 1) {
                     ide->blockcount = 0;
@@ -3204,6 +3244,10 @@ ide_drive_reset(int d)
 
     ide_set_signature(ide_drives[d]);
 
+    /* A read may still be going into the sector buffer on the I/O thread. */
+    if (ide_drives[d]->type == IDE_HDD)
+        hdd_image_async_wait(ide_drives[d]->hdd_num);
+
     if (ide_drives[d]->sector_buffer)
         memset(ide_drives[d]->sector_buffer, 0, 256 * 512);
 
@@ -15,6 +15,7 @@
  *          Copyright 2017-2018 Fred N. van Kempen.
  */
 #define _GNU_SOURCE
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -24,14 +25,17 @@
 #include <time.h>
 #include <wchar.h>
 #include <errno.h>
-#ifdef __unix__
-#include <unistd.h>
+#ifndef _WIN32
+#    include <sys/mman.h>
+#    include <unistd.h>
+#    define HDD_IMAGE_MMAP
 #endif
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/path.h>
 #include <86box/plat.h>
 #include <86box/random.h>
+#include <86box/thread.h>
 #include <86box/hdd.h>
 #include "minivhd/minivhd.h"
 #include "minivhd/internal.h"
@@ -41,6 +45,40 @@
 #define HDD_IMAGE_HDX 2
 #define HDD_IMAGE_VHD 3
 
+/* Overlay files keep every cluster the guest writes, so the image under
+   them is only ever read. A cluster is stored as a 512-byte record
+   header followed by its data, appended in the order first written. */
+#define HDD_OVERLAY_MAGIC        "86BOXOVL"
+#define HDD_OVERLAY_RECORD_MAGIC "86BOXCLU"
+#define HDD_OVERLAY_VERSION      1
+#define HDD_OVERLAY_CLUSTER_SECT 128 /* 64 KB clusters. */
+#define HDD_OVERLAY_PAGE_SHIFT   10  /* Index entries per lazily allocated page. */
+#define HDD_OVERLAY_PAGE_SIZE    (1 << HDD_OVERLAY_PAGE_SHIFT)
+
+typedef struct hdd_overlay_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t cluster_sectors;
+    uint32_t sectors;
+    uint32_t reserved;
+    char     base[488]; /* Image the overlay was created for, informational. */
+} hdd_overlay_header_t;
+
+typedef struct hdd_overlay_record_t {
+    char     magic[8];
+    uint32_t cluster;
+    uint8_t  reserved[500];
+} hdd_overlay_record_t;
+
+typedef struct hdd_overlay_t {
+    FILE      *file;
+    uint32_t   sectors;
+    uint32_t   clusters;
+    uint32_t   used;  /* Records in the file. */
+    uint32_t **index; /* Cluster to record number + 1, 0 if not written. */
+    uint8_t   *buffer;
+} hdd_overlay_t;
+
 typedef struct hdd_image_t {
     FILE     *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
     MVHDMeta *vhd;  /* Used for HDD_IMAGE_VHD. */
@@ -49,9 +87,55 @@ typedef struct hdd_image_t {
     uint32_t  last_sector;
     uint8_t   type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, or HDD_IMAGE_VHD */
     uint8_t   loaded;
+
+    /* Used when a RAW, HDI, or HDX image is mapped into memory. */
+    uint8_t  *map;
+    uint64_t  map_size;
+    uint64_t  dirty_start; /* Range not yet synced back to the file. */
+    uint64_t  dirty_end;
+    mutex_t  *dirty_mutex;
+
+    /* Writes go here instead, if an overlay directory was given. */
+    hdd_overlay_t *overlay;
 } hdd_image_t;
 
+/* Each image gets an I/O thread the first time an asynchronous request
+   is made for it. There is only ever one request in flight per image,
+   since a drive only works on one command at a time. A write that fails
+   once the command has completed sets write_error, which sticks until it
+   is reported to the guest through the next command. */
+typedef struct hdd_image_async_t {
+    thread_t  *thread;
+    event_t   *wake_event;
+    event_t   *done_event;
+    atomic_int busy;
+    atomic_int write_error;
+    int        quit;
+    int        op;
+    int        result;
+    uint32_t   sector;
+    uint32_t   count;
+    uint8_t   *buffer;
+    uint8_t   *write_buffer; /* Private copy of the data being written. */
+    uint32_t   write_buffer_size;
+} hdd_image_async_t;
+
+#define HDD_ASYNC_READ  0
+#define HDD_ASYNC_WRITE 1
+#define HDD_ASYNC_FLUSH 2
+
+/* How often, in milliseconds, the I/O thread syncs back the dirty part
+   of a memory mapped image. */
+#define HDD_IMAGE_SYNC_INTERVAL 1000
+
 hdd_image_t hdd_images[HDD_NUM];
+char        hdd_overlay_path[1024];
+
+static hdd_image_async_t hdd_async[HDD_NUM];
+
+static int  hdd_image_async_start(uint8_t id);
+static void hdd_image_async_stop(uint8_t id);
+static int  hdd_image_base_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 
 static char  empty_sector[512];
 #ifndef __unix__
@@ -241,6 +325,410 @@ prepare_new_hard_disk(uint8_t id, uint64_t full_size)
     return 1;
 }
 
+#ifdef HDD_IMAGE_MMAP
+static void
+hdd_image_map(uint8_t id, uint64_t full_size)
+{
+    hdd_image_t *img  = &hdd_images[id];
+    uint64_t     size = full_size + img->base;
+    void        *map;
+
+    /* The image under an overlay is opened read-only. */
+    if (!hdd[id].mmap || hdd_overlay_path[0] || (img->file == NULL) || (size == 0) || ((uint64_t) (size_t) size != size))
+        return;
+
+    fflush(img->file);
+
+    map = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(img->file), 0);
+    if (map == MAP_FAILED) {
+        hdd_image_log("Hard disk image %i: Unable to map the image, using file I/O\n", id);
+        return;
+    }
+
+    img->map         = (uint8_t *) map;
+    img->map_size    = size;
+    img->dirty_start = img->dirty_end = 0;
+    img->dirty_mutex = thread_create_mutex();
+
+    hdd_image_log("Hard disk image %i: Mapped %" PRIu64 " bytes\n", id, size);
+
+    /* The I/O thread also syncs the image back in the background. */
+    hdd_image_async_start(id);
+}
+
+static void
+hdd_image_mark_dirty(hdd_image_t *img, uint64_t start, uint64_t len)
+{
+    thread_wait_mutex(img->dirty_mutex);
+    if (img->dirty_end == img->dirty_start) {
+        img->dirty_start = start;
+        img->dirty_end   = start + len;
+    } else {
+        if (start < img->dirty_start)
+            img->dirty_start = start;
+        if ((start + len) > img->dirty_end)
+            img->dirty_end = start + len;
+    }
+    thread_release_mutex(img->dirty_mutex);
+}
+
+/* Write the dirty range back to the file. */
+static int
+hdd_image_sync(uint8_t id)
+{
+    hdd_image_t *img  = &hdd_images[id];
+    uintptr_t    page = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uint64_t     start;
+    uint64_t     end;
+
+    thread_wait_mutex(img->dirty_mutex);
+    start            = img->dirty_start;
+    end              = img->dirty_end;
+    img->dirty_start = img->dirty_end = 0;
+    thread_release_mutex(img->dirty_mutex);
+
+    if (start == end)
+        return 0;
+
+    /* msync() wants a page aligned address. */
+    start &= ~((uint64_t) page - 1);
+    if (msync(img->map + start, (size_t) (end - start), MS_SYNC) == -1) {
+        hdd_image_log("Hard disk image %i: msync() failed (%i)\n", id, errno);
+        hdd_image_mark_dirty(img, start, end - start);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Let the kernel start reading ahead when the guest reads sequentially. */
+static void
+hdd_image_read_ahead(hdd_image_t *img, uint64_t offset, uint64_t len)
+{
+    uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uint64_t  start;
+
+    start = (offset + len) & ~((uint64_t) page - 1);
+    len <<= 2;
+    if (start >= img->map_size)
+        return;
+    if ((start + len) > img->map_size)
+        len = img->map_size - start;
+
+    madvise(img->map + start, (size_t) len, MADV_WILLNEED);
+}
+
+static void
+hdd_image_unmap(uint8_t id)
+{
+    hdd_image_t *img = &hdd_images[id];
+
+    if (img->map == NULL)
+        return;
+
+    hdd_image_sync(id);
+    munmap(img->map, (size_t) img->map_size);
+    thread_close_mutex(img->dirty_mutex);
+
+    img->map         = NULL;
+    img->map_size    = 0;
+    img->dirty_mutex = NULL;
+}
+#else
+#    define hdd_image_map(id, full_size)
+#    define hdd_image_unmap(id)
+#endif
+
+static uint32_t
+hdd_overlay_lookup(const hdd_overlay_t *ov, uint32_t cluster)
+{
+    const uint32_t *page = ov->index[cluster >> HDD_OVERLAY_PAGE_SHIFT];
+
+    return (page != NULL) ? page[cluster & (HDD_OVERLAY_PAGE_SIZE - 1)] : 0;
+}
+
+static int
+hdd_overlay_set(hdd_overlay_t *ov, uint32_t cluster, uint32_t record)
+{
+    uint32_t **page = &ov->index[cluster >> HDD_OVERLAY_PAGE_SHIFT];
+
+    if (*page == NULL) {
+        *page = (uint32_t *) calloc(HDD_OVERLAY_PAGE_SIZE, sizeof(uint32_t));
+        if (*page == NULL)
+            return -1;
+    }
+
+    (*page)[cluster & (HDD_OVERLAY_PAGE_SIZE - 1)] = record + 1;
+    return 0;
+}
+
+/* Offset of the data of a record in the overlay file. */
+static uint64_t
+hdd_overlay_offset(uint32_t record)
+{
+    return sizeof(hdd_overlay_header_t) +
+           ((uint64_t) record * (sizeof(hdd_overlay_record_t) + (HDD_OVERLAY_CLUSTER_SECT << 9))) +
+           sizeof(hdd_overlay_record_t);
+}
+
+static void
+hdd_overlay_close(uint8_t id)
+{
+    hdd_overlay_t *ov = hdd_images[id].overlay;
+
+    if (ov == NULL)
+        return;
+
+    if (ov->file != NULL)
+        fclose(ov->file);
+    if (ov->index != NULL) {
+        for (uint32_t i = 0; i <= (ov->clusters >> HDD_OVERLAY_PAGE_SHIFT); i++)
+            free(ov->index[i]);
+        free(ov->index);
+    }
+    free(ov->buffer);
+    free(ov);
+
+    hdd_images[id].overlay = NULL;
+}
+
+/* Open the overlay of a loaded image, creating it if needed. Creating one
+   only writes its header and opening one only reads the records of the
+   clusters written so far, so neither depends on the size of the disk. */
+static int
+hdd_overlay_open(uint8_t id)
+{
+    hdd_overlay_header_t header;
+    hdd_overlay_record_t record;
+    hdd_overlay_t       *ov;
+    char                 name[32];
+    char                 fn[1024 + 32];
+
+    if (!plat_dir_check(hdd_overlay_path))
+        plat_dir_create(hdd_overlay_path);
+
+    sprintf(name, "hdd_%02i.ovl", id + 1);
+    path_append_filename(fn, hdd_overlay_path, name);
+
+    ov = (hdd_overlay_t *) calloc(1, sizeof(hdd_overlay_t));
+    if (ov == NULL)
+        return 0;
+    hdd_images[id].overlay = ov;
+
+    ov->sectors  = hdd_images[id].last_sector + 1;
+    ov->clusters = (ov->sectors + HDD_OVERLAY_CLUSTER_SECT - 1) / HDD_OVERLAY_CLUSTER_SECT;
+    ov->index    = (uint32_t **) calloc((ov->clusters >> HDD_OVERLAY_PAGE_SHIFT) + 1, sizeof(uint32_t *));
+    ov->buffer   = (uint8_t *) malloc(HDD_OVERLAY_CLUSTER_SECT << 9);
+    if ((ov->index == NULL) || (ov->buffer == NULL))
+        goto fail;
+
+    ov->file = plat_fopen(fn, "rb+");
+    if (ov->file == NULL) {
+        ov->file = plat_fopen(fn, "wb+");
+        if (ov->file == NULL) {
+            pclog("Hard disk %i: Unable to create overlay '%s'\n", id, fn);
+            goto fail;
+        }
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, HDD_OVERLAY_MAGIC, sizeof(header.magic));
+        header.version         = HDD_OVERLAY_VERSION;
+        header.cluster_sectors = HDD_OVERLAY_CLUSTER_SECT;
+        header.sectors         = ov->sectors;
+        strncpy(header.base, hdd[id].fn, sizeof(header.base) - 1);
+        if (fwrite(&header, 1, sizeof(header), ov->file) != sizeof(header))
+            goto fail;
+        fflush(ov->file);
+
+        hdd_image_log("Hard disk %i: Created overlay '%s'\n", id, fn);
+        return 1;
+    }
+
+    if ((fread(&header, 1, sizeof(header), ov->file) != sizeof(header)) ||
+        memcmp(header.magic, HDD_OVERLAY_MAGIC, sizeof(header.magic)) ||
+        (header.version != HDD_OVERLAY_VERSION) || (header.cluster_sectors != HDD_OVERLAY_CLUSTER_SECT)) {
+        pclog("Hard disk %i: '%s' is not a valid overlay\n", id, fn);
+        goto fail;
+    }
+    if (header.sectors != ov->sectors) {
+        pclog("Hard disk %i: Overlay '%s' was made for a disk of %" PRIu32 " sectors, not %" PRIu32 "\n",
+              id, fn, header.sectors, ov->sectors);
+        goto fail;
+    }
+
+    /* Rebuild the index. A record cut short by a crash ends the scan, and
+       will simply be overwritten by the next cluster to be written. */
+    while (1) {
+        if (fseeko64(ov->file, hdd_overlay_offset(ov->used) - sizeof(record), SEEK_SET) == -1)
+            break;
+        if ((fread(&record, 1, sizeof(record), ov->file) != sizeof(record)) ||
+            memcmp(record.magic, HDD_OVERLAY_RECORD_MAGIC, sizeof(record.magic)) ||
+            (record.cluster >= ov->clusters))
+            break;
+        if (fseeko64(ov->file, (HDD_OVERLAY_CLUSTER_SECT << 9) - 1, SEEK_CUR) == -1)
+            break;
+        if (fgetc(ov->file) == EOF)
+            break;
+
+        if (hdd_overlay_set(ov, record.cluster, ov->used) < 0)
+            goto fail;
+        ov->used++;
+    }
+
+    hdd_image_log("Hard disk %i: Opened overlay '%s', %" PRIu32 " clusters written\n", id, fn, ov->used);
+    return 1;
+
+fail:
+    hdd_overlay_close(id);
+    return 0;
+}
+
+static int
+hdd_overlay_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_overlay_t *ov = hdd_images[id].overlay;
+    uint32_t       base_sector = 0;
+    uint32_t       base_count  = 0;
+    uint32_t       record;
+    uint32_t       n;
+    int            ret = 0;
+
+    if ((sector >= ov->sectors) || ((ov->sectors - sector) < count)) {
+        hdd_images[id].pos = sector;
+        return -1;
+    }
+
+    while (count > 0) {
+        n      = HDD_OVERLAY_CLUSTER_SECT - (sector % HDD_OVERLAY_CLUSTER_SECT);
+        n      = MIN(n, count);
+        record = hdd_overlay_lookup(ov, sector / HDD_OVERLAY_CLUSTER_SECT);
+
+        if (record == 0) {
+            /* Gather up consecutive unwritten clusters into one read. */
+            if (base_count == 0)
+                base_sector = sector;
+            base_count += n;
+        } else {
+            if (base_count > 0) {
+                ret        = hdd_image_base_read(id, base_sector, base_count, buffer - (base_count << 9));
+                base_count = 0;
+                if (ret < 0)
+                    break;
+            }
+
+            if ((fseeko64(ov->file, hdd_overlay_offset(record - 1) + ((sector % HDD_OVERLAY_CLUSTER_SECT) << 9), SEEK_SET) == -1) ||
+                (fread(buffer, 512, n, ov->file) != n)) {
+                ret = -1;
+                break;
+            }
+        }
+
+        sector += n;
+        count -= n;
+        buffer += n << 9;
+    }
+
+    if (base_count > 0)
+        ret = hdd_image_base_read(id, base_sector, base_count, buffer - (base_count << 9));
+
+    /* hdd_image_base_read() leaves pos at the end of its own run. */
+    hdd_images[id].pos = sector;
+    return ret;
+}
+
+/* A NULL buffer writes zeroes. */
+static int
+hdd_overlay_write(uint8_t id, uint32_t sector, uint32_t count, const uint8_t *buffer)
+{
+    hdd_overlay_t       *ov = hdd_images[id].overlay;
+    hdd_overlay_record_t rec;
+    const uint8_t       *src;
+    uint32_t             cluster;
+    uint32_t             record;
+    uint32_t             first;
+    uint32_t             valid;
+    uint32_t             n;
+    int                  ret = 0;
+
+    if ((sector >= ov->sectors) || ((ov->sectors - sector) < count)) {
+        hdd_images[id].pos = sector;
+        return -1;
+    }
+
+    while (count > 0) {
+        cluster = sector / HDD_OVERLAY_CLUSTER_SECT;
+        first   = sector % HDD_OVERLAY_CLUSTER_SECT;
+        n       = MIN(HDD_OVERLAY_CLUSTER_SECT - first, count);
+        record  = hdd_overlay_lookup(ov, cluster);
+
+        if (record != 0) {
+            if (buffer == NULL) {
+                memset(ov->buffer, 0, n << 9);
+                src = ov->buffer;
+            } else
+                src = buffer;
+            if ((fseeko64(ov->file, hdd_overlay_offset(record - 1) + (first << 9), SEEK_SET) == -1) ||
+                (fwrite(src, 512, n, ov->file) != n)) {
+                ret = -1;
+                break;
+            }
+        } else {
+            /* First write to the cluster, copy it up from the image unless
+               all of it is being replaced. */
+            if ((n < HDD_OVERLAY_CLUSTER_SECT) || (buffer == NULL)) {
+                valid = MIN(HDD_OVERLAY_CLUSTER_SECT, ov->sectors - (cluster * HDD_OVERLAY_CLUSTER_SECT));
+                if ((first > 0) &&
+                    (hdd_image_base_read(id, cluster * HDD_OVERLAY_CLUSTER_SECT, first, ov->buffer) < 0)) {
+                    ret = -1;
+                    break;
+                }
+                if (((first + n) < valid) &&
+                    (hdd_image_base_read(id, sector + n, valid - (first + n), ov->buffer + ((first + n) << 9)) < 0)) {
+                    ret = -1;
+                    break;
+                }
+                if (valid < HDD_OVERLAY_CLUSTER_SECT)
+                    memset(ov->buffer + (valid << 9), 0, (HDD_OVERLAY_CLUSTER_SECT - valid) << 9);
+                if (buffer != NULL)
+                    memcpy(ov->buffer + (first << 9), buffer, n << 9);
+                else
+                    memset(ov->buffer + (first << 9), 0, n << 9);
+                src = ov->buffer;
+            } else
+                src = buffer;
+
+            /* The data goes in before the record header, so a crash can not
+               leave a valid header in front of missing data. */
+            record = ov->used;
+            if ((fseeko64(ov->file, hdd_overlay_offset(record), SEEK_SET) == -1) ||
+                (fwrite(src, 512, HDD_OVERLAY_CLUSTER_SECT, ov->file) != HDD_OVERLAY_CLUSTER_SECT)) {
+                ret = -1;
+                break;
+            }
+
+            memset(&rec, 0, sizeof(rec));
+            memcpy(rec.magic, HDD_OVERLAY_RECORD_MAGIC, sizeof(rec.magic));
+            rec.cluster = cluster;
+            if ((fseeko64(ov->file, hdd_overlay_offset(record) - sizeof(rec), SEEK_SET) == -1) ||
+                (fwrite(&rec, 1, sizeof(rec), ov->file) != sizeof(rec)) ||
+                (hdd_overlay_set(ov, cluster, record) < 0)) {
+                ret = -1;
+                break;
+            }
+            ov->used++;
+        }
+
+        sector += n;
+        count -= n;
+        if (buffer != NULL)
+            buffer += n << 9;
+    }
+
+    /* The copy-up reads move pos, put it back past what was written. */
+    hdd_images[id].pos = sector;
+    return ret;
+}
+
 void
 hdd_image_init(void)
 {
@@ -248,8 +736,8 @@ hdd_image_init(void)
         memset(&hdd_images[i], 0, sizeof(hdd_image_t));
 }
 
-int
-hdd_image_load(int id)
+static int
+hdd_image_load_image(int id)
 {
     uint32_t sector_size = 512;
     uint32_t zero        = 0;
@@ -273,6 +761,10 @@ hdd_image_load(int id)
     hdd_images[id].base = 0;
 
     if (hdd_images[id].loaded) {
+        hdd_image_async_stop(id);
+        hdd_image_unmap(id);
+        hdd_overlay_close(id);
+
         if (hdd_images[id].file) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
@@ -297,14 +789,14 @@ hdd_image_load(int id)
         memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
         goto fail_raw;
     }
-    hdd_images[id].file = plat_fopen(fn, "rb+");
+    hdd_images[id].file = plat_fopen(fn, hdd_overlay_path[0] ? "rb" : "rb+");
     if (hdd_images[id].file == NULL) {
         /* Failed to open existing hard disk image */
         if (errno == ENOENT) {
             /* Failed because it does not exist,
                so try to create new file */
-            if (hdd[id].wp) {
-                hdd_image_log("A write-protected image must exist\n");
+            if (hdd[id].wp || hdd_overlay_path[0]) {
+                hdd_image_log("A write-protected or overlaid image must exist\n");
                 memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
                 goto fail_raw;
             }
@@ -343,6 +835,7 @@ hdd_image_load(int id)
                     hdd_images[id].type = HDD_IMAGE_HDX;
                 } else if (is_vhd[0]) {
                     fclose(hdd_images[id].file);
+                    hdd_images[id].file = NULL;
                     MVHDGeom geometry = { 0 };
                     geometry.cyl               = hdd[id].tracks;
                     geometry.heads             = hdd[id].hpc;
@@ -377,7 +870,8 @@ retry_vhd:
                         }
                         fatal("hdd_image_load(): VHD: Could not create VHD : %s\n", mvhd_strerr(vhd_error));
                     }
-                    hdd_images[id].type = HDD_IMAGE_VHD;
+                    hdd_images[id].type   = HDD_IMAGE_VHD;
+                    hdd_images[id].loaded = 1;
 
                     return 1;
                 } else {
@@ -391,6 +885,7 @@ retry_vhd:
             ret = prepare_new_hard_disk(id, full_size);
             if (ret <= 0)
                 goto fail_raw;
+            hdd_image_map(id, full_size);
             return ret;
         } else {
             /* Failed for another reason */
@@ -464,7 +959,7 @@ fail_raw:
         } else if (is_vhd[1]) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
-            hdd_images[id].vhd  = mvhd_open(fn, (bool) 0, &vhd_error);
+            hdd_images[id].vhd  = mvhd_open(fn, (bool) (hdd_overlay_path[0] != '\0'), &vhd_error);
             if (hdd_images[id].vhd == NULL) {
                 if (vhd_error == MVHD_ERR_FILE)
                     fatal("hdd_image_load(): VHD: Error opening VHD file '%s': %s\n", fn, strerror(mvhd_errno));
@@ -497,7 +992,7 @@ fail_raw:
     if (fseeko64(hdd_images[id].file, 0, SEEK_END) == -1)
         fatal("hdd_image_load(): Error seeking to the end of file\n");
     s = ftello64(hdd_images[id].file);
-    if (s < (full_size + hdd_images[id].base))
+    if ((s < (full_size + hdd_images[id].base)) && !hdd_overlay_path[0])
         ret = prepare_new_hard_disk(id, full_size);
     else {
         hdd_images[id].last_sector = (uint32_t) (full_size >> 9) - 1;
@@ -505,6 +1000,20 @@ fail_raw:
         ret                        = 1;
     }
 
+    if (ret > 0)
+        hdd_image_map(id, full_size);
+
+    return ret;
+}
+
+int
+hdd_image_load(int id)
+{
+    int ret = hdd_image_load_image(id);
+
+    if ((ret > 0) && hdd_images[id].loaded && hdd_overlay_path[0] && !hdd_overlay_open(id))
+        fatal("hdd_image_load(): Unable to open the overlay of hard disk %i\n", id);
+
     return ret;
 }
 
@@ -525,8 +1034,8 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     return 0;
 }
 
-int
-hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_base_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_read;
@@ -537,6 +1046,23 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
         hdd_images[id].pos        = sector + count - non_transferred_sectors - 1;
         if (hdd_images[id].vhd->error)
             return -1;
+#ifdef HDD_IMAGE_MMAP
+    } else if (hdd_images[id].map != NULL) {
+        hdd_image_t *img    = &hdd_images[id];
+        uint64_t     offset = ((uint64_t) sector << 9LL) + img->base;
+        uint64_t     len    = (uint64_t) count << 9LL;
+
+        if (offset > img->map_size)
+            return -1;
+        if ((offset + len) > img->map_size)
+            len = (img->map_size - offset) & ~511ULL;
+
+        if ((sector == img->pos) && (len > 0))
+            hdd_image_read_ahead(img, offset, len);
+
+        memcpy(buffer, img->map + offset, (size_t) len);
+        img->pos = sector + (uint32_t) (len >> 9);
+#endif
     } else {
         if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
             hdd_image_log("Hard disk image %i: Read error during seek\n", id);
@@ -547,11 +1073,23 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
         hdd_images[id].pos = sector + num_read;
         if ((num_read < count) && !feof(hdd_images[id].file))
             return -1;
+        /* An image under an overlay may be shorter than the disk. */
+        if (num_read < count)
+            memset(buffer + (num_read << 9), 0, (count - num_read) << 9);
     }
 
     return 0;
 }
 
+static int
+hdd_image_do_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].overlay != NULL)
+        return hdd_overlay_read(id, sector, count, buffer);
+
+    return hdd_image_base_read(id, sector, count, buffer);
+}
+
 uint32_t
 hdd_image_get_last_sector(uint8_t id)
 {
@@ -581,18 +1119,34 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_do_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_write;
 
+    if (hdd_images[id].overlay != NULL)
+        return hdd_overlay_write(id, sector, count, buffer);
+
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error = 0;
         non_transferred_sectors   = mvhd_write_sectors(hdd_images[id].vhd, sector, count, buffer);
         hdd_images[id].pos        = sector + count - non_transferred_sectors - 1;
         if (hdd_images[id].vhd->error)
             return -1;
+#ifdef HDD_IMAGE_MMAP
+    } else if (hdd_images[id].map != NULL) {
+        hdd_image_t *img    = &hdd_images[id];
+        uint64_t     offset = ((uint64_t) sector << 9LL) + img->base;
+        uint64_t     len    = (uint64_t) count << 9LL;
+
+        if ((offset + len) > img->map_size)
+            return -1;
+
+        memcpy(img->map + offset, buffer, (size_t) len);
+        hdd_image_mark_dirty(img, offset, len);
+        img->pos = sector + count;
+#endif
     } else {
         if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
             hdd_image_log("Hard disk image %i: Write error during seek\n", id);
@@ -609,6 +1163,290 @@ hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
+static int
+hdd_image_do_flush(uint8_t id)
+{
+    if (hdd_images[id].overlay != NULL)
+        return fflush(hdd_images[id].overlay->file) ? -1 : 0;
+#ifdef HDD_IMAGE_MMAP
+    if (hdd_images[id].map != NULL)
+        return hdd_image_sync(id);
+#endif
+    if (hdd_images[id].type == HDD_IMAGE_VHD)
+        return (hdd_images[id].vhd != NULL) ? mvhd_flush(hdd_images[id].vhd) : 0;
+
+    if ((hdd_images[id].file != NULL) && fflush(hdd_images[id].file))
+        return -1;
+
+    return 0;
+}
+
+static void
+hdd_image_async_thread(void *priv)
+{
+    hdd_image_async_t *async = (hdd_image_async_t *) priv;
+    uint8_t            id    = (uint8_t) (async - hdd_async);
+
+    while (1) {
+        thread_wait_event(async->wake_event, hdd_images[id].map ? HDD_IMAGE_SYNC_INTERVAL : -1);
+        thread_reset_event(async->wake_event);
+
+        if (async->quit)
+            break;
+
+        if (!atomic_load(&async->busy)) {
+#ifdef HDD_IMAGE_MMAP
+            /* Woken up by the timeout, sync the mapped image in the background. */
+            if (hdd_images[id].map != NULL)
+                hdd_image_sync(id);
+#endif
+            continue;
+        }
+
+        switch (async->op) {
+            case HDD_ASYNC_READ:
+                async->result = hdd_image_do_read(id, async->sector, async->count, async->buffer);
+                break;
+            case HDD_ASYNC_WRITE:
+                if (hdd_image_do_write(id, async->sector, async->count, async->write_buffer) < 0)
+                    atomic_store(&async->write_error, 1);
+                break;
+            case HDD_ASYNC_FLUSH:
+                async->result = hdd_image_do_flush(id);
+                break;
+            default:
+                break;
+        }
+
+        atomic_store(&async->busy, 0);
+        thread_set_event(async->done_event);
+    }
+}
+
+/* Wait for the request in flight, if any, to finish. */
+static void
+hdd_image_async_drain(uint8_t id)
+{
+    hdd_image_async_t *async = &hdd_async[id];
+
+    while (atomic_load(&async->busy))
+        thread_wait_event(async->done_event, -1);
+}
+
+/* Wait for the request in flight and return, and clear, any write error
+   not reported yet. The caller has to fail its command if there was one. */
+static int
+hdd_image_async_take_error(uint8_t id)
+{
+    hdd_image_async_drain(id);
+
+    if (atomic_exchange(&hdd_async[id].write_error, 0)) {
+        hdd_image_log("Hard disk image %i: Reporting a deferred write error\n", id);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int
+hdd_image_async_start(uint8_t id)
+{
+    hdd_image_async_t *async = &hdd_async[id];
+
+    if (async->thread != NULL)
+        return 1;
+
+    if (!hdd_images[id].loaded)
+        return 0;
+
+    async->quit       = 0;
+    async->wake_event = thread_create_event();
+    async->done_event = thread_create_event();
+    async->thread     = thread_create(hdd_image_async_thread, async);
+    if (async->thread == NULL) {
+        hdd_image_log("Hard disk image %i: Unable to start the I/O thread\n", id);
+        thread_destroy_event(async->wake_event);
+        thread_destroy_event(async->done_event);
+        async->wake_event = async->done_event = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+static void
+hdd_image_async_stop(uint8_t id)
+{
+    hdd_image_async_t *async = &hdd_async[id];
+
+    if (async->thread == NULL)
+        return;
+
+    hdd_image_async_drain(id);
+
+    async->quit = 1;
+    thread_set_event(async->wake_event);
+    thread_wait(async->thread);
+
+    thread_destroy_event(async->wake_event);
+    thread_destroy_event(async->done_event);
+    free(async->write_buffer);
+
+    memset(async, 0, sizeof(hdd_image_async_t));
+}
+
+static void
+hdd_image_async_submit(uint8_t id, int op, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_async_t *async = &hdd_async[id];
+
+    async->op     = op;
+    async->sector = sector;
+    async->count  = count;
+    async->buffer = buffer;
+    async->result = 0;
+
+    thread_reset_event(async->done_event);
+    atomic_store(&async->busy, 1);
+    thread_set_event(async->wake_event);
+}
+
+/* Start reading into buffer, which must be left alone until
+   hdd_image_async_busy() returns 0. The outcome is then returned by
+   hdd_image_async_result(). If the I/O thread cannot be used, the read
+   is done right away. A pending write error fails the read instead. */
+void
+hdd_image_async_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_async_t *async = &hdd_async[id];
+
+    if (hdd_image_async_take_error(id)) {
+        async->op     = HDD_ASYNC_READ;
+        async->result = -1;
+        return;
+    }
+
+    if (hdd_image_async_start(id))
+        hdd_image_async_submit(id, HDD_ASYNC_READ, sector, count, buffer);
+    else {
+        async->op     = HDD_ASYNC_READ;
+        async->result = hdd_image_do_read(id, sector, count, buffer);
+    }
+}
+
+/* Queue a write. The data is copied, so the caller is free to reuse the
+   buffer straight away. Like a drive with its write cache enabled, a
+   failure is reported by whichever command comes next. If that is this
+   one, -1 is returned and the write is not done, the guest will retry
+   it. */
+int
+hdd_image_async_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_async_t *async = &hdd_async[id];
+    uint32_t           len   = count << 9;
+    uint8_t           *new_buffer;
+
+    if (hdd_image_async_take_error(id))
+        return -1;
+
+    if (hdd_image_async_start(id)) {
+        if (len > async->write_buffer_size) {
+            new_buffer = (uint8_t *) realloc(async->write_buffer, len);
+            if (new_buffer == NULL)
+                return hdd_image_do_write(id, sector, count, buffer);
+
+            async->write_buffer      = new_buffer;
+            async->write_buffer_size = len;
+        }
+
+        memcpy(async->write_buffer, buffer, len);
+        hdd_image_async_submit(id, HDD_ASYNC_WRITE, sector, count, NULL);
+    } else if (hdd_image_do_write(id, sector, count, buffer) < 0)
+        return -1;
+
+    return 0;
+}
+
+/* Start writing back everything written so far, for the guest's cache
+   flush commands. The outcome, which includes any deferred write error,
+   is returned by hdd_image_async_result(). */
+void
+hdd_image_async_flush(uint8_t id)
+{
+    hdd_image_async_t *async = &hdd_async[id];
+
+    if (hdd_image_async_take_error(id)) {
+        async->op     = HDD_ASYNC_FLUSH;
+        async->result = -1;
+        return;
+    }
+
+    if (hdd_image_async_start(id))
+        hdd_image_async_submit(id, HDD_ASYNC_FLUSH, 0, 0, NULL);
+    else {
+        async->op     = HDD_ASYNC_FLUSH;
+        async->result = hdd_image_do_flush(id);
+    }
+}
+
+int
+hdd_image_async_busy(uint8_t id)
+{
+    return atomic_load(&hdd_async[id].busy);
+}
+
+/* Wait for the request in flight, for when its buffer is about to go. */
+void
+hdd_image_async_wait(uint8_t id)
+{
+    hdd_image_async_drain(id);
+}
+
+/* Return, and clear, the outcome of the last request, waiting for it
+   to finish if needed. */
+int
+hdd_image_async_result(uint8_t id)
+{
+    hdd_image_async_t *async = &hdd_async[id];
+    int                ret;
+
+    hdd_image_async_drain(id);
+
+    ret           = async->result;
+    async->result = 0;
+
+    return ret;
+}
+
+int
+hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_image_async_take_error(id))
+        return -1;
+
+    return hdd_image_do_read(id, sector, count, buffer);
+}
+
+int
+hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_image_async_take_error(id))
+        return -1;
+
+    return hdd_image_do_write(id, sector, count, buffer);
+}
+
+/* Write back everything written so far, reporting any deferred write
+   error along with the outcome. */
+int
+hdd_image_flush(uint8_t id)
+{
+    if (hdd_image_async_take_error(id))
+        return -1;
+
+    return hdd_image_do_flush(id);
+}
+
 int
 hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
@@ -629,12 +1467,33 @@ hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 int
 hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
 {
+    if (hdd_image_async_take_error(id))
+        return -1;
+
+    if (hdd_images[id].overlay != NULL)
+        return hdd_overlay_write(id, sector, count, NULL);
+
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error   = 0;
         int non_transferred_sectors = mvhd_format_sectors(hdd_images[id].vhd, sector, count);
         hdd_images[id].pos          = sector + count - non_transferred_sectors - 1;
         if (hdd_images[id].vhd->error)
             return -1;
+#ifdef HDD_IMAGE_MMAP
+    } else if (hdd_images[id].map != NULL) {
+        hdd_image_t *img    = &hdd_images[id];
+        uint64_t     offset = ((uint64_t) sector << 9LL) + img->base;
+        uint64_t     len    = (uint64_t) count << 9LL;
+
+        if (offset > img->map_size)
+            return -1;
+        if ((offset + len) > img->map_size)
+            len = (img->map_size - offset) & ~511ULL;
+
+        memset(img->map + offset, 0, (size_t) len);
+        hdd_image_mark_dirty(img, offset, len);
+        img->pos = sector + (uint32_t) (len >> 9);
+#endif
     } else {
         memset(empty_sector, 0, 512);
 
@@ -674,6 +1533,35 @@ hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
     return 0;
 }
 
+void
+hdd_image_vhd_stats_dump(void)
+{
+    MVHDStats stats;
+    int       found = 0;
+
+    for (uint8_t i = 0; i < HDD_NUM; i++) {
+        if (!hdd_images[i].loaded || (hdd_images[i].type != HDD_IMAGE_VHD) || (hdd_images[i].vhd == NULL))
+            continue;
+
+        mvhd_get_stats(hdd_images[i].vhd, &stats);
+        found = 1;
+
+        pclog("VHD %i: %" PRIu64 " sectors read, %" PRIu64 " sectors written\n",
+              i, stats.guest_read_sectors, stats.guest_write_sectors);
+        pclog("VHD %i: %" PRIu64 " host reads (%" PRIu64 " bytes), %" PRIu64 " host writes (%" PRIu64 " bytes)\n",
+              i, stats.host_reads, stats.host_read_bytes, stats.host_writes, stats.host_write_bytes);
+        if (stats.guest_read_sectors || stats.guest_write_sectors)
+            pclog("VHD %i: %.3f host calls per guest sector\n", i,
+                  (double) (stats.host_reads + stats.host_writes) /
+                  (double) (stats.guest_read_sectors + stats.guest_write_sectors));
+        pclog("VHD %i: %" PRIu64 " cache hits, %" PRIu64 " misses, %" PRIu64 " blocks allocated, %" PRIu64 " metadata flushes\n",
+              i, stats.cache_hits, stats.cache_misses, stats.blocks_allocated, stats.metadata_flushes);
+    }
+
+    if (!found)
+        pclog("VHD: No VHD images loaded\n");
+}
+
 uint32_t
 hdd_image_get_pos(uint8_t id)
 {
@@ -692,6 +1580,10 @@ hdd_image_unload(uint8_t id, UNUSED(int fn_preserve))
     if (strlen(hdd[id].fn) == 0)
         return;
 
+    hdd_image_async_stop(id);
+    hdd_image_unmap(id);
+    hdd_overlay_close(id);
+
     if (hdd_images[id].loaded) {
         if (hdd_images[id].file != NULL) {
             fclose(hdd_images[id].file);
@@ -716,6 +1608,10 @@ hdd_image_close(uint8_t id)
     if (!hdd_images[id].loaded)
         return;
 
+    hdd_image_async_stop(id);
+    hdd_image_unmap(id);
+    hdd_overlay_close(id);
+
     if (hdd_images[id].file != NULL) {
         fclose(hdd_images[id].file);
         hdd_images[id].file = NULL;
@@ -48,6 +48,14 @@
 
 #define MVHD_SPARSE_BLK        0xffffffff
 
+/* The data cache holds recently read parts of sparse images, in chunks
+   of MVHD_CACHE_CHUNK_SECT sectors kept in a small set-associative LRU. */
+#define MVHD_CACHE_CHUNK_SECT  64
+#define MVHD_CACHE_SETS        16
+#define MVHD_CACHE_WAYS        4
+
+#define MVHD_FLUSH_INTERVAL    5  /* Seconds dirty sector bitmaps may be held back */
+
 /* For simplicity, we don't handle paths longer than this
  * Note, this is the max path in characters, as that is what
  * Windows uses
@@ -62,11 +70,27 @@
 
 
 typedef struct MVHDSectorBitmap {
-    uint8_t* curr_bitmap;
-    int      sector_count;
-    int      curr_block;
+    uint8_t*  curr_bitmap;
+    int       sector_count;
+    int       curr_block;
+    uint8_t*  spare_bitmap; /* Used if a block's bitmap can't be cached */
+    uint8_t** cache;        /* Bitmaps of the blocks seen so far */
+    uint8_t*  dirty;        /* Cached bitmaps not yet written back */
+    bool      any_dirty;
 } MVHDSectorBitmap;
 
+typedef struct MVHDCacheChunk {
+    uint64_t sector;   /* First file sector held, UINT64_MAX if unused */
+    uint32_t last_use;
+    uint8_t* data;
+} MVHDCacheChunk;
+
+typedef struct MVHDDataCache {
+    MVHDCacheChunk chunks[MVHD_CACHE_SETS][MVHD_CACHE_WAYS];
+    uint32_t       clock;
+    uint8_t*       buffer;
+} MVHDDataCache;
+
 typedef struct MVHDFooter {
     uint8_t  cookie[8];
     uint32_t features;
@@ -123,6 +147,9 @@ struct MVHDMeta {
     uint32_t*        block_offset;
     int              sect_per_block;
     MVHDSectorBitmap bitmap;
+    time_t           last_flush;      /* When the bitmaps were last written back */
+    MVHDDataCache*   cache;
+    MVHDStats        stats;
     int (*read_sectors)(struct MVHDMeta*, uint32_t, int, void*);
     int (*write_sectors)(struct MVHDMeta*, uint32_t, int, void*);
     struct {
@@ -274,6 +301,15 @@ struct MVHDMeta* mvhd_create_fixed_raw(const char* path, FILE* raw_img, uint64_t
  */
 bool mvhd_write_empty_sectors(FILE* f, int sector_count);
 
+/**
+ * \brief Free the sector bitmap and data caches of an image
+ *
+ * Anything dirty should have been written back with mvhd_flush() first.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ */
+void mvhd_free_caches(struct MVHDMeta* vhdm);
+
 /**
  * \brief Read a fixed VHD image
  * 
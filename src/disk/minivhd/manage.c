@@ -179,11 +179,11 @@ calc_sparse_values(MVHDMeta* vhdm)
 
 
 /**
- * \brief Allocate memory for a sector bitmap.
+ * \brief Allocate memory for the sector bitmap cache.
  *
  * Each data block is preceded by a sector bitmap. Each bit indicates whether the corresponding sector
  * is considered 'clean' or 'dirty' (for sparse VHD images), or whether to read from the parent or current
- * image (for differencing images).
+ * image (for differencing images). The bitmap of each block is cached after its first use.
  *
  * \param [in] vhdm MiniVHD data structure
  * \param [out] err this is populated with MVHD_ERR_MEM if the calloc fails
@@ -194,8 +194,11 @@ calc_sparse_values(MVHDMeta* vhdm)
 static int
 init_sector_bitmap(MVHDMeta* vhdm, MVHDError* err)
 {
-    vhdm->bitmap.curr_bitmap = calloc(vhdm->bitmap.sector_count, MVHD_SECTOR_SIZE);
-    if (vhdm->bitmap.curr_bitmap == NULL) {
+    vhdm->bitmap.spare_bitmap = calloc(vhdm->bitmap.sector_count, MVHD_SECTOR_SIZE);
+    vhdm->bitmap.cache = calloc(vhdm->sparse.max_bat_ent, sizeof *vhdm->bitmap.cache);
+    vhdm->bitmap.dirty = calloc(vhdm->sparse.max_bat_ent, sizeof *vhdm->bitmap.dirty);
+    if ((vhdm->bitmap.spare_bitmap == NULL) || (vhdm->bitmap.cache == NULL) || (vhdm->bitmap.dirty == NULL)) {
+        mvhd_free_caches(vhdm);
         *err = MVHD_ERR_MEM;
         return -1;
     }
@@ -521,6 +524,7 @@ mvhd_open(const char* path, int readonly, int* err)
         goto cleanup_vhdm;
     }
     vhdm->readonly = readonly;
+    vhdm->last_flush = time(NULL);
 
     if (!mvhd_file_is_vhd(vhdm->f)) {
         *err = MVHD_ERR_NOT_VHD;
@@ -595,8 +599,7 @@ cleanup_format_buff:
     vhdm->format_buffer.zero_data = NULL;
 
 cleanup_bitmap:
-    free(vhdm->bitmap.curr_bitmap);
-    vhdm->bitmap.curr_bitmap = NULL;
+    mvhd_free_caches(vhdm);
 
 cleanup_bat:
     free(vhdm->block_offset);
@@ -624,16 +627,14 @@ mvhd_close(MVHDMeta* vhdm)
     if (vhdm->parent != NULL)
         mvhd_close(vhdm->parent);
 
+    mvhd_flush(vhdm);
     fclose(vhdm->f);
 
     if (vhdm->block_offset != NULL) {
         free(vhdm->block_offset);
         vhdm->block_offset = NULL;
     }
-    if (vhdm->bitmap.curr_bitmap != NULL) {
-        free(vhdm->bitmap.curr_bitmap);
-        vhdm->bitmap.curr_bitmap = NULL;
-    }
+    mvhd_free_caches(vhdm);
     if (vhdm->format_buffer.zero_data != NULL) {
         free(vhdm->format_buffer.zero_data);
         vhdm->format_buffer.zero_data = NULL;
@@ -681,6 +682,7 @@ mvhd_diff_update_par_timestamp(MVHDMeta* vhdm, int* err)
 MVHDAPI int
 mvhd_read_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors, void* out_buff)
 {
+    vhdm->stats.guest_read_sectors += num_sectors;
     return vhdm->read_sectors(vhdm, offset, num_sectors, out_buff);
 }
 
@@ -688,6 +690,7 @@ mvhd_read_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors, void* out_bu
 MVHDAPI int
 mvhd_write_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors, void* in_buff)
 {
+    vhdm->stats.guest_write_sectors += num_sectors;
     return vhdm->write_sectors(vhdm, offset, num_sectors, in_buff);
 }
 
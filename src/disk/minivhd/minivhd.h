@@ -103,6 +103,19 @@ typedef struct MVHDCreationOptions {
 
 typedef struct MVHDMeta MVHDMeta;
 
+typedef struct MVHDStats {
+    uint64_t guest_read_sectors;
+    uint64_t guest_write_sectors;
+    uint64_t host_reads;          /**< Calls into the C library to read */
+    uint64_t host_writes;         /**< Calls into the C library to write */
+    uint64_t host_read_bytes;
+    uint64_t host_write_bytes;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t blocks_allocated;
+    uint64_t metadata_flushes;
+} MVHDStats;
+
 
 extern int mvhd_errno;
 
@@ -395,6 +408,30 @@ MVHDAPI int mvhd_write_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors,
  */
 MVHDAPI int mvhd_format_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors);
 
+/**
+ * \brief Write cached metadata back to the VHD file
+ *
+ * Sector bitmaps changed by writes are kept in memory and written back
+ * by this function, by mvhd_close(), or by the first write that comes
+ * MVHD_FLUSH_INTERVAL seconds after the last write-back. BAT entries are
+ * written as soon as a block is allocated.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ *
+ * \return non-zero on error, 0 on success
+ */
+MVHDAPI int mvhd_flush(MVHDMeta* vhdm);
+
+/**
+ * \brief Get the I/O statistics of a VHD image
+ *
+ * The host I/O of any parent images is included.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [out] stats filled with the totals since the image was opened
+ */
+MVHDAPI void mvhd_get_stats(MVHDMeta* vhdm, MVHDStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -97,10 +97,57 @@ mvhd_write_empty_sectors(FILE *f, int sector_count)
 }
 
 /**
- * \brief Read the sector bitmap for a block.
+ * \brief Read from the VHD file, keeping count of the host I/O
+ */
+static size_t
+vhd_fread(MVHDMeta *vhdm, void *buff, size_t size, size_t count)
+{
+    size_t ret = fread(buff, size, count, vhdm->f);
+
+    vhdm->stats.host_reads++;
+    vhdm->stats.host_read_bytes += ret * size;
+
+    return ret;
+}
+
+/**
+ * \brief Write to the VHD file, keeping count of the host I/O
+ */
+static size_t
+vhd_fwrite(MVHDMeta *vhdm, const void *buff, size_t size, size_t count)
+{
+    size_t ret = fwrite(buff, size, count, vhdm->f);
+
+    vhdm->stats.host_writes++;
+    vhdm->stats.host_write_bytes += ret * size;
+
+    return ret;
+}
+
+/**
+ * \brief Write the sector bitmap of a block to file
  *
- * If the block is sparse, the sector bitmap in memory will be
- * zeroed. Otherwise, the sector bitmap is read from the VHD file.
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block to write the sector bitmap of
+ * \param [in] bitmap The sector bitmap
+ */
+static void
+write_sect_bitmap(MVHDMeta *vhdm, int blk, const uint8_t *bitmap)
+{
+    int64_t abs_offset = (int64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE;
+
+    if (mvhd_fseeko64(vhdm->f, abs_offset, SEEK_SET) == -1)
+        vhdm->error = 1;
+    if (!vhd_fwrite(vhdm, bitmap, MVHD_SECTOR_SIZE, vhdm->bitmap.sector_count))
+        vhdm->error = 1;
+}
+
+/**
+ * \brief Make the sector bitmap of a block the current one.
+ *
+ * The bitmaps are cached, so each one is only read from the VHD file the
+ * first time its block is visited. If the block is sparse, the sector
+ * bitmap in memory will be zeroed.
  *
  * \param [in] vhdm MiniVHD data structure
  * \param [in] blk The block for which to read the sector bitmap from
@@ -108,36 +155,62 @@ mvhd_write_empty_sectors(FILE *f, int sector_count)
 static void
 read_sect_bitmap(MVHDMeta *vhdm, int blk)
 {
-    if (vhdm->block_offset[blk] != MVHD_SPARSE_BLK) {
-        mvhd_fseeko64(vhdm->f, (uint64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE, SEEK_SET);
-        if (!fread(vhdm->bitmap.curr_bitmap, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE, 1, vhdm->f))
-            vhdm->error = 1;
-    } else
-        memset(vhdm->bitmap.curr_bitmap, 0, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE);
+    uint8_t *bitmap = vhdm->bitmap.cache[blk];
+
+    if (bitmap == NULL) {
+        bitmap = malloc(vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE);
+        if (bitmap != NULL)
+            vhdm->bitmap.cache[blk] = bitmap;
+        else {
+            /* Out of memory, fall back to an uncached bitmap. Changes to it
+               are written back right away, so it can simply be reused. */
+            bitmap = vhdm->bitmap.spare_bitmap;
+        }
+
+        if (vhdm->block_offset[blk] != MVHD_SPARSE_BLK) {
+            mvhd_fseeko64(vhdm->f, (uint64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE, SEEK_SET);
+            if (!vhd_fread(vhdm, bitmap, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE, 1))
+                vhdm->error = 1;
+        } else
+            memset(bitmap, 0, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE);
+    }
 
+    vhdm->bitmap.curr_bitmap = bitmap;
     vhdm->bitmap.curr_block = blk;
 }
 
 /**
- * \brief Write the current sector bitmap in memory to file
+ * \brief Mark the current sector bitmap in memory as changed
+ *
+ * Cached bitmaps are written back by mvhd_flush(), an uncached one is
+ * written to file straight away. A write that finds them held back for
+ * longer than MVHD_FLUSH_INTERVAL calls mvhd_flush() itself.
  *
  * \param [in] vhdm MiniVHD data structure
  */
 static void
 write_curr_sect_bitmap(MVHDMeta* vhdm)
 {
-    if (vhdm->bitmap.curr_block >= 0) {
-        int64_t abs_offset = (int64_t)vhdm->block_offset[vhdm->bitmap.curr_block] * MVHD_SECTOR_SIZE;
-        if (mvhd_fseeko64(vhdm->f, abs_offset, SEEK_SET) == -1)
-            vhdm->error = 1;
-        if (!fwrite(vhdm->bitmap.curr_bitmap, MVHD_SECTOR_SIZE, vhdm->bitmap.sector_count, vhdm->f))
-            vhdm->error = 1;
-    }
+    int blk = vhdm->bitmap.curr_block;
+
+    if (blk < 0)
+        return;
+
+    if (vhdm->bitmap.curr_bitmap == vhdm->bitmap.cache[blk]) {
+        vhdm->bitmap.dirty[blk] = 1;
+        vhdm->bitmap.any_dirty = true;
+    } else
+        write_sect_bitmap(vhdm, blk, vhdm->bitmap.curr_bitmap);
 }
 
 /**
  * \brief Write block offset from memory into file
  *
+ * This is not deferred like the sector bitmaps: the block has just been
+ * appended to the file, and without its BAT entry it would be lost for
+ * good if the emulator does not get to close the image. A lost bitmap
+ * update only loses the sectors written since the last mvhd_flush().
+ *
  * \param [in] vhdm MiniVHD data structure
  * \param [in] blk The block for which to write the offset for
  */
@@ -149,9 +222,153 @@ write_bat_entry(MVHDMeta *vhdm, int blk)
 
     if (mvhd_fseeko64(vhdm->f, table_offset, SEEK_SET) == -1)
         vhdm->error = 1;
-    if (!fwrite(&offset, sizeof offset, 1, vhdm->f))
+    if (!vhd_fwrite(vhdm, &offset, sizeof offset, 1))
+        vhdm->error = 1;
+    if (fflush(vhdm->f))
         vhdm->error = 1;
-    fflush(vhdm->f);
+}
+
+/**
+ * \brief Drop the cached data chunks that reach past a file sector
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] sector The first file sector that has changed
+ */
+static void
+cache_invalidate_from(MVHDMeta *vhdm, uint64_t sector)
+{
+    if (vhdm->cache == NULL)
+        return;
+
+    for (int set = 0; set < MVHD_CACHE_SETS; set++) {
+        for (int way = 0; way < MVHD_CACHE_WAYS; way++) {
+            MVHDCacheChunk *chunk = &vhdm->cache->chunks[set][way];
+
+            if ((chunk->sector != UINT64_MAX) && ((chunk->sector + MVHD_CACHE_CHUNK_SECT) > sector))
+                chunk->sector = UINT64_MAX;
+        }
+    }
+}
+
+static bool
+cache_alloc(MVHDMeta *vhdm)
+{
+    MVHDDataCache *cache = calloc(1, sizeof *cache);
+
+    if (cache == NULL)
+        return false;
+
+    cache->buffer = malloc((size_t)MVHD_CACHE_SETS * MVHD_CACHE_WAYS * MVHD_CACHE_CHUNK_SECT * MVHD_SECTOR_SIZE);
+    if (cache->buffer == NULL) {
+        free(cache);
+        return false;
+    }
+
+    for (int set = 0; set < MVHD_CACHE_SETS; set++) {
+        for (int way = 0; way < MVHD_CACHE_WAYS; way++) {
+            cache->chunks[set][way].sector = UINT64_MAX;
+            cache->chunks[set][way].data = cache->buffer +
+                ((size_t)((set * MVHD_CACHE_WAYS) + way) * MVHD_CACHE_CHUNK_SECT * MVHD_SECTOR_SIZE);
+        }
+    }
+
+    vhdm->cache = cache;
+    return true;
+}
+
+static MVHDCacheChunk *
+cache_find(MVHDMeta *vhdm, uint64_t chunk_sector)
+{
+    int set = (int)((chunk_sector / MVHD_CACHE_CHUNK_SECT) % MVHD_CACHE_SETS);
+
+    for (int way = 0; way < MVHD_CACHE_WAYS; way++) {
+        if (vhdm->cache->chunks[set][way].sector == chunk_sector)
+            return &vhdm->cache->chunks[set][way];
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Read a data sector of a sparse image through the data cache
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] sector The sector, counted from the start of the file
+ * \param [out] buff Where to store the sector
+ */
+static void
+cache_read_sector(MVHDMeta *vhdm, uint64_t sector, uint8_t *buff)
+{
+    uint64_t        chunk_sector = sector - (sector % MVHD_CACHE_CHUNK_SECT);
+    MVHDCacheChunk *chunk;
+    size_t          num_read;
+
+    if ((vhdm->cache == NULL) && !cache_alloc(vhdm)) {
+        mvhd_fseeko64(vhdm->f, (int64_t)sector * MVHD_SECTOR_SIZE, SEEK_SET);
+        if (!vhd_fread(vhdm, buff, MVHD_SECTOR_SIZE, 1) && !feof(vhdm->f))
+            vhdm->error = 1;
+        return;
+    }
+
+    chunk = cache_find(vhdm, chunk_sector);
+    if (chunk != NULL)
+        vhdm->stats.cache_hits++;
+    else {
+        int set = (int)((chunk_sector / MVHD_CACHE_CHUNK_SECT) % MVHD_CACHE_SETS);
+
+        /* Evict the least recently used chunk of the set. */
+        chunk = &vhdm->cache->chunks[set][0];
+        for (int way = 1; way < MVHD_CACHE_WAYS; way++) {
+            MVHDCacheChunk *c = &vhdm->cache->chunks[set][way];
+
+            if ((c->sector == UINT64_MAX) ||
+                ((chunk->sector != UINT64_MAX) && (c->last_use < chunk->last_use)))
+                chunk = c;
+        }
+
+        vhdm->stats.cache_misses++;
+        chunk->sector = UINT64_MAX;
+        mvhd_fseeko64(vhdm->f, (int64_t)chunk_sector * MVHD_SECTOR_SIZE, SEEK_SET);
+        num_read = vhd_fread(vhdm, chunk->data, MVHD_SECTOR_SIZE, MVHD_CACHE_CHUNK_SECT);
+        if ((num_read < MVHD_CACHE_CHUNK_SECT) && !feof(vhdm->f)) {
+            vhdm->error = 1;
+            memset(buff, 0, MVHD_SECTOR_SIZE);
+            return;
+        }
+        /* Past the end of the file reads as zero, like it did uncached. */
+        memset(chunk->data + (num_read * MVHD_SECTOR_SIZE), 0,
+               (MVHD_CACHE_CHUNK_SECT - num_read) * MVHD_SECTOR_SIZE);
+        chunk->sector = chunk_sector;
+    }
+
+    chunk->last_use = ++vhdm->cache->clock;
+    memcpy(buff, chunk->data + ((sector - chunk_sector) * MVHD_SECTOR_SIZE), MVHD_SECTOR_SIZE);
+}
+
+/**
+ * \brief Keep the data cache in step with sectors written to the file
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] sector The first sector written, counted from the start of the file
+ * \param [in] count The number of sectors written
+ * \param [in] buff The data written
+ */
+static void
+cache_update(MVHDMeta *vhdm, uint64_t sector, int count, const uint8_t *buff)
+{
+    MVHDCacheChunk *chunk;
+    uint64_t        chunk_sector;
+
+    if (vhdm->cache == NULL)
+        return;
+
+    for (int i = 0; i < count; i++, sector++) {
+        chunk_sector = sector - (sector % MVHD_CACHE_CHUNK_SECT);
+        chunk = cache_find(vhdm, chunk_sector);
+        if (chunk != NULL)
+            memcpy(chunk->data + ((sector - chunk_sector) * MVHD_SECTOR_SIZE),
+                   buff + ((size_t)i * MVHD_SECTOR_SIZE), MVHD_SECTOR_SIZE);
+    }
 }
 
 /**
@@ -175,24 +392,28 @@ create_block(MVHDMeta *vhdm, int blk)
 
     /* Seek to where the footer SHOULD be */
     mvhd_fseeko64(vhdm->f, -MVHD_FOOTER_SIZE, SEEK_END);
-    (void) !fread(footer, sizeof footer, 1, vhdm->f);
+    (void) !vhd_fread(vhdm, footer, sizeof footer, 1);
     mvhd_fseeko64(vhdm->f, -MVHD_FOOTER_SIZE, SEEK_END);
 
     if (!mvhd_is_conectix_str(footer)) {
         /* Oh dear. We use the header instead, since something has gone wrong at the footer */
         mvhd_fseeko64(vhdm->f, 0, SEEK_SET);
-        if (!fread(footer, sizeof footer, 1, vhdm->f))
+        if (!vhd_fread(vhdm, footer, sizeof footer, 1))
             vhdm->error = 1;
         mvhd_fseeko64(vhdm->f, 0, SEEK_END);
     }
 
     int64_t abs_offset = mvhd_ftello64(vhdm->f);
+
+    /* Everything from here on is about to be overwritten. */
+    cache_invalidate_from(vhdm, (uint64_t)abs_offset / MVHD_SECTOR_SIZE);
+
     if ((abs_offset % MVHD_SECTOR_SIZE) != 0) {
         /* Yikes! We're supposed to be on a sector boundary. Add some padding */
         int64_t padding_amount = ((int64_t) MVHD_SECTOR_SIZE) - (abs_offset % MVHD_SECTOR_SIZE);
         uint8_t zero_byte = 0;
         for (int i = 0; i < padding_amount; i++) {
-            if (!fwrite(&zero_byte, sizeof zero_byte, 1, vhdm->f))
+            if (!vhd_fwrite(vhdm, &zero_byte, sizeof zero_byte, 1))
                 vhdm->error = 1;
         }
         abs_offset += padding_amount;
@@ -208,14 +429,14 @@ create_block(MVHDMeta *vhdm, int blk)
         vhdm->error = 1;
 
     /* And we finish with the footer */
-    if (!fwrite(footer, sizeof footer, 1, vhdm->f))
+    if (!vhd_fwrite(vhdm, footer, sizeof footer, 1))
         vhdm->error = 1;
 
     /* We no longer have a sparse block. Update that BAT! */
     vhdm->block_offset[blk] = sect_offset;
     write_bat_entry(vhdm, blk);
 
-    fflush(vhdm->f);
+    vhdm->stats.blocks_allocated++;
 }
 
 int
@@ -230,7 +451,7 @@ mvhd_fixed_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff
     addr = ((int64_t) offset) * MVHD_SECTOR_SIZE;
     if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
         vhdm->error = 1;
-    if (!fread(out_buff, transfer_sectors * MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
+    if (!vhd_fread(vhdm, out_buff, transfer_sectors * MVHD_SECTOR_SIZE, 1) && !feof(vhdm->f))
         vhdm->error = 1;
 
     return truncated_sectors;
@@ -246,38 +467,24 @@ mvhd_sparse_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buf
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
     uint8_t* buff = (uint8_t*)out_buff;
-    int64_t addr = 0ULL;
+    uint64_t addr = 0ULL;
     uint32_t s = 0;
     uint32_t ls = 0;
     int blk = 0;
-    int prev_blk = -1;
     int sib = 0;
     ls = offset + transfer_sectors;
 
     for (s = offset; s < ls; s++) {
         blk = s / vhdm->sect_per_block;
         sib = s % vhdm->sect_per_block;
-        if (blk != prev_blk) {
-            prev_blk = blk;
-            if (vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(vhdm, blk);
-                if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                    vhdm->error = 1;
-            } else {
-                addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                       MVHD_SECTOR_SIZE;
-                if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                    vhdm->error = 1;
-            }
-        }
+        if (vhdm->bitmap.curr_block != blk)
+            read_sect_bitmap(vhdm, blk);
 
         if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib)) {
-            if (!fread(buff, MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
-                vhdm->error = 1;
-        } else {
+            addr = ((uint64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib;
+            cache_read_sector(vhdm, addr, buff);
+        } else
             memset(buff, 0, MVHD_SECTOR_SIZE);
-            mvhd_fseeko64(vhdm->f, MVHD_SECTOR_SIZE, SEEK_CUR);
-        }
         buff += MVHD_SECTOR_SIZE;
     }
 
@@ -345,9 +552,8 @@ mvhd_fixed_write(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *in_buff
     addr = (int64_t)offset * MVHD_SECTOR_SIZE;
     if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
         vhdm->error = 1;
-    if (!fwrite(in_buff, transfer_sectors * MVHD_SECTOR_SIZE, 1, vhdm->f))
+    if (!vhd_fwrite(vhdm, in_buff, transfer_sectors * MVHD_SECTOR_SIZE, 1))
         vhdm->error = 1;
-    fflush(vhdm->f);
 
     return truncated_sectors;
 }
@@ -362,55 +568,47 @@ mvhd_sparse_diff_write(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *i
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
     uint8_t* buff = (uint8_t *) in_buff;
-    int64_t addr = 0ULL;
+    uint64_t addr = 0ULL;
     uint32_t s = 0;
     uint32_t ls = 0;
     int blk = 0;
-    int prev_blk = -1;
     int sib = 0;
+    int run = 0;
     ls = offset + transfer_sectors;
 
     if (offset < total_sectors) {
-        for (s = offset; s < ls; s++) {
+        /* Sectors within a block are contiguous in the file, so each block
+           visited takes a single write. */
+        for (s = offset; s < ls; s += run) {
             blk = s / vhdm->sect_per_block;
             sib = s % vhdm->sect_per_block;
-            if (vhdm->bitmap.curr_block != blk && prev_blk >= 0) {
-                /* Write the sector bitmap for the previous block, before we replace it. */
-                write_curr_sect_bitmap(vhdm);
-            }
+            run = vhdm->sect_per_block - sib;
+            if ((uint32_t) run > (ls - s))
+                run = ls - s;
 
-            if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK) {
-                /* "read" the sector bitmap first, before creating a new block, as the bitmap will be
-                   zero either way */
+            if (vhdm->bitmap.curr_block != blk)
                 read_sect_bitmap(vhdm, blk);
-                create_block(vhdm, blk);
-            }
 
-            if (blk != prev_blk) {
-                if (vhdm->bitmap.curr_block != blk) {
-                    read_sect_bitmap(vhdm, blk);
-                    if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                        vhdm->error = 1;
-                } else {
-                    addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                           MVHD_SECTOR_SIZE;
-                    if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                        vhdm->error = 1;
-                }
-                prev_blk = blk;
-            }
+            if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK)
+                create_block(vhdm, blk);
 
-            if (!fwrite(buff, MVHD_SECTOR_SIZE, 1, vhdm->f))
+            addr = ((uint64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib;
+            if (mvhd_fseeko64(vhdm->f, (int64_t)addr * MVHD_SECTOR_SIZE, SEEK_SET) == -1)
                 vhdm->error = 1;
-            VHD_SETBIT(vhdm->bitmap.curr_bitmap, sib);
-            buff += MVHD_SECTOR_SIZE;
-        }
-    }
+            if (!vhd_fwrite(vhdm, buff, MVHD_SECTOR_SIZE, run))
+                vhdm->error = 1;
+            cache_update(vhdm, addr, run, buff);
+
+            for (int i = sib; i < (sib + run); i++)
+                VHD_SETBIT(vhdm->bitmap.curr_bitmap, i);
+            write_curr_sect_bitmap(vhdm);
 
-    /* And write the sector bitmap for the last block we visited to disk */
-    write_curr_sect_bitmap(vhdm);
+            buff += (size_t)run * MVHD_SECTOR_SIZE;
+        }
 
-    fflush(vhdm->f);
+        if (vhdm->bitmap.any_dirty && ((time(NULL) - vhdm->last_flush) >= MVHD_FLUSH_INTERVAL))
+            mvhd_flush(vhdm);
+    }
 
     return truncated_sectors;
 }
@@ -425,3 +623,69 @@ mvhd_noop_write(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *in_buff)
 
     return 0;
 }
+
+MVHDAPI int
+mvhd_flush(MVHDMeta* vhdm)
+{
+    if (vhdm == NULL)
+        return -1;
+
+    if (vhdm->readonly)
+        return 0;
+
+    if (vhdm->bitmap.any_dirty) {
+        for (uint32_t blk = 0; blk < vhdm->sparse.max_bat_ent; blk++) {
+            if (vhdm->bitmap.dirty[blk]) {
+                write_sect_bitmap(vhdm, blk, vhdm->bitmap.cache[blk]);
+                vhdm->bitmap.dirty[blk] = 0;
+            }
+        }
+        vhdm->bitmap.any_dirty = false;
+    }
+
+    if (fflush(vhdm->f))
+        vhdm->error = 1;
+
+    vhdm->last_flush = time(NULL);
+    vhdm->stats.metadata_flushes++;
+
+    return vhdm->error ? -1 : 0;
+}
+
+MVHDAPI void
+mvhd_get_stats(MVHDMeta* vhdm, MVHDStats* stats)
+{
+    *stats = vhdm->stats;
+
+    for (MVHDMeta* par = vhdm->parent; par != NULL; par = par->parent) {
+        stats->host_reads += par->stats.host_reads;
+        stats->host_writes += par->stats.host_writes;
+        stats->host_read_bytes += par->stats.host_read_bytes;
+        stats->host_write_bytes += par->stats.host_write_bytes;
+        stats->cache_hits += par->stats.cache_hits;
+        stats->cache_misses += par->stats.cache_misses;
+    }
+}
+
+void
+mvhd_free_caches(MVHDMeta* vhdm)
+{
+    if (vhdm->bitmap.cache != NULL) {
+        for (uint32_t blk = 0; blk < vhdm->sparse.max_bat_ent; blk++)
+            free(vhdm->bitmap.cache[blk]);
+        free(vhdm->bitmap.cache);
+        vhdm->bitmap.cache = NULL;
+    }
+    free(vhdm->bitmap.dirty);
+    vhdm->bitmap.dirty = NULL;
+    free(vhdm->bitmap.spare_bitmap);
+    vhdm->bitmap.spare_bitmap = NULL;
+    vhdm->bitmap.curr_bitmap = NULL;
+    vhdm->bitmap.curr_block = -1;
+
+    if (vhdm->cache != NULL) {
+        free(vhdm->cache->buffer);
+        free(vhdm->cache);
+        vhdm->cache = NULL;
+    }
+}
@@ -1867,17 +1867,31 @@ dma_mode(int channel)
 void
 dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int TransferSize)
 {
-    uint32_t n;
-    uint32_t n2;
-    uint8_t  bytes[4] = { 0, 0, 0, 0 };
+    const uint8_t *src;
+    uint32_t       n;
+    uint32_t       n2;
+    uint32_t       len;
+    uint32_t       end;
+    uint8_t        bytes[4] = { 0, 0, 0, 0 };
 
     n  = TotalSize & ~(TransferSize - 1);
     n2 = TotalSize - n;
 
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
-            mem_read_phys((void *) &(DataRead[i]), PhysAddress + i, TransferSize);
+    /* Do the divisible block, if there is one. Runs of plain RAM are copied
+       in one go, anything else goes through the mapping handlers. */
+    for (uint32_t i = 0; i < n;) {
+        len = n - i;
+        src = mem_bm_span(PhysAddress + i, &len, 0);
+        len &= ~(TransferSize - 1);
+
+        if ((src != NULL) && len) {
+            memcpy(&(DataRead[i]), src, len);
+            i += len;
+        } else {
+            end = i + MAX(len, (uint32_t) TransferSize);
+            for (; i < end; i += TransferSize)
+                mem_read_phys((void *) &(DataRead[i]), PhysAddress + i, TransferSize);
+        }
     }
 
     /* Do the non-divisible block, if there is one. */
@@ -1890,17 +1904,32 @@ dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int Tra
 void
 dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize, int TransferSize)
 {
+    uint8_t *dest;
     uint32_t n;
     uint32_t n2;
+    uint32_t len;
+    uint32_t end;
     uint8_t  bytes[4] = { 0, 0, 0, 0 };
 
     n  = TotalSize & ~(TransferSize - 1);
     n2 = TotalSize - n;
 
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
-            mem_write_phys((void *) &(DataWrite[i]), PhysAddress + i, TransferSize);
+    /* Do the divisible block, if there is one. Runs of plain RAM are copied
+       in one go, anything else goes through the mapping handlers; either way
+       the whole range is invalidated at the end. */
+    for (uint32_t i = 0; i < n;) {
+        len  = n - i;
+        dest = mem_bm_span(PhysAddress + i, &len, 1);
+        len &= ~(TransferSize - 1);
+
+        if ((dest != NULL) && len) {
+            memcpy(dest, &(DataWrite[i]), len);
+            i += len;
+        } else {
+            end = i + MAX(len, (uint32_t) TransferSize);
+            for (; i < end; i += TransferSize)
+                mem_write_phys((void *) &(DataWrite[i]), PhysAddress + i, TransferSize);
+        }
     }
 
     /* Do the non-divisible block, if there is one. */
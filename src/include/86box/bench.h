@@ -0,0 +1,25 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the headless benchmark mode.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#ifndef EMU_BENCH_H
+#define EMU_BENCH_H
+
+extern int  bench_seconds;    /* emulated seconds to run for, 0 if not benchmarking */
+extern char bench_path[1024]; /* report file, stdout if empty */
+
+extern void bench_start(void);
+extern int  bench_frame(void);
+extern void bench_report(void);
+
+#endif /*EMU_BENCH_H*/
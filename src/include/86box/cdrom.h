@@ -372,6 +372,8 @@ typedef struct cdrom {
     uint8_t            mode2;
 
     int                no_check;
+    /* Keep the layout of Virtual ISOs in an index so remounts are quick. */
+    int                viso_index;
 
     uint8_t            _F_LUT[_LUT_SIZE];
     uint8_t            _B_LUT[_LUT_SIZE];
@@ -31,8 +31,12 @@ typedef struct track_file_t {
     void *log;
 
     int motorola;
+    /* Set by backends which do their own caching. */
+    int no_cache;
 } track_file_t;
 
 extern void *image_open(cdrom_t *dev, const char *path);
 
+extern void  cdrom_image_cache_stats_dump(void);
+
 #endif /*CDROM_IMAGE_H*/
@@ -0,0 +1,35 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          CHD CD-ROM image back-end header.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#ifndef CDROM_IMAGE_CHD_H
+#define CDROM_IMAGE_CHD_H
+
+typedef struct chd_track_info_t {
+    char     type[32];    /* MODE1, MODE1_RAW, MODE2_FORM1, AUDIO, etc. */
+    char     subtype[32]; /* NONE, RW, or RW_RAW. */
+    uint32_t frames;      /* Including the pre-gap, if it is in the image. */
+    uint32_t pregap;
+    uint32_t postgap;
+    int      pregap_in_file;
+    uint64_t first_frame;
+} chd_track_info_t;
+
+/* CHD functions. The image stays open for as long as the caller or any
+   of its track files still hold a reference to it. */
+extern void         *chd_image_open(const uint8_t id, const char *filename, int *tracks);
+extern int           chd_image_get_track_info(void *priv, int track, chd_track_info_t *ti);
+extern track_file_t *chd_image_track_init(void *priv, int track, uint32_t sector_size, int motorola);
+extern void          chd_image_release(void *priv);
+
+#endif /*CDROM_IMAGE_CHD_H*/
@@ -156,7 +156,8 @@ typedef struct hard_disk_t {
                                         Bit 1 = DMA supportd. */
     uint8_t            wp;           /* Disk has been mounted
                                         READ-ONLY */
-    uint8_t            pad;
+    uint8_t            mmap;         /* Map RAW, HDI, and HDX images
+                                        into memory */
     uint8_t            pad0;
 
     void              *priv;
@@ -201,6 +202,7 @@ typedef struct hard_disk_t {
 
 extern hard_disk_t  hdd[HDD_NUM];
 extern unsigned int hdd_table[128][3];
+extern char         hdd_overlay_path[1024];
 
 extern int   hdd_init(void);
 extern int   hdd_string_to_bus(char *str, int cdrom);
@@ -216,12 +218,20 @@ extern int      hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uin
 extern int      hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count);
 extern int      hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count);
+extern int      hdd_image_flush(uint8_t id);
+extern void     hdd_image_async_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern int      hdd_image_async_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern void     hdd_image_async_flush(uint8_t id);
+extern int      hdd_image_async_busy(uint8_t id);
+extern void     hdd_image_async_wait(uint8_t id);
+extern int      hdd_image_async_result(uint8_t id);
 extern uint32_t hdd_image_get_last_sector(uint8_t id);
 extern uint32_t hdd_image_get_pos(uint8_t id);
 extern uint8_t  hdd_image_get_type(uint8_t id);
 extern void     hdd_image_unload(uint8_t id, int fn_preserve);
 extern void     hdd_image_close(uint8_t id);
 extern void     hdd_image_calc_chs(uint32_t *c, uint32_t *h, uint32_t *s, uint32_t size);
+extern void     hdd_image_vhd_stats_dump(void);
 
 extern int image_is_hdi(const char *s);
 extern int image_is_hdx(const char *s, int check_signature);
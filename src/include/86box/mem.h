@@ -261,11 +261,17 @@ extern uint8_t *rom;
 extern uint32_t biosmask;
 extern uint32_t biosaddr;
 
-extern int        readlookup[256];
+/* Number of live linear-to-host translations kept in each of readlookup2 and
+   writelookup2; must be a power of 2. The tables themselves are direct-mapped
+   over the whole 4 GB linear space, so this only bounds how many pages stay
+   cached between flushes. */
+#define MEM_TLB_SIZE 4096
+
+extern int        readlookup[MEM_TLB_SIZE];
 extern uintptr_t  old_rl2;
 extern uint8_t    uncached;
 extern int        readlnext;
-extern int        writelookup[256];
+extern int        writelookup[MEM_TLB_SIZE];
 
 extern int        writelnext;
 extern uint32_t   ram_mapped_addr[64];
@@ -296,6 +302,41 @@ extern int shadowbios_write;
 extern int readlnum;
 extern int writelnum;
 
+typedef struct mem_tlb_stats_t {
+    uint64_t read_fills;
+    uint64_t write_fills;
+    uint64_t read_evictions;
+    uint64_t write_evictions;
+    uint64_t flushes;
+    uint64_t write_flushes;
+    uint64_t page_flushes;
+    uint64_t read_hits;  /* Only counted with USE_INSTRUMENT */
+    uint64_t write_hits; /* Only counted with USE_INSTRUMENT */
+} mem_tlb_stats_t;
+
+extern mem_tlb_stats_t mem_tlb_stats;
+
+/* Hits are taken inline on every guest memory access, so they are only
+   counted in instrumented builds. The calls keep two accesses in one
+   expression from updating a counter unsequenced. */
+#ifdef USE_INSTRUMENT
+static __inline void
+mem_tlb_read_hit(void)
+{
+    mem_tlb_stats.read_hits++;
+}
+
+static __inline void
+mem_tlb_write_hit(void)
+{
+    mem_tlb_stats.write_hits++;
+}
+
+#    define MEM_TLB_HIT(type) mem_tlb_##type##_hit()
+#else
+#    define MEM_TLB_HIT(type) ((void) 0)
+#endif
+
 extern int memspeed[11];
 
 extern uint8_t high_page; /* if a high (> 4 gb) page was detected */
@@ -416,6 +457,7 @@ extern void     mem_writeb_phys(uint32_t addr, uint8_t val);
 extern void     mem_writew_phys(uint32_t addr, uint16_t val);
 extern void     mem_writel_phys(uint32_t addr, uint32_t val);
 extern void     mem_write_phys(void *src, uint32_t addr, int tranfer_size);
+extern uint8_t *mem_bm_span(uint32_t addr, uint32_t *len, int write);
 
 extern uint8_t  mem_read_ram(uint32_t addr, void *priv);
 extern uint16_t mem_read_ramw(uint32_t addr, void *priv);
@@ -449,6 +491,9 @@ extern void flushmmucache_write(void);
 extern void flushmmucache_pc(void);
 extern void flushmmucache_nopc(void);
 
+extern void mem_tlb_stats_reset(void);
+extern void mem_tlb_stats_dump(void);
+
 extern void mem_debug_check_addr(uint32_t addr, int write);
 
 extern void mem_a20_init(void);
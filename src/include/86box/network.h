@@ -44,6 +44,13 @@
 #define EMU_NETWORK_H
 #include <stdint.h>
 
+#ifdef __cplusplus
+#    include <atomic>
+using atomic_uint = std::atomic_uint;
+#else
+#    include <stdatomic.h>
+#endif
+
 /* Network provider types. */
 #define NET_TYPE_NONE     0 /* use the null network driver */
 #define NET_TYPE_SLIRP    1 /* use the SLiRP port forwarder */
@@ -54,10 +61,10 @@
 #define NET_TYPE_NRSWITCH 6 /* use the network remote switch provider */
 
 #define NET_MAX_FRAME  1518
-/* Queue size must be a power of 2 */
-#define NET_QUEUE_LEN      16
-#define NET_QUEUE_LEN_MASK (NET_QUEUE_LEN - 1)
-#define NET_QUEUE_COUNT    4
+/* Queue sizes must be a power of 2 */
+#define NET_QUEUE_LEN      16 /* default, also the packet batch size */
+#define NET_QUEUE_LEN_MAX  1024
+#define NET_QUEUE_COUNT    5
 #define NET_CARD_MAX       4
 #define NET_HOST_INTF_MAX  64
 
@@ -87,7 +94,8 @@ enum {
     NET_QUEUE_RX       = 0,
     NET_QUEUE_TX_VM    = 1,
     NET_QUEUE_TX_HOST  = 2,
-    NET_QUEUE_RX_ON_TX = 3
+    NET_QUEUE_RX_ON_TX = 3,
+    NET_QUEUE_RX_LOCAL = 4  /* looped back by the card, emulation thread only */
 };
 
 typedef struct netcard_conf_t {
@@ -98,6 +106,8 @@ typedef struct netcard_conf_t {
     uint8_t  switch_group;
     uint8_t  promisc_mode;
     char     nrs_hostname[128];
+    uint16_t queue_len;
+    uint8_t  tap_offload;
 } netcard_conf_t;
 
 extern netcard_conf_t net_cards_conf[NET_CARD_MAX];
@@ -112,10 +122,22 @@ typedef struct netpkt {
     int      len;
 } netpkt_t;
 
+/*
+   Single producer, single consumer ring. Only the producer moves head and
+   only the consumer moves tail, so neither side has to take a lock. Both
+   run freely and are masked on use, so all slots can be filled.
+ */
 typedef struct netqueue_t {
-    netpkt_t packets[NET_QUEUE_LEN];
-    int      head;
-    int      tail;
+    netpkt_t   *packets;
+    uint32_t    size;
+    uint32_t    mask;
+    atomic_uint head;
+    atomic_uint tail;
+
+    /* Statistics, only updated by the producer. */
+    atomic_uint packets_in;
+    atomic_uint drops;
+    atomic_uint peak;
 } netqueue_t;
 
 typedef struct _netcard_t netcard_t;
@@ -141,9 +163,8 @@ struct _netcard_t {
     NETRXCB         rx;
     NETSETLINKSTATE set_link_state;
     netqueue_t      queues[NET_QUEUE_COUNT];
-    netpkt_t        queued_pkt;
-    mutex_t        *tx_mutex;
-    mutex_t        *rx_mutex;
+    atomic_uint     rx_stalls; /* the card did not take a packet */
+    atomic_uint     tx_stalls; /* the host queue was full */
     pc_timer_t      timer;
     uint16_t        card_num;
     double          byte_period;
@@ -187,6 +208,7 @@ extern void       network_close(void);
 extern void       network_reset(void);
 extern int        network_available(void);
 extern void       network_tx(netcard_t *card, uint8_t *, int);
+extern void       network_stats_dump(void);
 
 extern int net_pcap_prepare(netdev_t *);
 extern int net_vde_prepare(void);
@@ -50,10 +50,18 @@ typedef struct pc_timer_t {
     void (*callback)(void *priv);
     void *priv;
 
-    struct pc_timer_t *prev;
-    struct pc_timer_t *next;
+    uint32_t heap_idx; /* Position in the timer queue, 0 if not queued. */
+    uint32_t seq;      /* Insertion order, used to break timestamp ties. */
+    uint64_t fired;    /* Number of times the callback has been called. */
 } pc_timer_t;
 
+/*Scheduler counters, reset by timer_init().*/
+typedef struct timer_stats_t {
+    uint64_t enables;
+    uint64_t callbacks;
+    uint32_t peak_queued;
+} timer_stats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -70,6 +78,21 @@ extern void timer_disable(pc_timer_t *timer);
 /*Process any pending timers*/
 extern void timer_process(void);
 
+/*Scheduler counters*/
+extern timer_stats_t timer_stats;
+
+/*Log every queued timer with its callback count, busiest first*/
+extern void timer_dump_stats(void);
+
+/*Host time profiler for timer callbacks, see timer_prof.c*/
+extern int  timer_prof_enabled;
+extern int  timer_prof_reset_pending; /* set by other threads, acted on by pc_run() */
+extern char timer_prof_path[1024];
+extern void timer_prof_call(pc_timer_t *timer);
+extern void timer_prof_reset(void);
+extern void timer_prof_dump(const char *path);
+extern void timer_prof_foreach(void (*func)(const char *name, uint64_t calls, uint64_t ns, void *priv), void *priv);
+
 /*Reset timer system*/
 extern void timer_close(void);
 extern void timer_init(void);
@@ -0,0 +1,48 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Span kernels for the 2D accelerator fast paths.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#ifndef VIDEO_ACCEL_SPAN_H
+#define VIDEO_ACCEL_SPAN_H
+
+/* Each kernel writes count pixels to dst, size being the log2 of the pixel
+   width in bytes (0 = 8bpp, 1 = 16bpp, 2 = 32bpp).
+
+   fill    - every pixel set to color.
+   pattern - pixel i set to pat[(phase + i) & 7].
+   expand  - monochrome expansion: bit (bit + i) of bits, most significant
+             bit first, selects fg when set, and bg (or, if transparent, the
+             existing pixel) when clear. */
+typedef struct accel_span_kernels_t {
+    const char *name;
+    void (*fill)(uint8_t *dst, uint32_t color, int count, int size);
+    void (*pattern)(uint8_t *dst, const uint32_t *pat, int phase, int count, int size);
+    void (*expand)(uint8_t *dst, const uint8_t *bits, int bit, int count,
+                   uint32_t fg, uint32_t bg, int transparent, int size);
+} accel_span_kernels_t;
+
+extern const accel_span_kernels_t *accel_span_kernels;
+
+/* Cleared to send every operation down the blitters' per-pixel paths. */
+extern int accel_span_fast;
+
+extern void accel_span_kernels_init(void);
+extern void accel_span_bench_blit(const char *name, void (*blit)(void *priv, int op), void *priv, int op,
+                                  uint8_t *vram, uint32_t vram_size, int pixels);
+extern void accel_span_benchmark(void);
+
+/* Blitter level benchmarks, in the drivers. */
+extern void s3_accel_benchmark(void);
+extern void mach64_accel_benchmark(void);
+
+#endif /*VIDEO_ACCEL_SPAN_H*/
@@ -83,4 +83,21 @@ extern void ibm8514_render_RGBA8888(svga_t *svga);
 
 extern void (*svga_render)(svga_t *svga);
 
+/* Pixel format conversion kernels used by the direct colour renderers on
+   contiguous runs of VRAM; see vid_svga_render_simd.c. */
+typedef void (*svga_conv_func_t)(uint32_t *dst, const uint8_t *src, int count);
+
+typedef struct svga_render_kernels_t {
+    const char      *name;
+    svga_conv_func_t conv_15bpp;
+    svga_conv_func_t conv_16bpp;
+    svga_conv_func_t conv_24bpp;
+    svga_conv_func_t conv_32bpp;
+} svga_render_kernels_t;
+
+extern const svga_render_kernels_t *svga_render_kernels;
+
+extern void svga_render_kernels_init(void);
+extern void svga_render_benchmark(void);
+
 #endif /*VID_SVGA_RENDER_H*/
@@ -0,0 +1,1509 @@
+/*AArch64 recompiler for the Voodoo pixel pipeline.
+
+  Blocks are cached on the same keys as the x86-64 recompiler :
+
+  alphaMode
+  fbzMode
+  fogMode
+  fbzColorPath
+  textureMode[0/1]
+  tLOD[0/1] & LOD_MASK
+  trexInit1[0] & (1 << 18)
+  col_tiled / aux_tiled
+
+  Everything else (colours, fog table, chroma key, clip, texture masks) is
+  read from the params at run time. The generated code follows the
+  interpreter in vid_voodoo_render.c exactly, including its rounding. Modes
+  the interpreter treats as fatal are not compiled; voodoo_get_block()
+  returns NULL for those and the span is drawn by the interpreter instead.
+
+  Registers :
+
+  X19 - state
+  X20 - params
+  W21 - real_y
+  X22 - voodoo
+  X23 - fb_mem
+  X24 - aux_mem
+  W25 - x
+  W26 - x2
+  W27 - x_tiled
+  W28 - 0xff
+
+  W8  - w_depth
+  W9  - new_depth
+  W10-W12 - src_r, src_g, src_b
+  W13 - src_a
+  W14 - alocal
+  W15 - aother
+  W5-W7   - colour before fog
+
+  W0-W4, X16 and X17 are scratch. Texture fetches may use any of the
+  caller-saved registers apart from W8 and W9.
+*/
+
+#ifndef VIDEO_VOODOO_CODEGEN_ARM64_H
+#define VIDEO_VOODOO_CODEGEN_ARM64_H
+
+#if defined(__APPLE__)
+#    include <pthread.h>
+#endif
+#ifdef _MSC_VER
+#    include <windows.h>
+#endif
+
+#define BLOCK_NUM  8
+#define BLOCK_MASK (BLOCK_NUM - 1)
+#define BLOCK_SIZE 8192
+
+#define LOD_MASK   (LOD_TMIRROR_S | LOD_TMIRROR_T)
+
+typedef struct voodoo_arm64_data_t {
+    uint8_t  code_block[BLOCK_SIZE];
+    int      xdir;
+    uint32_t alphaMode;
+    uint32_t fbzMode;
+    uint32_t fogMode;
+    uint32_t fbzColorPath;
+    uint32_t textureMode[2];
+    uint32_t tLOD[2];
+    uint32_t trexInit1;
+    int      col_tiled;
+    int      aux_tiled;
+    int      valid;
+} voodoo_arm64_data_t;
+
+static int last_block[VOODOO_MAX_RENDER_THREADS]          = { 0 };
+static int next_block_to_write[VOODOO_MAX_RENDER_THREADS] = { 0 };
+
+/*Past the end of the block, instructions are only counted, so that
+  voodoo_generate() can find out the block was too large and reject it*/
+#define addlong(val)                                    \
+    do {                                                \
+        if ((block_pos + 4) <= BLOCK_SIZE)              \
+            *(uint32_t *) &code_block[block_pos] = val; \
+        block_pos += 4;                                 \
+    } while (0)
+
+#define A64_STATE   19
+#define A64_PARAMS  20
+#define A64_REAL_Y  21
+#define A64_VOODOO  22
+#define A64_FB_MEM  23
+#define A64_AUX_MEM 24
+#define A64_X       25
+#define A64_X2      26
+#define A64_X_TILED 27
+#define A64_FF      28
+#define A64_ZR      31
+#define A64_SP      31
+
+#define A64_W_DEPTH   8
+#define A64_NEW_DEPTH 9
+#define A64_SRC_R     10
+#define A64_SRC_A     13
+#define A64_ALOCAL    14
+#define A64_AOTHER    15
+#define A64_COLBFOG_R 5
+
+#define COND_EQ 0x0
+#define COND_NE 0x1
+#define COND_GE 0xa
+#define COND_LT 0xb
+#define COND_GT 0xc
+#define COND_LE 0xd
+
+#define Rd(x)  (x)
+#define Rn(x)  ((x) << 5)
+#define Rm(x)  ((x) << 16)
+#define Ra(x)  ((x) << 10)
+#define Rt2(x) ((x) << 10)
+
+/*Data processing*/
+#define A64_ADD_REG(d, n, m, lsl)     addlong(0x0b000000 | Rd(d) | Rn(n) | Rm(m) | ((lsl) << 10))
+#define A64_ADD_REG_LSR(d, n, m, lsr) addlong(0x0b400000 | Rd(d) | Rn(n) | Rm(m) | ((lsr) << 10))
+#define A64_ADDX_REG(d, n, m)         addlong(0x8b000000 | Rd(d) | Rn(n) | Rm(m))
+#define A64_ADDX_UXTW(d, n, m, lsl)   addlong(0x8b204000 | Rd(d) | Rn(n) | Rm(m) | ((lsl) << 10))
+#define A64_SUB_REG(d, n, m)          addlong(0x4b000000 | Rd(d) | Rn(n) | Rm(m))
+#define A64_SUBX_REG(d, n, m)         addlong(0xcb000000 | Rd(d) | Rn(n) | Rm(m))
+#define A64_CMP_REG(n, m)             addlong(0x6b000000 | Rd(A64_ZR) | Rn(n) | Rm(m))
+#define A64_ADD_IMM(d, n, imm)        addlong(0x11000000 | Rd(d) | Rn(n) | ((imm) << 10))
+#define A64_ADDX_IMM(d, n, imm)       addlong(0x91000000 | Rd(d) | Rn(n) | ((imm) << 10))
+#define A64_ADDX_IMM_LSL12(d, n, imm) addlong(0x91400000 | Rd(d) | Rn(n) | ((imm) << 10))
+#define A64_SUB_IMM(d, n, imm)        addlong(0x51000000 | Rd(d) | Rn(n) | ((imm) << 10))
+#define A64_SUBS_IMM(d, n, imm)       addlong(0x71000000 | Rd(d) | Rn(n) | ((imm) << 10))
+#define A64_CMP_IMM(n, imm)           A64_SUBS_IMM(A64_ZR, n, imm)
+#define A64_AND_REG(d, n, m)          addlong(0x0a000000 | Rd(d) | Rn(n) | Rm(m))
+#define A64_ORR_REG(d, n, m, lsl)     addlong(0x2a000000 | Rd(d) | Rn(n) | Rm(m) | ((lsl) << 10))
+#define A64_ORR_REG_LSR(d, n, m, lsr) addlong(0x2a400000 | Rd(d) | Rn(n) | Rm(m) | ((lsr) << 10))
+#define A64_EOR_REG(d, n, m)          addlong(0x4a000000 | Rd(d) | Rn(n) | Rm(m))
+#define A64_MVN_REG(d, m)             addlong(0x2a2003e0 | Rd(d) | Rm(m))
+#define A64_MOV_REG(d, m)             A64_ORR_REG(d, A64_ZR, m, 0)
+#define A64_MOVX_REG(d, m)            addlong(0xaa0003e0 | Rd(d) | Rm(m))
+#define A64_NEG_REG(d, m)             A64_SUB_REG(d, A64_ZR, m)
+#define A64_MUL(d, n, m)              addlong(0x1b007c00 | Rd(d) | Rn(n) | Rm(m))
+#define A64_MADD(d, n, m, a)          addlong(0x1b000000 | Rd(d) | Rn(n) | Rm(m) | Ra(a))
+#define A64_MULX(d, n, m)             addlong(0x9b007c00 | Rd(d) | Rn(n) | Rm(m))
+#define A64_UDIVX(d, n, m)            addlong(0x9ac00800 | Rd(d) | Rn(n) | Rm(m))
+#define A64_LSLV(d, n, m)             addlong(0x1ac02000 | Rd(d) | Rn(n) | Rm(m))
+#define A64_LSRV(d, n, m)             addlong(0x1ac02400 | Rd(d) | Rn(n) | Rm(m))
+#define A64_ASRV(d, n, m)             addlong(0x1ac02800 | Rd(d) | Rn(n) | Rm(m))
+#define A64_LSLVX(d, n, m)            addlong(0x9ac02000 | Rd(d) | Rn(n) | Rm(m))
+#define A64_LSRVX(d, n, m)            addlong(0x9ac02400 | Rd(d) | Rn(n) | Rm(m))
+#define A64_CLZ(d, n)                 addlong(0x5ac01000 | Rd(d) | Rn(n))
+#define A64_CLZX(d, n)                addlong(0xdac01000 | Rd(d) | Rn(n))
+#define A64_CSEL(d, n, m, cond)       addlong(0x1a800000 | Rd(d) | Rn(n) | Rm(m) | ((cond) << 12))
+
+#define A64_UBFM(d, n, immr, imms)    addlong(0x53000000 | Rd(d) | Rn(n) | ((immr) << 16) | ((imms) << 10))
+#define A64_SBFM(d, n, immr, imms)    addlong(0x13000000 | Rd(d) | Rn(n) | ((immr) << 16) | ((imms) << 10))
+#define A64_UBFMX(d, n, immr, imms)   addlong(0xd3400000 | Rd(d) | Rn(n) | ((immr) << 16) | ((imms) << 10))
+#define A64_SBFMX(d, n, immr, imms)   addlong(0x93400000 | Rd(d) | Rn(n) | ((immr) << 16) | ((imms) << 10))
+#define A64_LSL_IMM(d, n, sh)         A64_UBFM(d, n, (32 - (sh)) & 31, 31 - (sh))
+#define A64_LSR_IMM(d, n, sh)         A64_UBFM(d, n, sh, 31)
+#define A64_ASR_IMM(d, n, sh)         A64_SBFM(d, n, sh, 31)
+#define A64_ASRX_IMM(d, n, sh)        A64_SBFMX(d, n, sh, 63)
+#define A64_UBFX(d, n, lsb, width)    A64_UBFM(d, n, lsb, (lsb) + (width) -1)
+#define A64_UBFXX(d, n, lsb, width)   A64_UBFMX(d, n, lsb, (lsb) + (width) -1)
+#define A64_SXTH(d, n)                A64_SBFM(d, n, 0, 15)
+
+#define A64_MOVZ(d, imm, hw)          addlong(0x52800000 | Rd(d) | ((imm) << 5) | ((hw) << 21))
+#define A64_MOVK(d, imm, hw)          addlong(0x72800000 | Rd(d) | ((imm) << 5) | ((hw) << 21))
+#define A64_MOVZX(d, imm, hw)         addlong(0xd2800000 | Rd(d) | ((imm) << 5) | ((hw) << 21))
+#define A64_MOVKX(d, imm, hw)         addlong(0xf2800000 | Rd(d) | ((imm) << 5) | ((hw) << 21))
+
+/*Loads and stores. Immediate offsets are unsigned and scaled by the access size*/
+#define A64_LDR_IMM(t, n, offset)   addlong(0xb9400000 | Rd(t) | Rn(n) | (((offset) >> 2) << 10))
+#define A64_STR_IMM(t, n, offset)   addlong(0xb9000000 | Rd(t) | Rn(n) | (((offset) >> 2) << 10))
+#define A64_LDRX_IMM(t, n, offset)  addlong(0xf9400000 | Rd(t) | Rn(n) | (((offset) >> 3) << 10))
+#define A64_STRX_IMM(t, n, offset)  addlong(0xf9000000 | Rd(t) | Rn(n) | (((offset) >> 3) << 10))
+#define A64_LDRB_IMM(t, n, offset)  addlong(0x39400000 | Rd(t) | Rn(n) | ((offset) << 10))
+#define A64_LDR_REG(t, n, m)        addlong(0xb8606800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_STR_REG(t, n, m)        addlong(0xb8206800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_LDRX_REG(t, n, m)       addlong(0xf8606800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_STRX_REG(t, n, m)       addlong(0xf8206800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_LDRB_REG(t, n, m)       addlong(0x38606800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_LDR_SXTW_2(t, n, m)     addlong(0xb860d800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_LDRX_SXTW_3(t, n, m)    addlong(0xf860d800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_LDRH_SXTW_1(t, n, m)    addlong(0x7860d800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_STRH_SXTW_1(t, n, m)    addlong(0x7820d800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_LDRB_UXTW(t, n, m)      addlong(0x38604800 | Rd(t) | Rn(n) | Rm(m))
+#define A64_STP_PREIDX(t, t2, n, o) addlong(0xa9800000 | Rd(t) | Rt2(t2) | Rn(n) | ((((o) >> 3) & 0x7f) << 15))
+#define A64_STP(t, t2, n, o)        addlong(0xa9000000 | Rd(t) | Rt2(t2) | Rn(n) | ((((o) >> 3) & 0x7f) << 15))
+#define A64_LDP_POSTIDX(t, t2, n, o) addlong(0xa8c00000 | Rd(t) | Rt2(t2) | Rn(n) | ((((o) >> 3) & 0x7f) << 15))
+#define A64_LDP(t, t2, n, o)        addlong(0xa9400000 | Rd(t) | Rt2(t2) | Rn(n) | ((((o) >> 3) & 0x7f) << 15))
+
+/*Branches. Forward branches are emitted with a zero offset and patched
+  with voodoo_arm64_branch_set_offset() once the target is known*/
+#define A64_B              addlong(0x14000000)
+#define A64_BCOND(cond)    addlong(0x54000000 | (cond))
+#define A64_CBZ(t)         addlong(0x34000000 | Rd(t))
+#define A64_CBNZ(t)        addlong(0x35000000 | Rd(t))
+#define A64_CBNZX(t)       addlong(0xb5000000 | Rd(t))
+#define A64_TBZ(t, bit, o) addlong(0x36000000 | Rd(t) | ((bit) << 19) | ((((o) >> 2) & 0x3fff) << 5))
+#define A64_RET            addlong(0xd65f03c0)
+
+#define MAX_SKIP_BRANCHES 8
+
+static inline void
+voodoo_arm64_branch_set_offset(uint8_t *code_block, int branch_pos, int dest_pos)
+{
+    uint32_t *opcode;
+    int       offset = (dest_pos - branch_pos) >> 2;
+
+    if ((branch_pos + 4) > BLOCK_SIZE)
+        return;
+
+    opcode = (uint32_t *) &code_block[branch_pos];
+    if ((*opcode & 0x7c000000) == 0x14000000) /*B*/
+        *opcode |= offset & 0x03ffffff;
+    else if ((*opcode & 0x7e000000) == 0x36000000) /*TBZ/TBNZ*/
+        *opcode |= (offset & 0x3fff) << 5;
+    else /*B.cond/CBZ/CBNZ*/
+        *opcode |= (offset & 0x7ffff) << 5;
+}
+
+static inline int
+voodoo_arm64_mov_imm(uint8_t *code_block, int block_pos, int reg, uint32_t imm)
+{
+    A64_MOVZ(reg, imm & 0xffff, 0);
+    if (imm & 0xffff0000)
+        A64_MOVK(reg, imm >> 16, 1);
+
+    return block_pos;
+}
+
+static inline int
+voodoo_arm64_movx_imm(uint8_t *code_block, int block_pos, int reg, uint64_t imm)
+{
+    A64_MOVZX(reg, imm & 0xffff, 0);
+    for (int c = 1; c < 4; c++) {
+        if ((imm >> (c * 16)) & 0xffff)
+            A64_MOVKX(reg, (imm >> (c * 16)) & 0xffff, c);
+    }
+
+    return block_pos;
+}
+
+/*Xd = Xn + offset. Uses X16 for offsets too large to encode*/
+static inline int
+voodoo_arm64_add_offset(uint8_t *code_block, int block_pos, int dst_reg, int base_reg, uint32_t offset)
+{
+    if (offset < 0x1000)
+        A64_ADDX_IMM(dst_reg, base_reg, offset);
+    else {
+        block_pos = voodoo_arm64_mov_imm(code_block, block_pos, 16, offset);
+        A64_ADDX_REG(dst_reg, base_reg, 16);
+    }
+
+    return block_pos;
+}
+
+static inline int
+voodoo_arm64_ldr(uint8_t *code_block, int block_pos, int reg, int base_reg, uint32_t offset)
+{
+    if (!(offset & 3) && offset < (0x1000 << 2))
+        A64_LDR_IMM(reg, base_reg, offset);
+    else {
+        block_pos = voodoo_arm64_mov_imm(code_block, block_pos, 16, offset);
+        A64_LDR_REG(reg, base_reg, 16);
+    }
+
+    return block_pos;
+}
+
+static inline int
+voodoo_arm64_str(uint8_t *code_block, int block_pos, int reg, int base_reg, uint32_t offset)
+{
+    if (!(offset & 3) && offset < (0x1000 << 2))
+        A64_STR_IMM(reg, base_reg, offset);
+    else {
+        block_pos = voodoo_arm64_mov_imm(code_block, block_pos, 16, offset);
+        A64_STR_REG(reg, base_reg, 16);
+    }
+
+    return block_pos;
+}
+
+static inline int
+voodoo_arm64_ldrx(uint8_t *code_block, int block_pos, int reg, int base_reg, uint32_t offset)
+{
+    if (!(offset & 7) && offset < (0x1000 << 3))
+        A64_LDRX_IMM(reg, base_reg, offset);
+    else {
+        block_pos = voodoo_arm64_mov_imm(code_block, block_pos, 16, offset);
+        A64_LDRX_REG(reg, base_reg, 16);
+    }
+
+    return block_pos;
+}
+
+static inline int
+voodoo_arm64_strx(uint8_t *code_block, int block_pos, int reg, int base_reg, uint32_t offset)
+{
+    if (!(offset & 7) && offset < (0x1000 << 3))
+        A64_STRX_IMM(reg, base_reg, offset);
+    else {
+        block_pos = voodoo_arm64_mov_imm(code_block, block_pos, 16, offset);
+        A64_STRX_REG(reg, base_reg, 16);
+    }
+
+    return block_pos;
+}
+
+static inline int
+voodoo_arm64_ldrb(uint8_t *code_block, int block_pos, int reg, int base_reg, uint32_t offset)
+{
+    if (offset < 0x1000)
+        A64_LDRB_IMM(reg, base_reg, offset);
+    else {
+        block_pos = voodoo_arm64_mov_imm(code_block, block_pos, 16, offset);
+        A64_LDRB_REG(reg, base_reg, 16);
+    }
+
+    return block_pos;
+}
+
+#define LDR_STATE(reg, field)   block_pos = voodoo_arm64_ldr(code_block, block_pos, reg, A64_STATE, offsetof(voodoo_state_t, field))
+#define STR_STATE(reg, field)   block_pos = voodoo_arm64_str(code_block, block_pos, reg, A64_STATE, offsetof(voodoo_state_t, field))
+#define LDRX_STATE(reg, field)  block_pos = voodoo_arm64_ldrx(code_block, block_pos, reg, A64_STATE, offsetof(voodoo_state_t, field))
+#define STRX_STATE(reg, field)  block_pos = voodoo_arm64_strx(code_block, block_pos, reg, A64_STATE, offsetof(voodoo_state_t, field))
+#define LDR_PARAMS(reg, field)  block_pos = voodoo_arm64_ldr(code_block, block_pos, reg, A64_PARAMS, offsetof(voodoo_params_t, field))
+#define LDRX_PARAMS(reg, field) block_pos = voodoo_arm64_ldrx(code_block, block_pos, reg, A64_PARAMS, offsetof(voodoo_params_t, field))
+#define LDRB_PARAMS(reg, field) block_pos = voodoo_arm64_ldrb(code_block, block_pos, reg, A64_PARAMS, offsetof(voodoo_params_t, field))
+
+/*voodoo->counter++, using W16 and X17*/
+static inline int
+voodoo_arm64_inc_counter(uint8_t *code_block, int block_pos, uint32_t offset)
+{
+    block_pos = voodoo_arm64_add_offset(code_block, block_pos, 17, A64_VOODOO, offset);
+    A64_LDR_IMM(16, 17, 0);
+    A64_ADD_IMM(16, 16, 1);
+    A64_STR_IMM(16, 17, 0);
+
+    return block_pos;
+}
+
+/*reg = CLAMP(reg)*/
+static inline int
+voodoo_arm64_clamp(uint8_t *code_block, int block_pos, int reg)
+{
+    A64_CMP_IMM(reg, 0);
+    A64_CSEL(reg, A64_ZR, reg, COND_LT);
+    A64_CMP_REG(reg, A64_FF);
+    A64_CSEL(reg, A64_FF, reg, COND_GT);
+
+    return block_pos;
+}
+
+/*reg = CLAMP16(reg), using W17*/
+static inline int
+voodoo_arm64_clamp16(uint8_t *code_block, int block_pos, int reg)
+{
+    A64_CMP_IMM(reg, 0);
+    A64_CSEL(reg, A64_ZR, reg, COND_LT);
+    A64_MOVZ(17, 0xffff, 0);
+    A64_CMP_REG(reg, 17);
+    A64_CSEL(reg, 17, reg, COND_GT);
+
+    return block_pos;
+}
+
+/*dst = src / 255, exact for src < 65536. Uses W17*/
+static inline int
+voodoo_arm64_div255(uint8_t *code_block, int block_pos, int dst_reg, int src_reg)
+{
+    A64_MOVZ(17, 0x8081, 0);
+    A64_MUL(dst_reg, src_reg, 17);
+    A64_LSR_IMM(dst_reg, dst_reg, 23);
+
+    return block_pos;
+}
+
+/*Conditional branch to skip_pixel unless the comparison passed, counting
+  the failure in the given voodoo counter*/
+static inline int
+voodoo_arm64_test_fail(uint8_t *code_block, int block_pos, int pass_cond, uint32_t counter, int *skip_pos, int *nr_skip)
+{
+    int pass_pos = -1;
+
+    if (pass_cond >= 0) {
+        pass_pos = block_pos;
+        A64_BCOND(pass_cond);
+    }
+    block_pos = voodoo_arm64_inc_counter(code_block, block_pos, counter);
+    skip_pos[(*nr_skip)++] = block_pos;
+    A64_B;
+    if (pass_pos != -1)
+        voodoo_arm64_branch_set_offset(code_block, pass_pos, block_pos);
+
+    return block_pos;
+}
+
+static inline int
+voodoo_arm64_compare_cond(int func)
+{
+    switch (func) {
+        case DEPTHOP_LESSTHAN:
+            return COND_LT;
+        case DEPTHOP_EQUAL:
+            return COND_EQ;
+        case DEPTHOP_LESSTHANEQUAL:
+            return COND_LE;
+        case DEPTHOP_GREATERTHAN:
+            return COND_GT;
+        case DEPTHOP_NOTEQUAL:
+            return COND_NE;
+        case DEPTHOP_GREATERTHANEQUAL:
+            return COND_GE;
+
+        default:
+            return -1;
+    }
+}
+
+/*Clamp or wrap a texture coordinate, as tex_read()/tex_read_4() do*/
+static inline int
+voodoo_arm64_tex_coord(uint8_t *code_block, int block_pos, int reg, int mask_reg, int clamp)
+{
+    if (clamp) {
+        A64_CMP_IMM(reg, 0);
+        A64_CSEL(reg, A64_ZR, reg, COND_LT);
+        A64_CMP_REG(reg, mask_reg);
+        A64_CSEL(reg, mask_reg, reg, COND_GT);
+    } else
+        A64_AND_REG(reg, reg, mask_reg);
+
+    return block_pos;
+}
+
+/*Equivalent of voodoo_tmu_fetch(). Leaves the texel in state->tex_[rgba][tmu],
+  and the LOD in state->lod and state->lod_frac[tmu]*/
+static inline int
+voodoo_arm64_texture_fetch(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params, int block_pos, int tmu)
+{
+    uint32_t s_offset = tmu ? offsetof(voodoo_state_t, tmu1_s) : offsetof(voodoo_state_t, tmu0_s);
+    uint32_t t_offset = tmu ? offsetof(voodoo_state_t, tmu1_t) : offsetof(voodoo_state_t, tmu0_t);
+    uint32_t w_offset = tmu ? offsetof(voodoo_state_t, tmu1_w) : offsetof(voodoo_state_t, tmu0_w);
+
+    if (params->textureMode[tmu] & 1) {
+        int zero_pos;
+        int small_pos;
+        int join_pos;
+        int end_pos;
+
+        block_pos = voodoo_arm64_ldrx(code_block, block_pos, 0, A64_STATE, w_offset);
+        A64_MOVZX(1, 1, 3);     /*MOV X1, #(1 << 48)*/
+        A64_UDIVX(2, 1, 0);     /*UDIV X2, X1, X0 - gives 0 when w == 0*/
+        A64_MOVZX(5, 0x2000, 1); /*MOV X5, #(1 << 29)*/
+        block_pos = voodoo_arm64_ldrx(code_block, block_pos, 3, A64_STATE, s_offset);
+        block_pos = voodoo_arm64_ldrx(code_block, block_pos, 4, A64_STATE, t_offset);
+        A64_ADDX_IMM_LSL12(3, 3, 2); /*ADD X3, X3, #(1 << 13)*/
+        A64_ADDX_IMM_LSL12(4, 4, 2);
+        A64_ASRX_IMM(3, 3, 14);
+        A64_ASRX_IMM(4, 4, 14);
+        A64_MULX(3, 3, 2);
+        A64_MULX(4, 4, 2);
+        A64_ADDX_REG(3, 3, 5);
+        A64_ADDX_REG(4, 4, 5);
+        A64_ASRX_IMM(3, 3, 30); /*W3 = tex_s*/
+        A64_ASRX_IMM(4, 4, 30); /*W4 = tex_t*/
+
+        /*W5 = fastlog(X2)*/
+        zero_pos = block_pos;
+        A64_CBNZX(2);
+        A64_MOVZ(5, 0x8000, 1);
+        end_pos = block_pos;
+        A64_B;
+        voodoo_arm64_branch_set_offset(code_block, zero_pos, block_pos);
+        A64_CLZX(6, 2);
+        A64_MOVZ(7, 63, 0);
+        A64_SUB_REG(6, 7, 6); /*W6 = exp*/
+        A64_SUBS_IMM(7, 6, 8);
+        small_pos = block_pos;
+        A64_BCOND(COND_LT);
+        A64_LSRVX(7, 2, 7);
+        join_pos = block_pos;
+        A64_B;
+        voodoo_arm64_branch_set_offset(code_block, small_pos, block_pos);
+        A64_NEG_REG(7, 7);
+        A64_LSLVX(7, 2, 7);
+        voodoo_arm64_branch_set_offset(code_block, join_pos, block_pos);
+        A64_UBFX(7, 7, 0, 8);
+        block_pos = voodoo_arm64_movx_imm(code_block, block_pos, 16, (uintptr_t) logtable);
+        A64_LDRB_UXTW(7, 16, 7);
+        A64_ORR_REG(5, 7, 6, 8);
+        voodoo_arm64_branch_set_offset(code_block, end_pos, block_pos);
+
+        LDR_STATE(6, tmu[tmu].lod);
+        A64_ADD_REG(5, 5, 6, 0);
+        A64_MOVZ(7, 19 << 8, 0);
+        A64_SUB_REG(5, 5, 7);
+    } else {
+        block_pos = voodoo_arm64_ldrx(code_block, block_pos, 3, A64_STATE, s_offset);
+        block_pos = voodoo_arm64_ldrx(code_block, block_pos, 4, A64_STATE, t_offset);
+        A64_ASRX_IMM(3, 3, 14 + 14);
+        A64_ASRX_IMM(4, 4, 14 + 14);
+        LDR_STATE(5, tmu[tmu].lod);
+    }
+
+    /*W5 = lod*/
+    LDR_STATE(6, lod_min[tmu]);
+    LDR_STATE(7, lod_max[tmu]);
+    A64_CMP_REG(5, 7);
+    A64_CSEL(7, 7, 5, COND_GT);
+    A64_CMP_REG(5, 6);
+    A64_CSEL(5, 6, 7, COND_LT);
+    A64_UBFX(7, 5, 0, 8);
+    STR_STATE(7, lod_frac[tmu]);
+    A64_ASR_IMM(5, 5, 8);
+    STR_STATE(5, lod);
+
+    /*W6 = tex_lod, W10 = w_mask, W11 = h_mask, X12 = texture, W13 = tex_shift*/
+    block_pos = voodoo_arm64_add_offset(code_block, block_pos, 16, A64_PARAMS, offsetof(voodoo_params_t, tex_lod[tmu]));
+    A64_LDR_SXTW_2(6, 16, 5);
+    block_pos = voodoo_arm64_add_offset(code_block, block_pos, 16, A64_PARAMS, offsetof(voodoo_params_t, tex_w_mask[tmu]));
+    A64_LDR_SXTW_2(10, 16, 5);
+    block_pos = voodoo_arm64_add_offset(code_block, block_pos, 16, A64_PARAMS, offsetof(voodoo_params_t, tex_h_mask[tmu]));
+    A64_LDR_SXTW_2(11, 16, 5);
+    block_pos = voodoo_arm64_add_offset(code_block, block_pos, 16, A64_STATE, offsetof(voodoo_state_t, tex[tmu]));
+    A64_LDRX_SXTW_3(12, 16, 5);
+    A64_MOVZ(13, 8, 0);
+    A64_SUB_REG(13, 13, 6);
+
+    if (params->tLOD[tmu] & LOD_TMIRROR_S) {
+        A64_TBZ(3, 12, 8);
+        A64_MVN_REG(3, 3);
+    }
+    if (params->tLOD[tmu] & LOD_TMIRROR_T) {
+        A64_TBZ(4, 12, 8);
+        A64_MVN_REG(4, 4);
+    }
+
+    if (voodoo->bilinear_enabled && (params->textureMode[tmu] & 6)) {
+        A64_MOVZ(7, 8, 0);
+        A64_LSLV(7, 7, 6);
+        A64_SUB_REG(3, 3, 7);
+        A64_SUB_REG(4, 4, 7);
+        A64_ASRV(3, 3, 6);
+        A64_ASRV(4, 4, 6);
+        A64_UBFX(14, 3, 0, 4); /*W14 = ds*/
+        A64_UBFX(15, 4, 0, 4); /*W15 = dt*/
+        A64_ASR_IMM(3, 3, 4);
+        A64_ASR_IMM(4, 4, 4);
+
+        A64_MOVZ(0, 16, 0);
+        A64_SUB_REG(1, 0, 14);
+        A64_SUB_REG(2, 0, 15);
+        A64_MUL(16, 1, 2);   /*W16 = d[0]*/
+        A64_MUL(17, 14, 2);  /*W17 = d[1]*/
+        A64_MUL(1, 1, 15);
+        A64_MUL(15, 14, 15); /*W15 = d[3]*/
+        A64_MOV_REG(14, 1);  /*W14 = d[2]*/
+
+        /*W3/W5 = s/s+1, W4/W6 = t/t+1*/
+        A64_ADD_IMM(5, 3, 1);
+        A64_ADD_IMM(6, 4, 1);
+        block_pos = voodoo_arm64_tex_coord(code_block, block_pos, 3, 10, params->textureMode[tmu] & TEXTUREMODE_TCLAMPS);
+        block_pos = voodoo_arm64_tex_coord(code_block, block_pos, 5, 10, params->textureMode[tmu] & TEXTUREMODE_TCLAMPS);
+        block_pos = voodoo_arm64_tex_coord(code_block, block_pos, 4, 11, params->textureMode[tmu] & TEXTUREMODE_TCLAMPT);
+        block_pos = voodoo_arm64_tex_coord(code_block, block_pos, 6, 11, params->textureMode[tmu] & TEXTUREMODE_TCLAMPT);
+        A64_LSLV(4, 4, 13);
+        A64_LSLV(6, 6, 13);
+
+        /*Blend the four texels with the red/blue and alpha/green pairs packed
+          into one register each; the weights sum to 256, so no lane can
+          overflow into the next*/
+        A64_MOVZ(13, 0xff, 0);
+        A64_MOVK(13, 0xff, 1);
+        for (int c = 0; c < 4; c++) {
+            int s_reg = (c & 1) ? 5 : 3;
+            int t_reg = (c & 2) ? 6 : 4;
+            int d_reg = (c == 0) ? 16 : ((c == 1) ? 17 : ((c == 2) ? 14 : 15));
+
+            A64_ADD_REG(2, s_reg, t_reg, 0);
+            A64_LDR_SXTW_2(2, 12, 2);
+            A64_AND_REG(10, 2, 13);
+            A64_LSR_IMM(11, 2, 8);
+            A64_AND_REG(11, 11, 13);
+            if (!c) {
+                A64_MUL(0, 10, d_reg);
+                A64_MUL(1, 11, d_reg);
+            } else {
+                A64_MADD(0, 10, d_reg, 0);
+                A64_MADD(1, 11, d_reg, 1);
+            }
+        }
+        A64_UBFX(2, 0, 8, 8);
+        STR_STATE(2, tex_b[tmu]);
+        A64_UBFX(2, 0, 24, 8);
+        STR_STATE(2, tex_r[tmu]);
+        A64_UBFX(2, 1, 8, 8);
+        STR_STATE(2, tex_g[tmu]);
+        A64_LSR_IMM(2, 1, 24);
+        STR_STATE(2, tex_a[tmu]);
+    } else {
+        A64_ADD_IMM(7, 6, 4);
+        A64_ASRV(3, 3, 7);
+        A64_ASRV(4, 4, 7);
+        block_pos = voodoo_arm64_tex_coord(code_block, block_pos, 3, 10, params->textureMode[tmu] & TEXTUREMODE_TCLAMPS);
+        block_pos = voodoo_arm64_tex_coord(code_block, block_pos, 4, 11, params->textureMode[tmu] & TEXTUREMODE_TCLAMPT);
+        A64_LSLV(4, 4, 13);
+        A64_ADD_REG(2, 3, 4, 0);
+        A64_LDR_SXTW_2(2, 12, 2);
+        A64_UBFX(0, 2, 0, 8);
+        STR_STATE(0, tex_b[tmu]);
+        A64_UBFX(0, 2, 8, 8);
+        STR_STATE(0, tex_g[tmu]);
+        A64_UBFX(0, 2, 16, 8);
+        STR_STATE(0, tex_r[tmu]);
+        A64_LSR_IMM(0, 2, 24);
+        STR_STATE(0, tex_a[tmu]);
+    }
+
+    return block_pos;
+}
+
+/*reg = detail factor for the given TMU, using W4*/
+static inline int
+voodoo_arm64_detail_factor(uint8_t *code_block, int block_pos, int reg, int tmu)
+{
+    LDR_PARAMS(reg, detail_bias[tmu]);
+    LDR_STATE(4, lod);
+    A64_SUB_REG(reg, reg, 4);
+    LDR_PARAMS(4, detail_scale[tmu]);
+    A64_LSLV(reg, reg, 4);
+    LDR_PARAMS(4, detail_max[tmu]);
+    A64_CMP_REG(reg, 4);
+    A64_CSEL(reg, 4, reg, COND_GT);
+
+    return block_pos;
+}
+
+/*reg = 0xff when the blend factor is to be inverted, 0 otherwise. With
+  trilinear filtering this depends on whether the LOD is odd*/
+static inline int
+voodoo_arm64_reverse_mask(uint8_t *code_block, int block_pos, int reg, int trilinear, int invert_odd, int invert_even)
+{
+    invert_odd  = !!invert_odd;
+    invert_even = !!invert_even;
+
+    if (!trilinear || (invert_odd == invert_even))
+        A64_MOVZ(reg, invert_even ? 0xff : 0, 0);
+    else {
+        LDR_STATE(reg, lod);
+        A64_UBFX(reg, reg, 0, 1);
+        if (invert_odd)
+            A64_NEG_REG(reg, reg);
+        else
+            A64_SUB_IMM(reg, reg, 1);
+        A64_AND_REG(reg, reg, A64_FF);
+    }
+
+    return block_pos;
+}
+
+/*Equivalent of voodoo_tmu_fetch_and_blend()*/
+static inline int
+voodoo_arm64_texture_fetch_and_blend(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params, int block_pos)
+{
+    const uint32_t tex_c_offset[2][3] = {
+        {offsetof(voodoo_state_t, tex_r[0]), offsetof(voodoo_state_t, tex_g[0]), offsetof(voodoo_state_t, tex_b[0])},
+        { offsetof(voodoo_state_t, tex_r[1]), offsetof(voodoo_state_t, tex_g[1]), offsetof(voodoo_state_t, tex_b[1])}
+    };
+    int trilinear;
+
+    block_pos = voodoo_arm64_texture_fetch(code_block, voodoo, params, block_pos, 1);
+
+    trilinear = params->textureMode[1] & TEXTUREMODE_TRILINEAR;
+    if (tc_sub_clocal_1) {
+        block_pos = voodoo_arm64_reverse_mask(code_block, block_pos, 6, trilinear, tc_reverse_blend, !tc_reverse_blend);
+        switch (tc_mselect_1) {
+            case TC_MSELECT_ALOCAL:
+                LDR_STATE(5, tex_a[1]);
+                break;
+            case TC_MSELECT_DETAIL:
+                block_pos = voodoo_arm64_detail_factor(code_block, block_pos, 5, 1);
+                break;
+            case TC_MSELECT_LOD_FRAC:
+                LDR_STATE(5, lod_frac[1]);
+                break;
+
+            default:
+                A64_MOVZ(5, 0, 0);
+                break;
+        }
+        for (int c = 0; c < 3; c++) {
+            block_pos = voodoo_arm64_ldr(code_block, block_pos, 0, A64_STATE, tex_c_offset[1][c]);
+            A64_EOR_REG(1, (tc_mselect_1 == TC_MSELECT_CLOCAL) ? 0 : 5, 6);
+            A64_ADD_IMM(1, 1, 1);
+            A64_NEG_REG(2, 0);
+            A64_MUL(2, 2, 1);
+            A64_ASR_IMM(2, 2, 8);
+            if (tc_add_clocal_1)
+                A64_ADD_REG(2, 2, 0, 0);
+            else if (tc_add_alocal_1) {
+                LDR_STATE(3, tex_a[1]);
+                A64_ADD_REG(2, 2, 3, 0);
+            }
+            block_pos = voodoo_arm64_clamp(code_block, block_pos, 2);
+            block_pos = voodoo_arm64_str(code_block, block_pos, 2, A64_STATE, tex_c_offset[1][c]);
+        }
+    }
+    if (tca_sub_clocal_1) {
+        block_pos = voodoo_arm64_reverse_mask(code_block, block_pos, 6, trilinear, !tca_reverse_blend, !!tca_reverse_blend);
+        LDR_STATE(0, tex_a[1]);
+        switch (tca_mselect_1) {
+            case TCA_MSELECT_CLOCAL:
+            case TCA_MSELECT_ALOCAL:
+                A64_MOV_REG(5, 0);
+                break;
+            case TCA_MSELECT_DETAIL:
+                block_pos = voodoo_arm64_detail_factor(code_block, block_pos, 5, 1);
+                break;
+            case TCA_MSELECT_LOD_FRAC:
+                LDR_STATE(5, lod_frac[1]);
+                break;
+
+            default:
+                A64_MOVZ(5, 0, 0);
+                break;
+        }
+        A64_EOR_REG(1, 5, 6);
+        A64_ADD_IMM(1, 1, 1);
+        A64_NEG_REG(2, 0);
+        A64_MUL(2, 2, 1);
+        A64_ASR_IMM(2, 2, 8);
+        if (tca_add_clocal_1 || tca_add_alocal_1)
+            A64_ADD_REG(2, 2, 0, 0);
+        block_pos = voodoo_arm64_clamp(code_block, block_pos, 2);
+        STR_STATE(2, tex_a[1]);
+    }
+
+    block_pos = voodoo_arm64_texture_fetch(code_block, voodoo, params, block_pos, 0);
+
+    trilinear = params->textureMode[0] & TEXTUREMODE_TRILINEAR;
+    block_pos = voodoo_arm64_reverse_mask(code_block, block_pos, 6, trilinear, tc_reverse_blend, !tc_reverse_blend);
+    switch (tc_mselect) {
+        case TC_MSELECT_AOTHER:
+            LDR_STATE(5, tex_a[1]);
+            break;
+        case TC_MSELECT_ALOCAL:
+            LDR_STATE(5, tex_a[0]);
+            break;
+        case TC_MSELECT_DETAIL:
+            block_pos = voodoo_arm64_detail_factor(code_block, block_pos, 5, 0);
+            break;
+        case TC_MSELECT_LOD_FRAC:
+            LDR_STATE(5, lod_frac[0]);
+            break;
+
+        default:
+            A64_MOVZ(5, 0, 0);
+            break;
+    }
+    for (int c = 0; c < 3; c++) {
+        block_pos = voodoo_arm64_ldr(code_block, block_pos, 0, A64_STATE, tex_c_offset[0][c]);
+        if (tc_zero_other)
+            A64_MOVZ(2, 0, 0);
+        else
+            block_pos = voodoo_arm64_ldr(code_block, block_pos, 2, A64_STATE, tex_c_offset[1][c]);
+        if (tc_sub_clocal)
+            A64_SUB_REG(2, 2, 0);
+        A64_EOR_REG(1, (tc_mselect == TC_MSELECT_CLOCAL) ? 0 : 5, 6);
+        A64_ADD_IMM(1, 1, 1);
+        A64_MUL(2, 2, 1);
+        A64_ASR_IMM(2, 2, 8);
+        if (tc_add_clocal)
+            A64_ADD_REG(2, 2, 0, 0);
+        else if (tc_add_alocal) {
+            LDR_STATE(3, tex_a[0]);
+            A64_ADD_REG(2, 2, 3, 0);
+        }
+        block_pos = voodoo_arm64_clamp(code_block, block_pos, 2);
+        if (tc_invert_output)
+            A64_EOR_REG(2, 2, A64_FF);
+        block_pos = voodoo_arm64_str(code_block, block_pos, 2, A64_STATE, tex_c_offset[0][c]);
+    }
+
+    block_pos = voodoo_arm64_reverse_mask(code_block, block_pos, 6, trilinear, tca_reverse_blend, !tca_reverse_blend);
+    LDR_STATE(0, tex_a[0]);
+    switch (tca_mselect) {
+        case TCA_MSELECT_CLOCAL:
+        case TCA_MSELECT_ALOCAL:
+            A64_MOV_REG(5, 0);
+            break;
+        case TCA_MSELECT_AOTHER:
+            LDR_STATE(5, tex_a[1]);
+            break;
+        case TCA_MSELECT_DETAIL:
+            block_pos = voodoo_arm64_detail_factor(code_block, block_pos, 5, 0);
+            break;
+        case TCA_MSELECT_LOD_FRAC:
+            LDR_STATE(5, lod_frac[0]);
+            break;
+
+        default:
+            A64_MOVZ(5, 0, 0);
+            break;
+    }
+    if (tca_zero_other)
+        A64_MOVZ(2, 0, 0);
+    else
+        LDR_STATE(2, tex_a[1]);
+    if (tca_sub_clocal)
+        A64_SUB_REG(2, 2, 0);
+    A64_EOR_REG(1, 5, 6);
+    A64_ADD_IMM(1, 1, 1);
+    A64_MUL(2, 2, 1);
+    A64_ASR_IMM(2, 2, 8);
+    if (tca_add_clocal || tca_add_alocal)
+        A64_ADD_REG(2, 2, 0, 0);
+    block_pos = voodoo_arm64_clamp(code_block, block_pos, 2);
+    if (tca_invert_output)
+        A64_EOR_REG(2, 2, A64_FF);
+    STR_STATE(2, tex_a[0]);
+
+    return block_pos;
+}
+
+/*reg = CLAMP(state->field >> 12)*/
+static inline int
+voodoo_arm64_iterated(uint8_t *code_block, int block_pos, int reg, uint32_t offset, int shift)
+{
+    block_pos = voodoo_arm64_ldr(code_block, block_pos, reg, A64_STATE, offset);
+    A64_ASR_IMM(reg, reg, shift);
+
+    return voodoo_arm64_clamp(code_block, block_pos, reg);
+}
+
+/*reg = table[reg][real_y & n][x & n], with the per-pixel part of the index
+  already in W0. Uses X16 and W17*/
+static inline int
+voodoo_arm64_dither_lookup(uint8_t *code_block, int block_pos, int reg, const uint8_t *table, int size_shift)
+{
+    block_pos = voodoo_arm64_movx_imm(code_block, block_pos, 16, (uintptr_t) table);
+    A64_ADD_REG(17, 0, reg, size_shift);
+    A64_LDRB_UXTW(reg, 16, 17);
+
+    return block_pos;
+}
+
+/*W0 = index of the current pixel within a 4x4 (or 2x2) dither table entry*/
+static inline int
+voodoo_arm64_dither_index(uint8_t *code_block, int block_pos, int is_2x2)
+{
+    if (is_2x2) {
+        A64_UBFX(0, A64_REAL_Y, 0, 1);
+        A64_UBFX(17, A64_X, 0, 1);
+        A64_ADD_REG(0, 17, 0, 1);
+    } else {
+        A64_UBFX(0, A64_REAL_Y, 0, 2);
+        A64_UBFX(17, A64_X, 0, 2);
+        A64_ADD_REG(0, 17, 0, 2);
+    }
+
+    return block_pos;
+}
+
+/*Returns non-zero if the interpreter would fatal() on this combination; those
+  are left to the interpreter*/
+static inline int
+voodoo_arm64_unsupported(voodoo_params_t *params)
+{
+    if (cca_localselect == 3 || a_sel == 3 || cc_mselect > CC_MSELECT_TEXRGB || cca_mselect > CCA_MSELECT_TEX || cc_add == 3)
+        return 1;
+    /*Undefined texture factor selects leave a stale factor in the interpreter*/
+    if ((params->fbzColorPath & FBZCP_TEXTURE_ENABLED) && (tc_mselect > TC_MSELECT_LOD_FRAC || tca_mselect > TCA_MSELECT_LOD_FRAC))
+        return 1;
+    if ((params->fbzColorPath & FBZCP_TEXTURE_ENABLED) && ((tc_sub_clocal_1 && tc_mselect_1 > TC_MSELECT_LOD_FRAC) || (tca_sub_clocal_1 && tca_mselect_1 > TCA_MSELECT_LOD_FRAC)))
+        return 1;
+
+    return 0;
+}
+
+/*Returns 0 if the block did not fit, in which case it must not be run*/
+static inline int
+voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int depthop)
+{
+    const uint32_t iter_offset[3]  = { offsetof(voodoo_state_t, ir), offsetof(voodoo_state_t, ig), offsetof(voodoo_state_t, ib) };
+    const uint32_t tex_c_offset[3] = { offsetof(voodoo_state_t, tex_r[0]), offsetof(voodoo_state_t, tex_g[0]), offsetof(voodoo_state_t, tex_b[0]) };
+    const int      color_shift[3]  = { 16, 8, 0 };
+    int            block_pos       = 0;
+    int            skip_pos[MAX_SKIP_BRANCHES];
+    int            nr_skip = 0;
+    int            loop_pos;
+    int            texels;
+    int            use_w_depth;
+    int            dest_colbfog;
+    int            fog_table;
+
+    fog_table    = (params->fogMode & (FOG_ENABLE | FOG_CONSTANT | FOG_Z | FOG_ALPHA)) == FOG_ENABLE;
+    use_w_depth  = (params->fbzMode & FBZ_W_BUFFER) || fog_table;
+    dest_colbfog = (params->alphaMode & (1 << 4)) && dest_afunc == AFUNC_ACOLORBEFOREFOG;
+
+    if ((params->textureMode[0] & TEXTUREMODE_MASK) == TEXTUREMODE_PASSTHROUGH || (params->textureMode[0] & TEXTUREMODE_LOCAL_MASK) == TEXTUREMODE_LOCAL)
+        texels = 1;
+    else
+        texels = 2;
+
+    A64_STP_PREIDX(29, 30, A64_SP, -96);
+    A64_STP(19, 20, A64_SP, 16);
+    A64_STP(21, 22, A64_SP, 32);
+    A64_STP(23, 24, A64_SP, 48);
+    A64_STP(25, 26, A64_SP, 64);
+    A64_STP(27, 28, A64_SP, 80);
+
+    A64_MOVX_REG(A64_STATE, 0);
+    A64_MOVX_REG(A64_PARAMS, 1);
+    A64_MOV_REG(A64_X, 2);
+    A64_MOV_REG(A64_REAL_Y, 3);
+    block_pos = voodoo_arm64_movx_imm(code_block, block_pos, A64_VOODOO, (uintptr_t) voodoo);
+    LDRX_STATE(A64_FB_MEM, fb_mem);
+    LDRX_STATE(A64_AUX_MEM, aux_mem);
+    LDR_STATE(A64_X2, x2);
+    A64_MOVZ(A64_FF, 0xff, 0);
+
+    loop_pos = block_pos;
+
+    if (params->col_tiled || params->aux_tiled) {
+        A64_UBFX(0, A64_X, 0, 6);
+        A64_ASR_IMM(1, A64_X, 6);
+        A64_ADD_REG(A64_X_TILED, 0, 1, 11);
+    }
+
+    if (use_w_depth) {
+        int zero_pos;
+        int f001_pos;
+        int done_pos[2];
+
+        LDRX_STATE(0, w);
+        A64_UBFXX(1, 0, 32, 16);
+        zero_pos = block_pos;
+        A64_CBNZX(1);
+        A64_UBFX(1, 0, 16, 16);
+        f001_pos = block_pos;
+        A64_CBZ(1);
+        A64_CLZ(2, 1);
+        A64_SUB_IMM(2, 2, 16); /*W2 = exp*/
+        A64_MVN_REG(3, 0);
+        A64_MOVZ(4, 19, 0);
+        A64_SUB_REG(4, 4, 2);
+        A64_LSRV(3, 3, 4);
+        A64_UBFX(3, 3, 0, 12); /*W3 = mant*/
+        A64_ADD_REG(A64_W_DEPTH, 3, 2, 12);
+        A64_ADD_IMM(A64_W_DEPTH, A64_W_DEPTH, 1);
+        A64_MOVZ(4, 0xffff, 0);
+        A64_CMP_REG(A64_W_DEPTH, 4);
+        A64_CSEL(A64_W_DEPTH, 4, A64_W_DEPTH, COND_GT);
+        done_pos[0] = block_pos;
+        A64_B;
+        voodoo_arm64_branch_set_offset(code_block, zero_pos, block_pos);
+        A64_MOVZ(A64_W_DEPTH, 0, 0);
+        done_pos[1] = block_pos;
+        A64_B;
+        voodoo_arm64_branch_set_offset(code_block, f001_pos, block_pos);
+        A64_MOVZ(A64_W_DEPTH, 0xf001, 0);
+        voodoo_arm64_branch_set_offset(code_block, done_pos[0], block_pos);
+        voodoo_arm64_branch_set_offset(code_block, done_pos[1], block_pos);
+    }
+
+    if (params->fbzMode & FBZ_W_BUFFER)
+        A64_MOV_REG(A64_NEW_DEPTH, A64_W_DEPTH);
+    else {
+        LDR_STATE(A64_NEW_DEPTH, z);
+        A64_ASR_IMM(A64_NEW_DEPTH, A64_NEW_DEPTH, 12);
+        block_pos = voodoo_arm64_clamp16(code_block, block_pos, A64_NEW_DEPTH);
+    }
+    if (params->fbzMode & FBZ_DEPTH_BIAS) {
+        LDR_PARAMS(0, zaColor);
+        A64_SXTH(0, 0);
+        A64_ADD_REG(A64_NEW_DEPTH, A64_NEW_DEPTH, 0, 0);
+        block_pos = voodoo_arm64_clamp16(code_block, block_pos, A64_NEW_DEPTH);
+    }
+
+    if ((params->fbzMode & FBZ_DEPTH_ENABLE) && depthop != DEPTHOP_ALWAYS) {
+        if (depthop == DEPTHOP_NEVER)
+            block_pos = voodoo_arm64_test_fail(code_block, block_pos, -1, offsetof(voodoo_t, fbiZFuncFail), skip_pos, &nr_skip);
+        else {
+            A64_LDRH_SXTW_1(0, A64_AUX_MEM, params->aux_tiled ? A64_X_TILED : A64_X);
+            if (params->fbzMode & FBZ_DEPTH_SOURCE) {
+                LDR_PARAMS(1, zaColor);
+                A64_UBFX(1, 1, 0, 16);
+                A64_CMP_REG(1, 0);
+            } else
+                A64_CMP_REG(A64_NEW_DEPTH, 0);
+            block_pos = voodoo_arm64_test_fail(code_block, block_pos, voodoo_arm64_compare_cond(depthop), offsetof(voodoo_t, fbiZFuncFail), skip_pos, &nr_skip);
+        }
+    }
+
+    if (params->fbzColorPath & FBZCP_TEXTURE_ENABLED) {
+        if ((params->textureMode[0] & TEXTUREMODE_LOCAL_MASK) == TEXTUREMODE_LOCAL || !voodoo->dual_tmus) {
+            /*TMU0 only sampling local colour or only one TMU, only sample TMU0*/
+            block_pos = voodoo_arm64_texture_fetch(code_block, voodoo, params, block_pos, 0);
+        } else if ((params->textureMode[0] & TEXTUREMODE_MASK) == TEXTUREMODE_PASSTHROUGH) {
+            /*TMU0 in pass-through mode, only sample TMU1*/
+            block_pos = voodoo_arm64_texture_fetch(code_block, voodoo, params, block_pos, 1);
+
+            LDR_STATE(0, tex_r[1]);
+            LDR_STATE(1, tex_g[1]);
+            LDR_STATE(2, tex_b[1]);
+            LDR_STATE(3, tex_a[1]);
+            STR_STATE(0, tex_r[0]);
+            STR_STATE(1, tex_g[0]);
+            STR_STATE(2, tex_b[0]);
+            STR_STATE(3, tex_a[0]);
+        } else
+            block_pos = voodoo_arm64_texture_fetch_and_blend(code_block, voodoo, params, block_pos);
+
+        if (params->fbzMode & FBZ_CHROMAKEY) {
+            int match_pos[2];
+
+            LDR_STATE(0, tex_r[0]);
+            LDR_PARAMS(1, chromaKey_r);
+            A64_CMP_REG(0, 1);
+            match_pos[0] = block_pos;
+            A64_BCOND(COND_NE);
+            LDR_STATE(0, tex_g[0]);
+            LDR_PARAMS(1, chromaKey_g);
+            A64_CMP_REG(0, 1);
+            match_pos[1] = block_pos;
+            A64_BCOND(COND_NE);
+            LDR_STATE(0, tex_b[0]);
+            LDR_PARAMS(1, chromaKey_b);
+            A64_CMP_REG(0, 1);
+            block_pos = voodoo_arm64_test_fail(code_block, block_pos, COND_NE, offsetof(voodoo_t, fbiChromaFail), skip_pos, &nr_skip);
+            voodoo_arm64_branch_set_offset(code_block, match_pos[0], block_pos);
+            voodoo_arm64_branch_set_offset(code_block, match_pos[1], block_pos);
+        }
+    }
+
+    if (voodoo->trexInit1[0] & (1 << 18)) {
+        STR_STATE(A64_ZR, tex_r[0]);
+        STR_STATE(A64_ZR, tex_g[0]);
+        block_pos = voodoo_arm64_ldr(code_block, block_pos, 0, A64_VOODOO, offsetof(voodoo_t, tmuConfig));
+        STR_STATE(0, tex_b[0]);
+    }
+
+    /*Alpha combine*/
+    switch (cca_localselect) {
+        case CCA_LOCALSELECT_ITER_A:
+            block_pos = voodoo_arm64_iterated(code_block, block_pos, A64_ALOCAL, offsetof(voodoo_state_t, ia), 12);
+            break;
+        case CCA_LOCALSELECT_COLOR0:
+            LDR_PARAMS(A64_ALOCAL, color0);
+            A64_LSR_IMM(A64_ALOCAL, A64_ALOCAL, 24);
+            break;
+        case CCA_LOCALSELECT_ITER_Z:
+            block_pos = voodoo_arm64_iterated(code_block, block_pos, A64_ALOCAL, offsetof(voodoo_state_t, z), 20);
+            break;
+
+        default:
+            break;
+    }
+    switch (a_sel) {
+        case A_SEL_ITER_A:
+            block_pos = voodoo_arm64_iterated(code_block, block_pos, A64_AOTHER, offsetof(voodoo_state_t, ia), 12);
+            break;
+        case A_SEL_TEX:
+            LDR_STATE(A64_AOTHER, tex_a[0]);
+            break;
+        case A_SEL_COLOR1:
+            LDR_PARAMS(A64_AOTHER, color1);
+            A64_LSR_IMM(A64_AOTHER, A64_AOTHER, 24);
+            break;
+
+        default:
+            break;
+    }
+
+    if (cca_zero_other)
+        A64_MOVZ(A64_SRC_A, 0, 0);
+    else
+        A64_MOV_REG(A64_SRC_A, A64_AOTHER);
+    if (cca_sub_clocal)
+        A64_SUB_REG(A64_SRC_A, A64_SRC_A, A64_ALOCAL);
+    switch (cca_mselect) {
+        case CCA_MSELECT_ALOCAL:
+        case CCA_MSELECT_ALOCAL2:
+            A64_MOV_REG(0, A64_ALOCAL);
+            break;
+        case CCA_MSELECT_AOTHER:
+            A64_MOV_REG(0, A64_AOTHER);
+            break;
+        case CCA_MSELECT_TEX:
+            LDR_STATE(0, tex_a[0]);
+            break;
+
+        default:
+            A64_MOVZ(0, 0, 0);
+            break;
+    }
+    if (!cca_reverse_blend)
+        A64_EOR_REG(0, 0, A64_FF);
+    A64_ADD_IMM(0, 0, 1);
+    A64_MUL(A64_SRC_A, A64_SRC_A, 0);
+    A64_ASR_IMM(A64_SRC_A, A64_SRC_A, 8);
+    if (cca_add)
+        A64_ADD_REG(A64_SRC_A, A64_SRC_A, A64_ALOCAL, 0);
+    block_pos = voodoo_arm64_clamp(code_block, block_pos, A64_SRC_A);
+    if (cca_invert_output)
+        A64_EOR_REG(A64_SRC_A, A64_SRC_A, A64_FF);
+
+    /*Colour combine, one channel at a time. W0 = clocal, W1 = cother, W2 = msel*/
+    for (int c = 0; c < 3; c++) {
+        int src_reg = A64_SRC_R + c;
+
+        if (cc_localselect_override) {
+            block_pos = voodoo_arm64_iterated(code_block, block_pos, 0, iter_offset[c], 12);
+            LDR_PARAMS(1, color0);
+            A64_UBFX(1, 1, color_shift[c], 8);
+            LDR_STATE(2, tex_a[0]);
+            A64_UBFX(2, 2, 7, 1);
+            A64_CMP_IMM(2, 0);
+            A64_CSEL(0, 1, 0, COND_NE);
+        } else if (cc_localselect) {
+            LDR_PARAMS(0, color0);
+            A64_UBFX(0, 0, color_shift[c], 8);
+        } else
+            block_pos = voodoo_arm64_iterated(code_block, block_pos, 0, iter_offset[c], 12);
+
+        switch (_rgb_sel) {
+            case CC_LOCALSELECT_ITER_RGB:
+                block_pos = voodoo_arm64_iterated(code_block, block_pos, 1, iter_offset[c], 12);
+                break;
+            case CC_LOCALSELECT_TEX:
+                block_pos = voodoo_arm64_ldr(code_block, block_pos, 1, A64_STATE, tex_c_offset[c]);
+                break;
+            case CC_LOCALSELECT_COLOR1:
+                LDR_PARAMS(1, color1);
+                A64_UBFX(1, 1, color_shift[c], 8);
+                break;
+
+            default: /*Linear frame buffer colour, always zero here*/
+                A64_MOVZ(1, 0, 0);
+                break;
+        }
+
+        if (cc_zero_other)
+            A64_MOVZ(src_reg, 0, 0);
+        else
+            A64_MOV_REG(src_reg, 1);
+        if (cc_sub_clocal)
+            A64_SUB_REG(src_reg, src_reg, 0);
+
+        switch (cc_mselect) {
+            case CC_MSELECT_CLOCAL:
+                A64_MOV_REG(2, 0);
+                break;
+            case CC_MSELECT_AOTHER:
+                A64_MOV_REG(2, A64_AOTHER);
+                break;
+            case CC_MSELECT_ALOCAL:
+                A64_MOV_REG(2, A64_ALOCAL);
+                break;
+            case CC_MSELECT_TEX:
+                LDR_STATE(2, tex_a[0]);
+                break;
+            case CC_MSELECT_TEXRGB:
+                block_pos = voodoo_arm64_ldr(code_block, block_pos, 2, A64_STATE, tex_c_offset[c]);
+                break;
+
+            default:
+                A64_MOVZ(2, 0, 0);
+                break;
+        }
+        if (!cc_reverse_blend)
+            A64_EOR_REG(2, 2, A64_FF);
+        A64_ADD_IMM(2, 2, 1);
+        A64_MUL(src_reg, src_reg, 2);
+        A64_ASR_IMM(src_reg, src_reg, 8);
+
+        if (cc_add == CC_ADD_CLOCAL)
+            A64_ADD_REG(src_reg, src_reg, 0, 0);
+        else if (cc_add == CC_ADD_ALOCAL)
+            A64_ADD_REG(src_reg, src_reg, A64_ALOCAL, 0);
+        block_pos = voodoo_arm64_clamp(code_block, block_pos, src_reg);
+        if (cc_invert_output)
+            A64_EOR_REG(src_reg, src_reg, A64_FF);
+
+        if (dest_colbfog)
+            A64_MOV_REG(A64_COLBFOG_R + c, src_reg);
+    }
+
+    if (params->fogMode & FOG_ENABLE) {
+        if (params->fogMode & FOG_CONSTANT) {
+            for (int c = 0; c < 3; c++) {
+                block_pos = voodoo_arm64_ldrb(code_block, block_pos, 0, A64_PARAMS, offsetof(voodoo_params_t, fogColor) + 2 - c);
+                A64_ADD_REG(A64_SRC_R + c, A64_SRC_R + c, 0, 0);
+            }
+        } else {
+            /*W4 = fog_a*/
+            switch (params->fogMode & (FOG_Z | FOG_ALPHA)) {
+                case 0:
+                    A64_UBFX(0, A64_W_DEPTH, 10, 6);
+                    block_pos = voodoo_arm64_add_offset(code_block, block_pos, 16, A64_PARAMS, offsetof(voodoo_params_t, fogTable));
+                    A64_ADDX_UXTW(16, 16, 0, 1);
+                    A64_LDRB_IMM(4, 16, 0);
+                    A64_LDRB_IMM(1, 16, 1);
+                    A64_UBFX(2, A64_W_DEPTH, 2, 8);
+                    A64_MUL(1, 1, 2);
+                    A64_ADD_REG_LSR(4, 4, 1, 10);
+                    break;
+                case FOG_Z:
+                    LDR_STATE(4, z);
+                    A64_UBFX(4, 4, 20, 8);
+                    break;
+                case FOG_ALPHA:
+                    block_pos = voodoo_arm64_iterated(code_block, block_pos, 4, offsetof(voodoo_state_t, ia), 12);
+                    break;
+                case FOG_W:
+                    LDRX_STATE(4, w);
+                    A64_UBFXX(4, 4, 32, 8);
+                    break;
+
+                default:
+                    break;
+            }
+            A64_ADD_IMM(4, 4, 1);
+
+            for (int c = 0; c < 3; c++) {
+                int src_reg = A64_SRC_R + c;
+
+                if (!(params->fogMode & FOG_ADD))
+                    block_pos = voodoo_arm64_ldrb(code_block, block_pos, 0, A64_PARAMS, offsetof(voodoo_params_t, fogColor) + 2 - c);
+                else
+                    A64_MOVZ(0, 0, 0);
+                if (!(params->fogMode & FOG_MULT))
+                    A64_SUB_REG(0, 0, src_reg);
+                A64_MUL(0, 0, 4);
+                A64_ASR_IMM(0, 0, 8);
+                if (params->fogMode & FOG_MULT)
+                    A64_MOV_REG(src_reg, 0);
+                else
+                    A64_ADD_REG(src_reg, src_reg, 0, 0);
+            }
+        }
+        for (int c = 0; c < 3; c++)
+            block_pos = voodoo_arm64_clamp(code_block, block_pos, A64_SRC_R + c);
+    }
+
+    if (params->alphaMode & 1) {
+        if (alpha_func == AFUNC_NEVER)
+            block_pos = voodoo_arm64_test_fail(code_block, block_pos, -1, offsetof(voodoo_t, fbiAFuncFail), skip_pos, &nr_skip);
+        else if (alpha_func != AFUNC_ALWAYS) {
+            A64_CMP_IMM(A64_SRC_A, a_ref);
+            block_pos = voodoo_arm64_test_fail(code_block, block_pos, voodoo_arm64_compare_cond(alpha_func), offsetof(voodoo_t, fbiAFuncFail), skip_pos, &nr_skip);
+        }
+    }
+
+    if (params->alphaMode & (1 << 4)) {
+        /*W1-W3 = dest_r/g/b. dest_a is always 0xff*/
+        A64_LDRH_SXTW_1(0, A64_FB_MEM, params->col_tiled ? A64_X_TILED : A64_X);
+        A64_UBFX(1, 0, 11, 5);
+        A64_UBFX(2, 0, 5, 6);
+        A64_UBFX(3, 0, 0, 5);
+        A64_LSL_IMM(4, 1, 3);
+        A64_ORR_REG_LSR(1, 4, 1, 2);
+        A64_LSL_IMM(4, 2, 2);
+        A64_ORR_REG_LSR(2, 4, 2, 4);
+        A64_LSL_IMM(4, 3, 3);
+        A64_ORR_REG_LSR(3, 4, 3, 2);
+
+        if (dithersub && voodoo->dithersub_enabled) {
+            block_pos = voodoo_arm64_dither_index(code_block, block_pos, dither2x2);
+            block_pos = voodoo_arm64_dither_lookup(code_block, block_pos, 1, dither2x2 ? &dithersub_rb2x2[0][0][0] : &dithersub_rb[0][0][0], dither2x2 ? 2 : 4);
+            block_pos = voodoo_arm64_dither_lookup(code_block, block_pos, 2, dither2x2 ? &dithersub_g2x2[0][0][0] : &dithersub_g[0][0][0], dither2x2 ? 2 : 4);
+            block_pos = voodoo_arm64_dither_lookup(code_block, block_pos, 3, dither2x2 ? &dithersub_rb2x2[0][0][0] : &dithersub_rb[0][0][0], dither2x2 ? 2 : 4);
+        }
+
+        for (int c = 0; c < 3; c++) {
+            int src_reg  = A64_SRC_R + c;
+            int dest_reg = 1 + c;
+
+            /*W4 = newdest*/
+            switch (dest_afunc) {
+                case AFUNC_ASRC_ALPHA:
+                    A64_MUL(4, dest_reg, A64_SRC_A);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, 4, 4);
+                    break;
+                case AFUNC_A_COLOR:
+                    A64_MUL(4, dest_reg, src_reg);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, 4, 4);
+                    break;
+                case AFUNC_ADST_ALPHA:
+                case AFUNC_AONE:
+                    A64_MOV_REG(4, dest_reg);
+                    break;
+                case AFUNC_AOMSRC_ALPHA:
+                    A64_SUB_REG(4, A64_FF, A64_SRC_A);
+                    A64_MUL(4, dest_reg, 4);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, 4, 4);
+                    break;
+                case AFUNC_AOM_COLOR:
+                    A64_SUB_REG(4, A64_FF, src_reg);
+                    A64_MUL(4, dest_reg, 4);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, 4, 4);
+                    break;
+                case AFUNC_ACOLORBEFOREFOG:
+                    A64_MUL(4, dest_reg, A64_COLBFOG_R + c);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, 4, 4);
+                    break;
+
+                default:
+                    A64_MOVZ(4, 0, 0);
+                    break;
+            }
+
+            switch (src_afunc) {
+                case AFUNC_AZERO:
+                case AFUNC_AOMDST_ALPHA:
+                case AFUNC_ASATURATE:
+                    A64_MOVZ(src_reg, 0, 0);
+                    break;
+                case AFUNC_ASRC_ALPHA:
+                    A64_MUL(src_reg, src_reg, A64_SRC_A);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, src_reg, src_reg);
+                    break;
+                case AFUNC_A_COLOR:
+                    A64_MUL(src_reg, src_reg, dest_reg);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, src_reg, src_reg);
+                    break;
+                case AFUNC_AOMSRC_ALPHA:
+                    A64_SUB_REG(0, A64_FF, A64_SRC_A);
+                    A64_MUL(src_reg, src_reg, 0);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, src_reg, src_reg);
+                    break;
+                case AFUNC_AOM_COLOR:
+                    A64_SUB_REG(0, A64_FF, dest_reg);
+                    A64_MUL(src_reg, src_reg, 0);
+                    block_pos = voodoo_arm64_div255(code_block, block_pos, src_reg, src_reg);
+                    break;
+
+                default: /*AFUNC_ADST_ALPHA, AFUNC_AONE and undefined modes leave the source as is*/
+                    break;
+            }
+
+            A64_ADD_REG(src_reg, src_reg, 4, 0);
+            block_pos = voodoo_arm64_clamp(code_block, block_pos, src_reg);
+        }
+    }
+
+    if (params->fbzMode & FBZ_RGB_WMASK) {
+        if (dither) {
+            block_pos = voodoo_arm64_dither_index(code_block, block_pos, dither2x2);
+            block_pos = voodoo_arm64_dither_lookup(code_block, block_pos, A64_SRC_R, dither2x2 ? &dither_rb2x2[0][0][0] : &dither_rb[0][0][0], dither2x2 ? 2 : 4);
+            block_pos = voodoo_arm64_dither_lookup(code_block, block_pos, A64_SRC_R + 1, dither2x2 ? &dither_g2x2[0][0][0] : &dither_g[0][0][0], dither2x2 ? 2 : 4);
+            block_pos = voodoo_arm64_dither_lookup(code_block, block_pos, A64_SRC_R + 2, dither2x2 ? &dither_rb2x2[0][0][0] : &dither_rb[0][0][0], dither2x2 ? 2 : 4);
+        } else {
+            A64_LSR_IMM(A64_SRC_R, A64_SRC_R, 3);
+            A64_LSR_IMM(A64_SRC_R + 1, A64_SRC_R + 1, 2);
+            A64_LSR_IMM(A64_SRC_R + 2, A64_SRC_R + 2, 3);
+        }
+        A64_ORR_REG(0, A64_SRC_R + 2, A64_SRC_R + 1, 5);
+        A64_ORR_REG(0, 0, A64_SRC_R, 11);
+        A64_STRH_SXTW_1(0, A64_FB_MEM, params->col_tiled ? A64_X_TILED : A64_X);
+    }
+    if ((params->fbzMode & (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE)) == (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE))
+        A64_STRH_SXTW_1(A64_NEW_DEPTH, A64_AUX_MEM, params->aux_tiled ? A64_X_TILED : A64_X);
+
+    block_pos = voodoo_arm64_inc_counter(code_block, block_pos, offsetof(voodoo_t, fbiPixelsOut));
+
+    /*skip_pixel*/
+    for (int c = 0; c < nr_skip; c++)
+        voodoo_arm64_branch_set_offset(code_block, skip_pos[c], block_pos);
+
+    LDR_STATE(0, pixel_count);
+    A64_ADD_IMM(0, 0, 1);
+    STR_STATE(0, pixel_count);
+    LDR_STATE(0, texel_count);
+    A64_ADD_IMM(0, 0, texels);
+    STR_STATE(0, texel_count);
+
+    for (int c = 0; c < 5; c++) {
+        static const uint32_t state_offset[5]  = { offsetof(voodoo_state_t, ir), offsetof(voodoo_state_t, ig), offsetof(voodoo_state_t, ib), offsetof(voodoo_state_t, ia), offsetof(voodoo_state_t, z) };
+        static const uint32_t params_offset[5] = { offsetof(voodoo_params_t, dRdX), offsetof(voodoo_params_t, dGdX), offsetof(voodoo_params_t, dBdX), offsetof(voodoo_params_t, dAdX), offsetof(voodoo_params_t, dZdX) };
+
+        block_pos = voodoo_arm64_ldr(code_block, block_pos, 0, A64_STATE, state_offset[c]);
+        block_pos = voodoo_arm64_ldr(code_block, block_pos, 1, A64_PARAMS, params_offset[c]);
+        if (state->xdir > 0)
+            A64_ADD_REG(0, 0, 1, 0);
+        else
+            A64_SUB_REG(0, 0, 1);
+        block_pos = voodoo_arm64_str(code_block, block_pos, 0, A64_STATE, state_offset[c]);
+    }
+    for (int c = 0; c < 7; c++) {
+        static const uint32_t state_offset[7]  = { offsetof(voodoo_state_t, tmu0_s), offsetof(voodoo_state_t, tmu0_t), offsetof(voodoo_state_t, tmu0_w),
+                                                   offsetof(voodoo_state_t, tmu1_s), offsetof(voodoo_state_t, tmu1_t), offsetof(voodoo_state_t, tmu1_w),
+                                                   offsetof(voodoo_state_t, w) };
+        static const uint32_t params_offset[7] = { offsetof(voodoo_params_t, tmu[0].dSdX), offsetof(voodoo_params_t, tmu[0].dTdX), offsetof(voodoo_params_t, tmu[0].dWdX),
+                                                   offsetof(voodoo_params_t, tmu[1].dSdX), offsetof(voodoo_params_t, tmu[1].dTdX), offsetof(voodoo_params_t, tmu[1].dWdX),
+                                                   offsetof(voodoo_params_t, dWdX) };
+
+        block_pos = voodoo_arm64_ldrx(code_block, block_pos, 0, A64_STATE, state_offset[c]);
+        block_pos = voodoo_arm64_ldrx(code_block, block_pos, 1, A64_PARAMS, params_offset[c]);
+        if (state->xdir > 0)
+            A64_ADDX_REG(0, 0, 1);
+        else
+            A64_SUBX_REG(0, 0, 1);
+        block_pos = voodoo_arm64_strx(code_block, block_pos, 0, A64_STATE, state_offset[c]);
+    }
+
+    A64_MOV_REG(0, A64_X);
+    if (state->xdir > 0)
+        A64_ADD_IMM(A64_X, A64_X, 1);
+    else
+        A64_SUB_IMM(A64_X, A64_X, 1);
+    A64_CMP_REG(0, A64_X2);
+    addlong(0x54000000 | COND_NE | ((((loop_pos - block_pos) >> 2) & 0x7ffff) << 5)); /*B.NE loop_pos*/
+
+    A64_LDP(19, 20, A64_SP, 16);
+    A64_LDP(21, 22, A64_SP, 32);
+    A64_LDP(23, 24, A64_SP, 48);
+    A64_LDP(25, 26, A64_SP, 64);
+    A64_LDP(27, 28, A64_SP, 80);
+    A64_LDP_POSTIDX(29, 30, A64_SP, 96);
+    A64_RET;
+
+    if (block_pos > BLOCK_SIZE) {
+        voodoo_render_log("voodoo_generate : block too large (%i bytes)\n", block_pos);
+        return 0;
+    }
+
+    return 1;
+}
+
+int voodoo_recomp = 0;
+
+static inline void *
+voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even)
+{
+    int                  b                 = last_block[odd_even];
+    voodoo_arm64_data_t *voodoo_arm64_data = voodoo->codegen_data;
+    voodoo_arm64_data_t *data;
+
+    for (uint8_t c = 0; c < 8; c++) {
+        data = &voodoo_arm64_data[odd_even + b * voodoo->render_threads];
+
+        if (state->xdir == data->xdir && params->alphaMode == data->alphaMode && params->fbzMode == data->fbzMode && params->fogMode == data->fogMode && params->fbzColorPath == data->fbzColorPath && (voodoo->trexInit1[0] & (1 << 18)) == data->trexInit1 && params->textureMode[0] == data->textureMode[0] && params->textureMode[1] == data->textureMode[1] && (params->tLOD[0] & LOD_MASK) == data->tLOD[0] && (params->tLOD[1] & LOD_MASK) == data->tLOD[1] && params->col_tiled == data->col_tiled && params->aux_tiled == data->aux_tiled) {
+            last_block[odd_even] = b;
+            return data->valid ? data->code_block : NULL;
+        }
+
+        b = (b + 1) & 7;
+    }
+    voodoo_recomp++;
+    data = &voodoo_arm64_data[odd_even + next_block_to_write[odd_even] * voodoo->render_threads];
+
+    /*The keys share the MAP_JIT mapping with the code, so on Apple Silicon
+      every store to data has to be made while the mapping is writable*/
+#if defined(__APPLE__) && defined(__aarch64__)
+    if (__builtin_available(macOS 11.0, *))
+        pthread_jit_write_protect_np(0);
+#endif
+    data->valid = !voodoo_arm64_unsupported(params);
+    if (data->valid)
+        data->valid = voodoo_generate(data->code_block, voodoo, params, state, depth_op);
+
+    data->xdir           = state->xdir;
+    data->alphaMode      = params->alphaMode;
+    data->fbzMode        = params->fbzMode;
+    data->fogMode        = params->fogMode;
+    data->fbzColorPath   = params->fbzColorPath;
+    data->trexInit1      = voodoo->trexInit1[0] & (1 << 18);
+    data->textureMode[0] = params->textureMode[0];
+    data->textureMode[1] = params->textureMode[1];
+    data->tLOD[0]        = params->tLOD[0] & LOD_MASK;
+    data->tLOD[1]        = params->tLOD[1] & LOD_MASK;
+    data->col_tiled      = params->col_tiled;
+    data->aux_tiled      = params->aux_tiled;
+#if defined(__APPLE__) && defined(__aarch64__)
+    if (__builtin_available(macOS 11.0, *))
+        pthread_jit_write_protect_np(1);
+#endif
+
+    if (data->valid) {
+#ifndef _MSC_VER
+        __clear_cache((char *) data->code_block, (char *) &data->code_block[BLOCK_SIZE]);
+#else
+        FlushInstructionCache(GetCurrentProcess(), data->code_block, BLOCK_SIZE);
+#endif
+    }
+
+    next_block_to_write[odd_even] = (next_block_to_write[odd_even] + 1) & 7;
+
+    return data->valid ? data->code_block : NULL;
+}
+
+void
+voodoo_codegen_init(voodoo_t *voodoo)
+{
+    voodoo->codegen_data = plat_mmap(sizeof(voodoo_arm64_data_t) * BLOCK_NUM * voodoo->render_threads, 1);
+}
+
+void
+voodoo_codegen_close(voodoo_t *voodoo)
+{
+    plat_munmap(voodoo->codegen_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * voodoo->render_threads);
+}
+
+#endif /*VIDEO_VOODOO_CODEGEN_ARM64_H*/
@@ -54,9 +54,20 @@ typedef struct {
     void     *priv;
 } io_trap_t;
 
-int   initialized = 0;
-io_t *io[NPORTS];
-io_t *io_last[NPORTS];
+/* Per-port fast path flags, set when a port has exactly one handler and an
+   access of the given size can be passed straight to it, with no other
+   handler on the neighbouring ports needing a split byte or word access. */
+#define IO_FAST_INB  0x01
+#define IO_FAST_INW  0x02
+#define IO_FAST_INL  0x04
+#define IO_FAST_OUTB 0x10
+#define IO_FAST_OUTW 0x20
+#define IO_FAST_OUTL 0x40
+
+int     initialized = 0;
+io_t   *io[NPORTS];
+io_t   *io_last[NPORTS];
+uint8_t io_fast[NPORTS];
 
 #ifdef ENABLE_IO_LOG
 int io_do_log = ENABLE_IO_LOG;
@@ -105,6 +116,75 @@ io_init(void)
         /* io[c] should be NULL. */
         io[c] = io_last[c] = NULL;
     }
+
+    memset(io_fast, 0x00, sizeof(io_fast));
+}
+
+/* Returns 1 if none of the handlers on the port would be called by the byte
+   split of a word (dword = 0) or double word (dword = 1) access, and 0
+   otherwise. */
+static int
+io_port_no_split_b(uint16_t port, int write, int dword)
+{
+    for (io_t *p = io[port]; p != NULL; p = p->next) {
+        if (write ? (p->outb && !p->outw && !(dword && p->outl)) :
+                    (p->inb && !p->inw && !(dword && p->inl)))
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Returns 1 if none of the handlers on the port would be called by the word
+   split of a double word access, and 0 otherwise. */
+static int
+io_port_no_split_w(uint16_t port, int write)
+{
+    for (io_t *p = io[port]; p != NULL; p = p->next) {
+        if (write ? (p->outw && !p->outl) : (p->inw && !p->inl))
+            return 0;
+    }
+
+    return 1;
+}
+
+static void
+io_fast_update(uint16_t port)
+{
+    const io_t *p    = io[port];
+    uint8_t     fast = 0x00;
+
+    if ((p != NULL) && (p->next == NULL)) {
+        if (p->inb)
+            fast |= IO_FAST_INB;
+        if (p->outb)
+            fast |= IO_FAST_OUTB;
+
+        /* The word split only looks for byte-only handlers, so a word
+           handler here covers both bytes of the port itself. */
+        if (p->inw && io_port_no_split_b(port + 1, 0, 0))
+            fast |= IO_FAST_INW;
+        if (p->outw && io_port_no_split_b(port + 1, 1, 0))
+            fast |= IO_FAST_OUTW;
+
+        if (p->inl && io_port_no_split_w(port + 2, 0) && io_port_no_split_b(port + 1, 0, 1) &&
+            io_port_no_split_b(port + 2, 0, 1) && io_port_no_split_b(port + 3, 0, 1))
+            fast |= IO_FAST_INL;
+        if (p->outl && io_port_no_split_w(port + 2, 1) && io_port_no_split_b(port + 1, 1, 1) &&
+            io_port_no_split_b(port + 2, 1, 1) && io_port_no_split_b(port + 3, 1, 1))
+            fast |= IO_FAST_OUTL;
+    }
+
+    io_fast[port] = fast;
+}
+
+/* A change to a port can affect the word and double word fast paths of the
+   three ports below it, so those are recomputed as well. */
+static void
+io_fast_update_range(uint16_t base, int size)
+{
+    for (int c = -3; c < size; c++)
+        io_fast_update((uint16_t) (base + c));
 }
 
 void
@@ -147,6 +227,8 @@ io_sethandler_common(uint16_t base, int size,
 
         q = NULL;
     }
+
+    io_fast_update_range(base, size);
 }
 
 void
@@ -184,6 +266,8 @@ io_removehandler_common(uint16_t base, int size,
             p = q;
         }
     }
+
+    io_fast_update_range(base, size);
 }
 
 void
@@ -360,6 +444,13 @@ inb(uint16_t port)
         found = 1;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port] & IO_FAST_INB) {
+        p = io[port];
+        ret = p->inb(port, p->priv);
+        found = 1;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -427,6 +518,13 @@ outb(uint16_t port, uint8_t val)
         found = 1;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port] & IO_FAST_OUTB) {
+        p = io[port];
+        p->outb(port, val, p->priv);
+        found = 1;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -485,6 +583,13 @@ inw(uint16_t port)
         found = 2;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port] & IO_FAST_INW) {
+        p = io[port];
+        ret = p->inw(port, p->priv);
+        found = 2;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -564,6 +669,13 @@ outw(uint16_t port, uint16_t val)
         found = 2;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port] & IO_FAST_OUTW) {
+        p = io[port];
+        p->outw(port, val, p->priv);
+        found = 2;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -638,6 +750,13 @@ inl(uint16_t port)
         found = 4;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port] & IO_FAST_INL) {
+        p = io[port];
+        ret = p->inl(port, p->priv);
+        found = 4;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -749,6 +868,13 @@ outl(uint16_t port, uint32_t val)
         found = 4;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port] & IO_FAST_OUTL) {
+        p = io[port];
+        p->outl(port, val, p->priv);
+        found = 4;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -83,11 +83,11 @@ uint32_t pccache;
 uint8_t *pccache2;
 
 int        readlnext;
-int        readlookup[256];
+int        readlookup[MEM_TLB_SIZE];
 uintptr_t  old_rl2;
 uint8_t    uncached = 0;
 int        writelnext;
-int        writelookup[256];
+int        writelookup[MEM_TLB_SIZE];
 
 /* The lookup tables. */
 page_t *page_lookup[1048576] = { 0 };
@@ -101,7 +101,15 @@ int shadowbios = 0;
 int shadowbios_write;
 int readlnum  = 0;
 int writelnum = 0;
-int cachesize = 256;
+int cachesize = MEM_TLB_SIZE;
+
+mem_tlb_stats_t mem_tlb_stats;
+
+/* Number of slots of readlookup/writelookup used since the last full flush.
+   The rings are refilled from slot 0 after a flush, so anything past these
+   is known to be empty and the flushes need not walk it. */
+static int readlused;
+static int writelused;
 
 uint32_t get_phys_virt;
 uint32_t get_phys_phys;
@@ -173,7 +181,7 @@ resetreadlookup(void)
     memset(page_lookup, 0x00, (1 << 20) * sizeof(page_t *));
 
     /* Initialize the tables for lower (<= 1024K) RAM. */
-    for (uint16_t c = 0; c < 256; c++) {
+    for (int c = 0; c < MEM_TLB_SIZE; c++) {
         readlookup[c]  = 0xffffffff;
         writelookup[c] = 0xffffffff;
     }
@@ -185,24 +193,51 @@ resetreadlookup(void)
 
     readlnext  = 0;
     writelnext = 0;
+    readlused  = 0;
+    writelused = 0;
+    readlnum   = 0;
+    writelnum  = 0;
     pccache    = 0xffffffff;
     high_page  = 0;
 }
 
-void
-flushmmucache(void)
+static void
+flush_read_lookups(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
+    for (int c = 0; c < readlused; c++) {
         if (readlookup[c] != (int) 0xffffffff) {
             readlookup2[readlookup[c]] = LOOKUP_INV;
             readlookup[c]              = 0xffffffff;
         }
+    }
+
+    readlnext = 0;
+    readlused = 0;
+    readlnum  = 0;
+}
+
+static void
+flush_write_lookups(void)
+{
+    for (int c = 0; c < writelused; c++) {
         if (writelookup[c] != (int) 0xffffffff) {
             page_lookup[writelookup[c]]  = NULL;
             writelookup2[writelookup[c]] = LOOKUP_INV;
             writelookup[c]               = 0xffffffff;
         }
     }
+
+    writelnext = 0;
+    writelused = 0;
+    writelnum  = 0;
+}
+
+void
+flushmmucache(void)
+{
+    flush_read_lookups();
+    flush_write_lookups();
+    mem_tlb_stats.flushes++;
     mmuflush++;
 
     pccache  = (uint32_t) 0xffffffff;
@@ -216,13 +251,8 @@ flushmmucache(void)
 void
 flushmmucache_write(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookup[c]               = 0xffffffff;
-        }
-    }
+    flush_write_lookups();
+    mem_tlb_stats.write_flushes++;
     mmuflush++;
 }
 
@@ -242,17 +272,9 @@ flushmmucache_pc(void)
 void
 flushmmucache_nopc(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (readlookup[c] != (int) 0xffffffff) {
-            readlookup2[readlookup[c]] = LOOKUP_INV;
-            readlookup[c]              = 0xffffffff;
-        }
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookup[c]               = 0xffffffff;
-        }
-    }
+    flush_read_lookups();
+    flush_write_lookups();
+    mem_tlb_stats.flushes++;
 }
 
 void
@@ -260,18 +282,46 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
 {
     const page_t *page_target = &pages[addr >> 12];
 
-    for (uint16_t c = 0; c < 256; c++) {
+    mem_tlb_stats.page_flushes++;
+
+    for (int c = 0; c < writelused; c++) {
         if (writelookup[c] != (int) 0xffffffff) {
             uintptr_t target = (uintptr_t) &ram[(uintptr_t) (addr & ~0xfff) - (virt & ~0xfff)];
             if (writelookup2[writelookup[c]] == target || page_lookup[writelookup[c]] == page_target) {
                 writelookup2[writelookup[c]] = LOOKUP_INV;
                 page_lookup[writelookup[c]]  = NULL;
                 writelookup[c]               = 0xffffffff;
+                writelnum--;
             }
         }
     }
 }
 
+void
+mem_tlb_stats_reset(void)
+{
+    memset(&mem_tlb_stats, 0, sizeof(mem_tlb_stats_t));
+}
+
+void
+mem_tlb_stats_dump(void)
+{
+    pclog("TLB: %i of %i read and %i of %i write translations in use\n",
+          readlnum, MEM_TLB_SIZE, writelnum, MEM_TLB_SIZE);
+    pclog("TLB: %" PRIu64 " read fills (%" PRIu64 " evictions), %" PRIu64 " write fills (%" PRIu64 " evictions)\n",
+          mem_tlb_stats.read_fills, mem_tlb_stats.read_evictions,
+          mem_tlb_stats.write_fills, mem_tlb_stats.write_evictions);
+    pclog("TLB: %" PRIu64 " full flushes, %" PRIu64 " write flushes, %" PRIu64 " single page flushes\n",
+          mem_tlb_stats.flushes, mem_tlb_stats.write_flushes, mem_tlb_stats.page_flushes);
+#ifdef USE_INSTRUMENT
+    pclog("TLB: %" PRIu64 " read hits (%.2f%%), %" PRIu64 " write hits (%.2f%%)\n",
+          mem_tlb_stats.read_hits,
+          (100.0 * (double) mem_tlb_stats.read_hits) / (double) MAX(mem_tlb_stats.read_hits + mem_tlb_stats.read_fills, 1),
+          mem_tlb_stats.write_hits,
+          (100.0 * (double) mem_tlb_stats.write_hits) / (double) MAX(mem_tlb_stats.write_hits + mem_tlb_stats.write_fills, 1));
+#endif
+}
+
 #define mmutranslate_read(addr)  mmutranslatereal(addr, 0)
 #define mmutranslate_write(addr) mmutranslatereal(addr, 1)
 #define rammap(x)                ((uint32_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 2) & MEM_GRANULARITY_QMASK]
@@ -580,12 +630,17 @@ addreadlookup(uint32_t virt, uint32_t phys)
         if ((readlookup[readlnext] == ((es + DI) >> 12)) || (readlookup[readlnext] == ((es + EDI) >> 12)))
             uncached = 1;
         readlookup2[readlookup[readlnext]] = LOOKUP_INV;
-    }
+        mem_tlb_stats.read_evictions++;
+    } else
+        readlnum++;
 
     readlookup2[virt >> 12] = (uintptr_t) &ram[(uintptr_t) (phys & ~0xFFF) - (uintptr_t) (virt & ~0xfff)];
 
     readlookup[readlnext++] = virt >> 12;
+    if (readlnext > readlused)
+        readlused = readlnext;
     readlnext &= (cachesize - 1);
+    mem_tlb_stats.read_fills++;
 
     cycles -= 9;
 }
@@ -602,7 +657,9 @@ addwritelookup(uint32_t virt, uint32_t phys)
     if (writelookup[writelnext] != -1) {
         page_lookup[writelookup[writelnext]]  = NULL;
         writelookup2[writelookup[writelnext]] = LOOKUP_INV;
-    }
+        mem_tlb_stats.write_evictions++;
+    } else
+        writelnum++;
 
 #ifdef USE_NEW_DYNAREC
 #    ifdef USE_DYNAREC
@@ -624,7 +681,10 @@ addwritelookup(uint32_t virt, uint32_t phys)
     }
 
     writelookup[writelnext++] = virt >> 12;
+    if (writelnext > writelused)
+        writelused = writelnext;
     writelnext &= (cachesize - 1);
+    mem_tlb_stats.write_fills++;
 
     cycles -= 9;
 }
@@ -1772,6 +1832,62 @@ mem_write_phys(void *src, uint32_t addr, int transfer_size)
     }
 }
 
+/* Whether a bus master access to the given mapping can go straight to its
+   exec pointer, which is what the byte/word/dword paths above end up doing
+   for plain RAM anyway. */
+static inline int
+mem_bm_direct(const mem_mapping_t *map, int write)
+{
+    if ((map == NULL) || (map->exec == NULL))
+        return 0;
+
+    if (cpu_use_exec)
+        return 1;
+
+    return write ? (map->write_b == mem_write_ram) : (map->read_b == mem_read_ram);
+}
+
+/* Resolve the run of up to *len bytes at bus address addr for a bus master
+   transfer. If it starts in plain RAM, returns a host pointer to it and
+   shortens *len to the part that is contiguous in host memory; otherwise
+   returns NULL and shortens *len to the end of the granule, which then has
+   to go through mem_read_phys()/mem_write_phys(). */
+uint8_t *
+mem_bm_span(uint32_t addr, uint32_t *len, int write)
+{
+    mem_mapping_t *const *bus = write ? write_mapping_bus : read_mapping_bus;
+    mem_mapping_t        *map = bus[addr >> MEM_GRANULARITY_BITS];
+    uint32_t              run = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+    uint8_t              *p;
+    uint32_t              next;
+
+    if (!mem_bm_direct(map, write)) {
+        if (*len > run)
+            *len = run;
+        return NULL;
+    }
+
+    p = &map->exec[(addr - map->base) & map->mask];
+
+    /* Extend across granules for as long as they map to the following host bytes. */
+    while (run < *len) {
+        next = addr + run;
+        if ((next >> MEM_GRANULARITY_BITS) == 0)
+            break;
+
+        map = bus[next >> MEM_GRANULARITY_BITS];
+        if (!mem_bm_direct(map, write) || (&map->exec[(next - map->base) & map->mask] != (p + run)))
+            break;
+
+        run += MEM_GRANULARITY_SIZE;
+    }
+
+    if (*len > run)
+        *len = run;
+
+    return p;
+}
+
 uint8_t
 mem_read_ram(uint32_t addr, UNUSED(void *priv))
 {
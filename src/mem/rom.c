@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <wchar.h>
 #include <stdbool.h>
+#include <sys/stat.h>
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include "cpu.h"
@@ -34,6 +35,8 @@
 #include <86box/rom.h>
 #include <86box/path.h>
 #include <86box/plat.h>
+#include <86box/plat_dir.h>
+#include <86box/thread.h>
 #include <86box/machine.h>
 #include <86box/m_xt_xi8088.h>
 
@@ -55,6 +58,452 @@ rom_log(const char *fmt, ...)
 #    define rom_log(fmt, ...)
 #endif
 
+#ifndef S_ISDIR
+#    define S_ISDIR(m) (((m) &S_IFMT) == S_IFDIR)
+#endif
+
+#ifdef _WIN32
+#    define stat _stat64
+typedef struct __stat64 stat_t;
+#else
+typedef struct stat stat_t;
+#endif
+
+/*
+ * ROM file index.
+ *
+ * Availability checks (machine_available(), device_available()) probe a
+ * lot of ROM files that are mostly not there, and each probe used to cost
+ * one stat() per ROM path. Instead, the ROM paths are walked once and
+ * every file and directory found is put in a hash table, keyed by its
+ * name relative to the ROM path. The index is saved to the global data
+ * directory along with the modification times of all directories seen,
+ * so it can be reused by the next run as long as none of them changed.
+ * The directories are also re-checked at most once a second, so ROMs
+ * added while the emulator is running are still picked up.
+ */
+#define ROM_INDEX_MAGIC     "86BoxROMIdx"
+#define ROM_INDEX_VERSION   2
+#define ROM_INDEX_FILE      "rom_index.bin"
+#define ROM_INDEX_MAX_DEPTH 16
+#define ROM_INDEX_CHECK_MS  1000
+
+typedef struct rom_index_entry_t {
+    char    *name; /* relative to the ROM path, '/' separated */
+    uint32_t hash;
+    uint16_t path_id;
+    uint8_t  is_dir;
+} rom_index_entry_t;
+
+typedef struct rom_index_dir_t {
+    char   *path;
+    int64_t mtime;
+} rom_index_dir_t;
+
+typedef struct rom_index_header_t {
+    char     magic[12];
+    uint32_t version;
+    uint32_t paths_hash;
+    uint32_t dirs_num;
+    uint32_t entries_num;
+    uint32_t complete;
+} rom_index_header_t;
+
+static rom_index_entry_t *rom_index_entries;
+static uint32_t           rom_index_size;
+static uint32_t           rom_index_count;
+static rom_index_dir_t   *rom_index_dirs;
+static uint32_t           rom_index_dirs_size;
+static uint32_t           rom_index_dirs_num;
+static uint32_t           rom_index_paths_hash;
+static uint32_t           rom_index_last_check;
+static int                rom_index_valid;
+static int                rom_index_complete;
+static mutex_t           *rom_index_mutex;
+
+/* ROM names are matched the way the host file system would. */
+static inline uint8_t
+rom_index_fold(char c)
+{
+    if (c == '\\')
+        return '/';
+#if defined(_WIN32) || defined(__APPLE__)
+    if ((c >= 'A') && (c <= 'Z'))
+        return c + 0x20;
+#endif
+    return c;
+}
+
+static uint32_t
+rom_index_hash(const char *name, int len)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    for (int i = 0; i < len; i++)
+        hash = (hash ^ rom_index_fold(name[i])) * 0x01000193;
+
+    return hash;
+}
+
+static int
+rom_index_match(const rom_index_entry_t *entry, const char *name, int len)
+{
+    for (int i = 0; i < len; i++) {
+        if (rom_index_fold(entry->name[i]) != rom_index_fold(name[i]))
+            return 0;
+    }
+
+    return entry->name[len] == '\0';
+}
+
+static int64_t
+rom_index_mtime(const char *path)
+{
+    stat_t stats;
+
+    if ((stat(path, &stats) != 0) || !S_ISDIR(stats.st_mode))
+        return -1;
+
+    /* Whole seconds would miss a change made within the same second as the scan. */
+#if defined(__APPLE__)
+    return ((int64_t) stats.st_mtimespec.tv_sec * 1000000000) + stats.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    return ((int64_t) stats.st_mtim.tv_sec * 1000000000) + stats.st_mtim.tv_nsec;
+#else
+    return (int64_t) stats.st_mtime;
+#endif
+}
+
+static void
+rom_index_clear(void)
+{
+    for (uint32_t i = 0; i < rom_index_size; i++)
+        free(rom_index_entries[i].name);
+    free(rom_index_entries);
+    rom_index_entries = NULL;
+    rom_index_size = rom_index_count = 0;
+
+    for (uint32_t i = 0; i < rom_index_dirs_num; i++)
+        free(rom_index_dirs[i].path);
+    free(rom_index_dirs);
+    rom_index_dirs = NULL;
+    rom_index_dirs_size = rom_index_dirs_num = 0;
+}
+
+static rom_index_entry_t *
+rom_index_find(const char *name, int len, uint32_t hash)
+{
+    if (!rom_index_size)
+        return NULL;
+
+    for (uint32_t i = hash;; i++) {
+        rom_index_entry_t *entry = &rom_index_entries[i & (rom_index_size - 1)];
+        if (!entry->name || ((entry->hash == hash) && rom_index_match(entry, name, len)))
+            return entry;
+    }
+}
+
+static void
+rom_index_add(const char *name, uint16_t path_id, uint8_t is_dir)
+{
+    const int          len  = strlen(name);
+    const uint32_t     hash = rom_index_hash(name, len);
+    rom_index_entry_t *entry;
+
+    /* Keep the table at most half full. */
+    if ((rom_index_count + 1) * 2 > rom_index_size) {
+        rom_index_entry_t *old      = rom_index_entries;
+        uint32_t           old_size = rom_index_size;
+
+        rom_index_size    = old_size ? (old_size << 1) : 4096;
+        rom_index_entries = calloc(rom_index_size, sizeof(rom_index_entry_t));
+        for (uint32_t i = 0; i < old_size; i++) {
+            if (old[i].name)
+                *rom_index_find(old[i].name, strlen(old[i].name), old[i].hash) = old[i];
+        }
+        free(old);
+    }
+
+    /* The first ROM path to have a file wins, like in the lookups. */
+    entry = rom_index_find(name, len, hash);
+    if (entry->name)
+        return;
+
+    entry->name    = strdup(name);
+    entry->hash    = hash;
+    entry->path_id = path_id;
+    entry->is_dir  = is_dir;
+    rom_index_count++;
+}
+
+static void
+rom_index_add_dir(const char *path, int64_t mtime)
+{
+    if (rom_index_dirs_num == rom_index_dirs_size) {
+        rom_index_dirs_size = rom_index_dirs_size ? (rom_index_dirs_size << 1) : 64;
+        rom_index_dirs      = realloc(rom_index_dirs, rom_index_dirs_size * sizeof(rom_index_dir_t));
+    }
+
+    rom_index_dirs[rom_index_dirs_num].path  = strdup(path);
+    rom_index_dirs[rom_index_dirs_num].mtime = mtime;
+    rom_index_dirs_num++;
+}
+
+static void
+rom_index_scan(uint16_t path_id, const char *base, const char *rel, int depth)
+{
+    char           dir_path[1024];
+    char           path[1024];
+    char           name[1024];
+    struct dirent *readdir_entry;
+    stat_t         stats;
+    DIR           *dirp;
+
+    snprintf(dir_path, sizeof(dir_path), "%s%s", base, rel);
+
+    /* Store the time before the walk, so a change during it is caught next
+       time. A ROM path that doesn't exist is stored too (as -1), so that it
+       being created later also invalidates the index. */
+    rom_index_add_dir(dir_path, rom_index_mtime(dir_path));
+
+    dirp = opendir(dir_path);
+    if (dirp == NULL)
+        return;
+
+    while ((readdir_entry = readdir(dirp))) {
+        if ((readdir_entry->d_name[0] == '.') && ((readdir_entry->d_name[1] == '\0') || ((readdir_entry->d_name[1] == '.') && (readdir_entry->d_name[2] == '\0'))))
+            continue;
+
+        snprintf(name, sizeof(name), "%s%s", rel, readdir_entry->d_name);
+        snprintf(path, sizeof(path), "%s%s", base, name);
+        if (stat(path, &stats) != 0)
+            continue;
+
+        if (S_ISDIR(stats.st_mode)) {
+            rom_index_add(name, path_id, 1);
+            if (depth < ROM_INDEX_MAX_DEPTH) {
+                strcat(name, "/");
+                rom_index_scan(path_id, base, name, depth + 1);
+            } else if (rom_index_complete) {
+                /* Anything the index misses from here on goes to the file system. */
+                pclog("ROM: %s is nested too deeply to be indexed\n", path);
+                rom_index_complete = 0;
+            }
+        } else
+            rom_index_add(name, path_id, 0);
+    }
+
+    closedir(dirp);
+}
+
+static void
+rom_index_path(char *path, int size)
+{
+    plat_get_global_data_dir(path, size - sizeof(ROM_INDEX_FILE));
+    strcat(path, ROM_INDEX_FILE);
+}
+
+static int
+rom_index_load(void)
+{
+    rom_index_header_t hdr;
+    char               path[1024];
+    int64_t            mtime;
+    uint16_t           len;
+    uint16_t           path_id;
+    uint8_t            is_dir;
+    FILE              *fp;
+    int                ret = 0;
+
+    rom_index_path(path, sizeof(path));
+    fp = plat_fopen(path, "rb");
+    if (fp == NULL)
+        return 0;
+
+    if ((fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) || memcmp(hdr.magic, ROM_INDEX_MAGIC, sizeof(hdr.magic)) ||
+        (hdr.version != ROM_INDEX_VERSION) || (hdr.paths_hash != rom_index_paths_hash) || !hdr.complete)
+        goto end;
+
+    /* Any directory being added to, removed from or renamed into invalidates the whole index. */
+    for (uint32_t i = 0; i < hdr.dirs_num; i++) {
+        if ((fread(&mtime, 1, sizeof(mtime), fp) != sizeof(mtime)) || (fread(&len, 1, sizeof(len), fp) != sizeof(len)) ||
+            (len >= sizeof(path)) || (fread(path, 1, len, fp) != len))
+            goto end;
+        path[len] = '\0';
+        if (rom_index_mtime(path) != mtime)
+            goto end;
+        rom_index_add_dir(path, mtime);
+    }
+
+    for (uint32_t i = 0; i < hdr.entries_num; i++) {
+        if ((fread(&path_id, 1, sizeof(path_id), fp) != sizeof(path_id)) || (fread(&is_dir, 1, sizeof(is_dir), fp) != sizeof(is_dir)) ||
+            (fread(&len, 1, sizeof(len), fp) != sizeof(len)) || (len >= sizeof(path)) || (fread(path, 1, len, fp) != len))
+            goto end;
+        path[len] = '\0';
+        rom_index_add(path, path_id, is_dir);
+    }
+
+    ret = 1;
+
+end:
+    fclose(fp);
+    return ret;
+}
+
+/* Write the index to a temporary file and then move it into place, so that
+   another instance reading it never sees half of it. */
+static void
+rom_index_save(void)
+{
+    rom_index_header_t hdr = { 0 };
+    char               path[1024];
+    char               temp[2048];
+    char               temp_fn[1024];
+    uint16_t           len;
+    FILE              *fp;
+    int                ret = 1;
+
+    rom_index_path(path, sizeof(path));
+    plat_tempfile(temp_fn, NULL, ".tmp");
+    snprintf(temp, sizeof(temp), "%s.%s", path, temp_fn);
+    fp = plat_fopen(temp, "wb");
+    if (fp == NULL)
+        return;
+
+    memcpy(hdr.magic, ROM_INDEX_MAGIC, sizeof(hdr.magic));
+    hdr.version     = ROM_INDEX_VERSION;
+    hdr.paths_hash  = rom_index_paths_hash;
+    hdr.dirs_num    = rom_index_dirs_num;
+    hdr.entries_num = rom_index_count;
+    hdr.complete    = rom_index_complete;
+    ret             = (fwrite(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr));
+
+    for (uint32_t i = 0; ret && (i < rom_index_dirs_num); i++) {
+        len = strlen(rom_index_dirs[i].path);
+        ret = (fwrite(&rom_index_dirs[i].mtime, 1, sizeof(rom_index_dirs[i].mtime), fp) == sizeof(rom_index_dirs[i].mtime)) &&
+              (fwrite(&len, 1, sizeof(len), fp) == sizeof(len)) && (fwrite(rom_index_dirs[i].path, 1, len, fp) == len);
+    }
+
+    for (uint32_t i = 0; ret && (i < rom_index_size); i++) {
+        const rom_index_entry_t *entry = &rom_index_entries[i];
+        if (!entry->name)
+            continue;
+        len = strlen(entry->name);
+        ret = (fwrite(&entry->path_id, 1, sizeof(entry->path_id), fp) == sizeof(entry->path_id)) &&
+              (fwrite(&entry->is_dir, 1, sizeof(entry->is_dir), fp) == sizeof(entry->is_dir)) &&
+              (fwrite(&len, 1, sizeof(len), fp) == sizeof(len)) && (fwrite(entry->name, 1, len, fp) == len);
+    }
+
+    ret = (fclose(fp) == 0) && ret;
+
+#ifdef _WIN32
+    /* rename() won't replace an existing file on Windows. */
+    if (ret)
+        remove(path);
+#endif
+    if (!ret || rename(temp, path)) {
+        rom_log("ROM: could not write the index\n");
+        remove(temp);
+    }
+}
+
+static void
+rom_index_build(int use_cache)
+{
+    uint16_t path_id = 0;
+
+    rom_index_clear();
+
+    rom_index_paths_hash = 0x811c9dc5;
+    for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
+        rom_index_paths_hash = rom_index_hash(rom_path->path, strlen(rom_path->path)) ^ (rom_index_paths_hash * 0x01000193);
+        path_id++;
+    }
+
+    rom_index_complete = 1;
+    if (!use_cache || !rom_index_load()) {
+        rom_index_clear();
+        rom_index_complete = 1;
+
+        path_id = 0;
+        for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next)
+            rom_index_scan(path_id++, rom_path->path, "", 0);
+
+        rom_log("ROM: indexed %u entries in %u directories\n", rom_index_count, rom_index_dirs_num);
+        rom_index_save();
+    } else
+        rom_log("ROM: loaded index of %u entries in %u directories\n", rom_index_count, rom_index_dirs_num);
+
+    rom_index_valid      = 1;
+    rom_index_last_check = plat_get_ticks();
+}
+
+static void
+rom_index_check(void)
+{
+    uint32_t now;
+
+    if (!rom_index_valid) {
+        rom_index_build(1);
+        return;
+    }
+
+    now = plat_get_ticks();
+    if ((now - rom_index_last_check) < ROM_INDEX_CHECK_MS)
+        return;
+    rom_index_last_check = now;
+
+    for (uint32_t i = 0; i < rom_index_dirs_num; i++) {
+        if (rom_index_mtime(rom_index_dirs[i].path) != rom_index_dirs[i].mtime) {
+            rom_log("ROM: %s changed, rebuilding index\n", rom_index_dirs[i].path);
+            rom_index_build(0);
+            return;
+        }
+    }
+}
+
+/*
+ * Look a "roms/" relative name up in the index, returning the ROM path
+ * it's in, or NULL if it's not there. A trailing slash looks up a
+ * directory. Returns 0 if the index can't answer for this name.
+ */
+static int
+rom_index_lookup(const char *fn, const rom_path_t **found)
+{
+    const char              *name = fn + 5;
+    int                      len  = strlen(name);
+    int                      want_dir;
+    const rom_index_entry_t *entry;
+    const rom_path_t        *rom_path = NULL;
+    int                      complete;
+
+    /* Leave anything that isn't a plain relative name to the file system. */
+    if ((rom_index_mutex == NULL) || (len == 0) || strstr(name, "./") || strstr(name, ".\\"))
+        return 0;
+
+    want_dir = (name[len - 1] == '/') || (name[len - 1] == '\\');
+    if (want_dir)
+        len--;
+
+    thread_wait_mutex(rom_index_mutex);
+    rom_index_check();
+    entry = rom_index_find(name, len, rom_index_hash(name, len));
+    if ((entry != NULL) && (entry->name != NULL) && (entry->is_dir == want_dir)) {
+        rom_path = &rom_paths;
+        for (uint16_t i = 0; (i < entry->path_id) && (rom_path != NULL); i++)
+            rom_path = rom_path->next;
+    }
+    complete = rom_index_complete;
+    thread_release_mutex(rom_index_mutex);
+
+    /* A miss in an index that had to skip part of a tree proves nothing. */
+    if ((rom_path == NULL) && !complete)
+        return 0;
+
+    *found = rom_path;
+    return 1;
+}
+
 void
 rom_add_path(const char *path)
 {
@@ -83,6 +532,11 @@ rom_add_path(const char *path)
 
     // Ensure the path ends with a separator.
     path_slash(rom_path->path);
+
+    // The index has to be rebuilt to cover the new path.
+    if (rom_index_mutex == NULL)
+        rom_index_mutex = thread_create_mutex();
+    rom_index_valid = 0;
 }
 
 static int
@@ -113,6 +567,13 @@ rom_get_full_path(char *dest, const char *fn)
 
     if (!strncmp(fn, "roms/", 5)) {
         /* Relative path */
+        const rom_path_t *found;
+        if (rom_index_lookup(fn, &found)) {
+            if (found != NULL)
+                path_append_filename(dest, found->path, fn + 5);
+            return;
+        }
+
         for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
             path_append_filename(temp, rom_path->path, fn + 5);
 
@@ -140,6 +601,16 @@ rom_fopen(const char *fn, char *mode)
 
     if (!strncmp(fn, "roms/", 5)) {
         /* Relative path */
+        const rom_path_t *found;
+        if (!strchr(mode, 'w') && !strchr(mode, 'a') && rom_index_lookup(fn, &found)) {
+            if (found == NULL)
+                return NULL;
+
+            path_append_filename(temp, found->path, fn + 5);
+            if ((fp = plat_fopen(temp, mode)) != NULL)
+                return fp;
+        }
+
         for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
             path_append_filename(temp, rom_path->path, fn + 5);
 
@@ -161,6 +632,16 @@ rom_getfile(const char *fn, char *s, int size)
 
     if (!strncmp(fn, "roms/", 5)) {
         /* Relative path */
+        const rom_path_t *found;
+        if (rom_index_lookup(fn, &found)) {
+            if (found == NULL)
+                return 0;
+
+            path_append_filename(temp, found->path, fn + 5);
+            strncpy(s, temp, size);
+            return 1;
+        }
+
         for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
             path_append_filename(temp, rom_path->path, fn + 5);
 
@@ -192,6 +673,10 @@ rom_present(const char *fn)
 
     if (!strncmp(fn, "roms/", 5)) {
         /* Relative path */
+        const rom_path_t *found;
+        if (rom_index_lookup(fn, &found))
+            return found != NULL;
+
         for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
             path_append_filename(temp, rom_path->path, fn + 5);
 
@@ -60,11 +60,13 @@
 #include <fcntl.h>
 #include <sys/select.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <linux/if.h>
 #include <linux/if_tun.h>
 #include <linux/if_arp.h>
 #include <linux/sockios.h>
+#include <linux/virtio_net.h>
 
 #define HAVE_STDARG_H
 
@@ -77,14 +79,17 @@
 #include <86box/network.h>
 #include <86box/net_event.h>
 
+#define TAP_PKT_BATCH NET_QUEUE_LEN
+
 typedef struct net_tap_t {
     int        fd; // tap device file descriptor
+    int        vnet_hdr; // frames are prefixed with a virtio_net_hdr
     netcard_t *card;
     thread_t  *poll_tid;
     net_evt_t  tx_event;
     net_evt_t  stop_event;
     netpkt_t   pkt_rx;
-    netpkt_t   pkts_tx[NET_QUEUE_LEN];
+    netpkt_t   pkts_tx[TAP_PKT_BATCH];
 } net_tap_t;
 
 #ifdef ENABLE_TAP_LOG
@@ -119,6 +124,91 @@ static void tap_log(const char *fmt, ...)
         } while (0)
 #endif
 
+// The host may hand us frames with the L4 checksum left for us to fill in
+// (VIRTIO_NET_HDR_F_NEEDS_CSUM); the emulated cards expect complete frames.
+static void net_tap_csum_complete(netpkt_t *pkt, const struct virtio_net_hdr *hdr)
+{
+    const int start  = hdr->csum_start;
+    const int offset = start + hdr->csum_offset;
+    uint32_t  sum    = 0;
+    int       i;
+
+    if ((offset + 2) > pkt->len) {
+        return;
+    }
+    // The checksum field already holds the pseudo-header sum.
+    for (i = start; (i + 1) < pkt->len; i += 2) {
+        sum += (pkt->data[i] << 8) | pkt->data[i + 1];
+    }
+    if (i < pkt->len) {
+        sum += pkt->data[i] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    sum = ~sum & 0xffff;
+    if (sum == 0) {
+        sum = 0xffff;
+    }
+    pkt->data[offset]     = sum >> 8;
+    pkt->data[offset + 1] = sum & 0xff;
+}
+
+// Read one frame, returns the frame length, 0 if it was dropped or -1 on error
+static ssize_t net_tap_read(net_tap_t *tap)
+{
+    struct virtio_net_hdr hdr;
+    ssize_t               len;
+
+    if (tap->vnet_hdr) {
+        struct iovec iov[2] = {
+            { &hdr, sizeof(hdr) },
+            { tap->pkt_rx.data, NET_MAX_FRAME }
+        };
+        len = readv(tap->fd, iov, 2);
+        if (len < (ssize_t) sizeof(hdr)) {
+            return (len < 0) ? len : 0;
+        }
+        len -= sizeof(hdr);
+        // We never enable TSO/UFO, but don't pass on a super-frame if one shows up
+        if (hdr.gso_type != VIRTIO_NET_HDR_GSO_NONE) {
+            tap_log("TAP: dropping GSO frame of type %i\n", hdr.gso_type);
+            return 0;
+        }
+        tap->pkt_rx.len = len;
+        if (hdr.flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+            net_tap_csum_complete(&tap->pkt_rx, &hdr);
+        }
+    } else {
+        len = read(tap->fd, tap->pkt_rx.data, NET_MAX_FRAME);
+        if (len < 0) {
+            return len;
+        }
+        tap->pkt_rx.len = len;
+    }
+    return len;
+}
+
+static void net_tap_write(net_tap_t *tap, netpkt_t *pkt)
+{
+    ssize_t ret;
+
+    if (tap->vnet_hdr) {
+        // The guest already checksummed the frame, so the header stays blank
+        struct virtio_net_hdr hdr = { 0 };
+        struct iovec iov[2] = {
+            { &hdr, sizeof(hdr) },
+            { pkt->data, pkt->len }
+        };
+        ret = writev(tap->fd, iov, 2);
+    } else {
+        ret = write(tap->fd, pkt->data, pkt->len);
+    }
+    if (ret < 0) {
+        tap_log("TAP: write error: %s\n", strerror(errno));
+    }
+}
+
 static void net_tap_thread(void *priv) {
     enum {
         NET_EVENT_STOP = 0,
@@ -155,24 +245,31 @@ static void net_tap_thread(void *priv) {
         }
         if (pfd[NET_EVENT_TX].revents & POLLIN) {
             net_event_clear(&tap->tx_event);
-            int packets = network_tx_popv(tap->card, tap->pkts_tx,
-                                          NET_QUEUE_LEN);
-            for(int i = 0; i < packets; i++) {
-                netpkt_t *pkt = &tap->pkts_tx[i];
-                ssize_t ret = write(tap->fd, pkt->data, pkt->len);
-                if (ret < 0) {
-                    tap_log("TAP: write error: %s\n", strerror(errno));
+            // Keep going while full batches come out, the card may be
+            // queueing faster than one batch per wakeup
+            int packets;
+            do {
+                packets = network_tx_popv(tap->card, tap->pkts_tx, TAP_PKT_BATCH);
+                for(int i = 0; i < packets; i++) {
+                    net_tap_write(tap, &tap->pkts_tx[i]);
                 }
-            }
+            } while (packets == TAP_PKT_BATCH);
         }
         if (pfd[NET_EVENT_RX].revents & POLLIN) {
-            ssize_t len = read(tap->fd, tap->pkt_rx.data, NET_MAX_FRAME);
-            if (len < 0) {
-                tap_log("TAP: read error: %s\n", strerror(errno));
-                continue;
+            // Drain what's pending instead of going back to poll() for
+            // every frame, but bound it so TX and stop still get serviced
+            for (int i = 0; i < TAP_PKT_BATCH; i++) {
+                ssize_t len = net_tap_read(tap);
+                if (len < 0) {
+                    if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                        tap_log("TAP: read error: %s\n", strerror(errno));
+                    }
+                    break;
+                }
+                if (len > 0) {
+                    network_rx_put_pkt(tap->card, &tap->pkt_rx);
+                }
             }
-            tap->pkt_rx.len = len;
-            network_rx_put_pkt(tap->card, &tap->pkt_rx);
         }
         if (pfd[NET_EVENT_STOP].revents & POLLIN) {
             net_event_clear(&tap->stop_event);
@@ -192,7 +289,7 @@ void net_tap_close(void *priv)
     tap_log("TAP: waiting for poll thread to exit.\n");
     thread_wait(tap->poll_tid);
     tap_log("TAP: poll thread exited.\n");
-    for(int i = 0; i < NET_QUEUE_LEN; i++) {
+    for(int i = 0; i < TAP_PKT_BATCH; i++) {
         free(tap->pkts_tx[i].data);
     }
     free(tap->pkt_rx.data);
@@ -221,7 +318,7 @@ void net_tap_error(char *errbuf, const char* format, ...)
     } while (0)
 
 // Returns -ERRNO so we can get an idea what's wrong
-int net_tap_alloc(const uint8_t *mac_addr, const char* bridge_dev)
+int net_tap_alloc(const uint8_t *mac_addr, const char* bridge_dev, int *vnet_hdr)
 {
     int fd;
     struct ifreq ifr = {0};
@@ -230,12 +327,28 @@ int net_tap_alloc(const uint8_t *mac_addr, const char* bridge_dev)
         return -errno;
     }
     ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    if (*vnet_hdr) {
+        ifr.ifr_flags |= IFF_VNET_HDR;
+    }
     int err;
     if ((err = ioctl(fd, TUNSETIFF, &ifr)) < 0) {
         tap_log("TAP: ioctl TUNSETIFF error: %s\n", strerror(errno));
         close(fd);
         return -errno;
     }
+    // Let the host skip checksumming what it sends us, we fill it in on
+    // receive. Fall back to plain frames if the kernel won't have it.
+    if (*vnet_hdr) {
+        int hdr_size = sizeof(struct virtio_net_hdr);
+        if ((ioctl(fd, TUNSETVNETHDRSZ, &hdr_size) < 0) ||
+            (ioctl(fd, TUNSETOFFLOAD, TUN_F_CSUM) < 0)) {
+            tap_log("TAP: checksum offload unavailable: %s\n", strerror(errno));
+            close(fd);
+            *vnet_hdr = 0;
+            return net_tap_alloc(mac_addr, bridge_dev, vnet_hdr);
+        }
+        tap_log("TAP: checksum offload enabled.\n");
+    }
     // Create a socket for ioctl operations
     int sock;
     if ((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
@@ -298,7 +411,8 @@ net_tap_init(
         char *netdrv_errbuf)
 {
     const char *bridge_dev = (void *) priv;
-    int tap_fd = net_tap_alloc(mac_addr, bridge_dev);
+    int vnet_hdr = !!net_cards_conf[card->card_num].tap_offload;
+    int tap_fd = net_tap_alloc(mac_addr, bridge_dev, &vnet_hdr);
     if (tap_fd < 0) {
         if (tap_fd == -EPERM) {
             net_tap_error(
@@ -324,14 +438,15 @@ net_tap_init(
     if (!tap->pkt_rx.data) {
         goto alloc_fail;
     }
-    for(int i = 0; i < NET_QUEUE_LEN; i++) {
+    for(int i = 0; i < TAP_PKT_BATCH; i++) {
         tap->pkts_tx[i].data = calloc(1, NET_MAX_FRAME);
         if (!tap->pkts_tx[i].data) {
             goto alloc_fail;
         }
     }
-    tap->fd   = tap_fd;
-    tap->card = (netcard_t *) card;
+    tap->fd       = tap_fd;
+    tap->vnet_hdr = vnet_hdr;
+    tap->card     = (netcard_t *) card;
     net_event_init(&tap->tx_event);
     net_event_init(&tap->stop_event);
     tap->poll_tid = thread_create(net_tap_thread, tap);
@@ -133,6 +133,8 @@ int  network_ndev;
 netdev_t network_devs[NET_HOST_INTF_MAX];
 
 /* Local variables. */
+static netcard_t *net_cards_attached[NET_CARD_MAX];
+
 #ifdef ENABLE_NETWORK_LOG
 int             network_do_log = ENABLE_NETWORK_LOG;
 static FILE    *network_dump   = NULL;
@@ -275,53 +277,95 @@ network_init(void)
 }
 
 void
-network_queue_init(netqueue_t *queue)
-{
-    queue->head = queue->tail = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+network_queue_init(netqueue_t *queue, uint32_t size)
+{
+    queue->packets = calloc(size, sizeof(netpkt_t));
+    queue->size    = size;
+    queue->mask    = size - 1;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->packets_in, 0);
+    atomic_init(&queue->drops, 0);
+    atomic_init(&queue->peak, 0);
+    for (uint32_t i = 0; i < size; i++) {
         queue->packets[i].data = calloc(1, NET_MAX_FRAME);
         queue->packets[i].len  = 0;
     }
 }
 
-static bool
-network_queue_full(netqueue_t *queue)
+static inline void
+network_swap_packet(netpkt_t *pkt1, netpkt_t *pkt2)
 {
-    return ((queue->head + 1) & NET_QUEUE_LEN_MASK) == queue->tail;
+    netpkt_t tmp = *pkt2;
+    *pkt2        = *pkt1;
+    *pkt1        = tmp;
 }
 
-static bool
-network_queue_empty(netqueue_t *queue)
+/* Producer side: get the slot to fill, or NULL if the queue is full. */
+static netpkt_t *
+network_queue_slot(netqueue_t *queue)
 {
-    return (queue->head == queue->tail);
+    const uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    const uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if ((head - tail) >= queue->size) {
+        atomic_fetch_add_explicit(&queue->drops, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    return &queue->packets[head & queue->mask];
 }
 
+/* Producer side: hand the filled slot over to the consumer. */
+static void
+network_queue_commit(netqueue_t *queue)
+{
+    const uint32_t head  = atomic_load_explicit(&queue->head, memory_order_relaxed) + 1;
+    const uint32_t depth = head - atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&queue->head, head, memory_order_release);
+
+    atomic_fetch_add_explicit(&queue->packets_in, 1, memory_order_relaxed);
+    if (depth > atomic_load_explicit(&queue->peak, memory_order_relaxed))
+        atomic_store_explicit(&queue->peak, depth, memory_order_relaxed);
+}
+
+/* Consumer side: get the number of packets waiting, starting at *tail. */
+static uint32_t
+network_queue_peek(netqueue_t *queue, uint32_t *tail)
+{
+    *tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    return atomic_load_explicit(&queue->head, memory_order_acquire) - *tail;
+}
+
+/* Consumer side: give the slots up to tail back to the producer. */
 static inline void
-network_swap_packet(netpkt_t *pkt1, netpkt_t *pkt2)
+network_queue_release(netqueue_t *queue, const uint32_t tail)
 {
-    netpkt_t tmp = *pkt2;
-    *pkt2        = *pkt1;
-    *pkt1        = tmp;
+    atomic_store_explicit(&queue->tail, tail, memory_order_release);
 }
 
 int
 network_queue_put(netqueue_t *queue, uint8_t *data, int len)
 {
-    if (len == 0 || len > NET_MAX_FRAME || network_queue_full(queue)) {
+    netpkt_t *pkt;
+
+    if ((len == 0) || (len > NET_MAX_FRAME) || !(pkt = network_queue_slot(queue)))
         return 0;
-    }
 
-    netpkt_t *pkt = &queue->packets[queue->head];
     memcpy(pkt->data, data, len);
-    pkt->len    = len;
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
+    pkt->len = len;
+    network_queue_commit(queue);
     return 1;
 }
 
 int
 network_queue_put_swap(netqueue_t *queue, netpkt_t *src_pkt)
 {
-    if (src_pkt->len == 0 || src_pkt->len > NET_MAX_FRAME || network_queue_full(queue)) {
+    netpkt_t *dst_pkt;
+
+    if ((src_pkt->len == 0) || (src_pkt->len > NET_MAX_FRAME) || !(dst_pkt = network_queue_slot(queue))) {
 #ifdef DEBUG
         if (src_pkt->len == 0) {
             network_log("Discarded zero length packet.\n");
@@ -334,59 +378,105 @@ network_queue_put_swap(netqueue_t *queue, netpkt_t *src_pkt)
         return 0;
     }
 
-    netpkt_t *dst_pkt = &queue->packets[queue->head];
     network_swap_packet(src_pkt, dst_pkt);
-
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
+    network_queue_commit(queue);
     return 1;
 }
 
+/* Pop up to vec_size packets in one go, swapping them into pkt_vec. */
 static int
-network_queue_get_swap(netqueue_t *queue, netpkt_t *dst_pkt)
+network_queue_get_swapv(netqueue_t *queue, netpkt_t *pkt_vec, int vec_size)
 {
-    if (network_queue_empty(queue))
-        return 0;
+    uint32_t tail;
+    uint32_t count = network_queue_peek(queue, &tail);
 
-    netpkt_t *src_pkt = &queue->packets[queue->tail];
-    network_swap_packet(src_pkt, dst_pkt);
-    queue->tail = (queue->tail + 1) & NET_QUEUE_LEN_MASK;
-    return 1;
+    if (count > (uint32_t) vec_size)
+        count = vec_size;
+
+    for (uint32_t i = 0; i < count; i++) {
+        network_swap_packet(&queue->packets[tail++ & queue->mask], &pkt_vec[i]);
+        network_dump_packet(&pkt_vec[i]);
+    }
+
+    if (count)
+        network_queue_release(queue, tail);
+
+    return count;
 }
 
-static int
-network_queue_move(netqueue_t *dst_q, netqueue_t *src_q)
+/* Move as many packets as fit; both queues must be owned by the calling thread's side. */
+static uint32_t
+network_queue_move(netqueue_t *dst_q, netqueue_t *src_q, int *stalled)
 {
-    if (network_queue_empty(src_q))
-        return 0;
+    uint32_t  tail;
+    uint32_t  count = network_queue_peek(src_q, &tail);
+    uint32_t  bytes = 0;
+    netpkt_t *dst_pkt;
 
-    if (network_queue_full(dst_q)) {
-        return 0;
-    }
+    *stalled = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!(dst_pkt = network_queue_slot(dst_q))) {
+            *stalled = 1;
+            break;
+        }
 
-    netpkt_t *src_pkt = &src_q->packets[src_q->tail];
-    netpkt_t *dst_pkt = &dst_q->packets[dst_q->head];
+        network_swap_packet(&src_q->packets[tail++ & src_q->mask], dst_pkt);
+        bytes += dst_pkt->len;
+        network_queue_commit(dst_q);
+    }
 
-    network_swap_packet(src_pkt, dst_pkt);
-    dst_q->head = (dst_q->head + 1) & NET_QUEUE_LEN_MASK;
-    src_q->tail = (src_q->tail + 1) & NET_QUEUE_LEN_MASK;
+    if (bytes)
+        network_queue_release(src_q, tail);
 
-    return dst_pkt->len;
+    return bytes;
 }
 
 void
 network_queue_clear(netqueue_t *queue)
 {
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    if (queue->packets == NULL)
+        return;
+
+    for (uint32_t i = 0; i < queue->size; i++)
         free(queue->packets[i].data);
-        queue->packets[i].len = 0;
+    free(queue->packets);
+    queue->packets = NULL;
+    atomic_store(&queue->head, 0);
+    atomic_store(&queue->tail, 0);
+}
+
+/* Hand the waiting packets to the card in one batch, until it stops taking them. */
+static uint32_t
+network_rx_deliver(netcard_t *card, netqueue_t *queue)
+{
+    uint32_t tail;
+    uint32_t count    = network_queue_peek(queue, &tail);
+    uint32_t rx_bytes = 0;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        netpkt_t *pkt = &queue->packets[tail & queue->mask];
+
+        network_dump_packet(pkt);
+        if (!card->rx(card->card_drv, pkt->data, pkt->len)) {
+            atomic_fetch_add_explicit(&card->rx_stalls, 1, memory_order_relaxed);
+            break;
+        }
+        rx_bytes += pkt->len;
+        tail++;
     }
-    queue->tail = queue->head = 0;
+
+    if (i)
+        network_queue_release(queue, tail);
+
+    return rx_bytes;
 }
 
 static void
 network_rx_queue(void *priv)
 {
     netcard_t *card = (netcard_t *) priv;
+    int        stalled;
 
     uint32_t new_link_state = net_cards_conf[card->card_num].link_state;
     if (new_link_state != card->link_state) {
@@ -395,34 +485,13 @@ network_rx_queue(void *priv)
         card->link_state = new_link_state;
     }
 
-    uint32_t rx_bytes = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        if (card->queued_pkt.len == 0) {
-            thread_wait_mutex(card->rx_mutex);
-            int res = network_queue_get_swap(&card->queues[NET_QUEUE_RX], &card->queued_pkt);
-            thread_release_mutex(card->rx_mutex);
-            if (!res)
-                break;
-        }
-
-        network_dump_packet(&card->queued_pkt);
-        int res = card->rx(card->card_drv, card->queued_pkt.data, card->queued_pkt.len);
-        if (!res)
-            break;
-        rx_bytes += card->queued_pkt.len;
-        card->queued_pkt.len = 0;
-    }
+    uint32_t rx_bytes = network_rx_deliver(card, &card->queues[NET_QUEUE_RX_LOCAL]);
+    rx_bytes += network_rx_deliver(card, &card->queues[NET_QUEUE_RX]);
 
     /* Transmission. */
-    uint32_t tx_bytes = 0;
-    thread_wait_mutex(card->tx_mutex);
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        uint32_t bytes = network_queue_move(&card->queues[NET_QUEUE_TX_HOST], &card->queues[NET_QUEUE_TX_VM]);
-        if (!bytes)
-            break;
-        tx_bytes += bytes;
-    }
-    thread_release_mutex(card->tx_mutex);
+    uint32_t tx_bytes = network_queue_move(&card->queues[NET_QUEUE_TX_HOST], &card->queues[NET_QUEUE_TX_VM], &stalled);
+    if (stalled)
+        atomic_fetch_add_explicit(&card->tx_stalls, 1, memory_order_relaxed);
     if (tx_bytes) {
         /* Notify host that a packet is available in the TX queue */
         card->host_drv.notify_in(card->host_drv.priv);
@@ -455,22 +524,24 @@ network_rx_queue(void *priv)
 netcard_t *
 network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_link_state)
 {
-    netcard_t *card       = calloc(1, sizeof(netcard_t));
-    int net_type          = net_cards_conf[net_card_current].net_type;
-    card->queued_pkt.data = calloc(1, NET_MAX_FRAME);
-    card->card_drv        = card_drv;
-    card->rx              = rx;
-    card->set_link_state  = set_link_state;
-    card->tx_mutex        = thread_create_mutex();
-    card->rx_mutex        = thread_create_mutex();
-    card->card_num        = net_card_current;
-    card->byte_period     = NET_PERIOD_10M;
+    netcard_t *card      = calloc(1, sizeof(netcard_t));
+    int net_type         = net_cards_conf[net_card_current].net_type;
+    uint32_t queue_len   = NET_QUEUE_LEN;
+    card->card_drv       = card_drv;
+    card->rx             = rx;
+    card->set_link_state = set_link_state;
+    card->card_num       = net_card_current;
+    card->byte_period    = NET_PERIOD_10M;
 
     char net_drv_error[NET_DRV_ERRBUF_SIZE];
     wchar_t tempmsg[NET_DRV_ERRBUF_SIZE * 2];
 
+    /* The ring depth has to be a power of two. */
+    while ((queue_len < net_cards_conf[net_card_current].queue_len) && (queue_len < NET_QUEUE_LEN_MAX))
+        queue_len <<= 1;
+
     for (int i = 0; i < NET_QUEUE_COUNT; i++) {
-        network_queue_init(&card->queues[i]);
+        network_queue_init(&card->queues[i], queue_len);
     }
 
     if ((!strcmp(network_card_get_internal_name(net_cards_conf[net_card_current].device_num), "modem") ||
@@ -543,13 +614,10 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
         // If null fails, something is very wrong
         // Clean up and fatal
         if(!card->host_drv.priv) {
-            thread_close_mutex(card->tx_mutex);
-            thread_close_mutex(card->rx_mutex);
             for (int i = 0; i < NET_QUEUE_COUNT; i++) {
                 network_queue_clear(&card->queues[i]);
             }
 
-            free(card->queued_pkt.data);
             free(card);
             // Placeholder - insert the error message
             fatal("Error initializing the network device: Null driver initialization failed\n");
@@ -561,6 +629,8 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
     timer_add(&card->timer, network_rx_queue, card, 0);
     timer_on_auto(&card->timer, 100);
 
+    net_cards_attached[card->card_num] = card;
+
     return card;
 }
 
@@ -570,13 +640,13 @@ netcard_close(netcard_t *card)
     timer_stop(&card->timer);
     card->host_drv.close(card->host_drv.priv);
 
-    thread_close_mutex(card->tx_mutex);
-    thread_close_mutex(card->rx_mutex);
+    if (net_cards_attached[card->card_num] == card)
+        net_cards_attached[card->card_num] = NULL;
+
     for (int i = 0; i < NET_QUEUE_COUNT; i++) {
         network_queue_clear(&card->queues[i]);
     }
 
-    free(card->queued_pkt.data);
     free(card);
 }
 
@@ -632,93 +702,66 @@ network_tx(netcard_t *card, uint8_t *bufp, int len)
 int
 network_tx_pop(netcard_t *card, netpkt_t *out_pkt)
 {
-    int ret = 0;
-
-    thread_wait_mutex(card->tx_mutex);
-    ret = network_queue_get_swap(&card->queues[NET_QUEUE_TX_HOST], out_pkt);
-    thread_release_mutex(card->tx_mutex);
-
-    return ret;
+    return network_queue_get_swapv(&card->queues[NET_QUEUE_TX_HOST], out_pkt, 1);
 }
 
 int
 network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
 {
-    int pkt_count = 0;
-
-    netqueue_t *queue = &card->queues[NET_QUEUE_TX_HOST];
-    thread_wait_mutex(card->tx_mutex);
-    for (int i = 0; i < vec_size; i++) {
-        if (!network_queue_get_swap(queue, pkt_vec))
-            break;
-        network_dump_packet(pkt_vec);
-        pkt_count++;
-        pkt_vec++;
-    }
-    thread_release_mutex(card->tx_mutex);
-
-    return pkt_count;
+    return network_queue_get_swapv(&card->queues[NET_QUEUE_TX_HOST], pkt_vec, vec_size);
 }
 
+/* Only used by cards looping frames back to themselves, on the emulation thread. */
 int
 network_rx_put(netcard_t *card, uint8_t *bufp, int len)
 {
-    int ret = 0;
-
-    thread_wait_mutex(card->rx_mutex);
-    ret = network_queue_put(&card->queues[NET_QUEUE_RX], bufp, len);
-    thread_release_mutex(card->rx_mutex);
-
-    return ret;
+    return network_queue_put(&card->queues[NET_QUEUE_RX_LOCAL], bufp, len);
 }
 
 int
 network_rx_on_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
 {
-    int pkt_count = 0;
-
-    netqueue_t *queue = &card->queues[NET_QUEUE_RX_ON_TX];
-    for (int i = 0; i < vec_size; i++) {
-        if (!network_queue_get_swap(queue, pkt_vec))
-            break;
-        network_dump_packet(pkt_vec);
-        pkt_count++;
-        pkt_vec++;
-    }
-
-    return pkt_count;
+    return network_queue_get_swapv(&card->queues[NET_QUEUE_RX_ON_TX], pkt_vec, vec_size);
 }
 
 int
 network_rx_on_tx_put(netcard_t *card, uint8_t *bufp, int len)
 {
-    int ret = 0;
-
-    ret = network_queue_put(&card->queues[NET_QUEUE_RX_ON_TX], bufp, len);
-
-    return ret;
+    return network_queue_put(&card->queues[NET_QUEUE_RX_ON_TX], bufp, len);
 }
 
 int
 network_rx_on_tx_put_pkt(netcard_t *card, netpkt_t *pkt)
 {
-    int ret = 0;
-
-    ret = network_queue_put_swap(&card->queues[NET_QUEUE_RX_ON_TX], pkt);
-
-    return ret;
+    return network_queue_put_swap(&card->queues[NET_QUEUE_RX_ON_TX], pkt);
 }
 
 int
 network_rx_put_pkt(netcard_t *card, netpkt_t *pkt)
 {
-    int ret = 0;
+    return network_queue_put_swap(&card->queues[NET_QUEUE_RX], pkt);
+}
+
+void
+network_stats_dump(void)
+{
+    static const char *queue_names[NET_QUEUE_COUNT] = { "RX", "TX (VM)", "TX (host)", "RX on TX", "RX (local)" };
 
-    thread_wait_mutex(card->rx_mutex);
-    ret = network_queue_put_swap(&card->queues[NET_QUEUE_RX], pkt);
-    thread_release_mutex(card->rx_mutex);
+    for (int i = 0; i < NET_CARD_MAX; i++) {
+        const netcard_t *card = net_cards_attached[i];
 
-    return ret;
+        if (card == NULL)
+            continue;
+
+        pclog("Network card %i: %u-deep queues, %u RX stalls, %u TX stalls\n", i + 1,
+              card->queues[0].size, atomic_load(&card->rx_stalls), atomic_load(&card->tx_stalls));
+        for (int j = 0; j < NET_QUEUE_COUNT; j++) {
+            const netqueue_t *queue = &card->queues[j];
+
+            pclog("  %-10s %10u packets, %8u dropped, peak depth %u\n", queue_names[j],
+                  atomic_load(&queue->packets_in), atomic_load(&queue->drops), atomic_load(&queue->peak));
+        }
+    }
 }
 
 void
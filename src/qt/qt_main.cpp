@@ -458,6 +458,10 @@ main_thread_fn()
 #endif
             drawits += static_cast<int>(new_time - old_time);
         old_time = new_time;
+        /* Turbo mode runs one frame per pass as fast as the host allows,
+           dropping to the idle path only to service a hard reset. */
+        if (turbo_mode)
+            drawits = hard_reset_pending ? 0 : 1;
         if (drawits > 0 && !dopause) {
             /* Yes, so run frames now. */
             do {
@@ -212,6 +212,12 @@ plat_timer_read(void)
     return elapsed_timer.elapsed();
 }
 
+uint64_t
+plat_get_ns(void)
+{
+    return elapsed_timer.nsecsElapsed();
+}
+
 FILE *
 plat_fopen(const char *path, const char *mode)
 {
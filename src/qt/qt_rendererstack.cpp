@@ -47,6 +47,7 @@
 
 #include <QTimer>
 
+#include <algorithm>
 #include <atomic>
 #include <mutex>
 #include <array>
@@ -370,6 +371,7 @@ RendererStack::switchRenderer(Renderer renderer)
 void
 RendererStack::createRenderer(Renderer renderer)
 {
+    dirtyReset               = true;
     rendererTakesScreenshots = false;
     switch (renderer) {
         default:
@@ -470,9 +472,33 @@ RendererStack::createRenderer(Renderer renderer)
 void
 RendererStack::blit(int x, int y, int w, int h)
 {
+    int top;
+    int bottom;
+
     if ((x < 0) || (y < 0) || (w <= 0) || (h <= 0) ||
         (w > 2048) || (h > 2048) || (switchInProgress) ||
-        (monitors[m_monitor_index].target_buffer == NULL) || imagebufs.empty() ||
+        (monitors[m_monitor_index].target_buffer == NULL) || imagebufs.empty()) {
+        video_blit_complete_monitor(m_monitor_index);
+        return;
+    }
+
+    /* The image buffers are filled in rotation, so each one accumulates the
+       lines changed since it was last filled, and only those are copied. */
+    if (dirtyReset.exchange(false) || (bufDirty.size() != imagebufs.size()) ||
+        (x != sx) || (y != sy) || (w != sw) || (h != sh)) {
+        bufDirty.assign(imagebufs.size(), std::make_pair(y, y + h));
+    } else if (video_blit_get_dirty_monitor(&top, &bottom, m_monitor_index)) {
+        for (auto &dirty : bufDirty) {
+            if (dirty.second <= dirty.first)
+                dirty = std::make_pair(top, bottom);
+            else
+                dirty = std::make_pair(std::min(dirty.first, top), std::max(dirty.second, bottom));
+        }
+    }
+
+    auto &dirty = bufDirty[currentBuf];
+    /* Nothing changed since this buffer was last shown, so don't bother the renderer. */
+    if (((dirty.second <= dirty.first) && !monitors[m_monitor_index].mon_screenshots) ||
         std::get<std::atomic_flag *>(imagebufs[currentBuf])->test_and_set()) {
         video_blit_complete_monitor(m_monitor_index);
         return;
@@ -482,10 +508,11 @@ RendererStack::blit(int x, int y, int w, int h)
     sw = this->w = w;
     sh = this->h       = h;
     uint8_t *imagebits = std::get<uint8_t *>(imagebufs[currentBuf]);
-    for (int y1 = y; y1 < (y + h); y1++) {
+    for (int y1 = dirty.first; y1 < dirty.second; y1++) {
         auto scanline = imagebits + (y1 * rendererWindow->getBytesPerRow()) + (x * 4);
         video_copy(scanline, &(monitors[m_monitor_index].target_buffer->line[y1][x]), w * 4);
     }
+    dirty = std::make_pair(0, 0);
 
     if (monitors[m_monitor_index].mon_screenshots && !rendererTakesScreenshots) {
         video_screenshot_monitor((uint32_t *) imagebits, x, y, 2048, m_monitor_index);
@@ -134,6 +134,9 @@ private:
     int m_monitor_index = 0;
 
     std::vector<std::tuple<uint8_t *, std::atomic_flag *>> imagebufs;
+    /* Target buffer rows [first, second) each image buffer has yet to catch up on. */
+    std::vector<std::pair<int, int>>                       bufDirty;
+    std::atomic_bool                                       dirtyReset { true };
 
     RendererCommon          *rendererWindow { nullptr };
     std::unique_ptr<QWidget> current;
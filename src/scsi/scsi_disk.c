@@ -66,6 +66,7 @@ const uint8_t scsi_disk_command_flags[0x100] = {
     [0x2a ... 0x2b] = IMPLEMENTED | CHECK_READY,
     [0x2e]          = IMPLEMENTED | CHECK_READY,
     [0x2f]          = IMPLEMENTED | CHECK_READY | SCSI_ONLY,
+    [0x35]          = IMPLEMENTED | CHECK_READY,
     [0x41]          = IMPLEMENTED | CHECK_READY,
     [0x55]          = IMPLEMENTED,
     [0x5a]          = IMPLEMENTED,
@@ -783,22 +784,20 @@ scsi_disk_blocks(scsi_disk_t *dev, int32_t *len, UNUSED(int first_batch), const
 
     *len = dev->requested_blocks << 9;
 
-    for (int i = 0; i < dev->requested_blocks; i++) {
-        if (out) {
-            if (hdd_image_write(dev->id, dev->sector_pos, 1, dev->temp_buffer +
-                                (i << 9)) < 0) {
-                scsi_disk_write_error(dev);
-                return -1;
-            }
-        } else {
-            if (hdd_image_read(dev->id, dev->sector_pos, 1, dev->temp_buffer +
-                               (i << 9)) < 0) {
-                scsi_disk_read_error(dev);
-                return -1;
-            }
+    /* Writes are handed to the image's I/O thread, reads have to be done
+       here as the host adapter will transfer the data right away. */
+    if (out) {
+        if (hdd_image_async_write(dev->id, dev->sector_pos, dev->requested_blocks,
+                                  dev->temp_buffer) < 0) {
+            scsi_disk_write_error(dev);
+            return -1;
         }
-        dev->sector_pos++;
+    } else if (hdd_image_read(dev->id, dev->sector_pos, dev->requested_blocks,
+                              dev->temp_buffer) < 0) {
+        scsi_disk_read_error(dev);
+        return -1;
     }
+    dev->sector_pos += dev->requested_blocks;
 
     scsi_disk_log(dev->log, "%s %i bytes of blocks...\n", out ? "Written" : "Read", *len);
 
@@ -1454,6 +1453,17 @@ atapi_out:
             scsi_disk_command_complete(dev);
             break;
 
+        case GPCMD_SYNCHRONIZE_CACHE:
+            /* Also reports a write that failed after its command completed. */
+            if (hdd_image_flush(dev->id) < 0) {
+                scsi_disk_write_error(dev);
+                break;
+            }
+
+            scsi_disk_set_phase(dev, SCSI_PHASE_STATUS);
+            scsi_disk_command_complete(dev);
+            break;
+
         case GPCMD_SEEK_6:
         case GPCMD_SEEK_10:
             switch (cdb[0]) {
@@ -386,6 +386,9 @@ sound_cd_thread(UNUSED(void *param))
             }
         }
 
+        if (turbo_mode)
+            continue;
+
         if (sound_is_float)
             givealbuffer_cd(cd_out_buffer);
         else
@@ -579,23 +582,27 @@ sound_poll(UNUSED(void *priv))
         for (c = 0; c < sound_handlers_num; c++)
             sound_handlers[c].get_buffer(outbuffer, SOUNDBUFLEN, sound_handlers[c].priv);
 
-        for (c = 0; c < SOUNDBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_ex[c] = ((float) outbuffer[c]) / (float) 32768.0;
-            else {
-                if (outbuffer[c] > 32767)
-                    outbuffer[c] = 32767;
-                if (outbuffer[c] < -32768)
-                    outbuffer[c] = -32768;
-
-                outbuffer_ex_int16[c] = (int16_t) outbuffer[c];
+        /* Mixed as usual so the sources stay in step, but dropped while
+           running unthrottled instead of flooding the output device. */
+        if (!turbo_mode) {
+            for (c = 0; c < SOUNDBUFLEN * 2; c++) {
+                if (sound_is_float)
+                    outbuffer_ex[c] = ((float) outbuffer[c]) / (float) 32768.0;
+                else {
+                    if (outbuffer[c] > 32767)
+                        outbuffer[c] = 32767;
+                    if (outbuffer[c] < -32768)
+                        outbuffer[c] = -32768;
+
+                    outbuffer_ex_int16[c] = (int16_t) outbuffer[c];
+                }
             }
-        }
 
-        if (sound_is_float)
-            givealbuffer(outbuffer_ex);
-        else
-            givealbuffer(outbuffer_ex_int16);
+            if (sound_is_float)
+                givealbuffer(outbuffer_ex);
+            else
+                givealbuffer(outbuffer_ex_int16);
+        }
 
         if (cd_thread_enable) {
             cd_buf_update--;
@@ -626,23 +633,25 @@ music_poll(UNUSED(void *priv))
         for (c = 0; c < music_handlers_num; c++)
             music_handlers[c].get_buffer(outbuffer_m, MUSICBUFLEN, music_handlers[c].priv);
 
-        for (c = 0; c < MUSICBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_m_ex[c] = ((float) outbuffer_m[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_m[c] > 32767)
-                    outbuffer_m[c] = 32767;
-                if (outbuffer_m[c] < -32768)
-                    outbuffer_m[c] = -32768;
-
-                outbuffer_m_ex_int16[c] = (int16_t) outbuffer_m[c];
+        if (!turbo_mode) {
+            for (c = 0; c < MUSICBUFLEN * 2; c++) {
+                if (sound_is_float)
+                    outbuffer_m_ex[c] = ((float) outbuffer_m[c]) / (float) 32768.0;
+                else {
+                    if (outbuffer_m[c] > 32767)
+                        outbuffer_m[c] = 32767;
+                    if (outbuffer_m[c] < -32768)
+                        outbuffer_m[c] = -32768;
+
+                    outbuffer_m_ex_int16[c] = (int16_t) outbuffer_m[c];
+                }
             }
-        }
 
-        if (sound_is_float)
-            givealbuffer_music(outbuffer_m_ex);
-        else
-            givealbuffer_music(outbuffer_m_ex_int16);
+            if (sound_is_float)
+                givealbuffer_music(outbuffer_m_ex);
+            else
+                givealbuffer_music(outbuffer_m_ex_int16);
+        }
 
         music_pos_global = 0;
     }
@@ -662,23 +671,25 @@ wavetable_poll(UNUSED(void *priv))
         for (c = 0; c < wavetable_handlers_num; c++)
             wavetable_handlers[c].get_buffer(outbuffer_w, WTBUFLEN, wavetable_handlers[c].priv);
 
-        for (c = 0; c < WTBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_w_ex[c] = ((float) outbuffer_w[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_w[c] > 32767)
-                    outbuffer_w[c] = 32767;
-                if (outbuffer_w[c] < -32768)
-                    outbuffer_w[c] = -32768;
-
-                outbuffer_w_ex_int16[c] = (int16_t) outbuffer_w[c];
+        if (!turbo_mode) {
+            for (c = 0; c < WTBUFLEN * 2; c++) {
+                if (sound_is_float)
+                    outbuffer_w_ex[c] = ((float) outbuffer_w[c]) / (float) 32768.0;
+                else {
+                    if (outbuffer_w[c] > 32767)
+                        outbuffer_w[c] = 32767;
+                    if (outbuffer_w[c] < -32768)
+                        outbuffer_w[c] = -32768;
+
+                    outbuffer_w_ex_int16[c] = (int16_t) outbuffer_w[c];
+                }
             }
-        }
 
-        if (sound_is_float)
-            givealbuffer_wt(outbuffer_w_ex);
-        else
-            givealbuffer_wt(outbuffer_w_ex_int16);
+            if (sound_is_float)
+                givealbuffer_wt(outbuffer_w_ex);
+            else
+                givealbuffer_wt(outbuffer_w_ex_int16);
+        }
 
         wavetable_pos_global = 0;
     }
@@ -808,7 +819,8 @@ sound_fdd_thread(UNUSED(void *param))
         static float fdd_float_buffer[SOUNDBUFLEN * 2];
         memset(fdd_float_buffer, 0, sizeof(fdd_float_buffer));
         fdd_audio_callback((int16_t*)fdd_float_buffer, SOUNDBUFLEN * 2);
-        givealbuffer_fdd(fdd_float_buffer, SOUNDBUFLEN * 2);
+        if (!turbo_mode)
+            givealbuffer_fdd(fdd_float_buffer, SOUNDBUFLEN * 2);
     }
 }
 
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
@@ -10,103 +11,167 @@
 uint64_t TIMER_USEC;
 uint32_t timer_target;
 
-/*Enabled timers are stored in a linked list, with the first timer to expire at
-  the head.*/
-pc_timer_t *timer_head = NULL;
+/*Enabled timers are stored in a binary min-heap ordered by expiry time, with
+  the first timer to expire at index 1. Index 0 is unused so that a heap_idx
+  of 0 in a timer means it is not queued.*/
+static pc_timer_t **timer_heap       = NULL;
+static uint32_t     timer_heap_size  = 0;
+static uint32_t     timer_heap_alloc = 0;
+
+/*Every timer passed to timer_add() since the last timer_close(), queued or
+  not, for the statistics dump.*/
+static pc_timer_t **timer_list       = NULL;
+static uint32_t     timer_list_count = 0;
+static uint32_t     timer_list_alloc = 0;
+
+/*Insertion sequence number, used to break ties between timers expiring at the
+  same timestamp.*/
+static uint32_t timer_seq = 0;
+
+timer_stats_t timer_stats;
 
 /* Are we initialized? */
 int timer_inited = 0;
 
 static void timer_advance_ex(pc_timer_t *timer, int start);
 
+/*True if timer a must run before timer b. Timers with equal timestamps run
+  most recently enabled first, as they did with the old sorted list.*/
+static __inline int
+timer_heap_less(pc_timer_t *a, pc_timer_t *b)
+{
+    int64_t diff = (int64_t) (a->ts.ts64 - b->ts.ts64);
+
+    if (diff != 0)
+        return diff < 0;
+
+    return (int32_t) (a->seq - b->seq) > 0;
+}
+
+static __inline void
+timer_heap_set(uint32_t idx, pc_timer_t *timer)
+{
+    timer_heap[idx] = timer;
+    timer->heap_idx = idx;
+}
+
+static void
+timer_heap_sift_up(uint32_t idx)
+{
+    pc_timer_t *timer = timer_heap[idx];
+
+    while (idx > 1) {
+        uint32_t parent = idx >> 1;
+
+        if (!timer_heap_less(timer, timer_heap[parent]))
+            break;
+
+        timer_heap_set(idx, timer_heap[parent]);
+        idx = parent;
+    }
+
+    timer_heap_set(idx, timer);
+}
+
+static void
+timer_heap_sift_down(uint32_t idx)
+{
+    pc_timer_t *timer = timer_heap[idx];
+
+    while (1) {
+        uint32_t child = idx << 1;
+
+        if (child > timer_heap_size)
+            break;
+
+        if ((child < timer_heap_size) && timer_heap_less(timer_heap[child + 1], timer_heap[child]))
+            child++;
+
+        if (!timer_heap_less(timer_heap[child], timer))
+            break;
+
+        timer_heap_set(idx, timer_heap[child]);
+        idx = child;
+    }
+
+    timer_heap_set(idx, timer);
+}
+
+static void
+timer_heap_remove(uint32_t idx)
+{
+    pc_timer_t *last = timer_heap[timer_heap_size];
+
+    timer_heap[idx]->heap_idx = 0;
+    timer_heap[timer_heap_size--] = NULL;
+
+    if (idx > timer_heap_size)
+        return;
+
+    timer_heap_set(idx, last);
+    if ((idx > 1) && timer_heap_less(last, timer_heap[idx >> 1]))
+        timer_heap_sift_up(idx);
+    else
+        timer_heap_sift_down(idx);
+}
+
 void
 timer_enable(pc_timer_t *timer)
 {
-    pc_timer_t *timer_node = timer_head;
-    int ret = 0;
-
     if (!timer_inited || (timer == NULL))
         return;
 
     if (timer->flags & TIMER_ENABLED)
         timer_disable(timer);
 
-    if (timer->next || timer->prev)
-        fatal("timer_disable(): Attempting to enable a non-isolated "
+    if (timer->heap_idx)
+        fatal("timer_enable(): Attempting to enable a queued "
               "timer incorrectly marked as disabled\n");
 
-    /*List currently empty - add to head*/
-    if (!timer_head) {
-        timer_head  = timer;
-        timer->next = timer->prev = NULL;
-        timer_target              = timer_head->ts.ts32.integer;
-        ret = 1;
-    } else if (TIMER_LESS_THAN(timer, timer_head)) {
-        timer->next      = timer_head;
-        timer->prev      = NULL;
-        timer_head->prev = timer;
-        timer_head       = timer;
-        timer_target     = timer_head->ts.ts32.integer;
-        ret = 1;
-    } else if (!timer_head->next) {
-        timer_head->next = timer;
-        timer->prev      = timer_head;
-        ret = 1;
+    if ((timer_heap_size + 1) >= timer_heap_alloc) {
+        timer_heap_alloc = timer_heap_alloc ? (timer_heap_alloc << 1) : 64;
+        timer_heap       = (pc_timer_t **) realloc(timer_heap, timer_heap_alloc * sizeof(pc_timer_t *));
+        if (timer_heap == NULL)
+            fatal("timer_enable(): Unable to grow the timer queue to %i entries\n", timer_heap_alloc);
     }
 
-    if (ret == 0) {
-        pc_timer_t *prev = timer_head;
-        timer_node       = timer_head->next;
-
-        while (1) {
-            /*Timer expires before timer_node. Add to list in front of timer_node*/
-            if (TIMER_LESS_THAN(timer, timer_node)) {
-                timer->next      = timer_node;
-                timer->prev      = prev;
-                timer_node->prev = timer;
-                prev->next       = timer;
-                ret = 1;
-                break;
-            }
-
-            /*timer_node is last in the list. Add timer to end of list*/
-            if (!timer_node->next) {
-                timer_node->next = timer;
-                timer->prev      = timer_node;
-                ret = 1;
-                break;
-            }
-
-            prev       = timer_node;
-            timer_node = timer_node->next;
-        }
-    }
+    timer->seq = timer_seq++;
+
+    timer_heap_size++;
+    timer_heap[timer_heap_size] = timer;
+    timer_heap_sift_up(timer_heap_size);
+
+    if (timer->heap_idx == 1)
+        timer_target = timer->ts.ts32.integer;
 
-    /* Do not mark it as enabled if it has failed every single condition. */
-    if (ret == 1)
-        timer->flags |= TIMER_ENABLED;
+    timer->flags |= TIMER_ENABLED;
+
+    timer_stats.enables++;
+    if (timer_heap_size > timer_stats.peak_queued)
+        timer_stats.peak_queued = timer_heap_size;
 }
 
 void
 timer_disable(pc_timer_t *timer)
 {
+    uint32_t idx;
+
     if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
         return;
 
-    if (!timer->next && !timer->prev && timer != timer_head)
-        fatal("timer_disable(): Attempting to disable an isolated "
-              "non-head timer incorrectly marked as enabled\n");
+    idx = timer->heap_idx;
+
+    if (!idx || (idx > timer_heap_size) || (timer_heap[idx] != timer))
+        fatal("timer_disable(): Attempting to disable a non-queued "
+              "timer incorrectly marked as enabled\n");
 
     timer->flags &= ~TIMER_ENABLED;
     timer->in_callback = 0;
 
-    if (timer->prev)
-        timer->prev->next = timer->next;
-    else
-        timer_head = timer->next;
-    if (timer->next)
-        timer->next->prev = timer->prev;
-    timer->prev = timer->next = NULL;
+    timer_heap_remove(idx);
+
+    if ((idx == 1) && timer_heap_size)
+        timer_target = timer_heap[1]->ts.ts32.integer;
 }
 
 void
@@ -114,20 +179,17 @@ timer_process(void)
 {
     pc_timer_t *timer;
 
-    if (!timer_head)
+    if (!timer_heap_size)
         return;
 
-    while (1) {
-        timer = timer_head;
+    while (timer_heap_size) {
+        timer = timer_heap[1];
 
         if (!TIMER_LESS_THAN_VAL(timer, (uint32_t) tsc))
             break;
 
-        timer_head = timer->next;
-        if (timer_head)
-            timer_head->prev = NULL;
+        timer_heap_remove(1);
 
-        timer->next = timer->prev = NULL;
         timer->flags &= ~TIMER_ENABLED;
 
         if (timer->flags & TIMER_SPLIT)
@@ -137,31 +199,85 @@ timer_process(void)
             /* Make sure it's not NULL, so that we can
                have a NULL callback when no operation
                is needed. */
+            timer->fired++;
+            timer_stats.callbacks++;
+
             timer->in_callback = 1;
-            timer->callback(timer->priv);
+            if (timer_prof_enabled)
+                timer_prof_call(timer);
+            else
+                timer->callback(timer->priv);
             timer->in_callback = 0;
         }
     }
 
-    timer_target = timer_head->ts.ts32.integer;
+    if (timer_heap_size)
+        timer_target = timer_heap[1]->ts.ts32.integer;
+}
+
+static int
+timer_stats_compare(const void *a, const void *b)
+{
+    const pc_timer_t *ta = *(const pc_timer_t * const *) a;
+    const pc_timer_t *tb = *(const pc_timer_t * const *) b;
+
+    if (ta->fired == tb->fired)
+        return 0;
+
+    return (ta->fired > tb->fired) ? -1 : 1;
+}
+
+void
+timer_dump_stats(void)
+{
+    pc_timer_t **sorted;
+    uint32_t     count = timer_list_count;
+
+    pclog("Timer queue: %u registered, %u queued (peak %u), %llu enables, %llu callbacks\n",
+          count, timer_heap_size, timer_stats.peak_queued,
+          (unsigned long long) timer_stats.enables, (unsigned long long) timer_stats.callbacks);
+
+    if (!count)
+        return;
+
+    sorted = (pc_timer_t **) malloc(count * sizeof(pc_timer_t *));
+    if (sorted == NULL)
+        return;
+    memcpy(sorted, timer_list, count * sizeof(pc_timer_t *));
+    qsort(sorted, count, sizeof(pc_timer_t *), timer_stats_compare);
+
+    for (uint32_t i = 0; i < count; i++) {
+        pclog("  %p (priv %p): %llu callbacks (%.2f%%)%s\n",
+              (void *) (uintptr_t) sorted[i]->callback, sorted[i]->priv,
+              (unsigned long long) sorted[i]->fired,
+              timer_stats.callbacks ? ((double) sorted[i]->fired * 100.0) / (double) timer_stats.callbacks : 0.0,
+              (sorted[i]->flags & TIMER_ENABLED) ? "" : ", not queued");
+    }
+
+    free(sorted);
 }
 
 void
 timer_close(void)
 {
-    pc_timer_t *t = timer_head;
-    pc_timer_t *r;
-
-    /* Set all timers' prev and next to NULL so it is assured that
-       timers that are not in malloc'd structs don't keep pointing
-       to timers that may be in malloc'd structs. */
-    while (t != NULL) {
-        r       = t;
-        r->prev = r->next = NULL;
-        t                 = r->next;
+    /* Mark all queued timers as isolated so that timers that are not in
+       malloc'd structs don't keep pointing into the queue. */
+    for (uint32_t i = 1; i <= timer_heap_size; i++) {
+        timer_heap[i]->heap_idx = 0;
+        timer_heap[i]->flags &= ~TIMER_ENABLED;
+        timer_heap[i] = NULL;
     }
 
-    timer_head = NULL;
+    free(timer_heap);
+    timer_heap       = NULL;
+    timer_heap_size  = 0;
+    timer_heap_alloc = 0;
+
+    /* The devices owning the timers are about to be closed. */
+    free(timer_list);
+    timer_list       = NULL;
+    timer_list_count = 0;
+    timer_list_alloc = 0;
 
     timer_inited = 0;
 }
@@ -172,22 +288,51 @@ timer_init(void)
     timer_target = 0ULL;
     tsc          = 0;
 
+    timer_heap_size = 0;
+    timer_seq       = 0;
+    memset(&timer_stats, 0, sizeof(timer_stats_t));
+    timer_prof_reset();
+
     /* Initialise the CPU-independent timer */
     rivatimer_init();
 
     timer_inited = 1;
 }
 
+static void
+timer_register(pc_timer_t *timer)
+{
+    pc_timer_t **list;
+
+    /* Devices may add the same timer again when they are reset. */
+    for (uint32_t i = 0; i < timer_list_count; i++) {
+        if (timer_list[i] == timer)
+            return;
+    }
+
+    if (timer_list_count == timer_list_alloc) {
+        /* The list is only used for statistics, so just leave the timer out. */
+        list = (pc_timer_t **) realloc(timer_list, (timer_list_alloc ? (timer_list_alloc << 1) : 64) * sizeof(pc_timer_t *));
+        if (list == NULL)
+            return;
+        timer_list       = list;
+        timer_list_alloc = timer_list_alloc ? (timer_list_alloc << 1) : 64;
+    }
+
+    timer_list[timer_list_count++] = timer;
+}
+
 void
 timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start_timer)
 {
     memset(timer, 0, sizeof(pc_timer_t));
+    timer_register(timer);
 
     timer->callback    = callback;
     timer->in_callback = 0;
     timer->priv        = priv;
     timer->flags       = 0;
-    timer->prev        = timer->next = NULL;
+    timer->heap_idx    = 0;
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
@@ -271,19 +416,19 @@ timer_set_new_tsc(uint64_t new_tsc)
         update_tsc();
 #endif
 
-    if (!timer_head) {
+    if (!timer_heap_size) {
         tsc = new_tsc;
         return;
     }
 
-    timer = timer_head;
-    timer_target = new_tsc + (int32_t)(timer_get_ts_int(timer_head) - (uint32_t)tsc);
+    timer_target = new_tsc + (int32_t)(timer_get_ts_int(timer_heap[1]) - (uint32_t)tsc);
+
+    /* Every timer is shifted by the same amount, so the heap order holds. */
+    for (uint32_t i = 1; i <= timer_heap_size; i++) {
+        timer = timer_heap[i];
 
-    while (timer) {
         int32_t offset_from_current_tsc = (int32_t)(timer_get_ts_int(timer) - (uint32_t)tsc);
         timer->ts.ts32.integer = new_tsc + offset_from_current_tsc;
-
-        timer = timer->next;
     }
 
     tsc = new_tsc;
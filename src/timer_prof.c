@@ -0,0 +1,318 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Host time profiler for timer callbacks.
+ *
+ *          When enabled, every callback run by timer_process() is timed
+ *          on the host and attributed to its (callback, priv) pair, which
+ *          is named after the owning device where one can be found. The
+ *          totals are also aggregated per emulated second, and can be
+ *          dumped as CSV or JSON.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/device.h>
+#include <86box/timer.h>
+#include <86box/plat.h>
+
+#define TIMER_PROF_SIZE 1024 /* Must be a power of 2. */
+
+typedef struct timer_prof_t {
+    void      (*callback)(void *priv);
+    void       *priv;
+    const char *name;
+
+    uint64_t calls;
+    uint64_t ns;
+
+    /* Current emulated second. */
+    uint64_t sec_calls;
+    uint64_t sec_ns;
+
+    /* Last complete emulated second. */
+    uint64_t last_calls;
+    uint64_t last_ns;
+
+    /* Busiest emulated second seen. */
+    uint64_t peak_ns;
+} timer_prof_t;
+
+int  timer_prof_enabled       = 0;
+int  timer_prof_reset_pending = 0;
+char timer_prof_path[1024];
+
+/* The table is never reallocated, so the monitor console can safely
+   walk it while the emulation thread keeps updating it. */
+static timer_prof_t timer_prof[TIMER_PROF_SIZE];
+static uint32_t     timer_prof_used;
+static uint64_t     timer_prof_lost;
+static uint64_t     timer_prof_seconds;
+static uint32_t     timer_prof_sec_start;
+
+#ifdef ENABLE_TIMER_PROF_LOG
+int timer_prof_do_log = ENABLE_TIMER_PROF_LOG;
+
+static void
+timer_prof_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (timer_prof_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define timer_prof_log(fmt, ...)
+#endif
+
+static timer_prof_t *
+timer_prof_find(void (*callback)(void *priv), void *priv)
+{
+    uintptr_t       hash = ((uintptr_t) callback) ^ ((uintptr_t) priv * 31);
+    uint32_t        idx;
+    timer_prof_t   *p;
+    const device_t *dev;
+
+    hash ^= hash >> 17;
+    idx = (uint32_t) (hash * 0x9e3779b1) & (TIMER_PROF_SIZE - 1);
+
+    for (uint32_t i = 0; i < TIMER_PROF_SIZE; i++) {
+        p = &timer_prof[(idx + i) & (TIMER_PROF_SIZE - 1)];
+
+        if ((p->callback == callback) && (p->priv == priv))
+            return p;
+
+        if (p->callback == NULL) {
+            /* Leave a quarter of the table free to keep the probes short. */
+            if (timer_prof_used >= ((TIMER_PROF_SIZE * 3) / 4))
+                return NULL;
+
+            /* Resolve the name now, while the owning device is still alive. */
+            dev         = device_find_by_priv(priv);
+            p->name     = (dev != NULL) ? dev->name : NULL;
+            p->priv     = priv;
+            p->callback = callback;
+            timer_prof_used++;
+
+            timer_prof_log("Timer profiler: new entry %p (priv %p, %s)\n",
+                           (void *) (uintptr_t) callback, priv, p->name ? p->name : "unknown");
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+timer_prof_next_second(void)
+{
+    uint32_t sec_len = (uint32_t) (((TIMER_USEC >> 16) * MAX_USEC64) >> 16);
+
+    if (!TIMER_VAL_LESS_THAN_VAL(timer_prof_sec_start + sec_len, (uint32_t) tsc))
+        return;
+
+    for (uint32_t i = 0; i < TIMER_PROF_SIZE; i++) {
+        timer_prof_t *p = &timer_prof[i];
+
+        if (p->callback == NULL)
+            continue;
+
+        p->last_calls = p->sec_calls;
+        p->last_ns    = p->sec_ns;
+        if (p->sec_ns > p->peak_ns)
+            p->peak_ns = p->sec_ns;
+        p->sec_calls = p->sec_ns = 0;
+    }
+
+    timer_prof_seconds++;
+
+    /* Resynchronize instead of catching up if the TSC has jumped. */
+    if (TIMER_VAL_LESS_THAN_VAL(timer_prof_sec_start + (sec_len << 1), (uint32_t) tsc))
+        timer_prof_sec_start = (uint32_t) tsc;
+    else
+        timer_prof_sec_start += sec_len;
+}
+
+void
+timer_prof_call(pc_timer_t *timer)
+{
+    void        (*callback)(void *priv) = timer->callback;
+    void         *priv                  = timer->priv;
+    timer_prof_t *p;
+    uint64_t      start;
+    uint64_t      ns;
+
+    start = plat_get_ns();
+    callback(priv);
+    ns = plat_get_ns() - start;
+
+    p = timer_prof_find(callback, priv);
+    if (p != NULL) {
+        p->calls++;
+        p->ns += ns;
+        p->sec_calls++;
+        p->sec_ns += ns;
+    } else
+        timer_prof_lost++;
+
+    timer_prof_next_second();
+}
+
+void
+timer_prof_reset(void)
+{
+    memset(timer_prof, 0, sizeof(timer_prof));
+    timer_prof_used      = 0;
+    timer_prof_lost      = 0;
+    timer_prof_seconds   = 0;
+    timer_prof_sec_start = (uint32_t) tsc;
+}
+
+/* Call func for every profiled callback, in no particular order. */
+void
+timer_prof_foreach(void (*func)(const char *name, uint64_t calls, uint64_t ns, void *priv), void *priv)
+{
+    for (uint32_t i = 0; i < TIMER_PROF_SIZE; i++) {
+        if (timer_prof[i].callback != NULL)
+            func(timer_prof[i].name, timer_prof[i].calls, timer_prof[i].ns, priv);
+    }
+}
+
+static int
+timer_prof_compare(const void *a, const void *b)
+{
+    const timer_prof_t *pa = (const timer_prof_t *) a;
+    const timer_prof_t *pb = (const timer_prof_t *) b;
+
+    if (pa->ns == pb->ns)
+        return 0;
+
+    return (pa->ns > pb->ns) ? -1 : 1;
+}
+
+static void
+timer_prof_write_json_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s; s++) {
+        if ((*s == '"') || (*s == '\\'))
+            fputc('\\', fp);
+        fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+static void
+timer_prof_write_csv(FILE *fp, const timer_prof_t *entries, uint32_t count)
+{
+    fprintf(fp, "device,callback,priv,calls,host_ns,calls_per_sec,ns_per_sec,last_sec_calls,last_sec_ns,peak_sec_ns\n");
+
+    for (uint32_t i = 0; i < count; i++) {
+        const timer_prof_t *p    = &entries[i];
+        uint64_t            secs = timer_prof_seconds ? timer_prof_seconds : 1;
+
+        /* CSV escapes quotes by doubling them. */
+        fputc('"', fp);
+        for (const char *s = p->name ? p->name : ""; *s; s++) {
+            if (*s == '"')
+                fputc('"', fp);
+            fputc(*s, fp);
+        }
+        fputc('"', fp);
+
+        fprintf(fp, ",%p,%p,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                (void *) (uintptr_t) p->callback, p->priv, p->calls, p->ns, p->calls / secs, p->ns / secs,
+                p->last_calls, p->last_ns, p->peak_ns);
+    }
+}
+
+static void
+timer_prof_write_json(FILE *fp, const timer_prof_t *entries, uint32_t count)
+{
+    fprintf(fp, "{\n  \"emulated_seconds\": %" PRIu64 ",\n  \"unattributed_calls\": %" PRIu64 ",\n  \"timers\": [\n",
+            timer_prof_seconds, timer_prof_lost);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const timer_prof_t *p = &entries[i];
+
+        fprintf(fp, "    { \"device\": ");
+        if (p->name != NULL)
+            timer_prof_write_json_string(fp, p->name);
+        else
+            fprintf(fp, "null");
+        fprintf(fp, ", \"callback\": \"%p\", \"priv\": \"%p\", \"calls\": %" PRIu64 ", \"host_ns\": %" PRIu64
+                    ", \"last_sec_calls\": %" PRIu64 ", \"last_sec_ns\": %" PRIu64 ", \"peak_sec_ns\": %" PRIu64 " }%s\n",
+                (void *) (uintptr_t) p->callback, p->priv, p->calls, p->ns,
+                p->last_calls, p->last_ns, p->peak_ns, (i < (count - 1)) ? "," : "");
+    }
+
+    fprintf(fp, "  ]\n}\n");
+}
+
+/* Dump the profile to path, as JSON if it ends in .json or as CSV
+   otherwise. With no path, a summary of the busiest callbacks is
+   written to the log instead. */
+void
+timer_prof_dump(const char *path)
+{
+    timer_prof_t *entries;
+    uint32_t      count = 0;
+    const char   *ext;
+    FILE         *fp;
+
+    entries = (timer_prof_t *) malloc(sizeof(timer_prof));
+    if (entries == NULL)
+        return;
+
+    for (uint32_t i = 0; i < TIMER_PROF_SIZE; i++) {
+        if (timer_prof[i].callback != NULL)
+            memcpy(&entries[count++], &timer_prof[i], sizeof(timer_prof_t));
+    }
+    qsort(entries, count, sizeof(timer_prof_t), timer_prof_compare);
+
+    if ((path == NULL) || (path[0] == '\0')) {
+        pclog("Timer profile: %" PRIu64 " emulated seconds, %u callbacks tracked\n",
+              timer_prof_seconds, count);
+        for (uint32_t i = 0; (i < count) && (i < 32); i++) {
+            pclog("  %-32s %p: %" PRIu64 " calls, %" PRIu64 " ns (last second: %" PRIu64 " calls, %" PRIu64 " ns)\n",
+                  entries[i].name ? entries[i].name : "unknown", (void *) (uintptr_t) entries[i].callback,
+                  entries[i].calls, entries[i].ns, entries[i].last_calls, entries[i].last_ns);
+        }
+    } else {
+        fp = plat_fopen(path, "w");
+        if (fp == NULL) {
+            pclog("Timer profile: unable to open %s for writing\n", path);
+            free(entries);
+            return;
+        }
+
+        ext = strrchr(path, '.');
+        if ((ext != NULL) && !strcasecmp(ext, ".json"))
+            timer_prof_write_json(fp, entries, count);
+        else
+            timer_prof_write_csv(fp, entries, count);
+
+        fclose(fp);
+    }
+
+    free(entries);
+}
@@ -43,10 +43,21 @@
 #include <86box/unix_sdl.h>
 #include <86box/unix_osd.h>
 #include "cpu.h"
+#ifdef USE_DYNAREC
+#    include "codegen_public.h"
+#endif
 #include <86box/timer.h>
 #include <86box/nvr.h>
 #include <86box/version.h>
 #include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_svga_render.h>
+#include <86box/vid_accel_span.h>
+#include <86box/hdd.h>
+#include <86box/cdrom.h>
+#include <86box/cdrom_image.h>
+#include <86box/network.h>
+#include <86box/bench.h>
 #include <86box/ui.h>
 #include <86box/gdbstub.h>
 
@@ -458,6 +469,16 @@ plat_timer_read(void)
     return SDL_GetPerformanceCounter();
 }
 
+uint64_t
+plat_get_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + (uint64_t) ts.tv_nsec;
+}
+
 static uint64_t
 plat_get_ticks_common(void)
 {
@@ -584,6 +605,8 @@ main_thread(UNUSED(void *param))
     // title_update = 1;
     old_time = SDL_GetTicks();
     drawits = frames = 0;
+    if (bench_seconds)
+        bench_start();
     while (!is_quit && cpu_thread_run)
     {
         /* See if it is time to run a frame of code. */
@@ -599,6 +622,11 @@ main_thread(UNUSED(void *param))
 #endif
 
         old_time = new_time;
+
+        /* Benchmarks and turbo mode run as fast as the host allows. */
+        if (bench_seconds || turbo_mode)
+            drawits = 1;
+
         if (drawits > 0 && !dopause) {
             /* Yes, so do one frame now. */
             drawits -= force_10ms ? 10 : 1;
@@ -608,8 +636,14 @@ main_thread(UNUSED(void *param))
             /* Run a block of code. */
             pc_run();
 
-            /* Every 200 frames we save the machine status. */
-            if (++frames >= (force_10ms ? 200 : 2000) && nvr_dosave) {
+            if (bench_seconds && bench_frame()) {
+                bench_report();
+                break;
+            }
+
+            /* Every 200 frames we save the machine status. Benchmarks
+               leave it alone, so every run starts from the same state. */
+            if (++frames >= (force_10ms ? 200 : 2000) && nvr_dosave && !bench_seconds) {
                 nvr_save();
                 nvr_dosave = 0;
                 frames     = 0;
@@ -619,7 +653,7 @@ main_thread(UNUSED(void *param))
             SDL_Delay(1);
 
         /* If needed, handle a screen resize. */
-        if (atomic_load(&doresize_monitors[0]) && !video_fullscreen && !is_quit) {
+        if (atomic_load(&doresize_monitors[0]) && !video_fullscreen && !is_quit && !bench_seconds) {
 
             if (vid_resize & 2)
                 plat_resize(fixed_size_x, fixed_size_y, 0);
@@ -1029,8 +1063,21 @@ unix_executeLine(char *line)
                 "rdiskeject <id> - eject removable disk image from removable disk drive <id>.\n"
                 "carteject <id> - eject cartridge from drive <id>.\n"
                 "moeject <id> - eject image from MO drive <id>.\n\n"
+                "timerprof <on|off|reset> - control the timer callback profiler.\n"
+                "timerprof dump [filename] - dump the timer profile to the log, or to a .csv/.json file.\n"
+                "tlbstats [reset] - log the guest memory translation cache counters, or reset them.\n"
+                "renderbench - benchmark the SVGA pixel conversion kernels.\n"
+                "blitbench - benchmark the S3/Mach64 blitter fast paths.\n"
+                "vhdstats - log the host I/O done for each VHD image.\n"
+                "cdstats - log the sector cache hit rate for each CD-ROM image.\n"
+                "netstats - log the packet queue counters for each network card.\n"
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+                "hotblocks [count] - log the most executed dynarec blocks.\n"
+#endif
+                "\n"
                 "hardreset - hard reset the emulated system.\n"
                 "pause - pause the the emulated system.\n"
+                "turbo [on|off] - toggle running the emulated system unthrottled.\n"
                 "fullscreen - toggle fullscreen.\n"
                 "version - print version and license information.\n"
                 "exit - exit 86Box.\n");
@@ -1071,9 +1118,48 @@ unix_executeLine(char *line)
         } else if (strncasecmp(xargv[0], "fullscreen", 10) == 0) {
             video_fullscreen   = video_fullscreen ? 0 : 1;
             fullscreen_pending = 1;
+        } else if (strncasecmp(xargv[0], "turbo", 5) == 0) {
+            if (cmdargc >= 2)
+                turbo_mode = (strncasecmp(xargv[1], "on", 2) == 0);
+            else
+                turbo_mode ^= 1;
+            printf("%s", turbo_mode ? "Turbo mode enabled.\n" : "Turbo mode disabled.\n");
         } else if (strncasecmp(xargv[0], "pause", 5) == 0) {
             plat_pause(dopause ^ 1);
             printf("%s", dopause ? "Paused.\n" : "Unpaused.\n");
+        } else if (strncasecmp(xargv[0], "timerprof", 9) == 0 && cmdargc >= 2) {
+            if (strncasecmp(xargv[1], "on", 2) == 0) {
+                timer_prof_enabled = 1;
+                printf("Timer profiler enabled.\n");
+            } else if (strncasecmp(xargv[1], "off", 3) == 0) {
+                timer_prof_enabled = 0;
+                printf("Timer profiler disabled.\n");
+            } else if (strncasecmp(xargv[1], "reset", 5) == 0)
+                timer_prof_reset_pending = 1;
+            else if (strncasecmp(xargv[1], "dump", 4) == 0)
+                timer_prof_dump((cmdargc >= 3) ? xargv[2] : NULL);
+        } else if (strncasecmp(xargv[0], "tlbstats", 8) == 0) {
+            if (cmdargc >= 2 && strncasecmp(xargv[1], "reset", 5) == 0)
+                mem_tlb_stats_reset();
+            else
+                mem_tlb_stats_dump();
+        } else if (strncasecmp(xargv[0], "renderbench", 11) == 0) {
+            svga_render_benchmark();
+        } else if (strncasecmp(xargv[0], "blitbench", 9) == 0) {
+            accel_span_benchmark();
+        } else if (strncasecmp(xargv[0], "vhdstats", 8) == 0) {
+            hdd_image_vhd_stats_dump();
+        } else if (strncasecmp(xargv[0], "cdstats", 7) == 0) {
+            cdrom_image_cache_stats_dump();
+        } else if (strncasecmp(xargv[0], "netstats", 8) == 0) {
+            network_stats_dump();
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+        } else if (strncasecmp(xargv[0], "hotblocks", 9) == 0) {
+            if (cpu_use_dynarec)
+                codegen_dump_hot_blocks((cmdargc >= 2) ? atoi(xargv[1]) : 32);
+            else
+                printf("The dynamic recompiler is not in use.\n");
+#endif
         } else if (strncasecmp(xargv[0], "hardreset", 9) == 0) {
             pc_reset_hard();
         } else if (strncasecmp(xargv[0], "cdload", 6) == 0 && cmdargc >= 3) {
@@ -1287,9 +1373,10 @@ main(int argc, char **argv)
     } else
         fprintf(stderr, "libedit not found, line editing will be limited.\n");
     mousemutex = SDL_CreateMutex();
-    sdl_initho();
+    if (!bench_seconds)
+        sdl_initho();
 
-    if (start_in_fullscreen) {
+    if (start_in_fullscreen && !bench_seconds) {
         video_fullscreen = 1;
         sdl_set_fs(1);
     }
@@ -1302,8 +1389,14 @@ main(int argc, char **argv)
     /* Initialize the rendering window, or fullscreen. */
     do_start();
 
+    /* A benchmark has no window or console to service, so just wait
+       for it to finish. The machine and NVR state are left as-is. */
+    if (bench_seconds)
+        thread_wait(thMain);
+
 #ifndef USE_CLI
-    thread_create(monitor_thread, NULL);
+    if (!bench_seconds)
+        thread_create(monitor_thread, NULL);
 #endif
 
     SDL_AddTimer(1000, timer_onesec, NULL);
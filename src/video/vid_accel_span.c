@@ -0,0 +1,536 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Span kernels for the 2D accelerator fast paths.
+ *
+ *          The S3 and Mach64 blitters hand solid fills, 8x8 pattern fills
+ *          and monochrome expansions that need no destination read (or
+ *          only a transparent one) to these kernels a row at a time,
+ *          instead of going through the per-pixel mix and ROP dispatch.
+ *          The best variant for the host is picked once at startup, with
+ *          plain C as the fallback.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/plat.h>
+#include <86box/vid_accel_span.h>
+
+#if defined __amd64__ || defined _M_X64
+#    include <emmintrin.h>
+#    define USE_SSE2_KERNELS
+#elif defined __aarch64__ || defined _M_ARM64
+#    include <arm_neon.h>
+#    define USE_NEON_KERNELS
+#endif
+
+#ifdef ENABLE_ACCEL_SPAN_LOG
+int accel_span_do_log = ENABLE_ACCEL_SPAN_LOG;
+
+static void
+accel_span_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (accel_span_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define accel_span_log(fmt, ...)
+#endif
+
+static __inline void
+span_put(uint8_t *dst, int i, uint32_t val, int size)
+{
+    switch (size) {
+        case 0:
+            dst[i] = val;
+            break;
+        case 1:
+            ((uint16_t *) dst)[i] = val;
+            break;
+        default:
+            ((uint32_t *) dst)[i] = val;
+            break;
+    }
+}
+
+static void
+fill_c(uint8_t *dst, uint32_t color, int count, int size)
+{
+    for (int i = 0; i < count; i++)
+        span_put(dst, i, color, size);
+}
+
+static void
+pattern_c(uint8_t *dst, const uint32_t *pat, int phase, int count, int size)
+{
+    for (int i = 0; i < count; i++)
+        span_put(dst, i, pat[(phase + i) & 7], size);
+}
+
+static void
+expand_c(uint8_t *dst, const uint8_t *bits, int bit, int count, uint32_t fg, uint32_t bg, int transparent, int size)
+{
+    for (int i = 0; i < count; i++, bit++) {
+        if ((bits[bit >> 3] << (bit & 7)) & 0x80)
+            span_put(dst, i, fg, size);
+        else if (!transparent)
+            span_put(dst, i, bg, size);
+    }
+}
+
+static const accel_span_kernels_t kernels_c = {
+    .name    = "C",
+    .fill    = fill_c,
+    .pattern = pattern_c,
+    .expand  = expand_c
+};
+
+/* The pattern kernels store 32 bytes at a time, which is a whole number of
+   8-pixel periods at every depth; this lays out those 32 bytes. */
+static void
+pattern_row(uint8_t *buf, const uint32_t *pat, int phase, int size)
+{
+    pattern_c(buf, pat, phase, 32 >> size, size);
+}
+
+#ifdef USE_SSE2_KERNELS
+static __inline __m128i
+sse2_splat(uint32_t color, int size)
+{
+    switch (size) {
+        case 0:
+            return _mm_set1_epi8((char) color);
+        case 1:
+            return _mm_set1_epi16((short) color);
+        default:
+            return _mm_set1_epi32((int) color);
+    }
+}
+
+static void
+fill_sse2(uint8_t *dst, uint32_t color, int count, int size)
+{
+    const __m128i v     = sse2_splat(color, size);
+    const int     bytes = count << size;
+    int           i     = 0;
+
+    for (; (i + 32) <= bytes; i += 32) {
+        _mm_storeu_si128((__m128i *) &dst[i], v);
+        _mm_storeu_si128((__m128i *) &dst[i + 16], v);
+    }
+    for (; (i + 16) <= bytes; i += 16)
+        _mm_storeu_si128((__m128i *) &dst[i], v);
+
+    fill_c(&dst[i], color, (bytes - i) >> size, size);
+}
+
+static void
+pattern_sse2(uint8_t *dst, const uint32_t *pat, int phase, int count, int size)
+{
+    uint8_t   buf[32];
+    const int bytes = count << size;
+    int       i     = 0;
+    __m128i   lo;
+    __m128i   hi;
+
+    pattern_row(buf, pat, phase, size);
+    lo = _mm_loadu_si128((const __m128i *) buf);
+    hi = _mm_loadu_si128((const __m128i *) &buf[16]);
+
+    for (; (i + 32) <= bytes; i += 32) {
+        _mm_storeu_si128((__m128i *) &dst[i], lo);
+        _mm_storeu_si128((__m128i *) &dst[i + 16], hi);
+    }
+
+    pattern_c(&dst[i], pat, phase + (i >> size), (bytes - i) >> size, size);
+}
+
+static __inline void
+sse2_expand_store(uint8_t *dst, __m128i mask, __m128i fg, __m128i bg, int transparent)
+{
+    if (transparent)
+        bg = _mm_loadu_si128((const __m128i *) dst);
+
+    _mm_storeu_si128((__m128i *) dst, _mm_or_si128(_mm_and_si128(mask, fg), _mm_andnot_si128(mask, bg)));
+}
+
+static void
+expand_sse2(uint8_t *dst, const uint8_t *bits, int bit, int count, uint32_t fg, uint32_t bg, int transparent, int size)
+{
+    const __m128i vfg = sse2_splat(fg, size);
+    const __m128i vbg = sse2_splat(bg, size);
+    const uint8_t *src;
+    int            i = 0;
+
+    /* Line the source up on a byte first. */
+    if (bit & 7) {
+        i = MIN(count, 8 - (bit & 7));
+        expand_c(dst, bits, bit, i, fg, bg, transparent, size);
+    }
+    src = &bits[(bit + i) >> 3];
+
+    switch (size) {
+        case 0: {
+            const __m128i sel = _mm_set1_epi64x(0x0102040810204080LL);
+
+            for (; (i + 16) <= count; i += 16, src += 2) {
+                __m128i b = _mm_set_epi64x((int64_t) (src[1] * 0x0101010101010101ULL),
+                                           (int64_t) (src[0] * 0x0101010101010101ULL));
+                sse2_expand_store(&dst[i], _mm_cmpeq_epi8(_mm_and_si128(b, sel), sel), vfg, vbg, transparent);
+            }
+            break;
+        }
+        case 1: {
+            const __m128i sel = _mm_setr_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+
+            for (; (i + 8) <= count; i += 8, src++) {
+                __m128i b = _mm_set1_epi16(*src);
+                sse2_expand_store(&dst[i << 1], _mm_cmpeq_epi16(_mm_and_si128(b, sel), sel), vfg, vbg, transparent);
+            }
+            break;
+        }
+        default: {
+            const __m128i sel_hi = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+            const __m128i sel_lo = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+
+            for (; (i + 8) <= count; i += 8, src++) {
+                __m128i b = _mm_set1_epi32(*src);
+                sse2_expand_store(&dst[i << 2], _mm_cmpeq_epi32(_mm_and_si128(b, sel_hi), sel_hi), vfg, vbg, transparent);
+                sse2_expand_store(&dst[(i << 2) + 16], _mm_cmpeq_epi32(_mm_and_si128(b, sel_lo), sel_lo), vfg, vbg, transparent);
+            }
+            break;
+        }
+    }
+
+    expand_c(&dst[i << size], bits, bit + i, count - i, fg, bg, transparent, size);
+}
+
+static const accel_span_kernels_t kernels_sse2 = {
+    .name    = "SSE2",
+    .fill    = fill_sse2,
+    .pattern = pattern_sse2,
+    .expand  = expand_sse2
+};
+#endif
+
+#ifdef USE_NEON_KERNELS
+static __inline uint8x16_t
+neon_splat(uint32_t color, int size)
+{
+    switch (size) {
+        case 0:
+            return vdupq_n_u8(color);
+        case 1:
+            return vreinterpretq_u8_u16(vdupq_n_u16(color));
+        default:
+            return vreinterpretq_u8_u32(vdupq_n_u32(color));
+    }
+}
+
+static void
+fill_neon(uint8_t *dst, uint32_t color, int count, int size)
+{
+    const uint8x16_t v     = neon_splat(color, size);
+    const int        bytes = count << size;
+    int              i     = 0;
+
+    for (; (i + 32) <= bytes; i += 32) {
+        vst1q_u8(&dst[i], v);
+        vst1q_u8(&dst[i + 16], v);
+    }
+    for (; (i + 16) <= bytes; i += 16)
+        vst1q_u8(&dst[i], v);
+
+    fill_c(&dst[i], color, (bytes - i) >> size, size);
+}
+
+static void
+pattern_neon(uint8_t *dst, const uint32_t *pat, int phase, int count, int size)
+{
+    uint8_t    buf[32];
+    const int  bytes = count << size;
+    int        i     = 0;
+    uint8x16_t lo;
+    uint8x16_t hi;
+
+    pattern_row(buf, pat, phase, size);
+    lo = vld1q_u8(buf);
+    hi = vld1q_u8(&buf[16]);
+
+    for (; (i + 32) <= bytes; i += 32) {
+        vst1q_u8(&dst[i], lo);
+        vst1q_u8(&dst[i + 16], hi);
+    }
+
+    pattern_c(&dst[i], pat, phase + (i >> size), (bytes - i) >> size, size);
+}
+
+static __inline void
+neon_expand_store(uint8_t *dst, uint8x16_t mask, uint8x16_t fg, uint8x16_t bg, int transparent)
+{
+    if (transparent)
+        bg = vld1q_u8(dst);
+
+    vst1q_u8(dst, vbslq_u8(mask, fg, bg));
+}
+
+static void
+expand_neon(uint8_t *dst, const uint8_t *bits, int bit, int count, uint32_t fg, uint32_t bg, int transparent, int size)
+{
+    static const uint8_t  sel8[16]  = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                        0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    static const uint16_t sel16[8]  = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    static const uint32_t sel32[8]  = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    const uint8x16_t      vfg       = neon_splat(fg, size);
+    const uint8x16_t      vbg       = neon_splat(bg, size);
+    const uint8_t        *src;
+    int                   i = 0;
+
+    /* Line the source up on a byte first. */
+    if (bit & 7) {
+        i = MIN(count, 8 - (bit & 7));
+        expand_c(dst, bits, bit, i, fg, bg, transparent, size);
+    }
+    src = &bits[(bit + i) >> 3];
+
+    switch (size) {
+        case 0: {
+            const uint8x16_t sel = vld1q_u8(sel8);
+
+            for (; (i + 16) <= count; i += 16, src += 2) {
+                uint8x16_t b = vcombine_u8(vdup_n_u8(src[0]), vdup_n_u8(src[1]));
+                neon_expand_store(&dst[i], vtstq_u8(b, sel), vfg, vbg, transparent);
+            }
+            break;
+        }
+        case 1: {
+            const uint16x8_t sel = vld1q_u16(sel16);
+
+            for (; (i + 8) <= count; i += 8, src++) {
+                uint16x8_t m = vtstq_u16(vdupq_n_u16(*src), sel);
+                neon_expand_store(&dst[i << 1], vreinterpretq_u8_u16(m), vfg, vbg, transparent);
+            }
+            break;
+        }
+        default: {
+            const uint32x4_t sel_hi = vld1q_u32(sel32);
+            const uint32x4_t sel_lo = vld1q_u32(&sel32[4]);
+
+            for (; (i + 8) <= count; i += 8, src++) {
+                uint32x4_t b = vdupq_n_u32(*src);
+                neon_expand_store(&dst[i << 2], vreinterpretq_u8_u32(vtstq_u32(b, sel_hi)), vfg, vbg, transparent);
+                neon_expand_store(&dst[(i << 2) + 16], vreinterpretq_u8_u32(vtstq_u32(b, sel_lo)), vfg, vbg, transparent);
+            }
+            break;
+        }
+    }
+
+    expand_c(&dst[i << size], bits, bit + i, count - i, fg, bg, transparent, size);
+}
+
+static const accel_span_kernels_t kernels_neon = {
+    .name    = "NEON",
+    .fill    = fill_neon,
+    .pattern = pattern_neon,
+    .expand  = expand_neon
+};
+#endif
+
+const accel_span_kernels_t *accel_span_kernels = &kernels_c;
+int                         accel_span_fast    = 1;
+
+void
+accel_span_kernels_init(void)
+{
+    static int inited = 0;
+
+    if (inited)
+        return;
+    inited = 1;
+
+#if defined USE_NEON_KERNELS
+    accel_span_kernels = &kernels_neon;
+#elif defined USE_SSE2_KERNELS
+    accel_span_kernels = &kernels_sse2;
+#endif
+
+    accel_span_log("Accel: using %s span kernels\n", accel_span_kernels->name);
+}
+
+#define BENCH_WIDTH  1024
+#define BENCH_ROUNDS 4000
+#define BENCH_BLITS  16
+
+static void
+bench_seed(uint8_t *buf, uint32_t size)
+{
+    uint32_t seed = 0x12345678;
+
+    for (uint32_t i = 0; i < size; i++) {
+        seed   = (seed * 1103515245) + 12345;
+        buf[i] = seed >> 16;
+    }
+}
+
+/* The operations as the blitters used to do them for every pixel, used as
+   the baseline and to check the kernels against. */
+static void
+bench_op(int op, uint8_t *dst, const uint8_t *src, const uint32_t *pat, int size,
+         const accel_span_kernels_t *k)
+{
+    switch (op) {
+        case 0:
+            if (k)
+                k->fill(dst, 0x12345678, BENCH_WIDTH, size);
+            else
+                fill_c(dst, 0x12345678, BENCH_WIDTH, size);
+            break;
+        case 1:
+            if (k)
+                memmove(dst, src, BENCH_WIDTH << size);
+            else {
+                for (int i = 0; i < (BENCH_WIDTH << size); i += (1 << size))
+                    memcpy(&dst[i], &src[i], 1 << size);
+            }
+            break;
+        case 2:
+            if (k)
+                k->pattern(dst, pat, 3, BENCH_WIDTH, size);
+            else
+                pattern_c(dst, pat, 3, BENCH_WIDTH, size);
+            break;
+        case 3:
+        case 4:
+            if (k)
+                k->expand(dst, src, 5, BENCH_WIDTH, 0xcafebabe, 0x0badf00d, op == 4, size);
+            else
+                expand_c(dst, src, 5, BENCH_WIDTH, 0xcafebabe, 0x0badf00d, op == 4, size);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Runs a blitter operation, set up from scratch by blit() for each round,
+   from the same VRAM contents with the fast paths off and then on, and
+   logs both rates and whether the two left VRAM the same. */
+void
+accel_span_bench_blit(const char *name, void (*blit)(void *priv, int op), void *priv, int op,
+                      uint8_t *vram, uint32_t vram_size, int pixels)
+{
+    uint8_t *ref  = (uint8_t *) malloc(vram_size);
+    int      fast = accel_span_fast;
+    uint64_t start;
+    uint64_t ns_ref;
+    uint64_t ns;
+
+    if (ref == NULL)
+        return;
+
+    bench_seed(vram, vram_size);
+    accel_span_fast = 0;
+    start           = plat_get_ns();
+    for (int i = 0; i < BENCH_BLITS; i++)
+        blit(priv, op);
+    ns_ref = plat_get_ns() - start;
+    memcpy(ref, vram, vram_size);
+
+    bench_seed(vram, vram_size);
+    accel_span_fast = 1;
+    start           = plat_get_ns();
+    for (int i = 0; i < BENCH_BLITS; i++)
+        blit(priv, op);
+    ns              = plat_get_ns() - start;
+    accel_span_fast = fast;
+
+    pclog("  %-24s generic: %8.2f Mpx/s, fast: %8.2f Mpx/s, x%5.1f%s\n", name,
+          ((double) pixels * BENCH_BLITS * 1000.0) / (double) (ns_ref ? ns_ref : 1),
+          ((double) pixels * BENCH_BLITS * 1000.0) / (double) (ns ? ns : 1),
+          (double) ns_ref / (double) (ns ? ns : 1),
+          memcmp(ref, vram, vram_size) ? " (MISMATCH)" : "");
+
+    free(ref);
+}
+
+/* Run each fast path operation over a synthetic scanline at 8, 16 and
+   32bpp, with both the per-pixel baseline and the selected kernels, and
+   log the throughput. These are the spans the S3 and Mach64 blitters
+   issue; the blitters themselves are then timed end to end. */
+void
+accel_span_benchmark(void)
+{
+    static const char *const   ops[] = { "fill", "copy", "pattern", "expand", "expand-t" };
+    const accel_span_kernels_t *k    = accel_span_kernels;
+    uint8_t                    *src;
+    uint8_t                    *dst_ref;
+    uint8_t                    *dst;
+    uint32_t                    pat[8];
+    uint64_t                    start;
+    uint64_t                    ns_ref;
+    uint64_t                    ns;
+
+    src     = (uint8_t *) malloc(BENCH_WIDTH * 4);
+    dst_ref = (uint8_t *) malloc(BENCH_WIDTH * 4);
+    dst     = (uint8_t *) malloc(BENCH_WIDTH * 4);
+    if ((src == NULL) || (dst_ref == NULL) || (dst == NULL)) {
+        free(src);
+        free(dst_ref);
+        free(dst);
+        return;
+    }
+
+    bench_seed(src, BENCH_WIDTH * 4);
+    for (int i = 0; i < 8; i++)
+        pat[i] = (src[i * 4] << 24) | (src[i * 4 + 1] << 16) | (src[i * 4 + 2] << 8) | src[i * 4 + 3];
+
+    pclog("Accelerator span kernels, %d pixels x %d rounds:\n", BENCH_WIDTH, BENCH_ROUNDS);
+    for (int size = 0; size <= 2; size++) {
+        for (int op = 0; op < 5; op++) {
+            memset(dst_ref, 0x5a, BENCH_WIDTH * 4);
+            memset(dst, 0x5a, BENCH_WIDTH * 4);
+
+            start = plat_get_ns();
+            for (int i = 0; i < BENCH_ROUNDS; i++)
+                bench_op(op, dst_ref, src, pat, size, NULL);
+            ns_ref = plat_get_ns() - start;
+
+            start = plat_get_ns();
+            for (int i = 0; i < BENCH_ROUNDS; i++)
+                bench_op(op, dst, src, pat, size, k);
+            ns = plat_get_ns() - start;
+
+            pclog("  %2dbpp %-8s C: %6.2f px/ns, %-4s: %6.2f px/ns%s\n", 8 << size, ops[op],
+                  ((double) BENCH_WIDTH * BENCH_ROUNDS) / (double) (ns_ref ? ns_ref : 1), k->name,
+                  ((double) BENCH_WIDTH * BENCH_ROUNDS) / (double) (ns ? ns : 1),
+                  memcmp(dst_ref, dst, BENCH_WIDTH * 4) ? " (MISMATCH)" : "");
+        }
+    }
+
+    free(src);
+    free(dst_ref);
+    free(dst);
+
+    s3_accel_benchmark();
+    mach64_accel_benchmark();
+}
@@ -42,6 +42,7 @@
 #include <86box/vid_xga.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_accel_span.h>
 #include "cpu.h"
 
 #define ROM_ORCHID_86C911              "roms/video/s3/BIOS.BIN"
@@ -8165,6 +8166,398 @@ s3_visionx68_video_engine_op(uint32_t cpu_dat, s3_t *s3)
     }
 }
 
+/* Fast paths for the operations Windows leans on the most: solid rectangle
+   fills, left to right screen to screen copies, 8x8 pattern fills and the
+   colour expansion of monochrome host data used for text. They only apply
+   to linear 8, 16 and 32bpp frame buffers with every bit writable, no
+   colour compare and mixes that either do not read the destination or
+   leave it alone; everything else takes the per-pixel paths. Each of them
+   leaves the engine registers exactly as the per-pixel path would. */
+static __inline int
+s3_accel_span_size(const s3_t *s3)
+{
+    return (s3->bpp == 3) ? 2 : s3->bpp;
+}
+
+static int
+s3_accel_span_ok(const s3_t *s3, const svga_t *svga, uint32_t wrt_mask)
+{
+    uint32_t mask;
+
+    if (!accel_span_fast || (!svga->packed_chain4 && !svga->force_old_addr))
+        return 0;
+    if (s3->color_16bit || (s3->bpp == 2) || (svga->bpp == 24))
+        return 0;
+    if ((s3->accel.multifunc[0xe] & 0x100) || !(s3->accel.cmd & 0x10))
+        return 0;
+
+    mask = (s3->bpp == 0) ? 0xff : ((s3->bpp == 1) ? 0xffff : 0xffffffff);
+    return ((wrt_mask & mask) == mask);
+}
+
+/* Works out what a mix writes when it does not depend on the destination:
+   returns 1 with the value in *val, 0 if it leaves the pixel alone, and -1
+   if it needs the destination. */
+static int
+s3_accel_span_mix(uint8_t mix, uint32_t src_dat, uint32_t *val)
+{
+    switch (mix & 0xf) {
+        case 0x1:
+            *val = 0;
+            return 1;
+        case 0x2:
+            *val = ~0;
+            return 1;
+        case 0x3:
+            return 0;
+        case 0x4:
+            *val = ~src_dat;
+            return 1;
+        case 0x7:
+            *val = src_dat;
+            return 1;
+
+        default:
+            return -1;
+    }
+}
+
+/* Returns count pixels of VRAM starting at pixel address addr, or NULL if
+   they wrap around the end of it, marking them changed if written to. */
+static uint8_t *
+s3_accel_span(s3_t *s3, svga_t *svga, uint32_t addr, int count, int write)
+{
+    int      size  = s3_accel_span_size(s3);
+    uint32_t mask  = s3->vram_mask >> size;
+    uint32_t start = addr & mask;
+
+    if ((start + count - 1) > mask)
+        return NULL;
+
+    start <<= size;
+    if (write) {
+        for (uint32_t page = start >> 12; page <= ((start + (count << size) - 1) >> 12); page++)
+            svga->changedvram[page] = svga->monitor->mon_changeframecount;
+    }
+
+    return &svga->vram[start];
+}
+
+static uint32_t
+s3_accel_span_read(s3_t *s3, svga_t *svga, uint32_t addr)
+{
+    const uint8_t *p = s3_accel_span(s3, svga, addr, 1, 0);
+
+    switch (s3_accel_span_size(s3)) {
+        case 0:
+            return *p;
+        case 1:
+            return *(const uint16_t *) p;
+        default:
+            return *(const uint32_t *) p;
+    }
+}
+
+static void
+s3_accel_span_fill(s3_t *s3, svga_t *svga, uint32_t addr, int count, uint32_t color)
+{
+    int      size = s3_accel_span_size(s3);
+    uint8_t *p    = s3_accel_span(s3, svga, addr, count, 1);
+
+    if (p != NULL)
+        accel_span_kernels->fill(p, color, count, size);
+    else {
+        for (int i = 0; i < count; i++)
+            accel_span_kernels->fill(s3_accel_span(s3, svga, addr + i, 1, 1), color, 1, size);
+    }
+}
+
+static void
+s3_accel_span_pattern(s3_t *s3, svga_t *svga, uint32_t addr, int count, const uint32_t *pat, int phase)
+{
+    int      size = s3_accel_span_size(s3);
+    uint8_t *p    = s3_accel_span(s3, svga, addr, count, 1);
+
+    if (p != NULL)
+        accel_span_kernels->pattern(p, pat, phase, count, size);
+    else {
+        for (int i = 0; i < count; i++)
+            accel_span_kernels->pattern(s3_accel_span(s3, svga, addr + i, 1, 1), pat, phase + i, 1, size);
+    }
+}
+
+static void
+s3_accel_span_expand(s3_t *s3, svga_t *svga, uint32_t addr, int count, const uint8_t *bits, int bit,
+                     uint32_t fg, uint32_t bg, int transparent)
+{
+    int      size = s3_accel_span_size(s3);
+    uint8_t *p    = s3_accel_span(s3, svga, addr, count, 1);
+
+    if (p != NULL)
+        accel_span_kernels->expand(p, bits, bit, count, fg, bg, transparent, size);
+    else {
+        for (int i = 0; i < count; i++)
+            accel_span_kernels->expand(s3_accel_span(s3, svga, addr + i, 1, 1), bits, bit + i, 1, fg, bg, transparent, size);
+    }
+}
+
+/* Expands a row of monochrome bits into fg/bg, given what each of the two
+   mixes does; a side that leaves the destination alone is transparent. */
+static void
+s3_accel_span_mono(s3_t *s3, svga_t *svga, uint32_t addr, int count, uint8_t *bits, int nbits, int bit,
+                   int fg_draw, uint32_t fg, int bg_draw, uint32_t bg)
+{
+    if (!fg_draw && !bg_draw)
+        return;
+
+    if (!fg_draw) {
+        for (int i = 0; i < ((nbits + 7) >> 3); i++)
+            bits[i] = ~bits[i];
+        fg      = bg;
+        fg_draw = 1;
+        bg_draw = 0;
+    }
+
+    s3_accel_span_expand(s3, svga, addr, count, bits, bit, fg, bg, !bg_draw);
+}
+
+static int
+s3_accel_rect_fill_fast(s3_t *s3, svga_t *svga, uint32_t dstbase, uint32_t frgd_color, uint32_t bkgd_color,
+                        int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    int      frgd_mix = (s3->accel.frgd_mix >> 5) & 3;
+    int      maj      = s3->accel.maj_axis_pcnt & 0xfff;
+    int      lo       = (s3->accel.cmd & 0x20) ? s3->accel.cx : (s3->accel.cx - maj);
+    int      hi       = lo + maj;
+    int      draw;
+    uint32_t color = 0;
+
+    if ((s3->accel.cmd & 0x20) ? ((hi + 1) > 0xfff) : (lo < 1))
+        return 0;
+    if (s3->accel.multifunc[0xe] & 0x20)
+        return 0;
+
+    draw = s3_accel_span_mix(s3->accel.frgd_mix, (frgd_mix == 0) ? bkgd_color : ((frgd_mix == 1) ? frgd_color : 0), &color);
+    if (draw < 0)
+        return 0;
+
+    lo = MAX(lo, clip_l);
+    hi = MIN(hi, clip_r);
+
+    for (; s3->accel.sy >= 0; s3->accel.sy--) {
+        if (draw && (lo <= hi) && (s3->accel.cy >= clip_t) && (s3->accel.cy <= clip_b))
+            s3_accel_span_fill(s3, svga, s3->accel.dest + lo, hi - lo + 1, color);
+
+        if (s3->accel.cmd & 0x80)
+            s3->accel.cy++;
+        else
+            s3->accel.cy--;
+
+        s3->accel.cy &= 0xfff;
+        s3->accel.dest = dstbase + s3->accel.cy * s3->width;
+    }
+
+    s3->accel.cur_x = s3->accel.cx;
+    s3->accel.cur_y = s3->accel.cy;
+    return 1;
+}
+
+/* Colour expansion of across-the-plane host data, up to the end of the
+   current row; like the per-pixel path, the rest of the data is dropped
+   when a row ends. */
+static int
+s3_accel_mono_host_fast(s3_t *s3, svga_t *svga, int count, uint32_t mix_dat, uint32_t mix_mask, uint32_t dstbase,
+                        uint32_t frgd_color, uint32_t bkgd_color, int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    int      frgd_mix = (s3->accel.frgd_mix >> 5) & 3;
+    int      bkgd_mix = (s3->accel.bkgd_mix >> 5) & 3;
+    int      maj      = s3->accel.maj_axis_pcnt & 0xfff;
+    int      n        = MIN(count, s3->accel.sx + 1);
+    int      lo       = MAX(s3->accel.cx, clip_l);
+    int      hi       = MIN(s3->accel.cx + n - 1, clip_r);
+    int      fg_draw;
+    int      bg_draw;
+    uint32_t fg = 0;
+    uint32_t bg = 0;
+    uint8_t  bits[4];
+
+    if (((s3->accel.multifunc[0xa] & 0xc0) != 0x80) || !(s3->accel.cmd & 0x02) || !(s3->accel.cmd & 0x20))
+        return 0;
+    if (s3->accel.b2e8_pix || s3_cpu_dest(s3) || (s3->accel.multifunc[0xe] & 0x20))
+        return 0;
+    if ((count > 32) || (s3->accel.sy < 0) || ((s3->accel.cx + s3->accel.sx + 1) > 0xfff))
+        return 0;
+    if ((frgd_mix == 2) || (bkgd_mix == 2))
+        return 0;
+
+    fg_draw = s3_accel_span_mix(s3->accel.frgd_mix, (frgd_mix == 0) ? bkgd_color : ((frgd_mix == 1) ? frgd_color : 0), &fg);
+    bg_draw = s3_accel_span_mix(s3->accel.bkgd_mix, (bkgd_mix == 0) ? bkgd_color : ((bkgd_mix == 1) ? frgd_color : 0), &bg);
+    if ((fg_draw < 0) || (bg_draw < 0))
+        return 0;
+
+    /* Same bit walk as the per-pixel path, which shifts ones in. */
+    memset(bits, 0x00, sizeof(bits));
+    for (int i = 0; i < n; i++) {
+        if (mix_dat & mix_mask)
+            bits[i >> 3] |= 0x80 >> (i & 7);
+        mix_dat = (mix_dat << 1) | 1;
+    }
+
+    if ((lo <= hi) && (s3->accel.cy >= clip_t) && (s3->accel.cy <= clip_b))
+        s3_accel_span_mono(s3, svga, s3->accel.dest + lo, hi - lo + 1, bits, 32, lo - s3->accel.cx,
+                           fg_draw, fg, bg_draw, bg);
+
+    s3->accel.cx += n;
+    s3->accel.sx -= n;
+    if (s3->accel.sx < 0) {
+        s3->accel.sx = maj;
+        s3->accel.cx -= (maj + 1);
+
+        if (s3->accel.cmd & 0x80)
+            s3->accel.cy++;
+        else
+            s3->accel.cy--;
+
+        s3->accel.cy &= 0xfff;
+        s3->accel.dest = dstbase + s3->accel.cy * s3->width;
+
+        s3->accel.sy--;
+    }
+
+    return 1;
+}
+
+static int
+s3_accel_blit_fast(s3_t *s3, svga_t *svga, uint32_t srcbase, uint32_t dstbase,
+                   int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    int size = s3_accel_span_size(s3);
+    int maj  = s3->accel.maj_axis_pcnt & 0xfff;
+    int dx   = s3->accel.dx;
+    int lo   = MAX(dx, clip_l);
+    int hi   = MIN(dx + maj, clip_r);
+
+    if ((dx + maj + 1) > 0xfff)
+        return 0;
+
+    for (; s3->accel.sy >= 0; s3->accel.sy--) {
+        if ((lo <= hi) && (s3->accel.dy >= clip_t) && (s3->accel.dy <= clip_b)) {
+            int      count = hi - lo + 1;
+            uint32_t saddr = s3->accel.src + s3->accel.cx + (lo - dx);
+            uint32_t daddr = s3->accel.dest + lo;
+            uint8_t *s     = s3_accel_span(s3, svga, saddr, count, 0);
+            uint8_t *d     = s3_accel_span(s3, svga, daddr, count, 1);
+
+            /* The engine copies one pixel at a time from left to right, so
+               a destination overlapping the source further right repeats
+               it; only take the shortcut where that cannot happen. */
+            if ((s != NULL) && (d != NULL) && ((d <= s) || (d >= (s + (count << size)))))
+                memmove(d, s, count << size);
+            else {
+                for (int i = 0; i < count; i++)
+                    memcpy(s3_accel_span(s3, svga, daddr + i, 1, 1), s3_accel_span(s3, svga, saddr + i, 1, 0), 1 << size);
+            }
+        }
+
+        s3->accel.cy++;
+        s3->accel.dy++;
+
+        s3->accel.src  = srcbase + (s3->accel.cy * s3->width);
+        s3->accel.dest = dstbase + (s3->accel.dy * s3->width);
+    }
+
+    if (s3->accel.rd_mask_16bit_check) {
+        if (s3->accel.minus)
+            s3->accel.color_16bit_check = 0;
+        else
+            s3->accel.color_16bit_check = 1;
+    }
+    s3->accel.destx_distp = s3->accel.dx;
+    s3->accel.desty_axstp = s3->accel.dy;
+    return 1;
+}
+
+static int
+s3_accel_pattern_fast(s3_t *s3, svga_t *svga, uint32_t srcbase, uint32_t dstbase, uint32_t frgd_color,
+                      uint32_t bkgd_color, uint32_t rd_mask, int vram_mask,
+                      int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    int      frgd_mix = (s3->accel.frgd_mix >> 5) & 3;
+    int      bkgd_mix = (s3->accel.bkgd_mix >> 5) & 3;
+    int      maj      = s3->accel.maj_axis_pcnt & 0xfff;
+    int      lo       = (s3->accel.cmd & 0x20) ? s3->accel.dx : (s3->accel.dx - maj);
+    int      hi       = lo + maj;
+    int      fg_draw  = 0;
+    int      bg_draw  = 0;
+    uint32_t fg       = 0;
+    uint32_t bg       = 0;
+    uint32_t pat[8];
+    uint8_t  bits[(0x1000 >> 3) + 2];
+
+    if ((s3->accel.cmd & 0x20) ? ((hi + 1) > 0xfff) : (lo < 1))
+        return 0;
+
+    if (vram_mask) {
+        /* Monochrome pattern, each pixel picking the foreground or the
+           background mix depending on whether it matches the read mask. */
+        if ((frgd_mix == 3) || (bkgd_mix == 3))
+            return 0;
+        fg_draw = s3_accel_span_mix(s3->accel.frgd_mix, (frgd_mix == 0) ? bkgd_color : ((frgd_mix == 1) ? frgd_color : 0), &fg);
+        bg_draw = s3_accel_span_mix(s3->accel.bkgd_mix, (bkgd_mix == 0) ? bkgd_color : ((bkgd_mix == 1) ? frgd_color : 0), &bg);
+        if ((fg_draw < 0) || (bg_draw < 0))
+            return 0;
+    } else if (frgd_mix == 3) {
+        /* Colour pattern. */
+        if ((s3->accel.frgd_mix & 0xf) != 0x7)
+            return 0;
+    } else {
+        fg_draw = s3_accel_span_mix(s3->accel.frgd_mix, (frgd_mix == 0) ? bkgd_color : ((frgd_mix == 1) ? frgd_color : 0), &fg);
+        if (fg_draw < 0)
+            return 0;
+    }
+
+    lo = MAX(lo, clip_l);
+    hi = MIN(hi, clip_r);
+
+    for (; s3->accel.sy >= 0; s3->accel.sy--) {
+        if ((lo <= hi) && (s3->accel.dy >= clip_t) && (s3->accel.dy <= clip_b)) {
+            int      count = hi - lo + 1;
+            uint32_t daddr = s3->accel.dest + lo;
+
+            if (vram_mask) {
+                uint8_t row = 0;
+
+                for (int k = 0; k < 8; k++) {
+                    if ((s3_accel_span_read(s3, svga, s3->accel.src + k) & rd_mask) == rd_mask)
+                        row |= 0x80 >> k;
+                }
+                memset(bits, row, ((lo & 7) + count + 7) >> 3);
+                s3_accel_span_mono(s3, svga, daddr, count, bits, (lo & 7) + count, lo & 7, fg_draw, fg, bg_draw, bg);
+            } else if (frgd_mix == 3) {
+                for (int k = 0; k < 8; k++)
+                    pat[k] = s3_accel_span_read(s3, svga, s3->accel.src + k);
+                s3_accel_span_pattern(s3, svga, daddr, count, pat, lo & 7);
+            } else if (fg_draw)
+                s3_accel_span_fill(s3, svga, daddr, count, fg);
+        }
+
+        if (s3->accel.cmd & 0x80) {
+            s3->accel.cy = ((s3->accel.cy + 1) & 7) | (s3->accel.cy & ~7);
+            s3->accel.dy++;
+        } else {
+            s3->accel.cy = ((s3->accel.cy - 1) & 7) | (s3->accel.cy & ~7);
+            s3->accel.dy--;
+        }
+
+        s3->accel.src  = srcbase + s3->accel.pattern + (s3->accel.cy * s3->width);
+        s3->accel.dest = dstbase + s3->accel.dy * s3->width;
+    }
+
+    s3->accel.destx_distp = s3->accel.dx;
+    s3->accel.desty_axstp = s3->accel.dy;
+    return 1;
+}
+
 void
 s3_short_stroke_start(s3_t *s3, uint8_t ssv)
 {
@@ -9228,6 +9621,14 @@ s3_accel_start(int count, int cpu_input, uint32_t mix_dat, uint32_t cpu_dat, voi
                 break;
             }
 
+            if (s3_accel_span_ok(s3, svga, wrt_mask)) {
+                if (!cpu_input) {
+                    if (s3_accel_rect_fill_fast(s3, svga, dstbase, frgd_color, bkgd_color, clip_t, clip_l, clip_b, clip_r))
+                        return;
+                } else if (s3_accel_mono_host_fast(s3, svga, count, mix_dat, mix_mask, dstbase, frgd_color, bkgd_color, clip_t, clip_l, clip_b, clip_r))
+                    break;
+            }
+
             while (count-- && (s3->accel.sy >= 0)) {
                 if (s3->accel.b2e8_pix && s3_cpu_src(s3) && !s3->accel.temp_cnt) {
                     mix_dat >>= 16;
@@ -9753,6 +10154,9 @@ s3_accel_start(int count, int cpu_input, uint32_t mix_dat, uint32_t cpu_dat, voi
 
             if (!cpu_input && (frgd_mix == 3) && !vram_mask && !(s3->accel.multifunc[0xe] & 0x100) && ((s3->accel.cmd & 0xa0) == 0xa0) && ((s3->accel.frgd_mix & 0xf) == 7) && ((s3->accel.bkgd_mix & 0xf) == 7)) {
                 s3_log("Special BitBLT.\n");
+                if (s3_accel_span_ok(s3, svga, wrt_mask) && s3_accel_blit_fast(s3, svga, srcbase, dstbase, clip_t, clip_l, clip_b, clip_r))
+                    return;
+
                 while (1) {
                     if ((s3->accel.dx >= clip_l) && (s3->accel.dx <= clip_r) && (s3->accel.dy >= clip_t) && (s3->accel.dy <= clip_b)) {
                         READ(s3->accel.src + s3->accel.cx - s3->accel.minus, src_dat);
@@ -10071,6 +10475,10 @@ s3_accel_start(int count, int cpu_input, uint32_t mix_dat, uint32_t cpu_dat, voi
                 break;
             }
 
+            if (!cpu_input && s3_accel_span_ok(s3, svga, wrt_mask) &&
+                s3_accel_pattern_fast(s3, svga, srcbase, dstbase, frgd_color, bkgd_color, rd_mask, vram_mask, clip_t, clip_l, clip_b, clip_r))
+                return;
+
             while (count-- && (s3->accel.sy >= 0)) {
                 if ((s3->accel.dx >= clip_l) && (s3->accel.dx <= clip_r) && (s3->accel.dy >= clip_t) && (s3->accel.dy <= clip_b)) {
                     if (vram_mask) {
@@ -10852,6 +11260,122 @@ s3_accel_start(int count, int cpu_input, uint32_t mix_dat, uint32_t cpu_dat, voi
     }
 }
 
+#define S3_BENCH_VRAM (4 << 20)
+
+/* The blitter benchmark's operations, on a 1024 pixel wide screen: a solid
+   fill, a SRCCOPY screen to screen copy and a colour 8x8 pattern fill, all
+   512x384, and a screen of 8x16 text drawn from across-the-plane host
+   data the way the Windows drivers do it. */
+static void
+s3_accel_bench_blit(void *priv, int op)
+{
+    s3_t    *s3   = (s3_t *) priv;
+    uint32_t seed = 0x2468ace0;
+
+    s3->accel.frgd_color     = 0x89abcdef;
+    s3->accel.bkgd_color     = 0x01234567;
+    s3->accel.frgd_mix       = 0x27;
+    s3->accel.bkgd_mix       = 0x07;
+    s3->accel.multifunc[0xa] = 0x00;
+    s3->accel.maj_axis_pcnt  = 511;
+    s3->accel.multifunc[0]   = 383;
+
+    switch (op) {
+        case 0:
+            s3->accel.cmd   = 0x40b0;
+            s3->accel.cur_x = 3;
+            s3->accel.cur_y = 5;
+            s3_accel_start(-1, 0, 0xffffffff, 0, s3);
+            break;
+        case 1:
+            s3->accel.cmd         = 0xc0b0;
+            s3->accel.frgd_mix    = 0x67;
+            s3->accel.cur_x       = 0;
+            s3->accel.cur_y       = 400;
+            s3->accel.destx_distp = 3;
+            s3->accel.desty_axstp = 5;
+            s3_accel_start(-1, 0, 0xffffffff, 0, s3);
+            break;
+        case 2:
+            s3->accel.cmd         = 0xe0b0;
+            s3->accel.frgd_mix    = 0x67;
+            s3->accel.cur_x       = 600;
+            s3->accel.cur_y       = 400;
+            s3->accel.destx_distp = 3;
+            s3->accel.desty_axstp = 5;
+            s3_accel_start(-1, 0, 0xffffffff, 0, s3);
+            break;
+        case 3:
+            s3->accel.cmd            = 0x45b3;
+            s3->accel.multifunc[0xa] = 0x80;
+            s3->accel.maj_axis_pcnt  = 7;
+            s3->accel.multifunc[0]   = 15;
+            for (int y = 0; y < 24; y++) {
+                for (int x = 0; x < 64; x++) {
+                    s3->accel.cur_x = 3 + (x * 8);
+                    s3->accel.cur_y = 5 + (y * 16);
+                    s3_accel_start(-1, 0, 0xffffffff, 0, s3);
+                    for (int row = 0; row < 16; row++) {
+                        seed = (seed * 1103515245) + 12345;
+                        s3_accel_start(32, 1, (seed >> 8) & 0xff000000, 0, s3);
+                    }
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void
+s3_accel_benchmark(void)
+{
+    static const char *const ops[] = { "fill", "SRCCOPY", "pattern", "text" };
+    s3_t                    *s3    = (s3_t *) calloc(1, sizeof(s3_t));
+    svga_t                  *svga  = &s3->svga;
+    monitor_t                mon;
+    char                     name[32];
+
+    svga->vram        = (uint8_t *) malloc(S3_BENCH_VRAM);
+    svga->changedvram = (uint8_t *) calloc(S3_BENCH_VRAM >> 12, 1);
+    if ((svga->vram == NULL) || (svga->changedvram == NULL)) {
+        free(svga->vram);
+        free(svga->changedvram);
+        free(s3);
+        return;
+    }
+
+    memset(&mon, 0, sizeof(monitor_t));
+    svga->monitor       = &mon;
+    svga->packed_chain4 = 1;
+    s3->chip            = S3_TRIO64;
+    s3->vram_mask       = S3_BENCH_VRAM - 1;
+    s3->width           = 1024;
+
+    s3->accel.multifunc[3] = 767;
+    s3->accel.multifunc[4] = 1023;
+    s3->accel.rd_mask      = 0xffffffff;
+    s3->accel.wrt_mask     = 0xffffffff;
+
+    pclog("S3 Trio64 blitter:\n");
+    for (s3->bpp = 0; s3->bpp <= 3; s3->bpp++) {
+        if (s3->bpp == 2)
+            continue;
+
+        svga->bpp = (s3->bpp == 0) ? 8 : ((s3->bpp == 1) ? 16 : 32);
+        for (int op = 0; op < 4; op++) {
+            snprintf(name, sizeof(name), "%2dbpp %s", svga->bpp, ops[op]);
+            accel_span_bench_blit(name, s3_accel_bench_blit, s3, op, svga->vram, S3_BENCH_VRAM,
+                                  (op == 3) ? (64 * 24 * 8 * 16) : (512 * 384));
+        }
+    }
+
+    free(svga->vram);
+    free(svga->changedvram);
+    free(s3);
+}
+
 static uint8_t
 s3_pci_read(UNUSED(int func), int addr, void *priv)
 {
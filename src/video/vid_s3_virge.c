@@ -40,6 +40,14 @@
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
 
+#if defined __amd64__ || defined _M_X64
+#    include <emmintrin.h>
+#    define USE_SSE2_SPANS
+#elif defined __aarch64__ || defined _M_ARM64
+#    include <arm_neon.h>
+#    define USE_NEON_SPANS
+#endif
+
 #ifdef MIN
     #undef MIN
 #endif
@@ -74,9 +82,11 @@ static int dither[4][4] = {
 #define RB_SIZE 256
 #define RB_MASK (RB_SIZE - 1)
 
-#define RB_ENTRIES (virge->s3d_write_idx - virge->s3d_read_idx)
-#define RB_FULL (RB_ENTRIES == RB_SIZE)
-#define RB_EMPTY (!RB_ENTRIES)
+#define RB_ENTRIES(c) (virge->s3d_write_idx - virge->s3d_read_idx[c])
+#define RB_FULL(c) (RB_ENTRIES(c) == RB_SIZE)
+#define RB_EMPTY(c) (!RB_ENTRIES(c))
+
+#define VIRGE_MAX_RENDER_THREADS 8
 
 #define FIFO_SIZE 65536
 #define FIFO_MASK (FIFO_SIZE - 1)
@@ -218,13 +228,19 @@ typedef struct virge_t {
     int dithering_enabled;
     int memory_size;
 
-    int pixel_count;
     int tri_count;
 
-    thread_t *render_thread;
-    event_t  *wake_render_thread;
+    int render_threads;
+
+    struct virge_render_param_t {
+        struct virge_t *virge;
+        int             index;
+    } render_param[VIRGE_MAX_RENDER_THREADS];
+
+    thread_t *render_thread[VIRGE_MAX_RENDER_THREADS];
+    event_t  *wake_render_thread[VIRGE_MAX_RENDER_THREADS];
     event_t  *wake_main_thread;
-    event_t  *not_full_event;
+    event_t  *not_full_event[VIRGE_MAX_RENDER_THREADS];
 
     uint32_t hwc_fg_col;
     uint32_t hwc_bg_col;
@@ -290,9 +306,18 @@ typedef struct virge_t {
     s3d_t s3d_tri;
 
     s3d_t      s3d_buffer[RB_SIZE];
-    atomic_int s3d_read_idx;
+    atomic_int s3d_read_idx[VIRGE_MAX_RENDER_THREADS];
     atomic_int s3d_write_idx;
-    atomic_int s3d_busy;
+    atomic_int s3d_busy[VIRGE_MAX_RENDER_THREADS];
+
+    /* Surfaces the render threads were last drained for */
+    uint32_t s3d_sync_dest_base;
+    uint32_t s3d_sync_dest_str;
+    uint32_t s3d_sync_z_base;
+    uint32_t s3d_sync_z_str;
+
+    mutex_t *s3d_done_mutex;
+    int      s3d_done_idx; /* Write index the last S3D done interrupt was raised for */
 
     struct {
         uint32_t pri_ctrl;
@@ -391,6 +416,46 @@ wake_fifo_thread(virge_t *virge)
     thread_set_event(virge->wake_fifo_thread);
 }
 
+static __inline int
+s3_virge_render_thread_idle(virge_t *virge, int c)
+{
+    return RB_EMPTY(c) && !virge->s3d_busy[c];
+}
+
+static __inline int
+s3_virge_render_threads_idle(virge_t *virge)
+{
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (!s3_virge_render_thread_idle(virge, c))
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Have all the threads drawn every triangle queued before write_idx? */
+static __inline int
+s3_virge_render_threads_done(virge_t *virge, int write_idx)
+{
+    for (int c = 0; c < virge->render_threads; c++) {
+        if ((virge->s3d_read_idx[c] != write_idx) || virge->s3d_busy[c])
+            return 0;
+    }
+
+    return 1;
+}
+
+static __inline int
+s3_virge_render_threads_busy(virge_t *virge)
+{
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (virge->s3d_busy[c])
+            return 1;
+    }
+
+    return 0;
+}
+
 static virge_t *reset_state = NULL;
 
 static video_timings_t timing_diamond_stealth3d_2000_pci = { .type = VIDEO_PCI, .write_b = 2, .write_w = 2, .write_l = 3, .read_b = 28, .read_w = 28, .read_l = 45 };
@@ -1199,7 +1264,7 @@ s3_virge_mmio_read(uint32_t addr, void *priv)
             return ret;
         case 0x8505:
             ret = 0xc0;
-            if (virge->s3d_busy || virge->virge_busy || !FIFO_EMPTY)
+            if (s3_virge_render_threads_busy(virge) || virge->virge_busy || !FIFO_EMPTY)
                 ret |= 0x10;
             else
                 ret |= 0x30;
@@ -1244,7 +1309,7 @@ s3_virge_mmio_read_w(uint32_t addr, void *priv)
     switch (addr & 0xfffe) {
         case 0x8504:
             ret = 0xc000;
-            if (virge->s3d_busy || virge->virge_busy || !FIFO_EMPTY)
+            if (s3_virge_render_threads_busy(virge) || virge->virge_busy || !FIFO_EMPTY)
                 ret |= 0x1000;
             else
                 ret |= 0x3000;
@@ -1344,7 +1409,7 @@ s3_virge_mmio_read_l(uint32_t addr, void *priv)
 
         case 0x8504:
             ret = 0x0000c000;
-            if (virge->s3d_busy || virge->virge_busy || !FIFO_EMPTY)
+            if (s3_virge_render_threads_busy(virge) || virge->virge_busy || !FIFO_EMPTY)
                 ret |= 0x00001000;
             else
                 ret |= 0x00003000;
@@ -3411,18 +3476,18 @@ skip_line:
         g = (val & 0xff00) >> 8;   \
         r = (val & 0xff0000) >> 16
 
-#define RGB15(r, g, b, dest)                        \
-        if (virge->dithering_enabled) {             \
-                int add = dither[_y & 3][_x & 3];   \
-                int _r = (r > 248) ? 248 : r + add; \
-                int _g = (g > 248) ? 248 : g + add; \
-                int _b = (b > 248) ? 248 : b + add; \
-                dest = ((_b >> 3) & 0x1f) |         \
-                       (((_g >> 3) & 0x1f) << 5) |  \
-                       (((_r >> 3) & 0x1f) << 10);  \
-        } else                                      \
-                dest = ((b >> 3) & 0x1f) |          \
-                       (((g >> 3) & 0x1f) << 5) |   \
+#define RGB15(r, g, b, dest)                            \
+        if (virge->dithering_enabled) {                 \
+                int add = dither[state->y & 3][x & 3];  \
+                int _r = (r > 248) ? 248 : r + add;     \
+                int _g = (g > 248) ? 248 : g + add;     \
+                int _b = (b > 248) ? 248 : b + add;     \
+                dest = ((_b >> 3) & 0x1f) |             \
+                       (((_g >> 3) & 0x1f) << 5) |      \
+                       (((_r >> 3) & 0x1f) << 10);      \
+        } else                                          \
+                dest = ((b >> 3) & 0x1f) |              \
+                       (((g >> 3) & 0x1f) << 5) |       \
                        (((r >> 3) & 0x1f) << 10)
 
 #define RGB24(r, g, b) ((b) | ((g) << 8) | ((r) << 16))
@@ -3434,6 +3499,14 @@ typedef struct rgba_t {
     int a;
 } rgba_t;
 
+typedef struct s3d_texture_state_t {
+    int level;
+    int texture_shift;
+
+    int32_t u;
+    int32_t v;
+} s3d_texture_state_t;
+
 typedef struct s3d_state_t {
     int32_t r;
     int32_t g;
@@ -3471,26 +3544,22 @@ typedef struct s3d_state_t {
     int y;
 
     rgba_t dest_rgba;
-} s3d_state_t;
 
-typedef struct s3d_texture_state_t {
-    int level;
-    int texture_shift;
+    /* Picked per triangle; kept here rather than in globals so that each
+       render thread can be on a different triangle. */
+    void (*tex_read)(struct s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out);
+    void (*tex_sample)(struct s3d_state_t *state);
+    void (*dest_pixel)(struct s3d_state_t *state);
 
-    int32_t u;
-    int32_t v;
-} s3d_texture_state_t;
+    int thread;
+    int span_gouraud;
+    int span_modulate;
+} s3d_state_t;
 
-static void (*tex_read)(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out);
-static void (*tex_sample)(s3d_state_t *state);
-static void (*dest_pixel)(s3d_state_t *state);
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-static int _x;
-static int _y;
-
 static void
 tex_ARGB1555(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
 {
@@ -3588,7 +3657,7 @@ tex_sample_normal(s3d_state_t *state)
     texture_state.u             = state->u + state->tbu;
     texture_state.v             = state->v + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3607,21 +3676,21 @@ tex_sample_normal_filter(s3d_state_t *state)
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3650,7 +3719,7 @@ tex_sample_mipmap(s3d_state_t *state)
     texture_state.u             = state->u + state->tbu;
     texture_state.v             = state->v + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3671,21 +3740,21 @@ tex_sample_mipmap_filter(s3d_state_t *state)
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3716,7 +3785,7 @@ tex_sample_persp_normal(s3d_state_t *state)
     texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
     texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3744,21 +3813,21 @@ tex_sample_persp_normal_filter(s3d_state_t *state)
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3789,7 +3858,7 @@ tex_sample_persp_normal_375(s3d_state_t *state)
     texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
     texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3817,21 +3886,21 @@ tex_sample_persp_normal_filter_375(s3d_state_t *state)
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3864,7 +3933,7 @@ tex_sample_persp_mipmap(s3d_state_t *state)
     texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
     texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3894,21 +3963,21 @@ tex_sample_persp_mipmap_filter(s3d_state_t *state)
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3941,7 +4010,7 @@ tex_sample_persp_mipmap_375(s3d_state_t *state)
     texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
     texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3971,21 +4040,21 @@ tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -4053,7 +4122,7 @@ dest_pixel_gouraud_shaded_triangle(s3d_state_t *state)
 static void
 dest_pixel_unlit_texture_triangle(s3d_state_t *state)
 {
-    tex_sample(state);
+    state->tex_sample(state);
 
     if (state->cmd_set & CMD_SET_ABC_SRC)
         state->dest_rgba.a = state->a >> 7;
@@ -4062,7 +4131,7 @@ dest_pixel_unlit_texture_triangle(s3d_state_t *state)
 static void
 dest_pixel_lit_texture_decal(s3d_state_t *state)
 {
-    tex_sample(state);
+    state->tex_sample(state);
 
     if (state->cmd_set & CMD_SET_ABC_SRC)
         state->dest_rgba.a = state->a >> 7;
@@ -4071,7 +4140,7 @@ dest_pixel_lit_texture_decal(s3d_state_t *state)
 static void
 dest_pixel_lit_texture_reflection(s3d_state_t *state)
 {
-    tex_sample(state);
+    state->tex_sample(state);
 
     state->dest_rgba.r += (state->r >> 7);
     state->dest_rgba.g += (state->g >> 7);
@@ -4090,7 +4159,7 @@ dest_pixel_lit_texture_modulate(s3d_state_t *state)
     int b = state->b >> 7;
     int a = state->a >> 7;
 
-    tex_sample(state);
+    state->tex_sample(state);
 
     CLAMP_RGBA(r, g, b, a);
 
@@ -4102,6 +4171,304 @@ dest_pixel_lit_texture_modulate(s3d_state_t *state)
         state->dest_rgba.a = a;
 }
 
+/* Gouraud spans without fog or alpha blending only depend on the position
+   along the span, so their colours are worked out a batch at a time ahead
+   of the Z test and the VRAM writes. Texture modulated spans go the same
+   way once their texels have been sampled for the batch. */
+#define SPAN_BATCH 64
+
+typedef struct s3d_span_t {
+    int32_t         r;
+    int32_t         g;
+    int32_t         b;
+    int32_t         dr;
+    int32_t         dg;
+    int32_t         db;
+    int             x;
+    int             x_dir;
+    const int      *dither;
+    int             rgb24;
+    const uint32_t *tex; /* Texels to modulate by, as RGB24, or NULL */
+} s3d_span_t;
+
+static void
+gouraud_span(uint32_t *out, int count, const s3d_span_t *span)
+{
+    int i = 0;
+
+#if defined USE_SSE2_SPANS
+    if (count >= 8) {
+        const __m128i zero     = _mm_setzero_si128();
+        const __m128i max      = _mm_set1_epi16(0xff);
+        const __m128i tex_mask = _mm_set1_epi32(0xff);
+        __m128i       dv       = zero;
+        __m128i       r[2];
+        __m128i       g[2];
+        __m128i       b[2];
+        __m128i       r_step = _mm_set1_epi32((uint32_t) span->dr * 8);
+        __m128i       g_step = _mm_set1_epi32((uint32_t) span->dg * 8);
+        __m128i       b_step = _mm_set1_epi32((uint32_t) span->db * 8);
+
+        for (int c = 0; c < 2; c++) {
+            uint32_t o = c * 4;
+
+            r[c] = _mm_setr_epi32(span->r + span->dr * o, span->r + span->dr * (o + 1),
+                                  span->r + span->dr * (o + 2), span->r + span->dr * (o + 3));
+            g[c] = _mm_setr_epi32(span->g + span->dg * o, span->g + span->dg * (o + 1),
+                                  span->g + span->dg * (o + 2), span->g + span->dg * (o + 3));
+            b[c] = _mm_setr_epi32(span->b + span->db * o, span->b + span->db * (o + 1),
+                                  span->b + span->db * (o + 2), span->b + span->db * (o + 3));
+        }
+        if (span->dither) {
+            int16_t d[8];
+
+            for (int c = 0; c < 8; c++)
+                d[c] = span->dither[(span->x + c * span->x_dir) & 3];
+            dv = _mm_loadu_si128((const __m128i *) d);
+        }
+
+        for (; i <= (count - 8); i += 8) {
+            __m128i rv = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(_mm_srai_epi32(r[0], 7), _mm_srai_epi32(r[1], 7)), zero), max);
+            __m128i gv = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(_mm_srai_epi32(g[0], 7), _mm_srai_epi32(g[1], 7)), zero), max);
+            __m128i bv = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(_mm_srai_epi32(b[0], 7), _mm_srai_epi32(b[1], 7)), zero), max);
+
+            if (span->tex) {
+                __m128i t0 = _mm_loadu_si128((const __m128i *) &span->tex[i]);
+                __m128i t1 = _mm_loadu_si128((const __m128i *) &span->tex[i + 4]);
+                __m128i tr = _mm_packs_epi32(_mm_srli_epi32(t0, 16), _mm_srli_epi32(t1, 16));
+                __m128i tg = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(t0, 8), tex_mask), _mm_and_si128(_mm_srli_epi32(t1, 8), tex_mask));
+                __m128i tb = _mm_packs_epi32(_mm_and_si128(t0, tex_mask), _mm_and_si128(t1, tex_mask));
+
+                rv = _mm_srli_epi16(_mm_mullo_epi16(rv, tr), 8);
+                gv = _mm_srli_epi16(_mm_mullo_epi16(gv, tg), 8);
+                bv = _mm_srli_epi16(_mm_mullo_epi16(bv, tb), 8);
+            }
+
+            if (span->rgb24) {
+                __m128i gb = _mm_or_si128(bv, _mm_slli_epi16(gv, 8));
+
+                _mm_storeu_si128((__m128i *) &out[i], _mm_unpacklo_epi16(gb, rv));
+                _mm_storeu_si128((__m128i *) &out[i + 4], _mm_unpackhi_epi16(gb, rv));
+            } else {
+                __m128i col;
+
+                /* Clamping after the dither gives the same top 5 bits as
+                   the check against 248 in RGB15(). */
+                rv  = _mm_min_epi16(_mm_add_epi16(rv, dv), max);
+                gv  = _mm_min_epi16(_mm_add_epi16(gv, dv), max);
+                bv  = _mm_min_epi16(_mm_add_epi16(bv, dv), max);
+                col = _mm_or_si128(_mm_or_si128(_mm_srli_epi16(bv, 3),
+                                                _mm_slli_epi16(_mm_srli_epi16(gv, 3), 5)),
+                                   _mm_slli_epi16(_mm_srli_epi16(rv, 3), 10));
+                _mm_storeu_si128((__m128i *) &out[i], _mm_unpacklo_epi16(col, zero));
+                _mm_storeu_si128((__m128i *) &out[i + 4], _mm_unpackhi_epi16(col, zero));
+            }
+
+            for (int c = 0; c < 2; c++) {
+                r[c] = _mm_add_epi32(r[c], r_step);
+                g[c] = _mm_add_epi32(g[c], g_step);
+                b[c] = _mm_add_epi32(b[c], b_step);
+            }
+        }
+    }
+#elif defined USE_NEON_SPANS
+    if (count >= 8) {
+        const int16x8_t  zero     = vdupq_n_s16(0);
+        const int16x8_t  max      = vdupq_n_s16(0xff);
+        const uint32x4_t tex_mask = vdupq_n_u32(0xff);
+        int16x8_t        dv       = zero;
+        int32x4_t        r[2];
+        int32x4_t        g[2];
+        int32x4_t        b[2];
+        int32x4_t        r_step = vdupq_n_s32((int32_t) ((uint32_t) span->dr * 8));
+        int32x4_t        g_step = vdupq_n_s32((int32_t) ((uint32_t) span->dg * 8));
+        int32x4_t        b_step = vdupq_n_s32((int32_t) ((uint32_t) span->db * 8));
+
+        for (int c = 0; c < 2; c++) {
+            int32_t rr[4];
+            int32_t gg[4];
+            int32_t bb[4];
+
+            for (uint32_t o = 0; o < 4; o++) {
+                rr[o] = (int32_t) ((uint32_t) span->r + (uint32_t) span->dr * (c * 4 + o));
+                gg[o] = (int32_t) ((uint32_t) span->g + (uint32_t) span->dg * (c * 4 + o));
+                bb[o] = (int32_t) ((uint32_t) span->b + (uint32_t) span->db * (c * 4 + o));
+            }
+            r[c] = vld1q_s32(rr);
+            g[c] = vld1q_s32(gg);
+            b[c] = vld1q_s32(bb);
+        }
+        if (span->dither) {
+            int16_t d[8];
+
+            for (int c = 0; c < 8; c++)
+                d[c] = span->dither[(span->x + c * span->x_dir) & 3];
+            dv = vld1q_s16(d);
+        }
+
+        for (; i <= (count - 8); i += 8) {
+            int16x8_t rv = vminq_s16(vmaxq_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(r[0], 7)), vqmovn_s32(vshrq_n_s32(r[1], 7))), zero), max);
+            int16x8_t gv = vminq_s16(vmaxq_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(g[0], 7)), vqmovn_s32(vshrq_n_s32(g[1], 7))), zero), max);
+            int16x8_t bv = vminq_s16(vmaxq_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(b[0], 7)), vqmovn_s32(vshrq_n_s32(b[1], 7))), zero), max);
+
+            if (span->tex) {
+                uint32x4_t t0 = vld1q_u32(&span->tex[i]);
+                uint32x4_t t1 = vld1q_u32(&span->tex[i + 4]);
+                uint16x8_t tr = vcombine_u16(vmovn_u32(vshrq_n_u32(t0, 16)), vmovn_u32(vshrq_n_u32(t1, 16)));
+                uint16x8_t tg = vcombine_u16(vmovn_u32(vandq_u32(vshrq_n_u32(t0, 8), tex_mask)), vmovn_u32(vandq_u32(vshrq_n_u32(t1, 8), tex_mask)));
+                uint16x8_t tb = vcombine_u16(vmovn_u32(vandq_u32(t0, tex_mask)), vmovn_u32(vandq_u32(t1, tex_mask)));
+
+                rv = vreinterpretq_s16_u16(vshrq_n_u16(vmulq_u16(vreinterpretq_u16_s16(rv), tr), 8));
+                gv = vreinterpretq_s16_u16(vshrq_n_u16(vmulq_u16(vreinterpretq_u16_s16(gv), tg), 8));
+                bv = vreinterpretq_s16_u16(vshrq_n_u16(vmulq_u16(vreinterpretq_u16_s16(bv), tb), 8));
+            }
+
+            if (span->rgb24) {
+                uint16x8x2_t col = vzipq_u16(vorrq_u16(vreinterpretq_u16_s16(bv), vshlq_n_u16(vreinterpretq_u16_s16(gv), 8)),
+                                             vreinterpretq_u16_s16(rv));
+
+                vst1q_u32(&out[i], vreinterpretq_u32_u16(col.val[0]));
+                vst1q_u32(&out[i + 4], vreinterpretq_u32_u16(col.val[1]));
+            } else {
+                uint16x8_t col;
+
+                rv  = vminq_s16(vaddq_s16(rv, dv), max);
+                gv  = vminq_s16(vaddq_s16(gv, dv), max);
+                bv  = vminq_s16(vaddq_s16(bv, dv), max);
+                col = vorrq_u16(vorrq_u16(vshrq_n_u16(vreinterpretq_u16_s16(bv), 3),
+                                          vshlq_n_u16(vshrq_n_u16(vreinterpretq_u16_s16(gv), 3), 5)),
+                                vshlq_n_u16(vshrq_n_u16(vreinterpretq_u16_s16(rv), 3), 10));
+                vst1q_u32(&out[i], vmovl_u16(vget_low_u16(col)));
+                vst1q_u32(&out[i + 4], vmovl_u16(vget_high_u16(col)));
+            }
+
+            for (int c = 0; c < 2; c++) {
+                r[c] = vaddq_s32(r[c], r_step);
+                g[c] = vaddq_s32(g[c], g_step);
+                b[c] = vaddq_s32(b[c], b_step);
+            }
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        int r = (int32_t) ((uint32_t) span->r + (uint32_t) span->dr * i) >> 7;
+        int g = (int32_t) ((uint32_t) span->g + (uint32_t) span->dg * i) >> 7;
+        int b = (int32_t) ((uint32_t) span->b + (uint32_t) span->db * i) >> 7;
+
+        CLAMP(r);
+        CLAMP(g);
+        CLAMP(b);
+
+        if (span->tex) {
+            r = (((span->tex[i] >> 16) & 0xff) * r) >> 8;
+            g = (((span->tex[i] >> 8) & 0xff) * g) >> 8;
+            b = ((span->tex[i] & 0xff) * b) >> 8;
+        }
+
+        if (span->rgb24)
+            out[i] = RGB24(r, g, b);
+        else {
+            int add = span->dither ? span->dither[(span->x + i * span->x_dir) & 3] : 0;
+
+            r = (r > 248) ? 248 : r + add;
+            g = (g > 248) ? 248 : g + add;
+            b = (b > 248) ? 248 : b + add;
+            out[i] = (b >> 3) | ((g >> 3) << 5) | ((r >> 3) << 10);
+        }
+    }
+}
+
+static void
+tri_span_gouraud(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int x, int xe, int x_dir,
+                 uint32_t dest_addr, uint32_t z_addr, uint32_t z)
+{
+    uint8_t   *vram     = virge->svga.vram;
+    int        use_z    = !(s3d_tri->cmd_set & CMD_SET_ZB_MODE);
+    int        bpp      = (s3d_tri->cmd_set >> 2) & 7;
+    int        x_offset = x_dir * (bpp + 1);
+    int        count    = ((xe - x) * x_dir) & 0xfff;
+    uint32_t   col[SPAN_BATCH];
+    uint32_t   tex[SPAN_BATCH];
+    s3d_span_t span;
+
+    span.r      = state->r;
+    span.g      = state->g;
+    span.b      = state->b;
+    span.dr     = s3d_tri->TdRdX;
+    span.dg     = s3d_tri->TdGdX;
+    span.db     = s3d_tri->TdBdX;
+    span.x      = x;
+    span.x_dir  = x_dir;
+    span.dither = virge->dithering_enabled ? dither[state->y & 3] : NULL;
+    span.rgb24  = (bpp == 2);
+    span.tex    = state->span_modulate ? tex : NULL;
+
+    while (count > 0) {
+        int n = MIN(count, SPAN_BATCH);
+
+        /*Sampling has no side effects, so texels behind the Z buffer can be read too*/
+        if (state->span_modulate) {
+            for (int i = 0; i < n; i++) {
+                state->tex_sample(state);
+                tex[i] = RGB24(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b);
+
+                state->u += s3d_tri->TdUdX;
+                state->v += s3d_tri->TdVdX;
+                state->d += s3d_tri->TdDdX;
+                state->w += s3d_tri->TdWdX;
+            }
+        }
+
+        gouraud_span(col, n, &span);
+
+        for (int i = 0; i < n; i++) {
+            int      update = 1;
+            uint16_t src_z  = 0;
+
+            if (use_z) {
+                src_z = Z_READ(z_addr);
+                Z_CLIP(src_z, z >> 16);
+            }
+
+            if (update) {
+                if (bpp == 1)
+                    *(uint16_t *) &vram[dest_addr] = col[i];
+                else {
+                    *(uint8_t *) &vram[dest_addr]     = col[i] & 0xff;
+                    *(uint8_t *) &vram[dest_addr + 1] = (col[i] >> 8) & 0xff;
+                    *(uint8_t *) &vram[dest_addr + 2] = (col[i] >> 16) & 0xff;
+                }
+
+                if (use_z && (s3d_tri->cmd_set & CMD_SET_ZUP))
+                    Z_WRITE(z_addr, src_z);
+            }
+
+            z += s3d_tri->TdZdX;
+            dest_addr += x_offset;
+            z_addr += x_dir << 1;
+        }
+
+        span.r = (int32_t) ((uint32_t) span.r + (uint32_t) span.dr * n);
+        span.g = (int32_t) ((uint32_t) span.g + (uint32_t) span.dg * n);
+        span.b = (int32_t) ((uint32_t) span.b + (uint32_t) span.db * n);
+        span.x = (span.x + (n * x_dir)) & 0xfff;
+        count -= n;
+    }
+}
+
+/* Scanlines are dealt out to the render threads round-robin. Every thread
+   sees every triangle in order, so each pixel is always drawn by the same
+   thread and Z and blending come out as they would with just one. */
+static __inline int
+s3_virge_line_owned(virge_t *virge, s3d_state_t *state)
+{
+    if (virge->render_threads == 1)
+        return 1;
+
+    return ((unsigned int) state->y % (unsigned int) virge->render_threads) == (unsigned int) state->thread;
+}
+
 static void
 tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2)
 {
@@ -4155,7 +4522,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
             xe--;
         }
 
-        if (x != xe && ((x_dir > 0 && x < xe) || (x_dir < 0 && x > xe))) {
+        if (s3_virge_line_owned(virge, state) && x != xe && ((x_dir > 0 && x < xe) || (x_dir < 0 && x > xe))) {
             uint32_t dest_addr;
             uint32_t z_addr;
             int      dx        = (x_dir > 0) ? ((31 - ((state->x1 - 1) >> 15)) & 0x1f) : (((state->x1 - 1) >> 15) & 0x1f);
@@ -4231,13 +4598,15 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
             x &= 0xfff;
             xe &= 0xfff;
 
+            if (state->span_gouraud || state->span_modulate) {
+                tri_span_gouraud(virge, s3d_tri, state, x, xe, x_dir, dest_addr, z_addr, z);
+                goto tri_skip_line;
+            }
+
             for (; x != xe; x = (x + x_dir) & 0xfff) {
                 int      update = 1;
                 uint16_t src_z  = 0;
 
-                _x = x;
-                _y = state->y;
-
                 if (use_z) {
                     src_z = Z_READ(z_addr);
                     Z_CLIP(src_z, z >> 16);
@@ -4246,7 +4615,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 if (update) {
                     uint32_t dest_col;
 
-                    dest_pixel(state);
+                    state->dest_pixel(state);
 
                     if (s3d_tri->cmd_set & CMD_SET_FE) {
                         int a              = state->a >> 7;
@@ -4311,7 +4680,6 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 state->w += s3d_tri->TdWdX;
                 dest_addr += x_offset;
                 z_addr += xz_offset;
-                virge->pixel_count++;
             }
         }
 
@@ -4333,19 +4701,34 @@ tri_skip_line:
     }
 }
 
+/* Does the triangle read its texture from the surface it draws to? */
+static int
+s3_virge_tex_in_dest(virge_t *virge, const s3d_t *s3d_tri)
+{
+    uint32_t dest_end;
+
+    /*Gouraud shaded triangles don't read the texture*/
+    if (!((s3d_tri->cmd_set >> 27) & 0xf))
+        return 0;
+
+    if (s3d_tri->cmd_set & CMD_SET_HC)
+        dest_end = s3d_tri->dest_base + (s3d_tri->dest_str * (s3d_tri->clip_b + 1));
+    else
+        dest_end = virge->vram_mask + 1;
+
+    return (s3d_tri->tex_base >= s3d_tri->dest_base) && (s3d_tri->tex_base < dest_end);
+}
+
 static int tex_size[8] = { 4 * 2, 2 * 2, 2 * 2, 1 * 2, 2 / 1, 2 / 1, 1 * 2, 1 * 2 };
 
 static void
-s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
+s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri, int thread)
 {
     s3d_state_t state;
 
     uint32_t tex_base;
     int      c;
 
-    uint64_t start_time = plat_timer_read();
-    uint64_t end_time;
-
     state.tbu = s3d_tri->tbu << 11;
     state.tbv = s3d_tri->tbv << 11;
 
@@ -4355,6 +4738,10 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
 
     state.cmd_set = s3d_tri->cmd_set;
 
+    state.thread        = thread;
+    state.span_gouraud  = 0;
+    state.span_modulate = 0;
+
     state.base_u = s3d_tri->tus;
     state.base_v = s3d_tri->tvs;
     state.base_z = s3d_tri->tzs;
@@ -4374,19 +4761,26 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
 
     switch ((s3d_tri->cmd_set >> 27) & 0xf) {
         case 0:
-            dest_pixel = dest_pixel_gouraud_shaded_triangle;
+            state.dest_pixel   = dest_pixel_gouraud_shaded_triangle;
+            state.span_gouraud = !(s3d_tri->cmd_set & (CMD_SET_FE | CMD_SET_ABC_ENABLE)) &&
+                                 ((((s3d_tri->cmd_set >> 2) & 7) == 1) || (((s3d_tri->cmd_set >> 2) & 7) == 2));
             break;
         case 1:
         case 5:
             switch ((s3d_tri->cmd_set >> 15) & 0x3) {
                 case 0:
-                    dest_pixel = dest_pixel_lit_texture_reflection;
+                    state.dest_pixel = dest_pixel_lit_texture_reflection;
                     break;
                 case 1:
-                    dest_pixel = dest_pixel_lit_texture_modulate;
+                    state.dest_pixel    = dest_pixel_lit_texture_modulate;
+                    /* Spans sample their texels ahead of the writes, which
+                       would see stale texels when drawing onto the texture. */
+                    state.span_modulate = !(s3d_tri->cmd_set & (CMD_SET_FE | CMD_SET_ABC_ENABLE)) &&
+                                          ((((s3d_tri->cmd_set >> 2) & 7) == 1) || (((s3d_tri->cmd_set >> 2) & 7) == 2)) &&
+                                          !s3_virge_tex_in_dest(virge, s3d_tri);
                     break;
                 case 2:
-                    dest_pixel = dest_pixel_lit_texture_decal;
+                    state.dest_pixel = dest_pixel_lit_texture_decal;
                     break;
                 default:
                     return;
@@ -4394,7 +4788,7 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
             break;
         case 2:
         case 6:
-            dest_pixel = dest_pixel_unlit_texture_triangle;
+            state.dest_pixel = dest_pixel_unlit_texture_triangle;
             break;
         default:
             return;
@@ -4403,66 +4797,66 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
     switch (((s3d_tri->cmd_set >> 12) & 7) | ((s3d_tri->cmd_set & (1 << 29)) ? 8 : 0)) {
         case 0:
         case 1:
-            tex_sample = tex_sample_mipmap;
+            state.tex_sample = tex_sample_mipmap;
             break;
         case 2:
         case 3:
-            tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
+            state.tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
             break;
         case 4:
         case 5:
-            tex_sample = tex_sample_normal;
+            state.tex_sample = tex_sample_normal;
             break;
         case 6:
         case 7:
-            tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
+            state.tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
             break;
         case (0 | 8):
         case (1 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_mipmap_375;
+                state.tex_sample = tex_sample_persp_mipmap_375;
             else
-                tex_sample = tex_sample_persp_mipmap;
+                state.tex_sample = tex_sample_persp_mipmap;
             break;
         case (2 | 8):
         case (3 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 :
-                                                       tex_sample_persp_mipmap_375;
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 :
+                                                             tex_sample_persp_mipmap_375;
             else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter :
-                                                       tex_sample_persp_mipmap;
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter :
+                                                             tex_sample_persp_mipmap;
             break;
         case (4 | 8):
         case (5 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_normal_375;
+                state.tex_sample = tex_sample_persp_normal_375;
             else
-                tex_sample = tex_sample_persp_normal;
+                state.tex_sample = tex_sample_persp_normal;
             break;
         case (6 | 8):
         case (7 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 :
-                                                       tex_sample_persp_normal_375;
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 :
+                                                             tex_sample_persp_normal_375;
             else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter :
-                                                       tex_sample_persp_normal;
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter :
+                                                             tex_sample_persp_normal;
             break;
     }
 
     switch ((s3d_tri->cmd_set >> 5) & 7) {
         case 0:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
             break;
         case 1:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
             break;
         case 2:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
             break;
         default:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
             break;
     }
 
@@ -4473,47 +4867,114 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
     state.x2 = s3d_tri->txend12;
     tri(virge, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
 
-    virge->tri_count++;
-
-    end_time = plat_timer_read();
-
-    virge_time += end_time - start_time;
+    if (!thread)
+        virge->tri_count++;
 }
 
 static void
 render_thread(void *param)
 {
-    virge_t *virge = (virge_t *) param;
+    struct virge_render_param_t *render_param = (struct virge_render_param_t *) param;
+    virge_t                     *virge        = render_param->virge;
+    int                          c            = render_param->index;
+    int                          write_idx;
 
     while (virge->render_thread_run) {
-        thread_wait_event(virge->wake_render_thread, -1);
-        thread_reset_event(virge->wake_render_thread);
-        virge->s3d_busy = 1;
-        while (!RB_EMPTY) {
-            s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx & RB_MASK]);
-            virge->s3d_read_idx++;
-
-            if (RB_ENTRIES == RB_MASK)
-                thread_set_event(virge->not_full_event);
+        thread_wait_event(virge->wake_render_thread[c], -1);
+        thread_reset_event(virge->wake_render_thread[c]);
+        virge->s3d_busy[c] = 1;
+        while (!RB_EMPTY(c)) {
+            s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx[c] & RB_MASK], c);
+            virge->s3d_read_idx[c]++;
+
+            if (RB_ENTRIES(c) == RB_MASK)
+                thread_set_event(virge->not_full_event[c]);
         }
-        virge->s3d_busy = 0;
-        virge->subsys_stat |= INT_S3D_DONE;
-        virge->irq_pending++;
+        virge->s3d_busy[c] = 0;
+        thread_set_event(virge->not_full_event[c]);
+
+        /* Only the last thread to run out of work raises the interrupt.
+           Threads can finish together and all see the others idle, so
+           it is raised once per write index the threads caught up with.
+           The FIFO thread can queue more at any time, so the index is
+           read once, checked against and recorded as the same value. */
+        thread_wait_mutex(virge->s3d_done_mutex);
+        write_idx = virge->s3d_write_idx;
+        if ((virge->s3d_done_idx != write_idx) && s3_virge_render_threads_done(virge, write_idx)) {
+            virge->s3d_done_idx = write_idx;
+            virge->subsys_stat |= INT_S3D_DONE;
+            virge->irq_pending++;
+        }
+        thread_release_mutex(virge->s3d_done_mutex);
     }
 }
 
+static void
+s3_virge_wake_render_threads(virge_t *virge)
+{
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (!virge->s3d_busy[c])
+            thread_set_event(virge->wake_render_thread[c]); /*Wake up render thread if moving from idle*/
+    }
+}
+
+static void
+s3_virge_wait_for_render_threads_idle(virge_t *virge)
+{
+    int busy;
+
+    do {
+        busy = 0;
+        for (int c = 0; c < virge->render_threads; c++) {
+            if (!s3_virge_render_thread_idle(virge, c)) {
+                if (!busy)
+                    s3_virge_wake_render_threads(virge);
+                busy = 1;
+                thread_wait_event(virge->not_full_event[c], 1);
+            }
+        }
+    } while (busy);
+}
+
+/* The threads only share scanlines through the texture, so a triangle
+   textured from a surface drawn earlier could get ahead of the rows
+   another thread still has to draw. The same goes for a destination or
+   Z buffer laid out differently, which can put one thread's rows on top
+   of another's. */
+static int
+s3_virge_render_threads_need_sync(virge_t *virge)
+{
+    const s3d_t *s3d_tri = &virge->s3d_tri;
+
+    if ((s3d_tri->dest_base != virge->s3d_sync_dest_base) || (s3d_tri->dest_str != virge->s3d_sync_dest_str) ||
+        (s3d_tri->z_base != virge->s3d_sync_z_base) || (s3d_tri->z_str != virge->s3d_sync_z_str))
+        return 1;
+
+    /*Textured from the surface being drawn, every triangle has to see the last one finished*/
+    return s3_virge_tex_in_dest(virge, s3d_tri);
+}
+
 static void
 queue_triangle(virge_t *virge)
 {
-    if (RB_FULL) {
-        thread_reset_event(virge->not_full_event);
-        if (RB_FULL)
-            thread_wait_event(virge->not_full_event, -1); /*Wait for room in ringbuffer*/
+    if ((virge->render_threads > 1) && s3_virge_render_threads_need_sync(virge)) {
+        s3_virge_wait_for_render_threads_idle(virge);
+        virge->s3d_sync_dest_base = virge->s3d_tri.dest_base;
+        virge->s3d_sync_dest_str  = virge->s3d_tri.dest_str;
+        virge->s3d_sync_z_base    = virge->s3d_tri.z_base;
+        virge->s3d_sync_z_str     = virge->s3d_tri.z_str;
+    }
+
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (RB_FULL(c)) {
+            thread_reset_event(virge->not_full_event[c]);
+            if (RB_FULL(c))
+                thread_wait_event(virge->not_full_event[c], -1); /*Wait for room in ringbuffer*/
+        }
     }
     virge->s3d_buffer[virge->s3d_write_idx & RB_MASK] = virge->s3d_tri;
     virge->s3d_write_idx++;
-    if (!virge->s3d_busy)
-        thread_set_event(virge->wake_render_thread); /*Wake up render thread if moving from idle*/
+    s3_virge_wake_render_threads(virge);
 }
 
 static void
@@ -5303,9 +5764,12 @@ s3_virge_reset(void *priv)
         dev->virge_busy       = 0;
         dev->fifo_write_idx   = 0;
         dev->fifo_read_idx    = 0;
-        dev->s3d_busy         = 0;
         dev->s3d_write_idx    = 0;
-        dev->s3d_read_idx     = 0;
+        dev->s3d_done_idx     = 0;
+        for (int c = 0; c < dev->render_threads; c++) {
+            dev->s3d_busy[c]     = 0;
+            dev->s3d_read_idx[c] = 0;
+        }
         reset_state->pci_slot = dev->pci_slot;
 
         *dev = *reset_state;
@@ -5323,6 +5787,11 @@ s3_virge_init(const device_t *info)
 
     virge->bilinear_enabled  = device_get_config_int("bilinear");
     virge->dithering_enabled = device_get_config_int("dithering");
+    virge->render_threads    = device_get_config_int("render_threads");
+    if (virge->render_threads < 1)
+        virge->render_threads = 1;
+    else if (virge->render_threads > VIRGE_MAX_RENDER_THREADS)
+        virge->render_threads = VIRGE_MAX_RENDER_THREADS;
     if (virge->type >= S3_VIRGE_GX2)
         virge->memory_size = 4;
     else
@@ -5555,11 +6024,17 @@ s3_virge_init(const device_t *info)
 
     virge->svga.force_old_addr = 1;
 
-    virge->render_thread_run  = 1;
-    virge->wake_render_thread = thread_create_event();
-    virge->wake_main_thread   = thread_create_event();
-    virge->not_full_event     = thread_create_event();
-    virge->render_thread      = thread_create(render_thread, virge);
+    virge->render_thread_run = 1;
+    virge->wake_main_thread  = thread_create_event();
+    virge->s3d_done_mutex    = thread_create_mutex();
+    for (int c = 0; c < virge->render_threads; c++) {
+        virge->render_param[c].virge = virge;
+        virge->render_param[c].index = c;
+        virge->wake_render_thread[c] = thread_create_event();
+        virge->not_full_event[c]     = thread_create_event();
+    }
+    for (int c = 0; c < virge->render_threads; c++)
+        virge->render_thread[c] = thread_create(render_thread, &virge->render_param[c]);
 
     virge->fifo_thread_run     = 1;
     virge->wake_fifo_thread    = thread_create_event();
@@ -5581,11 +6056,16 @@ s3_virge_close(void *priv)
     virge_t *virge = (virge_t *) priv;
 
     virge->render_thread_run = 0;
-    thread_set_event(virge->wake_render_thread);
-    thread_wait(virge->render_thread);
-    thread_destroy_event(virge->not_full_event);
+    for (int c = 0; c < virge->render_threads; c++) {
+        thread_set_event(virge->wake_render_thread[c]);
+        thread_wait(virge->render_thread[c]);
+    }
+    for (int c = 0; c < virge->render_threads; c++) {
+        thread_destroy_event(virge->not_full_event[c]);
+        thread_destroy_event(virge->wake_render_thread[c]);
+    }
     thread_destroy_event(virge->wake_main_thread);
-    thread_destroy_event(virge->wake_render_thread);
+    thread_close_mutex(virge->s3d_done_mutex);
 
     virge->fifo_thread_run = 0;
     thread_set_event(virge->wake_fifo_thread);
@@ -5733,6 +6213,22 @@ static const device_config_t s3_virge_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "4", .value = 4 },
+            { .description = "8", .value = 8 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5785,6 +6281,22 @@ static const device_config_t s3_virge_stb_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "4", .value = 4 },
+            { .description = "8", .value = 8 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5838,6 +6350,22 @@ static const device_config_t s3_virge_357_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "4", .value = 4 },
+            { .description = "8", .value = 8 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5892,6 +6420,23 @@ static const device_config_t s3_trio3d2x_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "4", .value = 4 },
+            { .description = "8", .value = 8 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
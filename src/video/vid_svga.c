@@ -41,6 +41,7 @@
 #include <86box/vid_xga.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_accel_span.h>
 #include <86box/vid_xga_device.h>
 
 void svga_doblit(int wx, int wy, svga_t *svga);
@@ -265,6 +266,7 @@ svga_out(uint16_t addr, uint8_t val, void *priv)
                     svga->overscan_color = svga->pallook[svga->attrregs[0x11]];
                     if (o != val) {
                         svga_log("ATTR11.\n");
+                        svga->fullchange = svga->monitor->mon_changeframecount;
                         svga_recalctimings(svga);
                     }
                 } else if (svga->attraddr == 0x12) {
@@ -1328,6 +1330,30 @@ svga_do_render(svga_t *svga)
     }
 }
 
+/* Pass the range of target buffer lines redrawn this frame on to the blitter,
+   so that frontends only need to copy what actually changed. */
+static void
+svga_set_dirty_lines(svga_t *svga)
+{
+    int y_add  = svga->vertical_linedbl ? (svga->y_add << 1) : svga->y_add;
+    int top    = 0;
+    int bottom = 0;
+
+    if (svga->firstline_draw != 2000) {
+        top    = svga->firstline_draw + y_add;
+        bottom = svga->lastline_draw + y_add + 1;
+
+        /* Cursors hanging off the top edge are drawn above the line that
+           triggered them. */
+        if (svga->hwcursor_latch.ena && (svga->hwcursor_latch.y < 0))
+            top += svga->hwcursor_latch.y;
+        if (svga->dac_hwcursor_latch.ena && (svga->dac_hwcursor_latch.y < 0))
+            top += svga->dac_hwcursor_latch.y;
+    }
+
+    video_blit_set_dirty_monitor(top, bottom, svga->monitor_index);
+}
+
 void
 svga_poll(void *priv)
 {
@@ -1522,6 +1548,11 @@ svga_poll(void *priv)
             wx = x;
 
             if (!svga->override) {
+                /* Only when svga_doblit() will actually blit, so the range
+                   cannot leak into another renderer's blit. */
+                if ((wx > 0) && (svga->lastline > svga->firstline))
+                    svga_set_dirty_lines(svga);
+
                 if (svga->vertical_linedbl) {
                     wy = (svga->lastline - svga->firstline) << 1;
                     svga->vdisp = wy + 1;
@@ -1628,6 +1659,9 @@ svga_init(const device_t *info, svga_t *svga, void *priv, int memsize,
 {
     int e;
 
+    svga_render_kernels_init();
+    accel_span_kernels_init();
+
     svga->priv          = priv;
     svga->monitor_index = monitor_index_global;
     svga->monitor       = &monitors[svga->monitor_index];
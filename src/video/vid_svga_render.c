@@ -42,6 +42,14 @@ svga_lookup_lut_ram(svga_t* svga, uint32_t val)
 
 #define lookup_lut(val) svga_lookup_lut_ram(svga, val)
 
+/* Whether a run of the given length starting at memaddr can go through the
+   pixel conversion kernels in one go, i.e. does not wrap around VRAM. */
+static inline int
+svga_render_run_fits(const svga_t *svga, uint32_t bytes)
+{
+    return ((svga->memaddr & svga->vram_display_mask) + bytes) <= (svga->vram_display_mask + 1);
+}
+
 void
 svga_render_null(svga_t *svga)
 {
@@ -1568,6 +1576,7 @@ svga_render_15bpp_highres(svga_t *svga)
     uint32_t  dat;
     uint32_t  changed_addr;
     uint32_t  addr;
+    int       count;
 
     if ((svga->displine + svga->y_add) < 0)
         return;
@@ -1610,7 +1619,12 @@ svga_render_15bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            count = ((svga->hdisp + svga->scrollcache) & ~7) + 8;
+
+            if (!svga->remap_required && (svga->conv_16to32 == svga_conv_16to32) && svga_render_run_fits(svga, count << 1)) {
+                svga_render_kernels->conv_15bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], count);
+                svga->memaddr += count << 1;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->memaddr + (x << 1)) & svga->vram_display_mask]);
                     *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
@@ -1800,6 +1814,7 @@ svga_render_16bpp_highres(svga_t *svga)
     uint32_t  dat;
     uint32_t  changed_addr;
     uint32_t  addr;
+    int       count;
 
     if ((svga->displine + svga->y_add) < 0)
         return;
@@ -1842,7 +1857,12 @@ svga_render_16bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            count = ((svga->hdisp + svga->scrollcache) & ~7) + 8;
+
+            if (!svga->remap_required && (svga->conv_16to32 == svga_conv_16to32) && svga_render_run_fits(svga, count << 1)) {
+                svga_render_kernels->conv_16bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], count);
+                svga->memaddr += count << 1;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->memaddr + (x << 1)) & svga->vram_display_mask]);
                     *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
@@ -1964,6 +1984,7 @@ svga_render_24bpp_highres(svga_t *svga)
     uint32_t  dat1;
     uint32_t  dat2;
     uint32_t  dat;
+    int       count;
 
     if ((svga->displine + svga->y_add) < 0)
         return;
@@ -2003,7 +2024,12 @@ svga_render_24bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            count = ((svga->hdisp + svga->scrollcache) & ~3) + 4;
+
+            if (!svga->remap_required && !svga->lut_map && svga_render_run_fits(svga, count * 3)) {
+                svga_render_kernels->conv_24bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], count);
+                svga->memaddr += count * 3;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 4) {
                     dat0 = *(uint32_t *) (&svga->vram[svga->memaddr & svga->vram_display_mask]);
                     dat1 = *(uint32_t *) (&svga->vram[(svga->memaddr + 4) & svga->vram_display_mask]);
@@ -2102,6 +2128,7 @@ svga_render_32bpp_highres(svga_t *svga)
     uint32_t  dat;
     uint32_t  changed_addr;
     uint32_t  addr;
+    int       count;
 
     if ((svga->displine + svga->y_add) < 0)
         return;
@@ -2131,7 +2158,12 @@ svga_render_32bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            count = svga->hdisp + svga->scrollcache + 1;
+
+            if (!svga->remap_required && !svga->lut_map && svga_render_run_fits(svga, count << 2)) {
+                svga_render_kernels->conv_32bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], count);
+                svga->memaddr += count << 2;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x++) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->memaddr + (x << 2)) & svga->vram_display_mask]);
                     *p++ = lookup_lut(dat & 0xffffff);
@@ -0,0 +1,487 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Vectorized pixel format conversion for the SVGA renderers.
+ *
+ *          The direct colour renderers spend most of their time turning
+ *          packed 15/16/24/32bpp VRAM into the 32bpp target buffer. These
+ *          kernels convert a contiguous run of pixels at a time; the best
+ *          variant for the host is picked once at startup, with plain C
+ *          as the fallback.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/plat.h>
+#include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_svga_render.h>
+
+#if defined __amd64__ || defined _M_X64
+#    include <emmintrin.h>
+#    define USE_SSE2_KERNELS
+#    if defined __GNUC__ || defined __clang__
+#        include <immintrin.h>
+#        define USE_AVX2_KERNELS
+#        define AVX2_TARGET __attribute__((target("avx2")))
+#    endif
+#elif defined __aarch64__ || defined _M_ARM64
+#    include <arm_neon.h>
+#    define USE_NEON_KERNELS
+#endif
+
+/* The 5 and 6-bit channels are expanded exactly like calc_15to32() and
+   calc_16to32() do, i.e. floor(c * 255 / 31) and floor(c * 255 / 63):
+   pre-shifting the channel and keeping the high half of a 16x16 multiply
+   by these constants gives the same result for every input. */
+#define CONV_MUL_5BIT   33693
+#define CONV_SHIFT_5BIT 4
+#define CONV_MUL_6BIT   33159
+#define CONV_SHIFT_6BIT 3
+
+#ifdef ENABLE_SVGA_RENDER_SIMD_LOG
+int svga_render_simd_do_log = ENABLE_SVGA_RENDER_SIMD_LOG;
+
+static void
+svga_render_simd_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (svga_render_simd_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define svga_render_simd_log(fmt, ...)
+#endif
+
+static void
+conv_15bpp_c(uint32_t *dst, const uint8_t *src, int count)
+{
+    const uint16_t *s = (const uint16_t *) src;
+
+    for (int i = 0; i < count; i++)
+        dst[i] = video_15to32[s[i]];
+}
+
+static void
+conv_16bpp_c(uint32_t *dst, const uint8_t *src, int count)
+{
+    const uint16_t *s = (const uint16_t *) src;
+
+    for (int i = 0; i < count; i++)
+        dst[i] = video_16to32[s[i]];
+}
+
+static void
+conv_24bpp_c(uint32_t *dst, const uint8_t *src, int count)
+{
+    for (int i = 0; i < count; i++, src += 3)
+        dst[i] = src[0] | (src[1] << 8) | (src[2] << 16);
+}
+
+static void
+conv_32bpp_c(uint32_t *dst, const uint8_t *src, int count)
+{
+    const uint32_t *s = (const uint32_t *) src;
+
+    for (int i = 0; i < count; i++)
+        dst[i] = s[i] & 0x00ffffff;
+}
+
+static const svga_render_kernels_t kernels_c = {
+    .name       = "C",
+    .conv_15bpp = conv_15bpp_c,
+    .conv_16bpp = conv_16bpp_c,
+    .conv_24bpp = conv_24bpp_c,
+    .conv_32bpp = conv_32bpp_c
+};
+
+#ifdef USE_SSE2_KERNELS
+/* Expands 8 pixels into their blue|green and red|alpha halves. */
+static inline void
+sse2_expand_16bpp(__m128i v, int bpp, __m128i *bg, __m128i *ra)
+{
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mul5  = _mm_set1_epi16((int16_t) CONV_MUL_5BIT);
+    __m128i       b;
+    __m128i       g;
+    __m128i       r;
+
+    b = _mm_mulhi_epu16(_mm_slli_epi16(_mm_and_si128(v, mask5), CONV_SHIFT_5BIT), mul5);
+    if (bpp == 15) {
+        g = _mm_mulhi_epu16(_mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(v, 5), mask5), CONV_SHIFT_5BIT), mul5);
+        r = _mm_mulhi_epu16(_mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(v, 10), mask5), CONV_SHIFT_5BIT), mul5);
+    } else {
+        g = _mm_mulhi_epu16(_mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(v, 5), _mm_set1_epi16(0x3f)), CONV_SHIFT_6BIT),
+                            _mm_set1_epi16((int16_t) CONV_MUL_6BIT));
+        r = _mm_mulhi_epu16(_mm_slli_epi16(_mm_srli_epi16(v, 11), CONV_SHIFT_5BIT), mul5);
+    }
+
+    *bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+    *ra = _mm_or_si128(r, _mm_set1_epi16((int16_t) 0xff00));
+}
+
+static void
+conv_15bpp_sse2(uint32_t *dst, const uint8_t *src, int count)
+{
+    __m128i bg;
+    __m128i ra;
+    int     i = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        sse2_expand_16bpp(_mm_loadu_si128((const __m128i *) &src[i << 1]), 15, &bg, &ra);
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *) &dst[i + 4], _mm_unpackhi_epi16(bg, ra));
+    }
+
+    conv_15bpp_c(&dst[i], &src[i << 1], count - i);
+}
+
+static void
+conv_16bpp_sse2(uint32_t *dst, const uint8_t *src, int count)
+{
+    __m128i bg;
+    __m128i ra;
+    int     i = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        sse2_expand_16bpp(_mm_loadu_si128((const __m128i *) &src[i << 1]), 16, &bg, &ra);
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *) &dst[i + 4], _mm_unpackhi_epi16(bg, ra));
+    }
+
+    conv_16bpp_c(&dst[i], &src[i << 1], count - i);
+}
+
+static void
+conv_32bpp_sse2(uint32_t *dst, const uint8_t *src, int count)
+{
+    const __m128i mask = _mm_set1_epi32(0x00ffffff);
+    int           i    = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_and_si128(_mm_loadu_si128((const __m128i *) &src[i << 2]), mask));
+        _mm_storeu_si128((__m128i *) &dst[i + 4], _mm_and_si128(_mm_loadu_si128((const __m128i *) &src[(i + 4) << 2]), mask));
+    }
+
+    conv_32bpp_c(&dst[i], &src[i << 2], count - i);
+}
+
+/* SSE2 has no byte shuffle, so 24bpp stays in C here. */
+static const svga_render_kernels_t kernels_sse2 = {
+    .name       = "SSE2",
+    .conv_15bpp = conv_15bpp_sse2,
+    .conv_16bpp = conv_16bpp_sse2,
+    .conv_24bpp = conv_24bpp_c,
+    .conv_32bpp = conv_32bpp_sse2
+};
+#endif
+
+#ifdef USE_AVX2_KERNELS
+AVX2_TARGET static inline void
+avx2_store_16bpp(uint32_t *dst, __m256i v, int bpp)
+{
+    const __m256i mask5 = _mm256_set1_epi16(0x1f);
+    const __m256i mul5  = _mm256_set1_epi16((int16_t) CONV_MUL_5BIT);
+    __m256i       b;
+    __m256i       g;
+    __m256i       r;
+    __m256i       bg;
+    __m256i       ra;
+    __m256i       lo;
+    __m256i       hi;
+
+    b = _mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_and_si256(v, mask5), CONV_SHIFT_5BIT), mul5);
+    if (bpp == 15) {
+        g = _mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(v, 5), mask5), CONV_SHIFT_5BIT), mul5);
+        r = _mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(v, 10), mask5), CONV_SHIFT_5BIT), mul5);
+    } else {
+        g = _mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(v, 5), _mm256_set1_epi16(0x3f)), CONV_SHIFT_6BIT),
+                               _mm256_set1_epi16((int16_t) CONV_MUL_6BIT));
+        r = _mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_srli_epi16(v, 11), CONV_SHIFT_5BIT), mul5);
+    }
+
+    bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+    ra = _mm256_or_si256(r, _mm256_set1_epi16((int16_t) 0xff00));
+
+    /* The unpacks work within each 128-bit lane, so put the lanes back in order. */
+    lo = _mm256_unpacklo_epi16(bg, ra);
+    hi = _mm256_unpackhi_epi16(bg, ra);
+    _mm256_storeu_si256((__m256i *) dst, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *) &dst[8], _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+AVX2_TARGET static void
+conv_15bpp_avx2(uint32_t *dst, const uint8_t *src, int count)
+{
+    int i = 0;
+
+    for (; (i + 16) <= count; i += 16)
+        avx2_store_16bpp(&dst[i], _mm256_loadu_si256((const __m256i *) &src[i << 1]), 15);
+
+    conv_15bpp_c(&dst[i], &src[i << 1], count - i);
+}
+
+AVX2_TARGET static void
+conv_16bpp_avx2(uint32_t *dst, const uint8_t *src, int count)
+{
+    int i = 0;
+
+    for (; (i + 16) <= count; i += 16)
+        avx2_store_16bpp(&dst[i], _mm256_loadu_si256((const __m256i *) &src[i << 1]), 16);
+
+    conv_16bpp_c(&dst[i], &src[i << 1], count - i);
+}
+
+AVX2_TARGET static void
+conv_24bpp_avx2(uint32_t *dst, const uint8_t *src, int count)
+{
+    const __m128i shuf = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    int           i    = 0;
+
+    /* Each 16-byte load only uses 12 bytes; stop while the over-read still
+       falls within the run. */
+    for (; (i + 10) <= count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *) &src[i * 3]);
+        __m128i b = _mm_loadu_si128((const __m128i *) &src[(i + 4) * 3]);
+
+        _mm256_storeu_si256((__m256i *) &dst[i],
+                            _mm256_set_m128i(_mm_shuffle_epi8(b, shuf), _mm_shuffle_epi8(a, shuf)));
+    }
+
+    conv_24bpp_c(&dst[i], &src[i * 3], count - i);
+}
+
+AVX2_TARGET static void
+conv_32bpp_avx2(uint32_t *dst, const uint8_t *src, int count)
+{
+    const __m256i mask = _mm256_set1_epi32(0x00ffffff);
+    int           i    = 0;
+
+    for (; (i + 16) <= count; i += 16) {
+        _mm256_storeu_si256((__m256i *) &dst[i], _mm256_and_si256(_mm256_loadu_si256((const __m256i *) &src[i << 2]), mask));
+        _mm256_storeu_si256((__m256i *) &dst[i + 8], _mm256_and_si256(_mm256_loadu_si256((const __m256i *) &src[(i + 8) << 2]), mask));
+    }
+
+    conv_32bpp_c(&dst[i], &src[i << 2], count - i);
+}
+
+static const svga_render_kernels_t kernels_avx2 = {
+    .name       = "AVX2",
+    .conv_15bpp = conv_15bpp_avx2,
+    .conv_16bpp = conv_16bpp_avx2,
+    .conv_24bpp = conv_24bpp_avx2,
+    .conv_32bpp = conv_32bpp_avx2
+};
+#endif
+
+#ifdef USE_NEON_KERNELS
+static inline uint16x8_t
+neon_mulhi(uint16x8_t v, uint16_t mul)
+{
+    uint32x4_t lo = vmull_n_u16(vget_low_u16(v), mul);
+    uint32x4_t hi = vmull_n_u16(vget_high_u16(v), mul);
+
+    return vuzp2q_u16(vreinterpretq_u16_u32(lo), vreinterpretq_u16_u32(hi));
+}
+
+static inline void
+neon_store_16bpp(uint32_t *dst, uint16x8_t v, int bpp)
+{
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    uint16x8x2_t     out;
+    uint16x8_t       b;
+    uint16x8_t       g;
+    uint16x8_t       r;
+
+    b = neon_mulhi(vshlq_n_u16(vandq_u16(v, mask5), CONV_SHIFT_5BIT), CONV_MUL_5BIT);
+    if (bpp == 15) {
+        g = neon_mulhi(vshlq_n_u16(vandq_u16(vshrq_n_u16(v, 5), mask5), CONV_SHIFT_5BIT), CONV_MUL_5BIT);
+        r = neon_mulhi(vshlq_n_u16(vandq_u16(vshrq_n_u16(v, 10), mask5), CONV_SHIFT_5BIT), CONV_MUL_5BIT);
+    } else {
+        g = neon_mulhi(vshlq_n_u16(vandq_u16(vshrq_n_u16(v, 5), vdupq_n_u16(0x3f)), CONV_SHIFT_6BIT), CONV_MUL_6BIT);
+        r = neon_mulhi(vshlq_n_u16(vshrq_n_u16(v, 11), CONV_SHIFT_5BIT), CONV_MUL_5BIT);
+    }
+
+    /* Interleaving blue|green with red|alpha gives the 32bpp pixels. */
+    out.val[0] = vorrq_u16(b, vshlq_n_u16(g, 8));
+    out.val[1] = vorrq_u16(r, vdupq_n_u16(0xff00));
+    vst2q_u16((uint16_t *) dst, out);
+}
+
+static void
+conv_15bpp_neon(uint32_t *dst, const uint8_t *src, int count)
+{
+    int i = 0;
+
+    for (; (i + 8) <= count; i += 8)
+        neon_store_16bpp(&dst[i], vld1q_u16((const uint16_t *) &src[i << 1]), 15);
+
+    conv_15bpp_c(&dst[i], &src[i << 1], count - i);
+}
+
+static void
+conv_16bpp_neon(uint32_t *dst, const uint8_t *src, int count)
+{
+    int i = 0;
+
+    for (; (i + 8) <= count; i += 8)
+        neon_store_16bpp(&dst[i], vld1q_u16((const uint16_t *) &src[i << 1]), 16);
+
+    conv_16bpp_c(&dst[i], &src[i << 1], count - i);
+}
+
+static void
+conv_24bpp_neon(uint32_t *dst, const uint8_t *src, int count)
+{
+    uint8x16x3_t in;
+    uint8x16x4_t out;
+    int          i = 0;
+
+    out.val[3] = vdupq_n_u8(0);
+    for (; (i + 16) <= count; i += 16) {
+        in         = vld3q_u8(&src[i * 3]);
+        out.val[0] = in.val[0];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[2];
+        vst4q_u8((uint8_t *) &dst[i], out);
+    }
+
+    conv_24bpp_c(&dst[i], &src[i * 3], count - i);
+}
+
+static void
+conv_32bpp_neon(uint32_t *dst, const uint8_t *src, int count)
+{
+    const uint32x4_t mask = vdupq_n_u32(0x00ffffff);
+    int              i    = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        vst1q_u32(&dst[i], vandq_u32(vld1q_u32((const uint32_t *) &src[i << 2]), mask));
+        vst1q_u32(&dst[i + 4], vandq_u32(vld1q_u32((const uint32_t *) &src[(i + 4) << 2]), mask));
+    }
+
+    conv_32bpp_c(&dst[i], &src[i << 2], count - i);
+}
+
+static const svga_render_kernels_t kernels_neon = {
+    .name       = "NEON",
+    .conv_15bpp = conv_15bpp_neon,
+    .conv_16bpp = conv_16bpp_neon,
+    .conv_24bpp = conv_24bpp_neon,
+    .conv_32bpp = conv_32bpp_neon
+};
+#endif
+
+const svga_render_kernels_t *svga_render_kernels = &kernels_c;
+
+void
+svga_render_kernels_init(void)
+{
+    static int inited = 0;
+
+    if (inited)
+        return;
+    inited = 1;
+
+#if defined USE_NEON_KERNELS
+    svga_render_kernels = &kernels_neon;
+#else
+#    ifdef USE_SSE2_KERNELS
+    svga_render_kernels = &kernels_sse2;
+#    endif
+#    ifdef USE_AVX2_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        svga_render_kernels = &kernels_avx2;
+#    endif
+#endif
+
+    svga_render_simd_log("SVGA: using %s pixel conversion kernels\n", svga_render_kernels->name);
+}
+
+#define BENCH_WIDTH  1920
+#define BENCH_ROUNDS 2000
+
+static void
+svga_render_benchmark_one(const char *mode, svga_conv_func_t ref, svga_conv_func_t conv, const char *name,
+                          const uint8_t *src, uint32_t *dst_ref, uint32_t *dst)
+{
+    uint64_t start;
+    uint64_t ns_ref;
+    uint64_t ns;
+
+    start = plat_get_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        ref(dst_ref, src, BENCH_WIDTH);
+    ns_ref = plat_get_ns() - start;
+
+    start = plat_get_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        conv(dst, src, BENCH_WIDTH);
+    ns = plat_get_ns() - start;
+
+    pclog("  %-5s C: %6.2f px/ns, %-4s: %6.2f px/ns%s\n", mode,
+          ((double) BENCH_WIDTH * BENCH_ROUNDS) / (double) (ns_ref ? ns_ref : 1), name,
+          ((double) BENCH_WIDTH * BENCH_ROUNDS) / (double) (ns ? ns : 1),
+          memcmp(dst_ref, dst, BENCH_WIDTH * sizeof(uint32_t)) ? " (MISMATCH)" : "");
+}
+
+/* Feed a line of synthetic VRAM through each conversion, with both the C
+   and the selected kernels, and log the throughput. */
+void
+svga_render_benchmark(void)
+{
+    const svga_render_kernels_t *k = svga_render_kernels;
+    uint8_t                     *src;
+    uint32_t                    *dst_ref;
+    uint32_t                    *dst;
+    uint32_t                     seed = 0x12345678;
+
+    src     = (uint8_t *) malloc(BENCH_WIDTH * 4);
+    dst_ref = (uint32_t *) malloc(BENCH_WIDTH * sizeof(uint32_t));
+    dst     = (uint32_t *) malloc(BENCH_WIDTH * sizeof(uint32_t));
+    if ((src == NULL) || (dst_ref == NULL) || (dst == NULL) || (video_15to32 == NULL)) {
+        free(src);
+        free(dst_ref);
+        free(dst);
+        return;
+    }
+
+    for (int i = 0; i < (BENCH_WIDTH * 4); i++) {
+        seed   = (seed * 1103515245) + 12345;
+        src[i] = seed >> 16;
+    }
+
+    pclog("SVGA pixel conversion, %d pixels x %d rounds:\n", BENCH_WIDTH, BENCH_ROUNDS);
+    svga_render_benchmark_one("15bpp", kernels_c.conv_15bpp, k->conv_15bpp, k->name, src, dst_ref, dst);
+    svga_render_benchmark_one("16bpp", kernels_c.conv_16bpp, k->conv_16bpp, k->name, src, dst_ref, dst);
+    svga_render_benchmark_one("24bpp", kernels_c.conv_24bpp, k->conv_24bpp, k->name, src, dst_ref, dst);
+    svga_render_benchmark_one("32bpp", kernels_c.conv_32bpp, k->conv_32bpp, k->name, src, dst_ref, dst);
+
+    free(src);
+    free(dst_ref);
+    free(dst);
+}
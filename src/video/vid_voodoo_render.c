@@ -655,10 +655,42 @@ voodoo_tmu_fetch_and_blend(voodoo_t *voodoo, voodoo_params_t *params, voodoo_sta
 
 #if (defined __amd64__ || defined _M_X64)
 #    include <86box/vid_voodoo_codegen_x86-64.h>
+#elif (defined __aarch64__ || defined _M_ARM64)
+#    include <86box/vid_voodoo_codegen_arm64.h>
 #else
 int voodoo_recomp = 0;
 #endif
 
+/* Scanlines are dealt out to the render threads round-robin (after
+   removing the SLI interleave), which keeps the load even at any thread
+   count without needing to order writes between threads. */
+static __inline int
+voodoo_render_line_owned(voodoo_t *voodoo, int real_y, int odd_even)
+{
+    if (voodoo->render_threads == 1)
+        return 1;
+    if (SLI_ENABLED)
+        real_y >>= 1;
+
+    return ((unsigned int) real_y % (unsigned int) voodoo->render_threads) == (unsigned int) odd_even;
+}
+
+/* Small triangles often cover no scanlines owned by a given thread once
+   there are many threads; let those skip the span setup entirely. */
+static int
+voodoo_render_span_owned(voodoo_t *voodoo, voodoo_params_t *params, int y, int yend, int y_diff, int y_origin, int odd_even)
+{
+    if ((yend - y) >= (voodoo->render_threads * y_diff))
+        return 1;
+
+    for (; y < yend; y += y_diff) {
+        if (voodoo_render_line_owned(voodoo, (params->fbzMode & (1 << 17)) ? (y_origin - y) : y, odd_even))
+            return 1;
+    }
+
+    return 0;
+}
+
 static void
 voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
 {
@@ -779,6 +811,9 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
             state->xend += state->dx2;
         }
     }
+    if (!voodoo_render_span_owned(voodoo, params, state->y, yend, y_diff, y_origin, odd_even))
+        goto skip_span;
+
 #ifndef NO_CODEGEN
     if (voodoo->use_recompiler)
         voodoo_draw = voodoo_get_block(voodoo, params, state, odd_even);
@@ -825,13 +860,8 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         else
             real_y >>= 4;
 
-        if (SLI_ENABLED) {
-            if (((real_y >> 1) & voodoo->odd_even_mask) != odd_even)
-                goto next_line;
-        } else {
-            if ((real_y & voodoo->odd_even_mask) != odd_even)
-                goto next_line;
-        }
+        if (!voodoo_render_line_owned(voodoo, real_y, odd_even))
+            goto next_line;
 
         start_x = x;
 
@@ -932,7 +962,7 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         state->x           = x;
         state->x2          = x2;
 #ifndef NO_CODEGEN
-        if (voodoo->use_recompiler) {
+        if (voodoo_draw) {
             voodoo_draw(state, params, x, real_y);
         } else
 #endif
@@ -1389,6 +1419,7 @@ next_line:
         state->xend += state->dx2;
     }
 
+skip_span:
     voodoo->texture_cache[0][params->tex_entry[0]].refcount_r[odd_even]++;
     voodoo->texture_cache[1][params->tex_entry[1]].refcount_r[odd_even]++;
 }
@@ -1544,10 +1575,12 @@ voodoo_render_log("voodoo_triangle %i %i %i : vA %f, %f  vB %f, %f  vC %f, %f f
     voodoo_half_triangle(voodoo, params, &state, vertexAy_adjusted, vertexCy_adjusted, odd_even);
 }
 
-static void
-render_thread(void *param, int odd_even)
+void
+voodoo_render_thread(void *param)
 {
-    voodoo_t *voodoo = (voodoo_t *) param;
+    struct voodoo_render_param_t *render_param = (struct voodoo_render_param_t *) param;
+    voodoo_t                     *voodoo       = render_param->voodoo;
+    int                           odd_even     = render_param->odd_even;
 
     while (voodoo->render_thread_run[odd_even]) {
         thread_set_event(voodoo->render_not_full_event[odd_even]);
@@ -1556,7 +1589,7 @@ render_thread(void *param, int odd_even)
         voodoo->render_voodoo_busy[odd_even] = 1;
 
         while (!PARAM_EMPTY(odd_even)) {
-            uint64_t         start_time = plat_timer_read();
+            uint64_t         start_time = plat_get_ns();
             uint64_t         end_time;
             voodoo_params_t *params = &voodoo->params_buffer[voodoo->params_read_idx[odd_even] & PARAM_MASK];
 
@@ -1567,7 +1600,7 @@ render_thread(void *param, int odd_even)
             if (PARAM_ENTRIES(odd_even) > (PARAM_SIZE - 10))
                 thread_set_event(voodoo->render_not_full_event[odd_even]);
 
-            end_time = plat_timer_read();
+            end_time = plat_get_ns();
             voodoo->render_time[odd_even] += end_time - start_time;
         }
 
@@ -1575,48 +1608,109 @@ render_thread(void *param, int odd_even)
     }
 }
 
+/* Cards with render threads running, for the benchmark report; an SLI
+   pair shows up as two of them. */
+#define VOODOO_PROF_CARDS 4
+
+static voodoo_t *voodoo_prof_cards[VOODOO_PROF_CARDS];
+
 void
-voodoo_render_thread_1(void *param)
+voodoo_render_prof_reset(void)
 {
-    render_thread(param, 0);
+    for (int i = 0; i < VOODOO_PROF_CARDS; i++) {
+        voodoo_t *voodoo = voodoo_prof_cards[i];
+
+        if (voodoo == NULL)
+            continue;
+
+        for (int c = 0; c < voodoo->render_threads; c++) {
+            voodoo->render_time[c] = 0;
+            voodoo->pixel_count[c] = 0;
+        }
+    }
 }
+
 void
-voodoo_render_thread_2(void *param)
+voodoo_render_prof_foreach(void (*func)(int threads, const uint64_t *busy_ns, const int *pixels, void *priv), void *priv)
 {
-    render_thread(param, 1);
+    for (int i = 0; i < VOODOO_PROF_CARDS; i++) {
+        if (voodoo_prof_cards[i] != NULL)
+            func(voodoo_prof_cards[i]->render_threads, voodoo_prof_cards[i]->render_time, voodoo_prof_cards[i]->pixel_count, priv);
+    }
 }
+
 void
-voodoo_render_thread_3(void *param)
+voodoo_render_threads_start(voodoo_t *voodoo)
 {
-    render_thread(param, 2);
+    if (voodoo->render_threads < 1)
+        voodoo->render_threads = 1;
+    else if (voodoo->render_threads > VOODOO_MAX_RENDER_THREADS)
+        voodoo->render_threads = VOODOO_MAX_RENDER_THREADS;
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_param[c].voodoo   = voodoo;
+        voodoo->render_param[c].odd_even = c;
+        voodoo->wake_render_thread[c]    = thread_create_event();
+        voodoo->render_not_full_event[c] = thread_create_event();
+    }
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 1;
+        voodoo->render_thread[c]     = thread_create(voodoo_render_thread, &voodoo->render_param[c]);
+    }
+
+    for (int i = 0; i < VOODOO_PROF_CARDS; i++) {
+        if (voodoo_prof_cards[i] == NULL) {
+            voodoo_prof_cards[i] = voodoo;
+            break;
+        }
+    }
 }
+
 void
-voodoo_render_thread_4(void *param)
+voodoo_render_threads_stop(voodoo_t *voodoo)
 {
-    render_thread(param, 3);
+    for (int i = 0; i < VOODOO_PROF_CARDS; i++) {
+        if (voodoo_prof_cards[i] == voodoo)
+            voodoo_prof_cards[i] = NULL;
+    }
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 0;
+        thread_set_event(voodoo->wake_render_thread[c]);
+        thread_wait(voodoo->render_thread[c]);
+    }
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        thread_destroy_event(voodoo->wake_render_thread[c]);
+        thread_destroy_event(voodoo->render_not_full_event[c]);
+    }
+}
+
+static int
+voodoo_params_full(voodoo_t *voodoo)
+{
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (PARAM_FULL(c))
+            return 1;
+    }
+
+    return 0;
 }
 
 void
 voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
     voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
-
-    while (PARAM_FULL(0) || (voodoo->render_threads >= 2 && PARAM_FULL(1)) || (voodoo->render_threads == 4 && (PARAM_FULL(2) || PARAM_FULL(3)))) {
-        thread_reset_event(voodoo->render_not_full_event[0]);
-        if (voodoo->render_threads >= 2)
-            thread_reset_event(voodoo->render_not_full_event[1]);
-        if (voodoo->render_threads == 4) {
-            thread_reset_event(voodoo->render_not_full_event[2]);
-            thread_reset_event(voodoo->render_not_full_event[3]);
+    int              wake       = 0;
+
+    while (voodoo_params_full(voodoo)) {
+        for (int c = 0; c < voodoo->render_threads; c++)
+            thread_reset_event(voodoo->render_not_full_event[c]);
+        for (int c = 0; c < voodoo->render_threads; c++) {
+            if (PARAM_FULL(c))
+                thread_wait_event(voodoo->render_not_full_event[c], -1); /*Wait for room in ringbuffer*/
         }
-        if (PARAM_FULL(0))
-            thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads >= 2 && PARAM_FULL(1))
-            thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(2))
-            thread_wait_event(voodoo->render_not_full_event[2], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(3))
-            thread_wait_event(voodoo->render_not_full_event[3], -1); /*Wait for room in ringbuffer*/
     }
 
     voodoo_use_texture(voodoo, params, 0);
@@ -1627,6 +1721,10 @@ voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 
     voodoo->params_write_idx++;
 
-    if (PARAM_ENTRIES(0) < 4 || (voodoo->render_threads >= 2 && PARAM_ENTRIES(1) < 4) || (voodoo->render_threads == 4 && (PARAM_ENTRIES(2) < 4 || PARAM_ENTRIES(3) < 4)))
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (PARAM_ENTRIES(c) < 4)
+            wake = 1;
+    }
+    if (wake)
         voodoo_wake_render_thread(voodoo);
 }
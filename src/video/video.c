@@ -232,8 +232,16 @@ const uint32_t shade[5][256] = {
     }
 };
 
+#define TURBO_BLIT_FPS 60
+
 typedef struct blit_data_struct {
     int x, y, w, h;
+    int dirty_top, dirty_bottom;
+    int next_dirty_top, next_dirty_bottom;
+    int next_dirty_valid;
+    int skip_top, skip_bottom;
+    int skipped;
+    uint32_t last_blit;
     int busy;
     int buffer_in_use;
     int thread_run;
@@ -458,22 +466,97 @@ blit_thread(void *param)
     }
 }
 
+/* Report which rows [top, bottom) of the target buffer were redrawn since
+   the previous blit; applies to the next video_blit_memtoscreen_monitor()
+   call only. Cards that never call this get the whole blit area marked as
+   changed, so only renderers that track their redrawn lines need to. */
+void
+video_blit_set_dirty_monitor(int top, int bottom, int monitor_index)
+{
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    blit_data_ptr->next_dirty_top    = top;
+    blit_data_ptr->next_dirty_bottom = bottom;
+    blit_data_ptr->next_dirty_valid  = 1;
+}
+
+/* Called from blit_func: returns the rows [top, bottom) of the current blit
+   that changed since the previous one, clipped to the blit area, and
+   whether there are any. */
+int
+video_blit_get_dirty_monitor(int *top, int *bottom, int monitor_index)
+{
+    const blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    *top    = blit_data_ptr->dirty_top;
+    *bottom = blit_data_ptr->dirty_bottom;
+
+    return (*bottom > *top);
+}
+
 void
 video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
 {
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    int          top           = y;
+    int          bottom        = y + h;
+
     MTR_BEGIN("video", "video_blit_memtoscreen");
 
+    if (blit_data_ptr->next_dirty_valid) {
+        top    = MAX(y, blit_data_ptr->next_dirty_top);
+        bottom = MIN(y + h, blit_data_ptr->next_dirty_bottom);
+        if (bottom < top)
+            bottom = top;
+        blit_data_ptr->next_dirty_valid = 0;
+    }
+
     if ((w <= 0) || (h <= 0))
         return;
 
+    /* Running unthrottled, the guest produces frames far faster than
+       they can be shown; present at most TURBO_BLIT_FPS of them and fold
+       the rows changed by the skipped ones into the next that is. */
+    if (turbo_mode) {
+        uint32_t now = plat_get_ticks();
+
+        if ((now - blit_data_ptr->last_blit) < (1000 / TURBO_BLIT_FPS)) {
+            if (!blit_data_ptr->skipped || (blit_data_ptr->skip_bottom <= blit_data_ptr->skip_top)) {
+                blit_data_ptr->skip_top    = top;
+                blit_data_ptr->skip_bottom = bottom;
+            } else if (bottom > top) {
+                blit_data_ptr->skip_top    = MIN(top, blit_data_ptr->skip_top);
+                blit_data_ptr->skip_bottom = MAX(bottom, blit_data_ptr->skip_bottom);
+            }
+            blit_data_ptr->skipped = 1;
+            MTR_END("video", "video_blit_memtoscreen");
+            return;
+        }
+        blit_data_ptr->last_blit = now;
+    }
+
+    if (blit_data_ptr->skipped) {
+        if (blit_data_ptr->skip_bottom > blit_data_ptr->skip_top) {
+            top    = (bottom > top) ? MIN(top, blit_data_ptr->skip_top) : blit_data_ptr->skip_top;
+            bottom = MAX(bottom, blit_data_ptr->skip_bottom);
+            top    = MAX(y, top);
+            bottom = MIN(y + h, bottom);
+            if (bottom < top)
+                bottom = top;
+        }
+        blit_data_ptr->skipped = 0;
+    }
+
     video_wait_for_blit_monitor(monitor_index);
 
-    monitors[monitor_index].mon_blit_data_ptr->busy          = 1;
-    monitors[monitor_index].mon_blit_data_ptr->buffer_in_use = 1;
-    monitors[monitor_index].mon_blit_data_ptr->x             = x;
-    monitors[monitor_index].mon_blit_data_ptr->y             = y;
-    monitors[monitor_index].mon_blit_data_ptr->w             = w;
-    monitors[monitor_index].mon_blit_data_ptr->h             = h;
+    blit_data_ptr->busy          = 1;
+    blit_data_ptr->buffer_in_use = 1;
+    blit_data_ptr->x             = x;
+    blit_data_ptr->y             = y;
+    blit_data_ptr->w             = w;
+    blit_data_ptr->h             = h;
+    blit_data_ptr->dirty_top     = top;
+    blit_data_ptr->dirty_bottom  = bottom;
     monitors[monitor_index].mon_renderedframes++;
 
     thread_set_event(monitors[monitor_index].mon_blit_data_ptr->wake_blit_thread);
@@ -40,6 +40,11 @@ static int              clients;
 static int              updatingSize;
 static int              allowedX;
 static int              allowedY;
+static int              blit_x;
+static int              blit_y;
+static int              blit_w;
+static int              blit_h;
+static int              full_update;
 static int              ptr_x;
 static int              ptr_y;
 static int              ptr_but;
@@ -166,20 +171,39 @@ vnc_display(rfbClientPtr cl)
     } else if (updatingSize && !cl->newFBSizePending) {
         updatingSize = 0;
 
-        allowedX = rfb->width;
-        allowedY = rfb->height;
+        allowedX    = rfb->width;
+        allowedY    = rfb->height;
+        full_update = 1;
     }
 }
 
 static void
 vnc_blit(int x, int y, int w, int h, int monitor_index)
 {
+    int top;
+    int bottom;
+
     if (monitor_index || (x < 0) || (y < 0) || (w < VNC_MIN_X) || (h < VNC_MIN_Y) || (w > VNC_MAX_X) || (h > VNC_MAX_Y) || (buffer32 == NULL)) {
         video_blit_complete_monitor(monitor_index);
         return;
     }
 
-    for (int row = 0; row < h; ++row)
+    if ((x != blit_x) || (y != blit_y) || (w != blit_w) || (h != blit_h)) {
+        blit_x      = x;
+        blit_y      = y;
+        blit_w      = w;
+        blit_h      = h;
+        full_update = 1;
+    }
+
+    /* Only copy and send the lines the video card reports as redrawn. */
+    if (full_update) {
+        top    = y;
+        bottom = y + h;
+    } else
+        video_blit_get_dirty_monitor(&top, &bottom, monitor_index);
+
+    for (int row = top - y; row < (bottom - y); ++row)
         video_copy(&(((uint8_t *) rfb->frameBuffer)[row * 2048 * sizeof(uint32_t)]), &(buffer32->line[y + row][x]), w * sizeof(uint32_t));
 
     if (screenshots)
@@ -187,8 +211,13 @@ vnc_blit(int x, int y, int w, int h, int monitor_index)
 
     video_blit_complete_monitor(monitor_index);
 
-    if (!updatingSize)
-        rfbMarkRectAsModified(rfb, 0, 0, allowedX, allowedY);
+    if (!updatingSize) {
+        if (full_update) {
+            rfbMarkRectAsModified(rfb, 0, 0, allowedX, allowedY);
+            full_update = 0;
+        } else if ((bottom > top) && ((top - y) < allowedY))
+            rfbMarkRectAsModified(rfb, 0, top - y, allowedX, MIN(bottom - y, allowedY));
+    }
 }
 
 /* Initialize VNC for operation. */
@@ -239,6 +268,7 @@ vnc_init(UNUSED(void *arg))
     }
 
     /* Set up our BLIT handlers. */
+    full_update = 1;
     video_setblit(vnc_blit);
 
     clients = 0;
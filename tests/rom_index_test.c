@@ -0,0 +1,234 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Tests for the ROM file index: a ROM path that doesn't exist
+ *          yet must not leave a stale index behind once it is created,
+ *          neither in the running instance nor in the next one.
+ *
+ * Authors: The 86Box developers.
+ *
+ *          Copyright 2025 The 86Box developers.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/rom.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+
+/* What rom.c needs from the rest of the emulator. */
+rom_path_t    rom_paths = { "", NULL };
+mem_mapping_t bios_mapping;
+mem_mapping_t bios_high_mapping;
+uint32_t      biosaddr;
+uint32_t      biosmask;
+int           bios_only;
+uint8_t      *rom;
+CPU          *cpu_s;
+cpu_family_t *cpu_f;
+
+static char     data_dir[1024];
+static uint32_t ticks;
+
+void
+pclog(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void
+fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+void
+mem_mapping_add(UNUSED(mem_mapping_t *map), UNUSED(uint32_t base), UNUSED(uint32_t size),
+                UNUSED(uint8_t (*read_b)(uint32_t addr, void *priv)),
+                UNUSED(uint16_t (*read_w)(uint32_t addr, void *priv)),
+                UNUSED(uint32_t (*read_l)(uint32_t addr, void *priv)),
+                UNUSED(void (*write_b)(uint32_t addr, uint8_t val, void *priv)),
+                UNUSED(void (*write_w)(uint32_t addr, uint16_t val, void *priv)),
+                UNUSED(void (*write_l)(uint32_t addr, uint32_t val, void *priv)),
+                UNUSED(uint8_t *exec), UNUSED(uint32_t flags), UNUSED(void *priv))
+{
+}
+
+void
+mem_set_access(UNUSED(uint8_t bitmap), UNUSED(int mode), UNUSED(uint32_t base), UNUSED(uint32_t size), UNUSED(uint16_t access))
+{
+}
+
+int
+path_abs(char *path)
+{
+    return path[0] == '/';
+}
+
+void
+path_slash(char *path)
+{
+    if (path[strlen(path) - 1] != '/')
+        strcat(path, "/");
+}
+
+void
+path_append_filename(char *dest, const char *s1, const char *s2)
+{
+    strcpy(dest, s1);
+    path_slash(dest);
+    strcat(dest, s2);
+}
+
+int
+plat_getcwd(char *bufp, int max)
+{
+    return getcwd(bufp, max) == NULL;
+}
+
+int
+plat_dir_check(char *path)
+{
+    struct stat st;
+
+    return (stat(path, &st) == 0) && S_ISDIR(st.st_mode);
+}
+
+int
+plat_file_check(const char *path)
+{
+    struct stat st;
+
+    return (stat(path, &st) == 0) && !S_ISDIR(st.st_mode);
+}
+
+FILE *
+plat_fopen(const char *path, const char *mode)
+{
+    return fopen(path, mode);
+}
+
+void
+plat_get_global_data_dir(char *outbuf, size_t len)
+{
+    snprintf(outbuf, len, "%s", data_dir);
+}
+
+void
+plat_tempfile(char *bufp, UNUSED(char *prefix), char *suffix)
+{
+    sprintf(bufp, "%i%s", (int) getpid(), suffix);
+}
+
+uint32_t
+plat_get_ticks(void)
+{
+    return ticks;
+}
+
+mutex_t *
+thread_create_mutex(void)
+{
+    return (mutex_t *) &ticks;
+}
+
+int
+thread_wait_mutex(UNUSED(mutex_t *mutex))
+{
+    return 1;
+}
+
+int
+thread_release_mutex(UNUSED(mutex_t *mutex))
+{
+    return 1;
+}
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            printf("%s:%i: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                                      \
+        }                                                                  \
+    } while (0)
+
+/* Runs in a child process, to get a fresh index as a restart would. */
+static int
+restart_present(const char *base, const char *fn)
+{
+    pid_t pid = fork();
+    int   status;
+
+    if (pid == 0) {
+        rom_add_path(base);
+        exit(rom_present(fn) ? 0 : 1);
+    }
+
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+int
+main(void)
+{
+    char  tmpl[] = "/tmp/86box-rom-index-XXXXXX";
+    char  roms[1024];
+    char  fn[2048];
+    char *base = mkdtemp(tmpl);
+    FILE *fp;
+
+    CHECK(base != NULL);
+    snprintf(data_dir, sizeof(data_dir), "%s/", base);
+    snprintf(roms, sizeof(roms), "%s/roms/", base);
+
+    /* The first run has no ROM directory at all, and saves its index. */
+    rom_add_path(roms);
+    CHECK(!rom_present("roms/machines/test/bios.bin"));
+    CHECK(!restart_present(roms, "roms/machines/test/bios.bin"));
+
+    /* The directory shows up and gets a ROM. */
+    CHECK(mkdir(roms, 0755) == 0);
+    snprintf(fn, sizeof(fn), "%smachines", roms);
+    CHECK(mkdir(fn, 0755) == 0);
+    strcat(fn, "/test");
+    CHECK(mkdir(fn, 0755) == 0);
+    strcat(fn, "/bios.bin");
+    CHECK((fp = fopen(fn, "wb")) != NULL);
+    fclose(fp);
+
+    /* The next run must not trust the saved index... */
+    CHECK(restart_present(roms, "roms/machines/test/bios.bin"));
+
+    /* ...and the running one has to notice on its next check. */
+    ticks += 1000;
+    CHECK(rom_present("roms/machines/test/bios.bin"));
+    CHECK(rom_present("roms/machines/test/"));
+    CHECK(!rom_present("roms/machines/test/other.bin"));
+
+    printf("rom_index_test: passed\n");
+    return 0;
+}